@@ -0,0 +1,63 @@
+/*
+ * Lexing throughput over a synthetic script much bigger than the caches,
+ * made of lines like the ones people write.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../inc/ptr.h"
+#include "../inc/str.h"
+#include "../inc/lexer.h"
+
+#define SRC_BYTES (32 * 1024 * 1024)
+#define ROUNDS 4
+
+static const char *lines[] = {
+        "val total_count = items.length() + 42\n",
+        "var x = 0x1F & 0b1010 | (y << 3)\n",
+        "if x >= 10 and not done then return fib(x - 1) + fib(x - 2) else x\n",
+        "for i in 1 .. 100 step 2 { total = total + i * 3.25 }\n",
+        "val greeting = \"hello, world\" // say hi\n",
+        "    while queue.length() > 0 { node = queue.removeFirst() }\n",
+        "val d = dict { 'a' => 1, 'b' => 2 }\n",
+        "\n",
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+    char *src = malloc(SRC_BYTES);
+    size_t n = 0;
+    for (int i = 0;; i++) {
+        const char *line = lines[i % (sizeof(lines) / sizeof(lines[0]))];
+        size_t len = c_str_len(line);
+        if (n + len > SRC_BYTES) break;
+        mem_cp(src + n, (void *) line, len);
+        n += len;
+    }
+
+    size_t tokens = 0;
+    double start = now();
+    for (int i = 0; i < ROUNDS; i++) {
+        lexer_t lexer;
+        lexer_init(&lexer, src, (uint32_t) n);
+        while (lexer.token.tag != TAG_EOF) {
+            advance(&lexer);
+            tokens++;
+        }
+        if (lexer.err != ERR_NO_ERROR) {
+            printf("Lex error at %u\n", lexer.err_pos);
+            return 1;
+        }
+    }
+    double secs = now() - start;
+
+    printf("%-12s %8.2f MB/s  %8.2f Mtokens/s\n", "lexer",
+           (double) n * ROUNDS / 1e6 / secs, (double) tokens / 1e6 / secs);
+    free(src);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Throughput of the ptr.c primitives against the byte loops they replaced,
+ * on buffers much bigger than the caches.
+ */
+#include <stdio.h>
+#include <time.h>
+#include "../inc/ptr.h"
+
+#define BUF_BYTES (32 * 1024 * 1024)
+#define ROUNDS 8
+
+static unsigned char a[BUF_BYTES];
+static unsigned char b[BUF_BYTES];
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double start) {
+    double secs = now() - start;
+    double gb = (double) BUF_BYTES * ROUNDS / 1e9;
+    printf("%-12s %8.2f GB/s\n", name, gb / secs);
+}
+
+static void byte_set(unsigned char *p, int val, size_t len) {
+    while (len-- > 0) *p++ = (unsigned char) val;
+}
+
+static void byte_cp(unsigned char *dst, const unsigned char *src, size_t size) {
+    while (size-- > 0) *dst++ = *src++;
+}
+
+static boolean byte_eq(const unsigned char *p1, const unsigned char *p2, size_t size) {
+    while (size-- > 0) {
+        if (*p1++ != *p2++) return False;
+    }
+    return True;
+}
+
+static const unsigned char *byte_chr(const unsigned char *p, int val, size_t size) {
+    while (size-- > 0) {
+        if (*p == val) return p;
+        p++;
+    }
+    return NULL;
+}
+
+int main(void) {
+    double start;
+    // Keep results live so the loops aren't optimized away.
+    size_t sink = 0;
+
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) byte_set(a, i, BUF_BYTES);
+    report("byte set", start);
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) mem_set(a, i, BUF_BYTES);
+    report("mem_set", start);
+
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) byte_cp(b, a, BUF_BYTES);
+    report("byte copy", start);
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) mem_cp(b, a, BUF_BYTES);
+    report("mem_cp", start);
+
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) sink += byte_eq(a, b, BUF_BYTES);
+    report("byte eq", start);
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) sink += mem_eq(a, b, BUF_BYTES);
+    report("mem_eq", start);
+
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) sink += (size_t) byte_chr(a, 0xff, BUF_BYTES);
+    report("byte search", start);
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) sink += (size_t) mem_chr(a, 0xff, BUF_BYTES);
+    report("mem_chr", start);
+
+    return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <stddef.h>
+#include "def.h"
+
+/*
+ * An arena hands out memory by bumping a pointer through chunks it gets
+ * from the system, off the GC heap. Nothing in it is freed on its own;
+ * it all goes back at once in arena_free().
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *prev;
+    size_t used;
+    size_t size;
+    unsigned char data[];
+} arena_chunk_t;
+
+typedef struct Arena {
+    arena_chunk_t *chunk;  // The one being filled. Older chunks hang off it.
+    size_t bytes;  // Handed out so far.
+} arena_t;
+
+void arena_init(arena_t *arena);
+
+/* Return size bytes from the arena, or null if the system has no more. */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/* Give all of the arena's chunks back. The arena can be used again. */
+void arena_free(arena_t *arena);
+
+#endif
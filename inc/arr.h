@@ -11,6 +11,9 @@
  */
 obj_t *arr_hash(obj_t *obj, obj_varargs_t *args);
 
+/* The FNV-1a hash of the array's contents, unboxed. */
+uint32_t bytearray_hash(bytearray_t *a);
+
 obj_t *arr_copy(obj_t *obj, obj_varargs_t *args);
 
 /* Return the number of elements in the array object.  */
@@ -19,6 +22,9 @@ obj_t *arr_size(obj_t *obj, obj_varargs_t *args);
 /* Get the object in the array at the offset given by the first arg. */
 obj_t *arr_get(obj_t *obj, obj_varargs_t *args);
 
+/* Get the byte at offset i, or Nil if there isn't one. */
+obj_t *arr_get_at(obj_t *obj, int i);
+
 /* Set array offset given by first arg to byte in second arg. */
 obj_t *arr_set(obj_t *obj, obj_varargs_t *args);
 
@@ -31,6 +37,9 @@ obj_t *arr_eq(obj_t *obj, obj_varargs_t *args);
 /* Return true if the arrays are element-wise not equal. */
 obj_t *arr_ne(obj_t *obj, obj_varargs_t *args);
 
+/* Sort the bytes in place and return the array. */
+obj_t *arr_sort(obj_t *obj, obj_varargs_t *args);
+
 /* Return the array slice as a new array. */
 obj_t *arr_slice(obj_t *obj, obj_varargs_t *args);
 
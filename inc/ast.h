@@ -3,6 +3,7 @@
 
 #include <inttypes.h>
 #include "def.h"
+#include "arena.h"
 
 typedef uint8_t ast_reserved_callable_type_t;
 
@@ -19,10 +20,25 @@ typedef struct AstUnaryArg {
     ast_expr_t *a;
 } ast_unary_arg_t;
 
+/*
+ * What a binop has had for operands so far. Eval takes a shortcut for
+ * the first kind it sees, and the long way for good once another turns
+ * up.
+ */
+typedef enum {
+    SEEN_NOTHING = 0,
+    SEEN_INTS,
+    SEEN_FLOATS,
+    SEEN_BYTEARRAY_INT,
+    SEEN_MIXED,
+} ast_seen_t;
+
 typedef struct AstOpArgs {
     gc_header_t hdr;
     ast_expr_t *a;
     ast_expr_t *b;
+    uint8_t seen;  // An ast_seen_t.
+    type_t spec;  // TYPE_INT or TYPE_FLOAT if the operands are declared as that. See specialize().
 } ast_op_args_t;
 
 typedef struct AstRangeArgs {
@@ -84,6 +100,7 @@ typedef struct AstTypedExpr {
     gc_header_t hdr;
     ast_expr_t *expr;
     bytearray_t *type_name;
+    type_t type;
 } ast_typed_expr_t;
 
 typedef struct AstReservedCallable {
@@ -111,10 +128,70 @@ typedef struct AstForLoop {
     ast_expr_t *pred;
 } ast_for_loop_t;
 
+enum match_arm_kind {
+    MATCH_LITERAL,  // An Int, Byte, String or Boolean, found through the tables.
+    MATCH_VALUE,  // Any other expr, evaluated and compared in turn.
+    MATCH_GUARD,  // if cond, evaluated in turn.
+    MATCH_ELSE,
+};
+
+typedef struct AstMatchArm {
+    gc_header_t hdr;
+    ast_expr_t *pattern;  // The cond of a guard. Null for else.
+    ast_expr_t *expr;
+    struct AstMatchArm *next;
+    uint8_t kind;
+} ast_match_arm_t;
+
+typedef struct MatchKey {
+    int key;
+    int arm;
+} match_key_t;
+
+/*
+ * The Int or Byte literal arms, by key, sorted for a binary search. If the
+ * keys are dense enough there's a jump table too, from key - min to arm.
+ */
+typedef struct MatchTable {
+    uint32_t n;
+    match_key_t *keys;
+    int min;
+    uint32_t span;  // 0 if there's no jump table.
+    int *jump;  // -1 where no arm has the key.
+} match_table_t;
+
+typedef struct MatchStrSlot {
+    bytearray_t *key;  // Null if the slot is empty.
+    uint32_t hash;
+    int arm;
+} match_str_slot_t;
+
+/*
+ * A match with its literal arms compiled into tables when it's parsed. The
+ * tables are in the code's arena with the rest of it. Arms are numbered in
+ * order, and the first that matches wins; a literal's arm only if no guard
+ * or value arm before it matches first.
+ */
+typedef struct AstMatch {
+    gc_header_t hdr;
+    ast_expr_t *subject;
+    ast_match_arm_t *arm_list;
+    ast_match_arm_t **arms;
+    int narms;
+    int first_guard;  // The first arm that isn't a literal, or narms.
+    match_table_t ints;
+    match_table_t bytes;
+    uint32_t nstrs;  // A power of two, or 0.
+    match_str_slot_t *strs;
+    int on_true;  // -1 if no arm is for true.
+    int on_false;
+} ast_match_t;
+
 typedef struct AstFnArgDecl {
     gc_header_t hdr;
     bytearray_t *name;
     struct AstFnArgDecl *next;
+    type_t type;  // TYPE_UNKNOWN if the arg wasn't given one.
 } ast_fn_arg_decl_t;
 
 typedef struct AstFunc {
@@ -159,6 +236,7 @@ typedef struct AstGet {
     gc_header_t hdr;
     ast_expr_t *receiver;
     bytearray_t *name;
+    int slot;  // Where the field was found last time, or -1. See record_slot().
 } ast_field_t;
 
 typedef struct AstExpr {
@@ -180,6 +258,7 @@ typedef struct AstExpr {
         ast_do_while_loop_t *do_while_loop;
         ast_while_loop_t *while_loop;
         ast_for_loop_t *for_loop;
+        ast_match_t *match;
         ast_array_decl_t *array_decl;
         ast_assign_elem_t *assign_elem;
         ast_method_t *method_call;
@@ -196,6 +275,45 @@ typedef struct AstExpr {
     };
 } ast_expr_t;
 
+/*
+ * A parsed program's nodes, and the strings in them, go in an arena of
+ * their own instead of on the GC heap; its names are interned. The parser
+ * holds the code for whoever asked for it until they're done running it,
+ * and each call of a function made from it holds it while it runs. Once
+ * nothing holds it, it's freed: right away if no function was made from
+ * it, or else when the GC can't find any of those functions. Code loaded
+ * from a compiled image lives in the image's mapping instead.
+ */
+typedef struct AstCode {
+    arena_t arena;
+    void *image;  // The mapped image the code was loaded from, or null.
+    size_t image_size;
+    uint32_t holds;
+    uint32_t fns;  // Function objs made from the code, alive or not.
+    boolean reached;  // The GC found one of them.
+    struct AstCode *prev;
+    struct AstCode *next;
+} ast_code_t;
+
+/* New code, with one hold on it, or null if there's no memory. */
+ast_code_t *ast_code_new(void);
+
+void ast_code_hold(ast_code_t *code);
+
+void ast_code_release(ast_code_t *code);
+
+/* Count a function obj made from the code. */
+void ast_code_add_fn(ast_code_t *code);
+
+/* For the GC: a function obj made from the code is still reachable. */
+void ast_code_reach(ast_code_t *code);
+
+/* For the GC, once it's done: free the code that's unheld and unreached. */
+void ast_code_sweep(void);
+
+/* The bytes taken by all the code there is. */
+size_t ast_code_bytes(void);
+
 void pretty_print(ast_expr_t *expr);
 
 ast_expr_t *ast_unary(type_t type, ast_expr_t *a);
@@ -210,6 +328,8 @@ ast_expr_t *ast_list(ast_expr_list_t *nullable_init_es);
 
 ast_expr_t *ast_dict(ast_expr_kv_list_t *nullable_kvs);
 
+ast_expr_t *ast_set(ast_expr_list_t *nullable_init_es);
+
 ast_expr_t *ast_float(float value);
 
 ast_expr_t *ast_int(int value);
@@ -228,7 +348,7 @@ ast_expr_t *ast_type(type_t type);
 
 ast_expr_t *ast_typedef(bytearray_t *name, ast_expr_list_t *fields);
 
-ast_expr_t *ast_typed(ast_expr_t *expr, bytearray_t *type_name);
+ast_expr_t *ast_typed(ast_expr_t *expr, bytearray_t *type_name, type_t type);
 
 ast_expr_t *ast_ident(bytearray_t *name);
 
@@ -275,6 +395,11 @@ ast_expr_t *ast_while_loop(ast_expr_t *cond, ast_expr_t *pred);
 
 ast_expr_t *ast_for_loop(ast_expr_t *elem, ast_expr_t *iterable, ast_expr_t *pred);
 
+ast_match_arm_t *ast_match_arm(uint8_t kind, ast_expr_t *pattern, ast_expr_t *expr);
+
+/* Compile the literal arms into tables. Null if there's no memory for them. */
+ast_expr_t *ast_match(ast_expr_t *subject, ast_match_arm_t *arms);
+
 ast_expr_t *ast_break(void);
 
 ast_expr_t *ast_continue(void);
@@ -16,9 +16,21 @@
 #define ETHEL_HEAP_SIZE_BYTES 16000000L
 #define DICT_INIT_BUCKETS 16
 
-// FNV (Fowler, Noll, Vo) FNV-1a 32-bit hash constants.
+// Ints in this range are preallocated and shared; see int_obj().
+#define INT_CACHE_MIN (-1024)
+#define INT_CACHE_MAX 65535
+
+// Slices this short are copied out; a view would be no smaller.
+#define SLICE_COPY_MAX 32
+// Slices under 1/SLICE_COMPACT_RATIO of their parent are copied out too,
+// so a small token doesn't keep a huge input alive.
+#define SLICE_COMPACT_RATIO 16
+
+// FNV (Fowler, Noll, Vo) FNV-1a 32- and 64-bit hash constants.
 #define FNV32Prime 0x01000193
 #define FNV32Basis 0x811C9DC5
+#define FNV64Prime 0x00000100000001B3
+#define FNV64Basis 0xCBF29CE484222325
 
 enum all_flags {
     F_NONE = 0,
@@ -30,6 +42,13 @@ enum all_flags {
     F_GC_UNREACHED = (1 << 5),
     F_GC_UNSCANNED = (1 << 6),
     F_GC_SCANNED = (1 << 7),
+    F_COPY_ON_WRITE = (1 << 8),  // Bytearray or list elements are shared; clone before writing.
+    F_REMOVED = (1 << 9),  // List element or dict node was taken out; iterators skip it.
+    F_TAIL_CALL = (1 << 10),  // Call is the last thing its function does; it reuses the caller's frame.
+    F_ENV_CAPTURED = (1 << 11),  // Scope, or one under it, is the scope of a function defined in it.
+    F_ENV_TYPED = (1 << 12),  // Binding was declared with a type, and only takes that type.
+    F_ENV_UNBOXED = (1 << 13),  // Binding keeps its Int or Float in an obj of its own, written over in place.
+    F_VALUE_UNUSED = (1 << 14),  // Nothing looks at the expr's value, so eval needn't make one.
 };
 
 enum every_type {
@@ -70,6 +89,7 @@ enum every_type {
     AST_DICT,
     AST_DICT_KVS,
     AST_DICT_KV,
+    AST_SET,
     AST_APPLY,
     AST_APPLY_DATA,
     AST_FIELD,
@@ -91,6 +111,7 @@ enum every_type {
     AST_TYPED,
     AST_TYPED_DATA,
     AST_TYPEDEF,
+    AST_TYPEDEF_DATA,
     AST_METHOD_CALL,
     AST_METHOD_CALL_DATA,
     AST_FIELD_GET,
@@ -114,6 +135,9 @@ enum every_type {
     AST_WHILE_LOOP_DATA,
     AST_FOR_LOOP,
     AST_FOR_LOOP_DATA,
+    AST_MATCH,
+    AST_MATCH_DATA,
+    AST_MATCH_ARM,
     AST_BREAK,
     AST_CONTINUE,
     AST_CALL_UNDEFINED,
@@ -136,6 +160,9 @@ enum every_type {
     AST_CALL_EXP,
     AST_CALL_LN,
     AST_CALL_LOG,
+    AST_CALL_INTS,
+    AST_CALL_FLOATS,
+    AST_CALL_MEMO,
     TYPE_UNKNOWN,
     TYPE_NOTHING,
     TYPE_UNDEF,
@@ -145,12 +172,16 @@ enum every_type {
     TYPE_FUNCTION,
     TYPE_FUNCTION_PTR_DATA,
     TYPE_RETURN_VAL,
+    TYPE_TAIL_CALL,
     TYPE_INT,
     TYPE_FLOAT,
     TYPE_BYTE,
     TYPE_BYTEARRAY,
     TYPE_BYTEARRAY_DATA,
+    TYPE_INT_ARRAY,
+    TYPE_FLOAT_ARRAY,
     TYPE_STRING,
+    TYPE_STRING_BUILDER,
     TYPE_BOOLEAN,
     TYPE_RANGE,
     TYPE_RANGE_DATA,
@@ -160,13 +191,21 @@ enum every_type {
     TYPE_DICT,
     TYPE_DICT_DATA,
     TYPE_DICT_KV_DATA,
+    TYPE_SET,
     TYPE_ITERATOR,
     TYPE_ITERATOR_DATA,
+    TYPE_MEMO_DATA,
+    TYPE_MEMO_ENTRY_DATA,
+    TYPE_RECORD_TYPE,
+    TYPE_RECORD_TYPE_DATA,
+    TYPE_RECORD,
+    TYPE_RECORD_DATA,
     TYPE_BREAK,
     TYPE_CONTINUE,
     EVAL_RESULT,
     INTERP_ENV,
     INTERP_STATE,
+    INTERP_STACK_DATA,
     TYPE_MAX,
 };
 
@@ -208,6 +247,7 @@ static const char *type_names[TYPE_MAX] = {
         "AST-DICT",
         "AST-DICT-KVS",
         "AST-DICT-KV",
+        "AST-SET",
         "AST-APPLY",
         "AST-APPLY-DATA",
         "AST-FIELD",
@@ -229,6 +269,7 @@ static const char *type_names[TYPE_MAX] = {
         "AST-TYPED",
         "AST-TYPED-DATA",
         "AST-TYPEDEF",
+        "AST-TYPEDEF-DATA",
         "AST-METHOD-CALL",
         "AST-METHOD-CALL-DATA",
         "AST-FIELD-GET",
@@ -252,6 +293,9 @@ static const char *type_names[TYPE_MAX] = {
         "AST-WHILE-LOOP-DATA",
         "AST-FOR-LOOP",
         "AST-FOR-LOOP-DATA",
+        "AST-MATCH",
+        "AST-MATCH-DATA",
+        "AST-MATCH-ARM",
         "AST-BREAK",
         "AST-CONTINUE",
         "AST-CALL-UNDEFINED",
@@ -274,6 +318,9 @@ static const char *type_names[TYPE_MAX] = {
         "AST-CALL-EXP",
         "AST-CALL-LN",
         "AST-CALL-LOG",
+        "AST-CALL-INTS",
+        "AST-CALL-FLOATS",
+        "AST-CALL-MEMO",
         "Unknown",
         "Nothing",
         "Undefined",
@@ -283,12 +330,16 @@ static const char *type_names[TYPE_MAX] = {
         "Function",
         "Function Data",
         "Return Val",
+        "Tail Call",
         "Int",
         "Float",
         "Byte",
         "Byte Array",
         "Byte Array Data",
+        "Int Array",
+        "Float Array",
         "Str",
+        "String Builder",
         "Bool",
         "Range",
         "Range Data",
@@ -298,34 +349,53 @@ static const char *type_names[TYPE_MAX] = {
         "Dict",
         "Dict Data",
         "Dict KV Data Node",
+        "Set",
         "Iterator",
         "Iterator Data",
+        "Memo Data",
+        "Memo Entry Data",
+        "Record Type",
+        "Record Type Data",
+        "Record",
+        "Record Data",
         "Break",
         "Continue",
         "<Eval Result>",
         "<Interpreter Env>",
         "<Interpreter State>",
+        "<Interpreter Stack Data>",
 };
 
 typedef uint8_t byte;
 typedef uint32_t boolean;
-typedef uint8_t flags_t;
+typedef uint16_t flags_t;
 typedef uint8_t type_t;
 
 typedef struct {
 #ifdef BUILD64
-    uint64_t type: 52;
+    uint64_t type: 44;
 #else
-    unsigned int type : 20;
+    unsigned int type : 12;
 #endif
-    unsigned int flags: 8;
+    unsigned int flags: 16;
     unsigned int children: 4;
 } gc_header_t;
 
-typedef struct {
+/*
+ * A bytearray either owns its bytes, in which case data points at bytes[],
+ * or is a slice that views size bytes of a parent's data. The parent is
+ * the GC child, so it lives as long as any of its slices.
+ *
+ * An owner may have room for capacity bytes. Concatenation uses the room
+ * past size to extend a slice that ends at size without copying it.
+ */
+typedef struct ByteArray {
     gc_header_t hdr;
+    struct ByteArray *parent;
     size_t size;
-    byte data[];
+    size_t capacity;
+    byte *data;
+    byte bytes[];
 } bytearray_t;
 
 #endif
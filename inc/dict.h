@@ -5,10 +5,47 @@
 #include "err.h"
 #include "obj.h"
 
+/* Ints, Floats, Strs, Bytes and Bools can be keys, and records whose fields all can. */
+boolean dict_key_hashable(obj_t *k);
+
+/*
+ * Hash a key without boxing the result. Agrees with METHOD_HASH for each
+ * hashable type, except that the empty string hashes like any other string.
+ */
+uint32_t dict_key_hash(obj_t *k);
+
+/*
+ * Keys of different types are never equal, even if their hashes collide.
+ */
+boolean dict_keys_eq(obj_t *a, obj_t *b);
+
 obj_t *dict_get(obj_t *obj, obj_t *k);
 
 error_t dict_put(obj_t *obj, obj_t *k, obj_t *v);
 
+/*
+ * Like dict_put(), but a new kv node gets the given flags. The env uses the
+ * node flags to record how a name was bound (val, var, loop variable).
+ */
+error_t dict_put_flags(obj_t *obj, obj_t *k, obj_t *v, flags_t flags);
+
+/*
+ * Return the kv node for k, or NULL if k is not in the dict.
+ */
+dict_kv_node_t *dict_get_node(obj_t *obj, obj_t *k);
+
+/*
+ * Like dict_get_node(), for a key whose hash is already known, such as the
+ * key of a node in another dict.
+ */
+dict_kv_node_t *dict_get_node_hashed(obj_t *obj, obj_t *k, uint32_t hash_val);
+
+/*
+ * Like dict_put(), for a key whose hash is already known. The key is not
+ * copied, so it must already belong to a dict; dicts never mutate their keys.
+ */
+error_t dict_put_hashed(obj_t *obj, obj_t *k, obj_t *v, uint32_t hash_val);
+
 obj_t *dict_remove(obj_t *obj, obj_t *k);
 
 boolean dict_contains(obj_t *obj, obj_t *k);
@@ -4,7 +4,8 @@
 #include "err.h"
 #include "obj.h"
 
-#define ENV_MAX_STACK_DEPTH 50
+#define ENV_SEGMENT_SIZE 64
+#define ENV_DEFAULT_MAX_DEPTH 10000
 
 typedef struct Env {
     gc_header_t hdr;
@@ -12,14 +13,32 @@ typedef struct Env {
     obj_t *vars;
 } env_t;
 
+/*
+ * The scope stack is a chain of segments, so that it can grow without
+ * moving the scopes already on it. Segments stay in the chain after the
+ * stack shrinks, ready for the next time it grows.
+ */
+typedef struct EnvSegment {
+    gc_header_t hdr;
+    struct EnvSegment *prev;
+    struct EnvSegment *next;
+    env_t *scopes[ENV_SEGMENT_SIZE];
+} env_segment_t;
+
 typedef struct InterpState {
     int top;
+    int max_depth;  // Scopes past this are an error. Each call takes two.
+    int opt_level;  // 0 runs code just as it was parsed. See optimize().
     env_t *env;
-    env_t *ret_stack[ENV_MAX_STACK_DEPTH];
+    env_segment_t *stack;  // Segment at the bottom of the stack.
+    env_segment_t *segment;  // Segment holding the top.
 } interp_t;
 
 error_t interp_init(interp_t *interp);
 
+/* Get the scope at depth i, with 0 the outermost. */
+env_t *scope_at(interp_t *interp, int i);
+
 env_t *new_env(void);
 
 error_t push_scope(interp_t *interp, env_t *scope);
@@ -28,6 +47,13 @@ error_t enter_scope(interp_t *interp);
 
 error_t leave_scope(interp_t *interp);
 
+/*
+ * Leave a scope entered with enter_scope(). If nothing was declared in it
+ * and no function has hold of it, it stays in its slot for the next
+ * enter_scope() to take, so a block run over and over needs no new scope.
+ */
+error_t leave_block_scope(interp_t *interp);
+
 /*
  * Associate a name with an obj for lookup, and put them both in the current
  * environment scope. Objects may shadow other objects in higher scopes.
@@ -36,6 +62,38 @@ error_t leave_scope(interp_t *interp);
  */
 error_t put_env(interp_t *interp, bytearray_t *name_obj, gc_header_t *hdr);
 
+/*
+ * Like put_env(), but with the binding flags given explicitly instead of taken
+ * from the object's header. The object itself is not modified.
+ */
+error_t put_env_with_flags(interp_t *interp, bytearray_t *name_obj, obj_t *obj, flags_t flags);
+
+/*
+ * The name's binding in the current scope, or null. Setting its v rebinds
+ * the name without looking it up again. The node stays put as the scope
+ * grows, but check for F_REMOVED in case the name was deleted.
+ */
+dict_kv_node_t *get_env_binding(interp_t *interp, bytearray_t *name_obj);
+
+/*
+ * The name's binding in the current scope or the nearest one above it that
+ * has it, or null. Unlike get_env(), an unboxed binding's own obj comes
+ * back as it is, so don't let it escape.
+ */
+dict_kv_node_t *find_env_binding(interp_t *interp, bytearray_t *name_obj);
+
+/*
+ * The obj as a value for something declared as type: the obj itself, or a
+ * Float for an Int, or null if it won't do.
+ */
+obj_t *declared_value(type_t type, obj_t *obj);
+
+/*
+ * A copy of the Int or Float obj for an unboxed binding to keep as its own.
+ * Bind it with F_ENV_UNBOXED.
+ */
+obj_t *unboxed_value(obj_t *obj);
+
 /*
  * Plant a GC root for an object in the current scope.
  *
@@ -39,6 +39,7 @@ enum error_enum {
     ERR_WRONG_ARG_COUNT,
     ERR_SYNTAX_ERROR,
     ERR_OUT_OF_MEMORY,
+    ERR_WRITE_ERROR,
     ERR_MAX
 };
 
@@ -77,6 +78,7 @@ static const char *err_names[ERR_MAX] = {
         "Incorrect number of arguments",
         "Syntax error",
         "Out of memory",
+        "Write error",
 };
 
 #endif
@@ -5,6 +5,7 @@
 #include "obj.h"
 #include "ast.h"
 #include "env.h"
+#include "parser.h"
 
 typedef struct Result {
     gc_header_t hdr;
@@ -15,4 +16,35 @@ typedef struct Result {
 
 void eval(interp_t *interp, const char *input, eval_result_t *result);
 
+/* Like eval(), for a whole script of size bytes. See parse_script(). */
+void eval_script(interp_t *interp, const char *input, uint32_t size, eval_result_t *result);
+
+/*
+ * Parse a script as eval_script() would, and make it ready to run, but
+ * don't run it. If it parsed, parse_result->code holds it until it's given
+ * to eval_code().
+ */
+void compile_script(interp_t *interp, const char *input, uint32_t size,
+                    ast_expr_t *ast, parse_result_t *parse_result);
+
+/* Run code made ready by compile_script(), or loaded from an image, and release it. */
+void eval_code(interp_t *interp, ast_code_t *code, ast_expr_t *ast, eval_result_t *result);
+
+/*
+ * Call the function obj with already-evaluated args, from native code
+ * running inside eval(). If the call fails, or the function's value is an
+ * Error, returns an Error obj carrying the error; the native caller should
+ * stop and return it, which fails the method.
+ */
+obj_t *call_fn(obj_t *obj, obj_varargs_t *args);
+
+/*
+ * Like call_fn(), for native code that calls the same function over and
+ * over, such as a pipeline stage. The caller keeps a slot for the call's
+ * scope, starting out NULL, and the next call rebinds its args there rather
+ * than making a new one, unless a closure kept it or the body declared
+ * something in it. args may be on the caller's stack.
+ */
+obj_t *call_fn_in_scope(obj_t *obj, obj_varargs_t *args, void **scope);
+
 #endif
@@ -28,6 +28,9 @@ typedef struct HeapNode {
 // Remove a smidge if necessary.
 #define HEAP_BYTES (ETHEL_HEAP_SIZE_BYTES - ETHEL_HEAP_SIZE_BYTES % sizeof(heap_node_t))
 
+// Held back from allocation until the rest of the heap is used up.
+#define HEAP_RESERVE_BYTES (HEAP_BYTES / 64 - HEAP_BYTES / 64 % sizeof(heap_node_t))
+
 #define DATA_FOR_NODE(node) ((void*) ((size_t) node + sizeof(heap_node_t)))
 #define NODE_FOR_DATA(data_ptr) ((heap_node_t*) ((size_t) data_ptr - sizeof(heap_node_t)))
 
@@ -105,10 +108,29 @@ size_t node_size(heap_node_t *node);
 
 heap_node_t *heap_head(void);
 
+/*
+ * Look for space from the start of the heap again, after nodes have been
+ * freed, as by the GC, without efree().
+ */
+void heap_rescan(void);
+
+/*
+ * True once the heap has run out and allocation has started on the reserve
+ * kept at its end. It's held back again when collection frees the reserve.
+ * Loops and calls stop with ERR_OUT_OF_MEMORY while this is so.
+ */
+boolean heap_exhausted(void);
+
 heap_info_t *get_heap_info(void);
 
 void dump_heap(void);
 
+/*
+ * True if data_ptr points into the heap. Statically allocated objects, like
+ * the interned singletons, are not on the heap and are never collected.
+ */
+boolean on_heap(void *data_ptr);
+
 void assert_valid_heap_node(heap_node_t *node);
 
 void assert_valid_data_ptr(void *data_ptr);
@@ -0,0 +1,36 @@
+#ifndef _IMAGE_H
+#define _IMAGE_H
+
+#include <inttypes.h>
+#include "err.h"
+#include "ast.h"
+
+/*
+ * A compiled image is a script's code as it is once parsed and made ready
+ * to run, kept in a file so that the next run can map it in instead of
+ * parsing the script again. It's the code's arena, as it was, with each
+ * pointer in it written as an offset into it, and a list of where those
+ * are; loading it adds the address it's mapped at back to each. The names
+ * the code uses are written out, and interned again when it's loaded.
+ *
+ * An image is only good for the source it was made from, at the opt level
+ * it was made at. The key says which.
+ */
+typedef struct {
+    uint64_t hash;
+    uint32_t size;
+    uint32_t opt_level;
+} image_key_t;
+
+image_key_t image_key(const char *source, uint32_t size, int opt_level);
+
+/* Write code, which root heads, to fname as the image for key. */
+error_t image_write(const char *fname, image_key_t *key, ast_code_t *code, ast_expr_t *root);
+
+/*
+ * Map the image in fname and return its code, with a hold for the caller,
+ * and fill in root. Null if fname isn't an image for key.
+ */
+ast_code_t *image_load(const char *fname, image_key_t *key, ast_expr_t *root);
+
+#endif
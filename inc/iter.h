@@ -0,0 +1,51 @@
+#ifndef __ITER_H
+#define __ITER_H
+
+#include "obj.h"
+
+/*
+ * Lazy pipelines over anything with an iterator.
+ *
+ * map(), filter(), take(), zip() and enumerate() return a new iterator
+ * that pulls from the one before it, one element at a time, so a chain of
+ * them builds no intermediate collections. reduce(), sum(), count() and
+ * toList() run the chain to the end.
+ *
+ * Ranges, lists, dicts, sets and strings get these methods too; they start
+ * from the object's own iterator.
+ */
+
+/* Return obj if it's an iterator, else a new iterator over it, or NULL. */
+obj_t *iter_of(obj_t *obj);
+
+/* Iterator yielding fn(elem) for each elem. */
+obj_t *iter_map(obj_t *obj, obj_varargs_t *args);
+
+/* Iterator yielding the elems for which fn(elem) is True. */
+obj_t *iter_filter(obj_t *obj, obj_varargs_t *args);
+
+/* Iterator yielding at most the first n elems. */
+obj_t *iter_take(obj_t *obj, obj_varargs_t *args);
+
+/* Iterator yielding list { a, b } pairs until either side runs out. */
+obj_t *iter_zip(obj_t *obj, obj_varargs_t *args);
+
+/* Iterator yielding list { i, elem } pairs, counting from 0. */
+obj_t *iter_enumerate(obj_t *obj, obj_varargs_t *args);
+
+/*
+ * Fold the elems with fn(acc, elem), starting from the optional second
+ * arg, or else from the first elem. Nil if there's nothing to fold.
+ */
+obj_t *iter_reduce(obj_t *obj, obj_varargs_t *args);
+
+/* Sum with the elems' add method. Ints and Floats are added unboxed. */
+obj_t *iter_sum(obj_t *obj, obj_varargs_t *args);
+
+obj_t *iter_count(obj_t *obj, obj_varargs_t *args);
+
+obj_t *iter_to_list(obj_t *obj, obj_varargs_t *args);
+
+static_method get_iter_static_method(static_method_ident_t method_id);
+
+#endif
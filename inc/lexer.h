@@ -6,23 +6,35 @@
 #include "def.h"
 #include "token.h"
 
-#define LEXER_BUF_SIZE 64000
-
 typedef struct {
+    const char *input;  // Not copied; it must outlive the lexer.
+    uint32_t size;
     uint32_t pos;
     uint32_t err_pos;
     uint8_t depth; // Gross to have message-passing from the parser here :(
     error_t err;
     char nextch;
-    char buf[LEXER_BUF_SIZE];
     token_t token;
     token_t next_token;
 } lexer_t;
 
+/*
+ * Lex input_size bytes of input, or up to the first '\0'. There's no limit
+ * on the size.
+ */
 void lexer_init(lexer_t *lexer, const char input[], uint32_t input_size);
 
 void advance(lexer_t *lexer);
 
+/* Copy the text of the current token into a new bytearray. */
+bytearray_t *token_bytearray(lexer_t *lexer);
+
+/* The text of the current token as an interned name. See bytearray_intern(). */
+bytearray_t *token_name(lexer_t *lexer);
+
+/* The text of the current string token. See bytearray_intern_literal(). */
+bytearray_t *token_literal(lexer_t *lexer);
+
 boolean eat(lexer_t *lexer, tag_t t);
 
 #endif
@@ -24,6 +24,16 @@ obj_t *list_slice(obj_t *obj, obj_varargs_t *args);
 
 obj_t *list_contains(obj_t *obj, obj_varargs_t *args);
 
+/*
+ * Sort the list in place and return it. The sort is stable.
+ *
+ * With no args, elements are ordered by their lt method. The optional arg
+ * is a function of two elements that returns True if the first belongs
+ * before the second. If a call to it fails, the list is left as it was
+ * and the Error is returned.
+ */
+obj_t *list_sort(obj_t *obj, obj_varargs_t *args);
+
 obj_t *list_subscript_get(obj_t *obj, obj_varargs_t *args);
 
 obj_t *list_subscript_set(obj_t *obj, obj_varargs_t *args);
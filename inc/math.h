@@ -7,4 +7,17 @@ int max(int, int);
 
 int abs(int);
 
+typedef enum {
+    MATH_SQRT,
+    MATH_EXP,
+    MATH_LN,
+    MATH_LOG,
+    MATH_SIN,
+    MATH_COS,
+    MATH_TAN,
+} math_fn_t;
+
+/* Apply one of the math builtins to x. LOG is base 10. */
+float math_apply(math_fn_t fn, float x);
+
 #endif
@@ -2,15 +2,19 @@
 #define __MEM_H
 
 #include "def.h"
+#include "arena.h"
 
 /*
  * Allocate an object of size type_t with the given flags.
  *
- * For dictionaries, use the special alloc_dict(buckets, flags);
+ * For dictionaries, use the special alloc_dict(buckets, flags); for
+ * records and their types, alloc_record(slots) and alloc_record_type(fields).
  *
  * Makes the allocated object traceable by GC.
  */
 gc_header_t *alloc_dict(uint32_t buckets, flags_t flags);
+gc_header_t *alloc_record_type(uint32_t nfields);
+gc_header_t *alloc_record(uint32_t nslots);
 gc_header_t *alloc_type(type_t type, flags_t flags);
 
 /*
@@ -29,9 +33,16 @@ void *mem_alloc(size_t size);
  */
 void *mem_realloc(void *b, size_t size);
 
-/* Free allocated memory. */
+/* Free allocated memory. Memory in an arena is left for arena_free(). */
 void mem_free(void *b);
 
+/*
+ * Until called again with null, take memory for mem_alloc() and
+ * alloc_type() from the arena instead of the heap. The GC doesn't trace
+ * what's there, so it mustn't point at anything on the heap.
+ */
+void mem_use_arena(arena_t *arena);
+
 /* Initialize memory management. Initialize all words with initval. */
 void mem_init(unsigned char initval);
 
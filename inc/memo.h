@@ -0,0 +1,24 @@
+#ifndef __MEMO_H
+#define __MEMO_H
+
+#include "obj.h"
+
+/*
+ * Memoized functions.
+ *
+ * memo(fn) returns a function that runs the same code in the same scope,
+ * but remembers its result for each tuple of args. Only calls whose args
+ * could all be dict keys are remembered; others just run. With a max size,
+ * the least recently used result is dropped to make room for a new one.
+ */
+
+/* Return a memoized copy of fn, keeping at most max_size results, or any number if 0. */
+obj_t *memo_fn(obj_t *fn, int max_size);
+
+/* The remembered result of calling fn with args, or NULL. */
+obj_t *memo_get(obj_t *fn, obj_varargs_t *args);
+
+/* Remember val as the result of calling fn with args. */
+void memo_put(obj_t *fn, obj_varargs_t *args, obj_t *val);
+
+#endif
@@ -66,17 +66,104 @@ typedef struct ObjFuncDef {
     void *code;
     /* Pointer to the env_sym_t scope the function was declared in. */
     void *scope;
+    /* Pointer to the obj_memo_t of results, if the function is memoized. */
+    void *memo;
+    /* Not a child for GC: the ast_code_t holding code, if it was parsed. */
+    void *program;
 } obj_func_def_t;
 
+/*
+ * A memoized function's results, keyed on its args.
+ *
+ * The table is a dict from the hash of the args to a chain of entries with
+ * that hash. Entries are also linked in order of use, so that a bounded
+ * memo can evict the least recently used one.
+ */
+typedef struct ObjMemoEntry {
+    gc_header_t hdr;
+    obj_varargs_t *args;
+    obj_t *val;
+    struct ObjMemoEntry *same_hash;
+    struct ObjMemoEntry *older;
+    // Not a child for GC; the newer entry is also reachable from the memo.
+    struct ObjMemoEntry *newer;
+    uint32_t hash_val;
+} memo_entry_t;
+
+typedef struct ObjMemo {
+    gc_header_t hdr;
+    obj_t *table;
+    memo_entry_t *newest;
+    memo_entry_t *oldest;
+    int size;
+    /* Most entries to keep, or 0 for no limit. */
+    int max_size;
+} obj_memo_t;
+
+/*
+ * A record type is a fixed layout: its fields, in slot order. Instances
+ * keep their values in an array indexed by slot, so a field is found by
+ * where it is in the layout, not by hashing its name.
+ *
+ * Field names are interned, so they compare by pointer, and like the type's
+ * name they live off the heap and aren't children for GC.
+ */
+typedef struct RecordField {
+    bytearray_t *name;
+    type_t type;  // TYPE_UNKNOWN if it takes anything.
+    flags_t flags;  // F_ENV_MUTABLE if it was declared with var.
+} record_field_t;
+
+typedef struct ObjRecordType {
+    gc_header_t hdr;
+    bytearray_t *name;
+    uint32_t nfields;
+    /* Array alloc'd to size when struct is instantiated. */
+    record_field_t fields[];
+} obj_record_type_t;
+
+/*
+ * Like a dict, this breaks the gc header + children model: the type is the
+ * one child in the header, and the slots are special-cased for gc.
+ */
+typedef struct ObjRecord {
+    gc_header_t hdr;
+    obj_record_type_t *type;
+    /* One per field of the type. */
+    struct Obj *slots[];
+} obj_record_t;
+
+/*
+ * Iterators keep their position without allocating.
+ *
+ * Linked containers keep the node they last yielded in cursor, and the
+ * next step follows its link. Removed nodes keep their links and are
+ * flagged F_REMOVED, so removing the element just yielded is safe, and
+ * removed elements ahead of the cursor are skipped. Elements added ahead
+ * of the cursor are visited.
+ *
+ * A dict iterator visits nodes in order of their hashes with the bits
+ * reversed, which doesn't change when the dict resizes. It keeps the
+ * bucket table it is on in table, and index is the step it is at. If the
+ * dict has moved to a new table, it finds the cursor's place there and
+ * carries on, so no element is seen twice or missed.
+ *
+ * Indexed containers keep a byte offset or range offset in index. Pipeline
+ * stages keep the scope of their function's calls in table.
+ */
 typedef struct ObjIterator {
     gc_header_t hdr;
     obj_t *obj;
-    obj_t *state_obj;
+    void *cursor;
+    void *table;
 
     // Don't link to 'next' for GC; It's a pointer to native code.
     struct Obj *(*next)(struct ObjIterator *iterable);
 
     int state;
+    // Why a pipeline stage stopped early, e.g. its function failed.
+    error_t err;
+    int64_t index;
 } obj_iter_t;
 
 typedef struct Obj {
@@ -93,6 +180,8 @@ typedef struct Obj {
         bytearray_t *bytearray;
         obj_func_def_t *func_def;
         obj_iter_t *iterator;
+        obj_record_type_t *record_type;
+        obj_record_t *record;
         struct Obj *return_val;
     };
 } obj_t;
@@ -151,6 +240,24 @@ enum static_method_ident_enum {
     METHOD_REMOVE_ELEM,
     METHOD_ITERATOR,
     METHOD_DUMP,
+    METHOD_SORT,
+    METHOD_INSERT,
+    METHOD_UNION,
+    METHOD_INTERSECTION,
+    METHOD_DIFFERENCE,
+    METHOD_SUM,
+    METHOD_MIN,
+    METHOD_MAX,
+    METHOD_DOT,
+    METHOD_MAP,
+    METHOD_FILTER,
+    METHOD_TAKE,
+    METHOD_ZIP,
+    METHOD_ENUMERATE,
+    METHOD_REDUCE,
+    METHOD_COUNT,
+    METHOD_TO_LIST,
+    METHOD_BUILDER,
 };
 
 typedef struct {
@@ -194,8 +301,34 @@ static const static_method_name_t static_method_names[] = {
         {.ident = METHOD_REMOVE_AT, .name = "removeAt"},
         {.ident = METHOD_REMOVE_ELEM, .name = "remove"},
         {.ident = METHOD_DUMP, .name = "dump"},
+        {.ident = METHOD_SORT, .name = "sort"},
+        {.ident = METHOD_INSERT, .name = "add"},
+        {.ident = METHOD_UNION, .name = "union"},
+        {.ident = METHOD_INTERSECTION, .name = "intersection"},
+        {.ident = METHOD_DIFFERENCE, .name = "difference"},
+        {.ident = METHOD_SUM, .name = "sum"},
+        {.ident = METHOD_MIN, .name = "min"},
+        {.ident = METHOD_MAX, .name = "max"},
+        {.ident = METHOD_DOT, .name = "dot"},
+        {.ident = METHOD_MAP, .name = "map"},
+        {.ident = METHOD_FILTER, .name = "filter"},
+        {.ident = METHOD_TAKE, .name = "take"},
+        {.ident = METHOD_ZIP, .name = "zip"},
+        {.ident = METHOD_ENUMERATE, .name = "enumerate"},
+        {.ident = METHOD_REDUCE, .name = "reduce"},
+        {.ident = METHOD_COUNT, .name = "count"},
+        {.ident = METHOD_TO_LIST, .name = "toList"},
+        {.ident = METHOD_BUILDER, .name = "builder"},
 };
 
+/* Allocate a bare object of the given type. */
+obj_t *obj_of(type_t type);
+
+/*
+ * Undef, Nothing, Nil, True, False, Break, Continue, and Ints between
+ * INT_CACHE_MIN and INT_CACHE_MAX are interned: these constructors always
+ * return the same instance, which is never collected and must not be mutated.
+ */
 obj_t *undef_obj(void);
 
 obj_t *nil_obj(void);
@@ -212,8 +345,18 @@ obj_t *byte_obj(byte);
 
 obj_t *bytearray_obj(size_t size, uint8_t *data);
 
+/* A zeroed TYPE_INT_ARRAY or TYPE_FLOAT_ARRAY of n elements, or nil if it won't fit. */
+obj_t *vec_obj(type_t type, size_t n);
+
+/*
+ * The string shares src rather than copying it. Writers must go through
+ * arr_set(), which copies a shared bytearray before modifying it.
+ */
 obj_t *string_obj(bytearray_t *src);
 
+/* A string builder that starts out sharing src. append() never writes over src's bytes. */
+obj_t *string_builder_obj(bytearray_t *src);
+
 obj_t *boolean_obj(boolean);
 
 obj_t *range_obj(int from_inclusive, int to_inclusive);
@@ -225,9 +368,22 @@ obj_t *list_obj(obj_list_element_t *elems);
 obj_t *dict_obj_of_size(size_t buckets);
 obj_t *dict_obj(void);
 
+/*
+ * A set is a dict whose values are all True. The table is sized so that
+ * n elems fit without resizing.
+ */
+obj_t *set_obj_of_size(size_t n);
+obj_t *set_obj(void);
+
 obj_t *func_obj(void *code, void *scope);
 
-obj_t *iterator_obj(obj_t *obj, obj_t *state_obj, obj_t *(*next)(obj_iter_t *iterable));
+obj_t *iterator_obj(obj_t *obj, obj_t *(*next)(obj_iter_t *iterable));
+
+/* A record type called name, with room for nfields fields, to be filled in. */
+obj_t *record_type_obj(bytearray_t *name, uint32_t nfields);
+
+/* An instance of the record type, with every field Nil. */
+obj_t *record_obj(obj_t *type);
 
 obj_t *return_val(obj_t *val);
 
@@ -239,4 +395,13 @@ obj_varargs_t *wrap_varargs(int n_args, ...);
 
 boolean obj_prim_eq(obj_t *a, obj_t *b);
 
+/* True if obj is one of the shared, interned singletons. */
+boolean obj_is_interned(obj_t *obj);
+
+/*
+ * Return obj, or a private heap copy of it if obj is interned. Use this for
+ * anything that will be mutated in place, like iterator state.
+ */
+obj_t *obj_unshared(obj_t *obj);
+
 #endif
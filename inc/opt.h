@@ -0,0 +1,16 @@
+#ifndef _OPT_H
+#define _OPT_H
+
+#include "ast.h"
+
+#define OPT_DEFAULT_LEVEL 1
+
+/*
+ * Rewrite parsed code in place into code that does the same thing with
+ * less work: ops on literals become the literal they make, and an if on a
+ * literal becomes the branch it would take. Nothing is folded that could
+ * fail, or print, when run, so it still does that when it runs.
+ */
+void optimize(ast_expr_t *expr);
+
+#endif
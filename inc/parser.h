@@ -44,8 +44,22 @@ typedef struct {
     uint32_t pos;
     uint8_t depth;
     uint8_t err;
+    // Holds the nodes under ast, with a hold for the caller. Null if the
+    // input was incomplete, or didn't lex.
+    ast_code_t *code;
 } parse_result_t;
 
+/*
+ * Parse the null-terminated input into ast, which the caller provides.
+ * When done with it, release parse_result->code; see ast_code_t.
+ */
 void parse_program(const char *input, ast_expr_t *ast, parse_result_t *parse_result);
 
+/*
+ * Parse size bytes of input, which needn't be null-terminated, as the body
+ * of a block. That way all of a script's top-level exprs are run, and their
+ * names are local to the script.
+ */
+void parse_script(const char *input, uint32_t size, ast_expr_t *ast, parse_result_t *parse_result);
+
 #endif
@@ -3,10 +3,26 @@
 
 #include "def.h"
 
+/*
+ * Vector code is built for SSE2, which every x86-64 has, with AVX2 versions
+ * picked at run time when have_avx2() says the CPU can run them.
+ */
+#if defined(__x86_64__) && defined(__SSE2__)
+#define HAVE_SIMD 1
+
+boolean have_avx2(void);
+#endif
+
 /* Set the first len bytes in b to val. */
 void mem_set(void *b, int val, size_t len);
 
 /* Copy n bytes from src to dst. Return pointer to dst. */
 void *mem_cp(void *dst, void *src, size_t size);
 
+/* Return true if the first size bytes of a and b are the same. */
+boolean mem_eq(const void *a, const void *b, size_t size);
+
+/* Return a pointer to the first byte equal to val in b, or NULL. */
+void *mem_chr(const void *b, int val, size_t size);
+
 #endif
@@ -0,0 +1,49 @@
+#ifndef __RECORD_H
+#define __RECORD_H
+
+#include "obj.h"
+
+/*
+ * The slot of the field called name in the record type, or -1 if it has no
+ * such field. hint is the slot to try first, typically the one the same
+ * code found last time, so that code that sees one type keeps finding its
+ * field on the first try.
+ */
+int record_slot(obj_record_type_t *type, bytearray_t *name, int hint);
+
+/* point(x: 1, y: 2) */
+obj_t *record_to_string(obj_t *obj, obj_varargs_t *args);
+
+/* <Type point> */
+obj_t *record_type_to_string(obj_t *obj, obj_varargs_t *args);
+
+/* A new record of the same type, with a copy of each field's value. */
+obj_t *record_copy(obj_t *obj, obj_varargs_t *args);
+
+/*
+ * Records are equal if they're of the same type and each field is equal
+ * to the other's, by the field value's eq method.
+ */
+obj_t *record_eq(obj_t *obj, obj_varargs_t *args);
+
+obj_t *record_ne(obj_t *obj, obj_varargs_t *args);
+
+/*
+ * A record can be a dict key if all its fields can. As a key it's hashed,
+ * and compared, field by field, like the keys its fields would be. Changing
+ * a var field of a record that's a key changes its hash; don't.
+ */
+boolean record_hashable(obj_t *obj);
+
+uint32_t record_key_hash(obj_t *obj);
+
+boolean record_keys_eq(obj_t *a, obj_t *b);
+
+/* record_key_hash() as an Int, or Nil if a field can't be hashed. */
+obj_t *record_hash(obj_t *obj, obj_varargs_t *args);
+
+static_method get_record_static_method(static_method_ident_t method_id);
+
+static_method get_record_type_static_method(static_method_ident_t method_id);
+
+#endif
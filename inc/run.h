@@ -1,6 +1,8 @@
 #ifndef _RUN_H
 #define _RUN_H
 
-int run(char *fname);
+#include "def.h"
+
+int run(char *fname, int max_depth, int opt_level, boolean compile_only);
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef __SET_H
+#define __SET_H
+
+#include "def.h"
+#include "err.h"
+#include "obj.h"
+
+/*
+ * Sets are dicts underneath, so they hash and compare elems exactly as dict
+ * keys do, and only hashable types can be elems.
+ */
+error_t set_add(obj_t *obj, obj_t *elem);
+
+boolean set_contains(obj_t *obj, obj_t *elem);
+
+/*
+ * The set algebra returns a new set, sized up front so that it never has to
+ * grow. The other operand may be a set or a list.
+ */
+obj_t *set_union(obj_t *obj, obj_varargs_t *args);
+
+obj_t *set_intersection(obj_t *obj, obj_varargs_t *args);
+
+obj_t *set_difference(obj_t *obj, obj_varargs_t *args);
+
+// Static methods for actual use.
+obj_t *set_obj_add(obj_t *obj, obj_varargs_t *args);
+
+obj_t *set_obj_contains(obj_t *obj, obj_varargs_t *args);
+
+obj_t *set_obj_remove(obj_t *obj, obj_varargs_t *args);
+
+obj_t *set_obj_copy(obj_t *obj, obj_varargs_t *args);
+
+obj_t *set_obj_eq(obj_t *obj, obj_varargs_t *args);
+
+obj_t *set_obj_ne(obj_t *obj, obj_varargs_t *args);
+
+static_method get_set_static_method(static_method_ident_t method_id);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _SPEC_H
+#define _SPEC_H
+
+#include "ast.h"
+
+/*
+ * Mark the binops and assignments in parsed code whose operands are all
+ * declared as Ints or Floats, or are literals, so that eval can work them
+ * out unboxed. Names declared with int or float, and the variable of a for
+ * loop over a range, count as declared. Eval checks what the names are
+ * bound to when it runs, and takes the long way if they aren't what they
+ * were declared as.
+ */
+void specialize(ast_expr_t *expr);
+
+#endif
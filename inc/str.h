@@ -63,6 +63,40 @@ bytearray_t *bytearray_alloc(size_t size);
 /* Return a new bytearray that is a bytewise copy of the original. */
 bytearray_t *bytearray_clone(bytearray_t *src);
 
+/*
+ * Return the one bytearray holding these bytes that there will ever be.
+ * It's off the GC heap, and stays for good, so it can be shared anywhere.
+ * Meant for names, of which there aren't so many.
+ */
+bytearray_t *bytearray_intern(const byte *data, size_t size);
+
+// Bytes of string literals that are interned, at most, over a whole run.
+#define LITERAL_INTERN_MAX (1 << 20)
+
+/*
+ * Intern a string literal, as long as no more than LITERAL_INTERN_MAX bytes
+ * of them have been, so that a long REPL session can't pile them up for
+ * good. Past that, return a new bytearray for the literal, which goes in
+ * the arena of the code being parsed and is freed with it.
+ */
+bytearray_t *bytearray_intern_literal(const byte *data, size_t size);
+
+/* Whether a is one that bytearray_intern() gave out. */
+boolean bytearray_is_interned(bytearray_t *a);
+
+/*
+ * Return the bytes [start, end) of src without copying them. The result
+ * views the data of src's owner, and both are marked copy-on-write. Short
+ * slices, or ones much smaller than their owner, are copied instead.
+ */
+bytearray_t *bytearray_slice(bytearray_t *src, size_t start, size_t end);
+
+/*
+ * Mark src as shared and return it. The next write through arr_set() will
+ * copy it first, so other holders never see the change.
+ */
+bytearray_t *bytearray_share(bytearray_t *src);
+
 /* Return true if the two arrays have the same contents. */
 boolean bytearray_eq(bytearray_t *a, bytearray_t *b);
 
@@ -101,6 +135,20 @@ obj_t *str_to_byte(obj_t *obj, obj_varargs_t *args);
 
 obj_t *str_add(obj_t *obj, obj_varargs_t *args);
 
+/* A new builder that starts out with the string's contents. */
+obj_t *str_builder(obj_t *obj, obj_varargs_t *args);
+
+/*
+ * Append the arg, or its toString(), to the builder in place and return
+ * the builder. Repeated appends take amortized linear time.
+ */
+obj_t *builder_append(obj_t *obj, obj_varargs_t *args);
+
+/* A string of the builder's current contents. Later appends don't change it. */
+obj_t *builder_to_string(obj_t *obj, obj_varargs_t *args);
+
+obj_t *builder_len(obj_t *obj, obj_varargs_t *args);
+
 obj_t *str_get(obj_t *obj, obj_varargs_t *args);
 
 obj_t *str_contains(obj_t *obj, obj_varargs_t *args);
@@ -119,4 +167,6 @@ obj_t *str_iterator(obj_t *obj, obj_varargs_t *args);
 
 static_method get_str_static_method(static_method_ident_t method_id);
 
+static_method get_builder_static_method(static_method_ident_t method_id);
+
 #endif
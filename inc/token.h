@@ -46,6 +46,7 @@ enum tag_enum {
     TAG_NIL,
     TAG_LIST,
     TAG_DICT,
+    TAG_SET,
     TAG_OF,
     TAG_ARR_DECL,
     TAG_TYPE_INT,
@@ -101,6 +102,9 @@ enum tag_enum {
     TAG_EXP,
     TAG_LN,
     TAG_LOG,
+    TAG_INTS,
+    TAG_FLOATS,
+    TAG_MEMO,
 };
 
 static const char *tag_names[] = {
@@ -145,6 +149,7 @@ static const char *tag_names[] = {
         "NIL",
         "LIST",
         "DICT",
+        "SET",
         "OF",
         "ARRAY-DECL",
         "INT-TYPE",
@@ -200,10 +205,16 @@ static const char *tag_names[] = {
         "EXP",
         "LN",
         "LOG",
+        "INTS",
+        "FLOATS",
+        "MEMO",
 };
 
 typedef struct {
     tag_t tag;
+    // Where an ident, field, method, string, hex or bin token's text is in the input.
+    uint32_t offset;
+    uint32_t length;
     union {
         int32_t intval;
         float floatval;
@@ -244,6 +255,7 @@ static const token_t reserved[] = {
         {TAG_NIL, .string = (char *) "nil"},
         {TAG_LIST, .string = (char *) "list"},
         {TAG_DICT, .string = (char *) "dict"},
+        {TAG_SET, .string = (char *) "set"},
         {TAG_ARR_DECL, .string = (char *) "arr"},
         {TAG_TYPE_INT, .string = (char *) "int"},
         {TAG_TYPE_FLOAT, .string = (char *) "float"},
@@ -266,6 +278,9 @@ static const token_t reserved[] = {
         {TAG_EXP, .string = (char *) "exp"},
         {TAG_LN, .string = (char *) "ln"},
         {TAG_LOG, .string = (char *) "log"},
+        {TAG_INTS, .string = (char *) "ints"},
+        {TAG_FLOATS, .string = (char *) "floats"},
+        {TAG_MEMO, .string = (char *) "memo"},
 };
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef __VEC_H
+#define __VEC_H
+
+#include "obj.h"
+#include "math.h"
+
+/*
+ * Typed arrays keep Ints as int32_t and Floats as float, unboxed and
+ * contiguous in a bytearray, so whole-array operations are single loops
+ * over the buffer rather than an interpreter step per element.
+ */
+
+/* Number of elements in the typed array. */
+size_t vec_len(obj_t *obj);
+
+/*
+ * Make an Int Array or Float Array from src: an Int size for a zeroed
+ * array, or a list or range whose elements are converted.
+ */
+obj_t *vec_of(type_t type, obj_t *src);
+
+/*
+ * Apply a math builtin to every element. The result is always a Float
+ * Array; sqrt is vectorized, the others call libm per element.
+ */
+obj_t *vec_map(obj_t *obj, math_fn_t fn);
+
+obj_t *vec_size(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_copy(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_get(obj_t *obj, obj_varargs_t *args);
+
+/* Set the element at the offset in the first arg to the second arg. */
+obj_t *vec_set(obj_t *obj, obj_varargs_t *args);
+
+/*
+ * Elementwise arithmetic, returning a new array. The arg is an array of the
+ * same type and length, or a number to apply to every element. Float Arrays
+ * take Int or Float numbers; Int Arrays only take Ints.
+ */
+obj_t *vec_add(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_sub(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_mul(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_div(obj_t *obj, obj_varargs_t *args);
+
+/* Reductions. min() and max() of an empty array are nil. */
+obj_t *vec_sum(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_min(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_max(obj_t *obj, obj_varargs_t *args);
+
+/* Sum of the elementwise products with an array of the same type and length. */
+obj_t *vec_dot(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_abs(obj_t *obj, obj_varargs_t *args);
+
+obj_t *vec_iterator(obj_t *obj, obj_varargs_t *args);
+
+static_method get_vec_static_method(static_method_ident_t method_id);
+
+#endif
@@ -0,0 +1,51 @@
+#include <stdlib.h>
+#include "../inc/arena.h"
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN sizeof(void *)
+
+void arena_init(arena_t *arena) {
+    arena->chunk = NULL;
+    arena->bytes = 0;
+}
+
+static arena_chunk_t *new_chunk(size_t size, arena_chunk_t *prev) {
+    arena_chunk_t *chunk = malloc(sizeof(arena_chunk_t) + size);
+    if (chunk == NULL) return NULL;
+    chunk->prev = prev;
+    chunk->used = 0;
+    chunk->size = size;
+    return chunk;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    arena_chunk_t *chunk = arena->chunk;
+
+    if (size > ARENA_CHUNK_SIZE / 4 && chunk != NULL) {
+        // A big block gets a chunk of its own, behind the one being filled.
+        arena_chunk_t *own = new_chunk(size, chunk->prev);
+        if (own == NULL) return NULL;
+        chunk->prev = own;
+        chunk = own;
+    } else if (chunk == NULL || chunk->size - chunk->used < size) {
+        chunk = new_chunk(size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE, chunk);
+        if (chunk == NULL) return NULL;
+        arena->chunk = chunk;
+    }
+
+    void *p = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->bytes += size;
+    return p;
+}
+
+void arena_free(arena_t *arena) {
+    arena_chunk_t *chunk = arena->chunk;
+    while (chunk != NULL) {
+        arena_chunk_t *prev = chunk->prev;
+        free(chunk);
+        chunk = prev;
+    }
+    arena_init(arena);
+}
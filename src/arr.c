@@ -1,23 +1,13 @@
 #include <stdio.h>
 #include "../inc/type.h"
+#include "../inc/ptr.h"
 #include "../inc/mem.h"
 #include "../inc/rand.h"
+#include "../inc/str.h"
 #include "../inc/arr.h"
 
-static boolean bytesarrays_eq(bytearray_t *a, bytearray_t *b) {
-    if (a->size != b->size) return False;
-
-    for (size_t i = 0; i < a->size; i++) {
-        if (a->data[i] != b->data[i]) {
-            return False;
-        }
-    }
-
-    return True;
-}
-
-static obj_t *bytearray_slice(obj_t *obj, int start, int end) {
-    if (end > obj->bytearray->size) end = obj->bytearray->size;
+static obj_t *arr_slice_internal(obj_t *obj, int start, int end) {
+    if (end > obj->bytearray->size) end = (int) obj->bytearray->size;
 
     if (end < 0 ||
         start < 0 ||
@@ -26,12 +16,8 @@ static obj_t *bytearray_slice(obj_t *obj, int start, int end) {
         return bytearray_obj(0, NULL);
     }
 
-    size_t len = end - start;
-    obj_t *new = bytearray_obj(len, NULL);
-    for (size_t i = 0; i < len; i++) {
-        new->bytearray->data[i] = obj->bytearray->data[start + i];
-    }
-
+    obj_t *new = obj_of(TYPE_BYTEARRAY);
+    new->bytearray = bytearray_slice(obj->bytearray, (size_t) start, (size_t) end);
     return new;
 }
 
@@ -49,29 +35,33 @@ static byte obj_to_byte(obj_t *obj) {
     }
 }
 
-obj_t *arr_hash(obj_t *obj, obj_varargs_t /* Ignored */ *args) {
-    (void) *args;
-
+uint32_t bytearray_hash(bytearray_t *a) {
     uint32_t temp;
     byte b;
 
-    if (obj->bytearray->size == 0) {
-        return nil_obj();
-    }
-
     /*
      * FNV (Fowler, Noll, Vo), the non-cryptographic hash function FNV-1a
      * for 32-bit hashes returning a 32-bit integer.
      */
     temp = FNV32Basis;
     size_t i = 0;
-    while (i < obj->bytearray->size) {
-        b = obj->bytearray->data[i];
+    while (i < a->size) {
+        b = a->data[i];
         temp = FNV32Prime * (temp ^ b);
         i++;
     }
 
-    return int_obj((int) temp);
+    return temp;
+}
+
+obj_t *arr_hash(obj_t *obj, obj_varargs_t /* Ignored */ *args) {
+    (void) *args;
+
+    if (obj->bytearray->size == 0) {
+        return nil_obj();
+    }
+
+    return int_obj((int) bytearray_hash(obj->bytearray));
 }
 
 obj_t *arr_size(obj_t *obj, obj_varargs_t /* Ignored */ *args) {
@@ -83,7 +73,10 @@ obj_t *arr_size(obj_t *obj, obj_varargs_t /* Ignored */ *args) {
 obj_t *arr_copy(obj_t *obj, obj_varargs_t *args) {
     (void) *args;
 
-    return bytearray_obj(obj->bytearray->size, obj->bytearray->data);
+    // Share the data, copy-on-write.
+    obj_t *copy = obj_of(TYPE_BYTEARRAY);
+    copy->bytearray = bytearray_share(obj->bytearray);
+    return copy;
 }
 
 obj_t *arr_get_at(obj_t *obj, int i) {
@@ -132,6 +125,10 @@ obj_t *arr_set(obj_t *obj, obj_varargs_t *args) {
     }
 
     byte val = obj_to_byte(b);
+    if (FLAGS(obj->bytearray) & F_COPY_ON_WRITE) {
+        // Someone else may be looking at this; make our own copy.
+        obj->bytearray = bytearray_clone(obj->bytearray);
+    }
     obj->bytearray->data[i] = val;
     return byte_obj(val);
 }
@@ -163,13 +160,8 @@ obj_t *arr_contains(obj_t *obj, obj_varargs_t *args) {
         return nil_obj();
     }
 
-    for (size_t i = 0; i < obj->bytearray->size; i++) {
-        if (obj->bytearray->data[i] == b) {
-            return boolean_obj(True);
-        }
-    }
-
-    return boolean_obj(False);
+    boolean found = mem_chr(obj->bytearray->data, b, obj->bytearray->size) != NULL;
+    return boolean_obj(found);
 }
 
 obj_t *arr_eq(obj_t *obj, obj_varargs_t *args) {
@@ -184,7 +176,7 @@ obj_t *arr_eq(obj_t *obj, obj_varargs_t *args) {
         return nil_obj();
     }
 
-    return boolean_obj(bytesarrays_eq(obj->bytearray, other->bytearray));
+    return boolean_obj(bytearray_eq(obj->bytearray, other->bytearray));
 }
 
 obj_t *arr_ne(obj_t *obj, obj_varargs_t *args) {
@@ -199,7 +191,7 @@ obj_t *arr_ne(obj_t *obj, obj_varargs_t *args) {
         return nil_obj();
     }
 
-    return boolean_obj(!bytesarrays_eq(obj->bytearray, other->bytearray));
+    return boolean_obj(!bytearray_eq(obj->bytearray, other->bytearray));
 }
 
 obj_t *arr_slice(obj_t *obj, obj_varargs_t *args) {
@@ -214,7 +206,28 @@ obj_t *arr_slice(obj_t *obj, obj_varargs_t *args) {
     obj_t *end_arg = args->next->arg;
     if (TYPEOF(end_arg) != TYPE_INT) return nil_obj();
 
-    return bytearray_slice(obj, start_arg->intval, end_arg->intval);
+    return arr_slice_internal(obj, start_arg->intval, end_arg->intval);
+}
+
+obj_t *arr_sort(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    if (FLAGS(obj->bytearray) & F_COPY_ON_WRITE) {
+        obj->bytearray = bytearray_clone(obj->bytearray);
+    }
+
+    // Counting sort; there are only 256 possible values.
+    size_t counts[256] = {0};
+    byte *data = obj->bytearray->data;
+    for (size_t i = 0; i < obj->bytearray->size; i++) {
+        counts[data[i]]++;
+    }
+    for (int b = 0; b < 256; b++) {
+        mem_set(data, b, counts[b]);
+        data += counts[b];
+    }
+
+    return obj;
 }
 
 obj_t *arr_random_choice(obj_t *obj, obj_varargs_t *args) {
@@ -227,24 +240,19 @@ obj_t *arr_random_choice(obj_t *obj, obj_varargs_t *args) {
 }
 
 static obj_t *iter_next(obj_iter_t *iterable) {
-    size_t i;
-
     switch (iterable->state) {
         case ITER_NOT_STARTED:
-            i = 0;
-            iterable->state_obj->intval = i;
+            iterable->index = 0;
             iterable->state = ITER_ITERATING;
             // Fall through to ITERATING.
 
         case ITER_ITERATING:
-            i = iterable->state_obj->intval;
-            obj_t *next_val = arr_get_at(iterable->obj, i);
-            if (i >= iterable->obj->bytearray->size) {
+            // Check the size every time; the array may have changed.
+            if (iterable->index >= iterable->obj->bytearray->size) {
                 iterable->state = ITER_STOPPED;
                 return nil_obj();
             }
-            iterable->state_obj->intval = i + 1;
-            return next_val;
+            return byte_obj(iterable->obj->bytearray->data[iterable->index++]);
 
         case ITER_STOPPED:
             return nil_obj();
@@ -258,8 +266,7 @@ static obj_t *iter_next(obj_iter_t *iterable) {
 obj_t *arr_iterator(obj_t *obj, obj_varargs_t *args) {
     (void) *args;
 
-    obj_t *state = int_obj(0);
-    return iterator_obj(obj, state, iter_next);
+    return iterator_obj(obj, iter_next);
 }
 
 static_method get_arr_static_method(static_method_ident_t method_id) {
@@ -284,6 +291,8 @@ static_method get_arr_static_method(static_method_ident_t method_id) {
             return arr_random_choice;
         case METHOD_ITERATOR:
             return arr_iterator;
+        case METHOD_SORT:
+            return arr_sort;
         default:
             return NULL;
     }
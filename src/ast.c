@@ -1,10 +1,83 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
 #include "../inc/type.h"
 #include "../inc/mem.h"
+#include "../inc/ptr.h"
 #include "../inc/str.h"
+#include "../inc/arr.h"
 #include "../inc/ast.h"
 
+static ast_code_t *all_code = NULL;
+
+ast_code_t *ast_code_new(void) {
+    ast_code_t *code = malloc(sizeof(ast_code_t));
+    if (code == NULL) return NULL;
+    arena_init(&code->arena);
+    code->image = NULL;
+    code->image_size = 0;
+    code->holds = 1;
+    code->fns = 0;
+    code->reached = False;
+
+    code->prev = NULL;
+    code->next = all_code;
+    if (all_code != NULL) all_code->prev = code;
+    all_code = code;
+    return code;
+}
+
+static void ast_code_free(ast_code_t *code) {
+    if (code->prev != NULL) {
+        code->prev->next = code->next;
+    } else {
+        all_code = code->next;
+    }
+    if (code->next != NULL) code->next->prev = code->prev;
+
+    arena_free(&code->arena);
+    if (code->image != NULL) munmap(code->image, code->image_size);
+    free(code);
+}
+
+void ast_code_hold(ast_code_t *code) {
+    if (code != NULL) code->holds++;
+}
+
+void ast_code_release(ast_code_t *code) {
+    if (code == NULL) return;
+    code->holds--;
+    if (code->holds == 0 && code->fns == 0) ast_code_free(code);
+}
+
+void ast_code_add_fn(ast_code_t *code) {
+    if (code != NULL) code->fns++;
+}
+
+void ast_code_reach(ast_code_t *code) {
+    if (code != NULL) code->reached = True;
+}
+
+void ast_code_sweep(void) {
+    ast_code_t *code = all_code;
+    while (code != NULL) {
+        ast_code_t *next = code->next;
+        if (code->holds == 0 && !code->reached) {
+            ast_code_free(code);
+        } else {
+            code->reached = False;
+        }
+        code = next;
+    }
+}
+
+size_t ast_code_bytes(void) {
+    size_t bytes = 0;
+    for (ast_code_t *code = all_code; code != NULL; code = code->next) bytes += code->arena.bytes + code->image_size;
+    return bytes;
+}
+
 ast_expr_t *ast_node(type_t type) {
     assert(type > TYPE_ERR_DO_NOT_USE);
     ast_expr_t *node = (ast_expr_t *) alloc_type(type, F_NONE);
@@ -101,15 +174,17 @@ ast_expr_t *ast_op(type_t type, ast_expr_t *a, ast_expr_t *b) {
 
     node->op_args->a = a;
     node->op_args->b = b;
+    node->op_args->seen = SEEN_NOTHING;
+    node->op_args->spec = TYPE_UNKNOWN;
     return node;
 }
 
-ast_expr_t *ast_typed(ast_expr_t *expr, bytearray_t *type_name) {
-    printf("ast_typed(%s)\n", bytearray_to_c_str(type_name));
+ast_expr_t *ast_typed(ast_expr_t *expr, bytearray_t *type_name, type_t type) {
     ast_expr_t *node = ast_node(AST_TYPED);
     node->typed_expr = (ast_typed_expr_t *) alloc_type(AST_TYPED_DATA, F_NONE);
     node->typed_expr->expr = expr;
-    node->typed_expr->type_name = bytearray_clone(type_name);
+    node->typed_expr->type_name = type_name;
+    node->typed_expr->type = type;
     return node;
 }
 
@@ -128,8 +203,8 @@ ast_expr_t *ast_nil(void) {
 
 ast_expr_t *ast_typedef(bytearray_t *name, ast_expr_list_t *members) {
     ast_expr_t *node = ast_node(AST_TYPEDEF);
-    node->data_type_def = (ast_data_type_t *) alloc_type(AST_TYPEDEF, F_NONE);
-    node->data_type_def->name = bytearray_clone(name);
+    node->data_type_def = (ast_data_type_t *) alloc_type(AST_TYPEDEF_DATA, F_NONE);
+    node->data_type_def->name = name;
     node->data_type_def->members = members;
     return node;
 }
@@ -148,6 +223,15 @@ ast_expr_t *ast_list(ast_expr_list_t *nullable_init_es) {
     return node;
 }
 
+ast_expr_t *ast_set(ast_expr_list_t *nullable_init_es) {
+    ast_expr_t *node = ast_node(AST_SET);
+    gc_header_t *hdr = (gc_header_t *) node;
+    hdr->flags |= F_ENV_ASSIGNABLE;
+    node->list = (ast_list_t *) alloc_type(AST_LIST_ELEMS, F_NONE);
+    node->list->es = nullable_init_es;
+    return node;
+}
+
 ast_expr_t *ast_dict(ast_expr_kv_list_t *nullable_kvs) {
     ast_expr_t *node = ast_node(AST_DICT);
     gc_header_t *hdr = (gc_header_t *) node;
@@ -191,7 +275,7 @@ ast_expr_t *ast_array_decl(ast_expr_t *size) {
 
 ast_expr_t *ast_string(bytearray_t *s) {
     ast_expr_t *node = ast_node(AST_STRING);
-    node->bytearray = bytearray_clone(s);
+    node->bytearray = s;
     return node;
 }
 
@@ -210,7 +294,8 @@ ast_expr_t *ast_ident(bytearray_t *name) {
     ast_expr_t *node = ast_node(AST_IDENT);
     gc_header_t *hdr = (gc_header_t *) node;
     hdr->flags |= F_ENV_ASSIGNABLE;
-    node->bytearray = bytearray_clone(name);
+    // Names are interned, so they outlive the code. Env keys point at them.
+    node->bytearray = name;
     return node;
 }
 
@@ -228,7 +313,7 @@ ast_expr_t *ast_member_function_apply(ast_expr_t *expr,
 
     node->application = (ast_apply_t *) alloc_type(AST_APPLY_DATA, F_NONE);
     node->application->receiver = expr;
-    node->application->function_name = bytearray_clone(function_name);
+    node->application->function_name = function_name;
 
     node->application->args = (ast_expr_list_t *) alloc_type(AST_EXPR_LIST, F_NONE);
     node->application->args = args;
@@ -242,7 +327,8 @@ ast_expr_t *ast_member_field_get(ast_expr_t *expr,
 
     node->field = (ast_field_t *) alloc_type(AST_FIELD_DATA, F_NONE);
     node->field->receiver = expr;
-    node->field->name = bytearray_clone(field_name);
+    node->field->name = field_name;
+    node->field->slot = -1;
     return node;
 }
 
@@ -267,7 +353,7 @@ ast_expr_t *ast_range_step(ast_expr_t *expr, ast_expr_t *step) {
 ast_expr_t *ast_method_call(bytearray_t *name, ast_expr_list_t *args) {
     ast_expr_t *node = ast_node(AST_METHOD_CALL);
     node->method_call = (ast_method_t *) alloc_type(AST_METHOD_CALL_DATA, F_NONE);
-    node->method_call->name = bytearray_clone(name);
+    node->method_call->name = name;
     node->method_call->args = args;
     return node;
 }
@@ -275,7 +361,7 @@ ast_expr_t *ast_method_call(bytearray_t *name, ast_expr_list_t *args) {
 ast_expr_t *ast_field(bytearray_t *name) {
     ast_expr_t *node = ast_node(AST_FIELD_GET);
     node->field = (ast_field_t *) alloc_type(AST_FIELD_GET_DATA, F_NONE);
-    node->field->name = bytearray_clone(name);
+    node->field->name = name;
     return node;
 }
 
@@ -295,8 +381,81 @@ ast_expr_t *ast_block(ast_expr_list_t *es) {
     return node;
 }
 
+static void mark_tail_block(ast_expr_list_t *es);
+
+/* Flag the calls whose value would be the value of the function. */
+static void mark_tail(ast_expr_t *expr) {
+    if (expr == NULL) return;
+
+    switch (TYPEOF(expr)) {
+        case AST_FUNCTION_CALL:
+            FLAGS(expr->func_call) |= F_TAIL_CALL;
+            break;
+        case AST_IF_THEN:
+            mark_tail(expr->if_then_args->pred);
+            break;
+        case AST_IF_THEN_ELSE:
+            mark_tail(expr->if_then_else_args->pred);
+            mark_tail(expr->if_then_else_args->else_pred);
+            break;
+        case AST_MATCH:
+            for (ast_match_arm_t *arm = expr->match->arm_list; arm != NULL; arm = arm->next) {
+                mark_tail(arm->expr);
+            }
+            break;
+        case AST_BLOCK:
+            mark_tail_block(expr->block_exprs);
+            break;
+        case AST_FUNCTION_RETURN:
+            mark_tail_block(expr->func_return_values);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * A return makes its value the value of the enclosing block, so a return
+ * in a block in tail position, or in an if in that block, is a tail too.
+ * Other blocks and loops catch the return themselves.
+ */
+static void mark_tail_returns(ast_expr_t *expr) {
+    switch (TYPEOF(expr)) {
+        case AST_FUNCTION_RETURN:
+            mark_tail(expr);
+            break;
+        case AST_IF_THEN:
+            mark_tail_returns(expr->if_then_args->pred);
+            break;
+        case AST_IF_THEN_ELSE:
+            mark_tail_returns(expr->if_then_else_args->pred);
+            mark_tail_returns(expr->if_then_else_args->else_pred);
+            break;
+        case AST_MATCH:
+            for (ast_match_arm_t *arm = expr->match->arm_list; arm != NULL; arm = arm->next) {
+                mark_tail_returns(arm->expr);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* The last expr of a block that isn't empty gives it its value. */
+static void mark_tail_block(ast_expr_list_t *es) {
+    ast_expr_t *last = NULL;
+    for (; es != NULL; es = es->next) {
+        if (TYPEOF(es->root) == AST_EMPTY) continue;
+        mark_tail_returns(es->root);
+        last = es->root;
+    }
+    mark_tail(last);
+}
+
 ast_expr_t *ast_func_def(ast_fn_arg_decl_t *argnames,
                          ast_expr_list_t *es) {
+    mark_tail_block(es);
+
     ast_expr_t *node = ast_node(AST_FUNCTION_DEF);
     node->func_def = (ast_func_def_t *) alloc_type(AST_FUNCTION_DEF_DATA, F_NONE);
     node->func_def->argnames = argnames;
@@ -383,6 +542,168 @@ ast_expr_t *ast_for_loop(ast_expr_t *elem,
     return node;
 }
 
+ast_match_arm_t *ast_match_arm(uint8_t kind, ast_expr_t *pattern, ast_expr_t *expr) {
+    ast_match_arm_t *arm = (ast_match_arm_t *) alloc_type(AST_MATCH_ARM, F_NONE);
+    arm->kind = kind;
+    arm->pattern = pattern;
+    arm->expr = expr;
+    arm->next = NULL;
+    return arm;
+}
+
+// A jump table is made if at least this fraction of its entries are arms.
+#define MATCH_JUMP_DENSITY 4
+
+static boolean is_match_literal(ast_expr_t *pattern) {
+    switch (TYPEOF(pattern)) {
+        case AST_INT:
+        case AST_BYTE:
+        case AST_STRING:
+        case AST_BOOLEAN:
+            return True;
+        case AST_NEGATE:
+            return TYPEOF(pattern->unary_arg->a) == AST_INT;
+        default:
+            return False;
+    }
+}
+
+static int int_key(ast_expr_t *pattern) {
+    if (TYPEOF(pattern) == AST_NEGATE) return -pattern->unary_arg->a->intval;
+    return pattern->intval;
+}
+
+static int compare_keys(const void *a, const void *b) {
+    const match_key_t *x = a;
+    const match_key_t *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->arm - y->arm;
+}
+
+/* Sort the keys, keeping the first arm for each, and make a jump table if it pays. */
+static boolean build_table(match_table_t *table, match_key_t *keys, uint32_t n) {
+    qsort(keys, n, sizeof(match_key_t), compare_keys);
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (m > 0 && keys[m - 1].key == keys[i].key) continue;
+        keys[m++] = keys[i];
+    }
+
+    table->n = m;
+    table->keys = keys;
+    table->min = m > 0 ? keys[0].key : 0;
+    table->span = 0;
+    table->jump = NULL;
+    if (m == 0) return True;
+
+    int64_t span = (int64_t) keys[m - 1].key - keys[0].key + 1;
+    if (span > (int64_t) m * MATCH_JUMP_DENSITY) return True;
+
+    table->jump = mem_alloc((size_t) span * sizeof(int));
+    if (table->jump == NULL) return False;
+    for (int64_t i = 0; i < span; i++) table->jump[i] = -1;
+    for (uint32_t i = 0; i < m; i++) table->jump[keys[i].key - table->min] = keys[i].arm;
+    table->span = (uint32_t) span;
+    return True;
+}
+
+/* Open addressing, at most half full. The first arm for a string wins. */
+static boolean build_strs(ast_match_t *match, uint32_t n) {
+    match->nstrs = 0;
+    match->strs = NULL;
+    if (n == 0) return True;
+
+    uint32_t size = 2;
+    while (size < n * 2) size <<= 1;
+    match->strs = mem_alloc(size * sizeof(match_str_slot_t));
+    if (match->strs == NULL) return False;
+    mem_set(match->strs, 0, size * sizeof(match_str_slot_t));
+    match->nstrs = size;
+
+    for (int i = 0; i < match->narms; i++) {
+        ast_match_arm_t *arm = match->arms[i];
+        if (arm->kind != MATCH_LITERAL || TYPEOF(arm->pattern) != AST_STRING) continue;
+
+        bytearray_t *key = arm->pattern->bytearray;
+        uint32_t hash = bytearray_hash(key);
+        uint32_t j = hash & (size - 1);
+        while (match->strs[j].key != NULL && !bytearray_eq(match->strs[j].key, key)) {
+            j = (j + 1) & (size - 1);
+        }
+        if (match->strs[j].key != NULL) continue;
+        match->strs[j].key = key;
+        match->strs[j].hash = hash;
+        match->strs[j].arm = i;
+    }
+    return True;
+}
+
+ast_expr_t *ast_match(ast_expr_t *subject, ast_match_arm_t *arms) {
+    ast_expr_t *node = ast_node(AST_MATCH);
+    ast_match_t *match = (ast_match_t *) alloc_type(AST_MATCH_DATA, F_NONE);
+    node->match = match;
+    match->subject = subject;
+    match->arm_list = arms;
+
+    match->narms = 0;
+    for (ast_match_arm_t *arm = arms; arm != NULL; arm = arm->next) match->narms++;
+    match->arms = mem_alloc((size_t) match->narms * sizeof(ast_match_arm_t *));
+    if (match->arms == NULL) return NULL;
+
+    // Number the arms, and count the literals of each type.
+    uint32_t nints = 0;
+    uint32_t nbytes = 0;
+    uint32_t nstrs = 0;
+    match->first_guard = match->narms;
+    match->on_true = -1;
+    match->on_false = -1;
+    int i = 0;
+    for (ast_match_arm_t *arm = arms; arm != NULL; arm = arm->next, i++) {
+        match->arms[i] = arm;
+        if (arm->kind == MATCH_VALUE && is_match_literal(arm->pattern)) arm->kind = MATCH_LITERAL;
+        if (arm->kind != MATCH_LITERAL) {
+            if (match->first_guard == match->narms) match->first_guard = i;
+            continue;
+        }
+
+        switch (TYPEOF(arm->pattern)) {
+            case AST_BYTE:
+                nbytes++;
+                break;
+            case AST_STRING:
+                nstrs++;
+                break;
+            case AST_BOOLEAN:
+                if (arm->pattern->boolval && match->on_true < 0) match->on_true = i;
+                if (!arm->pattern->boolval && match->on_false < 0) match->on_false = i;
+                break;
+            default:
+                nints++;
+                break;
+        }
+    }
+
+    match_key_t *ints = mem_alloc(nints * sizeof(match_key_t));
+    match_key_t *bytes = mem_alloc(nbytes * sizeof(match_key_t));
+    if (ints == NULL || bytes == NULL) return NULL;
+    nints = 0;
+    nbytes = 0;
+    for (i = 0; i < match->narms; i++) {
+        ast_match_arm_t *arm = match->arms[i];
+        if (arm->kind != MATCH_LITERAL) continue;
+        if (TYPEOF(arm->pattern) == AST_BYTE) {
+            bytes[nbytes++] = (match_key_t) {.key = arm->pattern->byteval, .arm = i};
+        } else if (TYPEOF(arm->pattern) == AST_INT || TYPEOF(arm->pattern) == AST_NEGATE) {
+            ints[nints++] = (match_key_t) {.key = int_key(arm->pattern), .arm = i};
+        }
+    }
+
+    if (!build_table(&match->ints, ints, nints)) return NULL;
+    if (!build_table(&match->bytes, bytes, nbytes)) return NULL;
+    if (!build_strs(match, nstrs)) return NULL;
+    return node;
+}
+
 ast_expr_t *ast_break(void) {
     return ast_node(AST_BREAK);
 }
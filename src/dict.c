@@ -3,80 +3,160 @@
 #include "../inc/ptr.h"
 #include "../inc/mem.h"
 #include "../inc/list.h"
+#include "../inc/str.h"
+#include "../inc/arr.h"
+#include "../inc/record.h"
 #include "../inc/dict.h"
 
-error_t _dict_put(obj_dict_t *dict, obj_t *k, obj_t *v) {
-    obj_t *hash_obj = get_static_method(TYPEOF(k), METHOD_HASH)(k, NULL);
-    if (TYPEOF(hash_obj) == TYPE_NIL) {
-        printf("Disaster! No hash method for %s\n", type_names[TYPEOF(k)]);
-        return ERR_NO_SUCH_METHOD;
-    }
-    uint32_t hv = hash_obj->intval;
-    uint32_t bucket_index = hv % dict->buckets;
+boolean dict_key_hashable(obj_t *k) {
+    return TYPEOF(k) == TYPE_INT ||
+           TYPEOF(k) == TYPE_FLOAT ||
+           TYPEOF(k) == TYPE_STRING ||
+           TYPEOF(k) == TYPE_BYTE ||
+           TYPEOF(k) == TYPE_BOOLEAN ||
+           (TYPEOF(k) == TYPE_RECORD && record_hashable(k));
+}
 
-    obj_t *k_copy = get_static_method(TYPEOF(k), METHOD_COPY)(k, NULL);
-    if (TYPEOF(k_copy) != TYPEOF(k)) {
-        printf("Failed to copy key.\n");
-        return ERR_EVAL_UNHANDLED_OBJECT;
+uint32_t dict_key_hash(obj_t *k) {
+    switch (TYPEOF(k)) {
+        case TYPE_STRING:
+            return bytearray_hash(k->bytearray);
+        case TYPE_INT:
+            return (uint32_t) k->intval;
+        case TYPE_FLOAT: {
+            // The float's bits, copied out rather than read through a cast.
+            uint32_t bits;
+            mem_cp(&bits, &k->floatval, sizeof(bits));
+            return bits;
+        }
+        case TYPE_BYTE:
+            return (uint32_t) k->byteval;
+        case TYPE_BOOLEAN:
+            return (uint32_t) k->boolval;
+        case TYPE_RECORD:
+            return record_key_hash(k);
+        default:
+            printf("Disaster! No hash method for %s\n", type_names[TYPEOF(k)]);
+            return 0;
     }
+}
+
+boolean dict_keys_eq(obj_t *a, obj_t *b) {
+    if (TYPEOF(a) != TYPEOF(b)) return False;
+    if (TYPEOF(a) == TYPE_STRING) return bytearray_eq(a->bytearray, b->bytearray);
+    if (TYPEOF(a) == TYPE_RECORD) return record_keys_eq(a, b);
+    return obj_prim_eq(a, b);
+}
 
-    dict_kv_node_t *first = (dict_kv_node_t*) dict->nodes[bucket_index];
-    dict_kv_node_t *node = first;
-    static_method eq = get_static_method(TYPEOF(k), METHOD_EQ);
+/*
+ * Nodes are kept in order of their hashes with the bits reversed. Buckets
+ * are a power of two, say 2^k, and bucket b holds the hashes whose low k
+ * bits are b; reversed, those are the ones whose top k bits are b reversed.
+ * So an iterator that visits the buckets in that order, and each bucket's
+ * nodes in turn, visits every node in order, whatever the size of the
+ * table, and after a resize can find its place again.
+ */
+static uint32_t reverse_bits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+    x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+    x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+    return (x >> 16) | (x << 16);
+}
 
-    // See if this key is already in the dictionary.
+/* The bucket an iterator visits at the given step. */
+static uint32_t bucket_at_step(obj_dict_t *dict, uint32_t step) {
+    return reverse_bits(step) >> (32 - __builtin_ctz(dict->buckets));
+}
+
+/* The step at which an iterator visits the bucket for hv. */
+static uint32_t step_for_hash(obj_dict_t *dict, uint32_t hv) {
+    return reverse_bits(hv) >> (32 - __builtin_ctz(dict->buckets));
+}
+
+static dict_kv_node_t *find_node(obj_dict_t *dict, obj_t *k, uint32_t hv) {
+    dict_kv_node_t *node = dict->nodes[hv % dict->buckets];
     while (node != NULL) {
-        if (node->hash_val == hv &&
-            TYPEOF(node->k) == TYPEOF(k) &&
-            eq(node->k, wrap_varargs(1, k))) {
-            // There's an existing node for this key; update the value.
-            node->v = v;
-            return ERR_NO_ERROR;
+        if (node->hash_val == hv && dict_keys_eq(node->k, k)) {
+            return node;
         }
         node = node->next;
     }
+    return NULL;
+}
 
-    // Create a new node and put it in the bucket.
-    dict_kv_node_t *new_node = (dict_kv_node_t*) alloc_type(TYPE_DICT_KV_DATA, F_ENV_ASSIGNABLE);
+static error_t link_node(obj_dict_t *dict, obj_t *k, obj_t *v, uint32_t hv, flags_t flags) {
+    dict_kv_node_t *new_node = (dict_kv_node_t*) alloc_type(TYPE_DICT_KV_DATA, flags);
     if (!new_node) return ERR_OUT_OF_MEMORY;
 
     new_node->hash_val = hv;
-    new_node->k = k_copy;
+    new_node->k = k;
     new_node->v = v;
-    // Put the new node at the head of the list.
-    new_node->next = (first == NULL) ? NULL : first;
-    dict->nodes[bucket_index] = new_node;
+    // Put the new node in order, ahead of any with the same hash.
+    uint32_t order = reverse_bits(hv);
+    dict_kv_node_t **link = &dict->nodes[hv % dict->buckets];
+    while (*link != NULL && reverse_bits((*link)->hash_val) < order) {
+        link = &(*link)->next;
+    }
+    new_node->next = *link;
+    *link = new_node;
     dict->nelems++;
 
     return ERR_NO_ERROR;
 }
 
-static error_t dict_resize(obj_t *orig_obj) {
-    // Might want to be bigger or smaller.
-    size_t new_buckets =
-            DICT_INIT_BUCKETS +
-            (orig_obj->dict->nelems / DICT_INIT_BUCKETS) * DICT_INIT_BUCKETS;
+static error_t _dict_put(obj_dict_t *dict, obj_t *k, obj_t *v, flags_t flags) {
+    uint32_t hv = dict_key_hash(k);
 
-    if (new_buckets == orig_obj->dict->buckets) {
+    // See if this key is already in the dictionary.
+    dict_kv_node_t *node = find_node(dict, k, hv);
+    if (node != NULL) {
+        // There's an existing node for this key; update the value.
+        node->v = v;
         return ERR_NO_ERROR;
     }
 
-    printf("Resizing\n");
-    obj_t *new_dict_obj = (obj_t*) dict_obj_of_size(new_buckets);
+    obj_t *k_copy = get_static_method(TYPEOF(k), METHOD_COPY)(k, NULL);
+    if (TYPEOF(k_copy) != TYPEOF(k)) {
+        printf("Failed to copy key.\n");
+        return ERR_EVAL_UNHANDLED_OBJECT;
+    }
 
-    // Put all of orig's items in the new dict.
-    for (size_t i = 0; i < orig_obj->dict->buckets; i++) {
-        dict_kv_node_t *kv = orig_obj->dict->nodes[i];
-        while (kv != NULL) {
-            _dict_put(new_dict_obj->dict, kv->k, kv->v);
-            kv = kv->next;
+    return link_node(dict, k_copy, v, hv, flags);
+}
+
+/*
+ * Double the number of buckets once there are more elems than buckets.
+ *
+ * The existing nodes are moved into the new table, so nothing is copied.
+ * Bucket i splits into buckets i and i + the old size, each keeping its
+ * nodes in order. The old table is left for the GC, because an iterator
+ * may still hold it.
+ */
+static error_t dict_resize(obj_t *orig_obj) {
+    obj_dict_t *old_dict = orig_obj->dict;
+    if (old_dict->nelems <= old_dict->buckets) {
+        return ERR_NO_ERROR;
+    }
+
+    uint32_t new_buckets = old_dict->buckets * 2;
+    obj_dict_t *new_dict = (obj_dict_t *) alloc_dict(new_buckets, F_NONE);
+    if (new_dict == NULL) return ERR_OUT_OF_MEMORY;
+    new_dict->buckets = new_buckets;
+    new_dict->nelems = old_dict->nelems;
+
+    for (size_t i = 0; i < old_dict->buckets; i++) {
+        dict_kv_node_t **tails[2] = {&new_dict->nodes[i], &new_dict->nodes[i + old_dict->buckets]};
+        for (dict_kv_node_t *kv = old_dict->nodes[i]; kv != NULL; kv = kv->next) {
+            dict_kv_node_t ***tail = &tails[kv->hash_val % new_buckets != i];
+            **tail = kv;
+            *tail = &kv->next;
         }
+        *tails[0] = NULL;
+        *tails[1] = NULL;
     }
 
-    obj_dict_t *old_dict = orig_obj->dict;
-    orig_obj->dict = new_dict_obj->dict;
-    mem_free(old_dict);
-    old_dict = NULL;
+    orig_obj->dict = new_dict;
 
 #ifdef DEBUG
     printf("Resized dict. Now %d buckets for %d elems.\n",
@@ -87,18 +167,18 @@ static error_t dict_resize(obj_t *orig_obj) {
 }
 
 error_t dict_put(obj_t *obj, obj_t *k, obj_t *v) {
-    if (TYPEOF(k) != TYPE_INT &&
-        TYPEOF(k) != TYPE_FLOAT &&
-        TYPEOF(k) != TYPE_STRING &&
-        TYPEOF(k) != TYPE_BYTE &&
-        TYPEOF(k) != TYPE_BOOLEAN) {
+    return dict_put_flags(obj, k, v, F_ENV_ASSIGNABLE);
+}
+
+error_t dict_put_flags(obj_t *obj, obj_t *k, obj_t *v, flags_t flags) {
+    if (!dict_key_hashable(k)) {
         return ERR_TYPE_UNUSABLE_AS_KEY;
     }
 
     obj_dict_t *dict = obj->dict;
     error_t err;
 
-    if ((err = _dict_put(dict, k, v)) != ERR_NO_ERROR) {
+    if ((err = _dict_put(dict, k, v, flags)) != ERR_NO_ERROR) {
         return err;
     }
 
@@ -107,64 +187,39 @@ error_t dict_put(obj_t *obj, obj_t *k, obj_t *v) {
     return ERR_NO_ERROR;
 }
 
-boolean dict_contains(obj_t *dict_obj, obj_t *k) {
-    if (TYPEOF(k) != TYPE_INT &&
-        TYPEOF(k) != TYPE_FLOAT &&
-        TYPEOF(k) != TYPE_STRING &&
-        TYPEOF(k) != TYPE_BYTE &&
-        TYPEOF(k) != TYPE_BOOLEAN) {
-        return False;
+error_t dict_put_hashed(obj_t *obj, obj_t *k, obj_t *v, uint32_t hash_val) {
+    dict_kv_node_t *node = find_node(obj->dict, k, hash_val);
+    if (node != NULL) {
+        node->v = v;
+        return ERR_NO_ERROR;
     }
 
-    obj_dict_t *dict = dict_obj->dict;
-    obj_t *hash_obj = get_static_method(TYPEOF(k), METHOD_HASH)(k, NULL);
-    if (TYPEOF(hash_obj) == TYPE_NIL) {
-        printf("Disaster! No hash method for %s\n", type_names[TYPEOF(k)]);
-        return ERR_NO_SUCH_METHOD;
+    error_t err;
+    if ((err = link_node(obj->dict, k, v, hash_val, F_ENV_ASSIGNABLE)) != ERR_NO_ERROR) {
+        return err;
     }
-    uint32_t hv = hash_obj->intval;
-    uint32_t bucket_index = hv % dict->buckets;
 
-    dict_kv_node_t *node = dict->nodes[bucket_index];
-    static_method eq = get_static_method(TYPEOF(k), METHOD_EQ);
-    while (node != NULL) {
-        if (node->hash_val == hv &&
-            TYPEOF(node->k) == TYPEOF(k) &&
-            eq(node->k, wrap_varargs(1, k))) {
-            return True;
-        }
-        node = node->next;
-    }
+    return dict_resize(obj);
+}
 
-    return False;
+boolean dict_contains(obj_t *dict_obj, obj_t *k) {
+    return dict_get_node(dict_obj, k) != NULL;
 }
 
 obj_t *dict_remove(obj_t *obj, obj_t *k) {
-    if (TYPEOF(k) != TYPE_INT &&
-        TYPEOF(k) != TYPE_FLOAT &&
-        TYPEOF(k) != TYPE_STRING &&
-        TYPEOF(k) != TYPE_BYTE &&
-        TYPEOF(k) != TYPE_BOOLEAN) {
+    if (!dict_key_hashable(k)) {
         return nil_obj();
     }
 
     obj_dict_t *dict = obj->dict;
-    obj_t *hash_obj = get_static_method(TYPEOF(k), METHOD_HASH)(k, NULL);
-    if (TYPEOF(hash_obj) == TYPE_NIL) {
-        printf("Disaster! No hash method for %s\n", type_names[TYPEOF(k)]);
-        return nil_obj();
-    }
-    uint32_t hv = hash_obj->intval;
+    uint32_t hv = dict_key_hash(k);
     uint32_t bucket_index = hv % dict->buckets;
-    static_method eq = get_static_method(TYPEOF(k), METHOD_EQ);
 
     dict_kv_node_t *prev = NULL;
     dict_kv_node_t *node = dict->nodes[bucket_index];
     while (node != NULL) {
         // Remove this node and splice the list together.
-        if (node->hash_val == hv &&
-            TYPEOF(node->k) == TYPEOF(k) &&
-            eq(node->k, wrap_varargs(1, k))) {
+        if (node->hash_val == hv && dict_keys_eq(node->k, k)) {
 
             // Remove the node from the linked list.
             if (prev != NULL) {
@@ -174,15 +229,10 @@ obj_t *dict_remove(obj_t *obj, obj_t *k) {
                 // If this was the first in the list, its next is now the head.
                 dict->nodes[bucket_index] = node->next;
             }
-            obj_t *v = node->v;
-
+            // The node keeps its link, in case an iterator is sitting on it.
+            node->hdr.flags |= F_REMOVED;
             dict->nelems--;
-            dict_resize(obj);
-
-            mem_free(node);
-            node = NULL;
-
-            return v;
+            return node->v;
         }
         prev = node;
         node = node->next;
@@ -191,37 +241,21 @@ obj_t *dict_remove(obj_t *obj, obj_t *k) {
     return nil_obj();
 }
 
-obj_t *dict_get(obj_t *obj, obj_t *k) {
-    if (TYPEOF(k) != TYPE_INT &&
-        TYPEOF(k) != TYPE_FLOAT &&
-        TYPEOF(k) != TYPE_STRING &&
-        TYPEOF(k) != TYPE_BYTE &&
-        TYPEOF(k) != TYPE_BOOLEAN) {
-        return nil_obj();
+dict_kv_node_t *dict_get_node(obj_t *obj, obj_t *k) {
+    if (!dict_key_hashable(k)) {
+        return NULL;
     }
 
-    obj_dict_t *dict = obj->dict;
-    obj_t *hash_obj = get_static_method(TYPEOF(k), METHOD_HASH)(k, NULL);
-    if (TYPEOF(hash_obj) == TYPE_NIL) {
-        printf("Disaster! No hash method for %s\n", type_names[TYPEOF(k)]);
-        return nil_obj();
-    }
-    uint32_t hv = hash_obj->intval;
-    uint32_t bucket_index = hv % dict->buckets;
-
-    dict_kv_node_t *node = dict->nodes[bucket_index];
-    static_method eq = get_static_method(TYPEOF(k), METHOD_EQ);
-    while (node != NULL) {
-        if (node->hash_val == hv &&
-            TYPEOF(k) == TYPEOF(node->k) &&
-            eq(k, wrap_varargs(1, node->k))) {
-            return node->v;
-        }
+    return find_node(obj->dict, k, dict_key_hash(k));
+}
 
-        node = node->next;
-    }
+dict_kv_node_t *dict_get_node_hashed(obj_t *obj, obj_t *k, uint32_t hash_val) {
+    return find_node(obj->dict, k, hash_val);
+}
 
-    return nil_obj();
+obj_t *dict_get(obj_t *obj, obj_t *k) {
+    dict_kv_node_t *node = dict_get_node(obj, k);
+    return node == NULL ? nil_obj() : node->v;
 }
 
 obj_t *dict_obj_get(obj_t *obj, obj_varargs_t *args) {
@@ -274,7 +308,6 @@ obj_t *dict_obj_keys(obj_t *obj, obj_varargs_t *args) {
         while (kv != NULL) {
             list_append(list, wrap_varargs(1, kv->k));
             kv = kv->next;
-            printf("kv next = %p\n", kv);
         }
     }
     return list;
@@ -289,22 +322,45 @@ obj_t *dict_obj_remove(obj_t *obj, obj_varargs_t *args) {
     return dict_remove(obj, k);
 }
 
+/*
+ * The node after cursor in iteration order, in a table that cursor may
+ * have been moved into since. If cursor has been removed, its ties are
+ * taken to have been seen.
+ */
+static dict_kv_node_t *node_after(obj_dict_t *dict, dict_kv_node_t *cursor) {
+    uint32_t order = reverse_bits(cursor->hash_val);
+    dict_kv_node_t *kv = dict->nodes[cursor->hash_val % dict->buckets];
+    while (kv != NULL && reverse_bits(kv->hash_val) <= order) {
+        if (kv == cursor) return kv->next;
+        kv = kv->next;
+    }
+    return kv;
+}
+
 static obj_t *iter_next(obj_iter_t *iterable) {
+    obj_dict_t *dict = iterable->obj->dict;
+    dict_kv_node_t *kv;
+
     switch (iterable->state) {
         case ITER_NOT_STARTED:
             iterable->state = ITER_ITERATING;
-            // TODO if you're grossed out by this copy of all keys, fix it.
-            obj_t *keys = dict_obj_keys(iterable->obj, NULL);
-            iterable->state_obj->list = keys->list;
-            // Fall through to ITERATING.
+            iterable->table = dict;
+            iterable->index = 0;
+            kv = dict->nodes[bucket_at_step(dict, 0)];
+            break;
 
         case ITER_ITERATING: {
-            obj_t *elem = list_remove_first(iterable->state_obj, NULL);
-            if (TYPEOF(elem) == TYPE_NIL) {
-                iterable->state = ITER_STOPPED;
-                return nil_obj();
+            // The cursor is the node we yielded last.
+            dict_kv_node_t *cursor = iterable->cursor;
+            if (iterable->table != dict) {
+                // Resized. Pick up from the same place in the new table.
+                iterable->table = dict;
+                iterable->index = step_for_hash(dict, cursor->hash_val);
+                kv = node_after(dict, cursor);
+            } else {
+                kv = cursor->next;
             }
-            return elem;
+            break;
         }
 
         case ITER_STOPPED:
@@ -314,13 +370,30 @@ static obj_t *iter_next(obj_iter_t *iterable) {
             printf("Unexpected iteration state enum! %d\n", iterable->state);
             return nil_obj();
     }
+
+    // Skip removed nodes, moving on to the next bucket when this one runs out.
+    while (kv != NULL && (kv->hdr.flags & F_REMOVED)) {
+        kv = kv->next;
+    }
+    while (kv == NULL && ++iterable->index < dict->buckets) {
+        kv = dict->nodes[bucket_at_step(dict, (uint32_t) iterable->index)];
+    }
+
+    if (kv == NULL) {
+        iterable->state = ITER_STOPPED;
+        iterable->cursor = NULL;
+        iterable->table = NULL;
+        return nil_obj();
+    }
+
+    iterable->cursor = kv;
+    return kv->k;
 }
 
 obj_t *dict_obj_iterator(obj_t *obj, obj_varargs_t *args) {
     (void) args;
 
-    obj_t *start_state = list_obj(NULL);
-    return iterator_obj(obj, start_state, iter_next);
+    return iterator_obj(obj, iter_next);
 }
 
 static_method get_dict_static_method(static_method_ident_t method_id) {
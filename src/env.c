@@ -3,7 +3,9 @@
 #include "../inc/type.h"
 #include "../inc/dict.h"
 #include "../inc/mem.h"
+#include "../inc/ptr.h"
 #include "../inc/str.h"
+#include "../inc/opt.h"
 #include "../inc/env.h"
 
 env_t *new_env(void) {
@@ -13,64 +15,144 @@ env_t *new_env(void) {
     return env;
 }
 
+static env_segment_t *new_segment(env_segment_t *prev) {
+    env_segment_t *segment = (env_segment_t *) alloc_type(INTERP_STACK_DATA, F_NONE);
+    segment->prev = prev;
+    segment->next = NULL;
+    mem_set(segment->scopes, 0, sizeof(segment->scopes));
+    return segment;
+}
+
+env_t *scope_at(interp_t *interp, int i) {
+    env_segment_t *segment = interp->stack;
+    for (int n = i / ENV_SEGMENT_SIZE; n > 0; n--) segment = segment->next;
+    return segment->scopes[i % ENV_SEGMENT_SIZE];
+}
+
 error_t push_scope(interp_t *interp, env_t *scope) {
     interp->top += 1;
-    if (interp->top == ENV_MAX_STACK_DEPTH) {
+    int slot = interp->top % ENV_SEGMENT_SIZE;
+    if (slot == 0) {
+        if (interp->segment->next == NULL) interp->segment->next = new_segment(interp->segment);
+        interp->segment = interp->segment->next;
+    }
+
+    // Like a successful push, a failed one is undone with leave_scope().
+    if (interp->top >= interp->max_depth) {
         return ERR_ENV_MAX_DEPTH_EXCEEDED;
     }
-    interp->ret_stack[interp->top] = scope;
-    interp->env = interp->ret_stack[interp->top];
+    interp->segment->scopes[slot] = scope;
+    interp->env = scope;
     return ERR_NO_ERROR;
 }
 
+/* The scope a block left in the slot above the top, if any. */
+static env_t *spare_scope(interp_t *interp) {
+    int slot = (interp->top + 1) % ENV_SEGMENT_SIZE;
+    env_segment_t *segment = slot == 0 ? interp->segment->next : interp->segment;
+    return segment == NULL ? NULL : segment->scopes[slot];
+}
+
 error_t enter_scope(interp_t *interp) {
-    env_t *env = new_env();
+    env_t *env = spare_scope(interp);
+    if (env == NULL) env = new_env();
     env->parent = interp->env;
     return push_scope(interp, env);
 }
 
-error_t leave_scope(interp_t *interp) {
+static error_t pop_scope(interp_t *interp, boolean keep) {
     if (interp->top == 0) {
         return ERR_UNDERFLOW_ERROR;
     }
 
-    interp->ret_stack[interp->top] = NULL;
+    int slot = interp->top % ENV_SEGMENT_SIZE;
+    env_t *scope = interp->segment->scopes[slot];
+    if (keep && scope != NULL && !(FLAGS(scope) & F_ENV_CAPTURED) && scope->vars->dict->nelems == 0) {
+        scope->parent = NULL;
+    } else {
+        interp->segment->scopes[slot] = NULL;
+    }
+    if (slot == 0) interp->segment = interp->segment->prev;
     interp->top -= 1;
-    interp->env = interp->ret_stack[interp->top];
+    interp->env = interp->segment->scopes[interp->top % ENV_SEGMENT_SIZE];
 
     return ERR_NO_ERROR;
 }
 
+error_t leave_scope(interp_t *interp) {
+    return pop_scope(interp, False);
+}
+
+error_t leave_block_scope(interp_t *interp) {
+    return pop_scope(interp, True);
+}
+
+/*
+ * Wrap a name in a string object on the caller's stack for dict lookups, so
+ * that finding a name doesn't allocate. Don't let the key escape.
+ */
+#define NAME_KEY(name) ((obj_t) {.hdr = {.type = TYPE_STRING, .flags = F_NONE, .children = 1}, .bytearray = (name)})
+
+/*
+ * A typed binding takes only what its type does. An unboxed one that wasn't
+ * typed takes anything, but has to give up its own obj for a new type.
+ */
+static error_t rebind(dict_kv_node_t *found, obj_t *obj) {
+    if (found->hdr.flags & F_ENV_TYPED) {
+        obj = declared_value(TYPEOF(found->v), obj);
+        if (obj == NULL) return ERR_EVAL_TYPE_ERROR;
+    }
+
+    if (!(found->hdr.flags & F_ENV_UNBOXED)) {
+        found->v = obj;
+    } else if (TYPEOF(obj) != TYPEOF(found->v)) {
+        found->hdr.flags &= ~F_ENV_UNBOXED;
+        found->v = obj;
+    } else if (TYPEOF(obj) == TYPE_INT) {
+        found->v->intval = obj->intval;
+    } else {
+        found->v->floatval = obj->floatval;
+    }
+    return ERR_NO_ERROR;
+}
+
+/*
+ * Binding flags are kept on the dict kv node for the name, not on the bound
+ * object, so the same object (e.g., an interned Int) can be bound anywhere.
+ */
 static error_t put_env_internal(interp_t *interp,
                                 bytearray_t *name_obj,
-                                gc_header_t *obj) {
+                                obj_t *obj,
+                                flags_t flags) {
     env_t *env = interp->env;
-    obj_t *found;
+    dict_kv_node_t *found;
+    obj_t key = NAME_KEY(name_obj);
 
     // New declaration in this scope? (Can shadow.)
-    if (obj->flags & F_ENV_DECLARATION) {
-        found = dict_get(env->vars, string_obj(name_obj));
-        if (found->hdr.type != TYPE_NIL) {
+    if (flags & F_ENV_DECLARATION) {
+        found = dict_get_node(env->vars, &key);
+        if (found != NULL) {
             return ERR_ENV_SYMBOL_REDEFINED;
         }
         // Strip off the declaration flag. Don't need to preserve that.
-        obj->flags &= ~F_ENV_DECLARATION;
-        return dict_put(env->vars, string_obj(name_obj), (obj_t *) obj);
+        return dict_put_flags(env->vars, &key, obj, flags & ~F_ENV_DECLARATION);
     }
 
     // (Re-)assignment in this or a higher scope?
     while (env != NULL) {
-        found = dict_get(env->vars, string_obj(name_obj));
+        found = dict_get_node(env->vars, &key);
 
-        if (found->hdr.type != TYPE_NIL) {
+        if (found != NULL) {
             if (!(found->hdr.flags & F_ENV_MUTABLE) &&
                 !(found->hdr.flags & F_ENV_OVERWRITE)) {
                 return ERR_ENV_SYMBOL_REDEFINED;
             }
 
+            if (found->hdr.flags & (F_ENV_TYPED | F_ENV_UNBOXED)) return rebind(found, obj);
+
             // Mutate, preserving original flags.
-            obj->flags = found->hdr.flags;
-            return dict_put(env->vars, string_obj(name_obj), (obj_t *) obj);
+            found->v = obj;
+            return ERR_NO_ERROR;
         }
 
         // Keep looking in the parent env.
@@ -78,29 +160,69 @@ static error_t put_env_internal(interp_t *interp,
     }
 
     // First-time declaration of loop variable?
-    if (obj->flags & F_ENV_OVERWRITE) {
-        return dict_put(interp->env->vars, string_obj(name_obj), (obj_t *) obj);
+    if (flags & F_ENV_OVERWRITE) {
+        return dict_put_flags(interp->env->vars, &key, obj, flags);
     }
 
     return ERR_ENV_SYMBOL_UNDEFINED;
 }
 
 error_t put_env(interp_t *interp, bytearray_t *name_obj, gc_header_t *hdr) {
-    return put_env_internal(interp, name_obj, hdr);
+    return put_env_internal(interp, name_obj, (obj_t *) hdr, hdr->flags);
+}
+
+error_t put_env_with_flags(interp_t *interp, bytearray_t *name_obj, obj_t *obj, flags_t flags) {
+    return put_env_internal(interp, name_obj, obj, flags);
+}
+
+dict_kv_node_t *get_env_binding(interp_t *interp, bytearray_t *name_obj) {
+    obj_t key = NAME_KEY(name_obj);
+    return dict_get_node(interp->env->vars, &key);
+}
+
+dict_kv_node_t *find_env_binding(interp_t *interp, bytearray_t *name_obj) {
+    obj_t key = NAME_KEY(name_obj);
+    for (env_t *env = interp->env; env != NULL; env = env->parent) {
+        dict_kv_node_t *found = dict_get_node(env->vars, &key);
+        if (found != NULL) return found;
+    }
+    return NULL;
+}
+
+obj_t *declared_value(type_t type, obj_t *obj) {
+    if (TYPEOF(obj) == type) return obj;
+    if (type == TYPE_FLOAT && TYPEOF(obj) == TYPE_INT) return float_obj((float) obj->intval);
+    return NULL;
+}
+
+obj_t *unboxed_value(obj_t *obj) {
+    obj_t *own = obj_of(TYPEOF(obj));
+    if (TYPEOF(obj) == TYPE_INT) {
+        own->intval = obj->intval;
+    } else {
+        own->floatval = obj->floatval;
+    }
+    return own;
 }
 
 error_t del_env(interp_t *interp, bytearray_t *name_obj) {
-    dict_remove(interp->env->vars, string_obj(name_obj));
+    obj_t key = NAME_KEY(name_obj);
+    dict_remove(interp->env->vars, &key);
     return ERR_NO_ERROR;
 }
 
 obj_t *get_env(interp_t *interp, bytearray_t *name_obj) {
-    obj_t *found;
+    dict_kv_node_t *found;
+    obj_t key = NAME_KEY(name_obj);
     env_t *env = interp->env;
     while (env != NULL) {
-        found = dict_get(env->vars, string_obj(name_obj));
-        if (found->hdr.type != TYPE_NIL) {
-            return found;
+        found = dict_get_node(env->vars, &key);
+        if (found != NULL) {
+            // The binding's own obj is written over, so hand out its value.
+            if (found->hdr.flags & F_ENV_UNBOXED) {
+                return TYPEOF(found->v) == TYPE_INT ? int_obj(found->v->intval) : float_obj(found->v->floatval);
+            }
+            return found->v;
         }
         assert(env != env->parent);
         env = env->parent;
@@ -112,11 +234,12 @@ obj_t *get_env(interp_t *interp, bytearray_t *name_obj) {
 error_t interp_init(interp_t *interp) {
     env_t *env = new_env();
 
-    for (int i = 0; i < ENV_MAX_STACK_DEPTH; ++i) {
-        interp->ret_stack[i] = NULL;
-    }
-    interp->ret_stack[0] = env;
+    interp->stack = new_segment(NULL);
+    interp->segment = interp->stack;
+    interp->stack->scopes[0] = env;
     interp->top = 0;
+    interp->max_depth = ENV_DEFAULT_MAX_DEPTH;
+    interp->opt_level = OPT_DEFAULT_LEVEL;
     interp->env = env;
 
     return ERR_NO_ERROR;
@@ -125,8 +248,7 @@ error_t interp_init(interp_t *interp) {
 void show_env(interp_t *interp) {
     printf("interp: top %d, env %p\n", interp->top, interp->env);
     for (int i = interp->top; i >= 0; --i) {
-        printf("ret%d:\n env %p\n parent %p\n", i,
-               interp->ret_stack[i],
-               interp->ret_stack[i]->parent);
+        env_t *env = scope_at(interp, i);
+        printf("ret%d:\n env %p\n parent %p\n", i, env, env->parent);
     }
 }
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <stdio.h>
+#include <sys/resource.h>
 #include "../inc/err.h"
 #include "../inc/mem.h"
 #include "../inc/heap.h"
@@ -8,22 +9,36 @@
 #include "../inc/str.h"
 #include "../inc/list.h"
 #include "../inc/dict.h"
+#include "../inc/set.h"
+#include "../inc/vec.h"
+#include "../inc/memo.h"
+#include "../inc/record.h"
 #include "../inc/type.h"
 #include "../inc/rand.h"
 #include "../inc/eval.h"
 #include "../inc/parser.h"
+#include "../inc/opt.h"
+#include "../inc/spec.h"
 
 size_t MAX_INPUT_LINE = 80;
 
 static void eval_expr(ast_expr_t *expr, interp_t *interp, eval_result_t *result);
 
+/*
+ * Args for a method on the caller's stack, so that applying an operator
+ * doesn't allocate. Only for methods that don't keep the list.
+ */
+#define STACK_ARG(a, rest) (&(obj_varargs_t) {.hdr = {.type = TYPE_VARIABLE_ARGS, .flags = F_NONE, .children = 2}, \
+                                               .arg = (a), .next = (rest)})
+#define ONE_ARG(a) STACK_ARG(a, NULL)
+#define TWO_ARGS(a, b) STACK_ARG(a, STACK_ARG(b, NULL))
+
 static void eval_nil_expr(ast_expr_t *expr, eval_result_t *result) {
     if (TYPEOF(expr) != AST_NIL) {
         result->err = ERR_EVAL_TYPE_ERROR;
         return;
     }
-    obj_t *obj = (obj_t *) alloc_type(TYPE_NIL, F_NONE);
-    result->obj = obj;
+    result->obj = nil_obj();
 }
 
 static void eval_boolean_expr(ast_expr_t *expr, eval_result_t *result) {
@@ -56,11 +71,75 @@ static void eval_abs(ast_expr_t *expr, eval_result_t *result, interp_t *interp)
     result->obj = m(result->obj, NULL);
 }
 
+static void eval_math_fn(ast_expr_t *expr, math_fn_t fn, eval_result_t *result, interp_t *interp) {
+    eval_expr(expr, interp, result);
+    if (result->err != ERR_NO_ERROR) return;
+
+    obj_t *obj = result->obj;
+    switch (TYPEOF(obj)) {
+        case TYPE_INT:
+            result->obj = float_obj(math_apply(fn, (float) obj->intval));
+            break;
+        case TYPE_FLOAT:
+            result->obj = float_obj(math_apply(fn, obj->floatval));
+            break;
+        case TYPE_INT_ARRAY:
+        case TYPE_FLOAT_ARRAY:
+            result->obj = vec_map(obj, fn);
+            break;
+        default:
+            result->err = ERR_EVAL_TYPE_ERROR;
+            result->obj = nil_obj();
+    }
+}
+
+static void eval_vec(ast_expr_t *expr, type_t type, eval_result_t *result, interp_t *interp) {
+    eval_expr(expr, interp, result);
+    if (result->err != ERR_NO_ERROR) return;
+
+    result->obj = vec_of(type, result->obj);
+    if (TYPEOF(result->obj) == TYPE_NIL) result->err = ERR_EVAL_TYPE_ERROR;
+    if (TYPEOF(result->obj) == TYPE_ERROR) result->err = result->obj->errval;
+}
+
+static void eval_memo(ast_expr_list_t *args, eval_result_t *result, interp_t *interp) {
+    eval_expr(args->root, interp, result);
+    if (result->err != ERR_NO_ERROR) return;
+
+    obj_t *fn = result->obj;
+    if (TYPEOF(fn) != TYPE_FUNCTION) {
+        printf("memo() takes a function.\n");
+        result->err = ERR_EVAL_TYPE_ERROR;
+        return;
+    }
+
+    int max_size = 0;
+    if (args->next != NULL) {
+        eval_expr(args->next->root, interp, result);
+        if (result->err != ERR_NO_ERROR) return;
+
+        if (TYPEOF(result->obj) != TYPE_INT || result->obj->intval < 1) {
+            printf("memo() size must be a positive Int.\n");
+            result->err = ERR_EVAL_TYPE_ERROR;
+            return;
+        }
+        max_size = result->obj->intval;
+    }
+
+    result->obj = memo_fn(fn, max_size);
+}
+
 static void eval_type_of(ast_expr_t *expr, eval_result_t *result, interp_t *interp) {
     eval_expr(expr, interp, result);
 
     if (result->err != ERR_NO_ERROR) return;
 
+    // A record is of the type it was made with.
+    if (TYPEOF(result->obj) == TYPE_RECORD) {
+        result->obj = string_obj(bytearray_clone(result->obj->record->type->name));
+        return;
+    }
+
     result->obj = string_obj(c_str_to_bytearray(type_names[TYPEOF(result->obj)]));
 }
 
@@ -183,6 +262,29 @@ static void eval_dict_expr(ast_dict_t *expr, eval_result_t *result, interp_t *in
     result->obj = dict;
 }
 
+static void eval_set_expr(ast_list_t *list, eval_result_t *result, interp_t *interp) {
+    size_t n = 0;
+    for (ast_expr_list_t *node = list->es; node != NULL; node = node->next) n++;
+
+    obj_t *set = set_obj_of_size(n);
+
+    for (ast_expr_list_t *node = list->es; node != NULL; node = node->next) {
+        eval_expr(node->root, interp, result);
+        if (result->err != ERR_NO_ERROR) {
+            result->obj = nil_obj();
+            return;
+        }
+
+        if ((result->err = set_add(set, result->obj)) != ERR_NO_ERROR) {
+            printf("Can't put %s in a set.\n", type_names[TYPEOF(result->obj)]);
+            result->obj = nil_obj();
+            return;
+        }
+    }
+
+    result->obj = set;
+}
+
 static void eval_block_expr_in_scope(ast_expr_list_t *block_exprs,
                                      eval_result_t *result,
                                      interp_t *interp) {
@@ -199,7 +301,7 @@ static void eval_block_expr_in_scope(ast_expr_list_t *block_exprs,
             return;
         }
 
-        if (TYPEOF(result->obj) == TYPE_BREAK) return;
+        if (TYPEOF(result->obj) == TYPE_BREAK || TYPEOF(result->obj) == TYPE_TAIL_CALL) return;
 
         if (TYPEOF(result->obj) == TYPE_CONTINUE) break;
 
@@ -213,24 +315,399 @@ static void eval_block_expr_in_scope(ast_expr_list_t *block_exprs,
 }
 
 static void eval_block_expr(ast_expr_list_t *block_exprs, eval_result_t *result, interp_t *interp) {
-    enter_scope(interp);
+    if ((result->err = enter_scope(interp)) != ERR_NO_ERROR) {
+        leave_scope(interp);
+        result->obj = nil_obj();
+        return;
+    }
     eval_block_expr_in_scope(block_exprs, result, interp);
-    leave_scope(interp);
+    leave_block_scope(interp);
     //gc(interp);
 }
 
 static void eval_return_expr(ast_expr_list_t *block_exprs, eval_result_t *result, interp_t *interp) {
-    enter_scope(interp);
+    if ((result->err = enter_scope(interp)) != ERR_NO_ERROR) {
+        leave_scope(interp);
+        result->obj = nil_obj();
+        return;
+    }
     eval_block_expr_in_scope(block_exprs, result, interp);
-    // Wrap the return obj.
-    result->obj = return_val(result->obj);
-    leave_scope(interp);
+    // Wrap the return obj. A tail call already ends the block it's in.
+    if (TYPEOF(result->obj) != TYPE_TAIL_CALL) result->obj = return_val(result->obj);
+    leave_block_scope(interp);
     //gc(interp);
 }
 
-/* Wrap the function pointer in an obj. */
+/*
+ * Where the outermost eval() started on the C stack, and how far calls may
+ * take it from there. The limit leaves a quarter of the stack for natives
+ * and the evaluation of the deepest call.
+ */
+static char *c_stack_base = NULL;
+static size_t c_stack_limit = 0;
+
+static void init_c_stack(char *base) {
+    struct rlimit rl;
+    size_t size = 8 * 1024 * 1024;
+    if (getrlimit(RLIMIT_STACK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) size = rl.rlim_cur;
+
+    c_stack_base = base;
+    c_stack_limit = size / 4 * 3;
+}
+
+static boolean c_stack_exhausted(void) {
+    char here;
+    return c_stack_base != NULL && (size_t) (c_stack_base - &here) > c_stack_limit;
+}
+
+/*
+ * Wrap the function pointer in an obj. The scope it closes over, and every
+ * scope above, must outlive the call that made them.
+ */
+// The code being run. Functions defined now are made from it.
+static ast_code_t *running_code = NULL;
+
+/*
+ * The function run_fn() is running, and its scope. A call in tail position
+ * replaces them, and hands back obj to say so.
+ */
+typedef struct {
+    obj_t obj;
+    obj_t *fn;
+    env_t *env;
+} tail_call_t;
+
+static tail_call_t *running_call = NULL;
+
 static void eval_func_def(ast_func_def_t *func_def, eval_result_t *result, interp_t *interp) {
+    for (env_t *env = interp->env; env != NULL && !(FLAGS(env) & F_ENV_CAPTURED); env = env->parent) {
+        FLAGS(env) |= F_ENV_CAPTURED;
+    }
     result->obj = func_obj((void *) func_def, interp->env);
+    result->obj->func_def->program = running_code;
+    ast_code_add_fn(running_code);
+}
+
+/* Create the scope for a call to the function obj, whose parent is the scope it was defined in. */
+static env_t *fn_env(obj_t *obj) {
+    env_t *func_env = new_env();
+    func_env->parent = (env_t *) obj->func_def->scope;
+    return func_env;
+}
+
+/* Bind obj to the arg's name in func_env, if it's what the arg was declared as. */
+static error_t bind_arg(ast_fn_arg_decl_t *argname, obj_t *obj, env_t *func_env) {
+    obj_t key = {.hdr = {.type = TYPE_STRING, .flags = F_NONE, .children = 1}, .bytearray = argname->name};
+    if (argname->type == TYPE_UNKNOWN) return dict_put((obj_t *) func_env->vars, &key, obj);
+
+    obj_t *val = declared_value(argname->type, obj);
+    if (val == NULL) {
+        printf("%s required, not %s.\n", type_names[argname->type], type_names[TYPEOF(obj)]);
+        return ERR_EVAL_TYPE_ERROR;
+    }
+    return dict_put_flags((obj_t *) func_env->vars, &key, val, F_ENV_ASSIGNABLE | F_ENV_TYPED);
+}
+
+/* Bind args to the names of obj's args in func_env. */
+static error_t bind_args(obj_t *obj, obj_varargs_t *args, env_t *func_env) {
+    ast_func_def_t *fn = (ast_func_def_t *) obj->func_def->code;
+
+    for (ast_fn_arg_decl_t *argnames = fn->argnames; argnames != NULL; argnames = argnames->next) {
+        if (args == NULL) return ERR_WRONG_ARG_COUNT;
+
+        error_t err = bind_arg(argnames, args->arg, func_env);
+        if (err != ERR_NO_ERROR) return err;
+        args = args->next;
+    }
+    return ERR_NO_ERROR;
+}
+
+/* True if no closure has kept func_env, a scope of obj's, and it holds nothing but the args. */
+static boolean args_only_env(obj_t *obj, env_t *func_env) {
+    if (FLAGS(func_env) & F_ENV_CAPTURED) return False;
+
+    size_t nargs = 0;
+    ast_func_def_t *fn = (ast_func_def_t *) obj->func_def->code;
+    for (ast_fn_arg_decl_t *argnames = fn->argnames; argnames != NULL; argnames = argnames->next) nargs++;
+    return func_env->vars->dict->nelems == nargs;
+}
+
+/*
+ * A self call can rebind its args in the scope of the call it replaces, as
+ * long as no closure has kept that scope and the body declared nothing else.
+ */
+static boolean reusable_env(obj_t *obj, obj_t *next, env_t *func_env) {
+    if (next->func_def->code != obj->func_def->code) return False;
+    if (next->func_def->scope != obj->func_def->scope) return False;
+    return args_only_env(obj, func_env);
+}
+
+/*
+ * Run the body of the function obj with its args already bound in func_env.
+ * A call in tail position binds its args and comes back as call.obj instead
+ * of being made, and is run here in place of the one that returned it, so a
+ * loop written as recursion needs no more stack than a single call.
+ */
+static void run_fn(obj_t *obj, env_t *func_env, eval_result_t *result, interp_t *interp) {
+    ast_code_t *caller_code = running_code;
+    tail_call_t *caller_call = running_call;
+    tail_call_t call = {.obj = {.hdr = {.type = TYPE_TAIL_CALL, .flags = F_NONE, .children = 0}},
+                        .fn = obj, .env = func_env};
+    running_call = &call;
+
+    for (;;) {
+        ast_func_def_t *fn = (ast_func_def_t *) obj->func_def->code;
+
+        /* Push the scope the function was defined in. */
+        env_t *scope = (env_t *) obj->func_def->scope;
+        error_t err = push_scope(interp, scope);
+
+        if ((result->err = err) != ERR_NO_ERROR) {
+            leave_scope(interp);
+            result->obj = nil_obj();
+            break;
+        }
+
+        err = push_scope(interp, call.env);
+        if (err == ERR_NO_ERROR && c_stack_exhausted()) err = ERR_ENV_MAX_DEPTH_EXCEEDED;
+        if (err == ERR_NO_ERROR && heap_exhausted()) err = ERR_OUT_OF_MEMORY;
+        if ((result->err = err) != ERR_NO_ERROR) {
+            leave_scope(interp);
+            leave_scope(interp);
+            result->obj = nil_obj();
+            break;
+        }
+
+        running_code = (ast_code_t *) obj->func_def->program;
+        ast_code_hold(running_code);
+        eval_block_expr_in_scope(fn->block_exprs, result, interp);
+        ast_code_release(running_code);
+        running_code = caller_code;
+        leave_scope(interp);
+        leave_scope(interp);
+
+        if (result->err != ERR_NO_ERROR || result->obj != &call.obj) break;
+        obj = call.fn;
+    }
+
+    running_call = caller_call;
+}
+
+/* Eval the args of a call, up to the first empty one, in the current scope. */
+static obj_varargs_t *eval_args(ast_expr_list_t *callargs, eval_result_t *result, interp_t *interp) {
+    obj_varargs_t *args = NULL;
+    obj_varargs_t *last = NULL;
+    for (; callargs != NULL && TYPEOF(callargs->root) != AST_EMPTY; callargs = callargs->next) {
+        eval_expr(callargs->root, interp, result);
+        if (result->err != ERR_NO_ERROR) return NULL;
+
+        obj_varargs_t *arg = (obj_varargs_t *) alloc_type(TYPE_VARIABLE_ARGS, F_NONE);
+        arg->arg = result->obj;
+        arg->next = NULL;
+        if (last == NULL) {
+            args = arg;
+        } else {
+            last->next = arg;
+        }
+        last = arg;
+    }
+    return args;
+}
+
+/*
+ * Call a memoized function. All the args are evaluated up front, since
+ * they're the key to its results.
+ */
+static void eval_memo_call(obj_t *obj, ast_expr_list_t *callargs, eval_result_t *result, interp_t *interp) {
+    obj_varargs_t *args = eval_args(callargs, result, interp);
+    if (result->err != ERR_NO_ERROR) return;
+
+    obj_t *val = memo_get(obj, args);
+    if (val != NULL) {
+        result->obj = val;
+        return;
+    }
+
+    env_t *func_env = fn_env(obj);
+    if ((result->err = bind_args(obj, args, func_env)) != ERR_NO_ERROR) return;
+
+    run_fn(obj, func_env, result, interp);
+    if (result->err == ERR_NO_ERROR) memo_put(obj, args, result->obj);
+}
+
+/*
+ * Eval the args of a call in tail position, bind them, and leave the call
+ * to run_fn(). A self call rebinds them in the scope it's running in, so a
+ * loop of them allocates nothing.
+ */
+static void eval_tail_call(obj_t *obj, ast_expr_list_t *callargs, eval_result_t *result, interp_t *interp) {
+    ast_func_def_t *fn = (ast_func_def_t *) obj->func_def->code;
+    size_t nargs = 0;
+    for (ast_fn_arg_decl_t *argnames = fn->argnames; argnames != NULL; argnames = argnames->next) nargs++;
+
+    // Every arg is evaluated before any is bound, since they may use the old ones.
+    obj_t *args[nargs + 1];
+    for (size_t i = 0; i < nargs; i++, callargs = callargs->next) {
+        if (callargs == NULL) {
+            result->err = ERR_WRONG_ARG_COUNT;
+            return;
+        }
+        eval_expr(callargs->root, interp, result);
+        if (result->err != ERR_NO_ERROR) return;
+        args[i] = result->obj;
+    }
+
+    tail_call_t *call = running_call;
+    env_t *func_env = reusable_env(call->fn, obj, call->env) ? call->env : fn_env(obj);
+    size_t i = 0;
+    for (ast_fn_arg_decl_t *argnames = fn->argnames; argnames != NULL; argnames = argnames->next) {
+        if ((result->err = bind_arg(argnames, args[i++], func_env)) != ERR_NO_ERROR) return;
+    }
+
+    call->fn = obj;
+    call->env = func_env;
+    result->obj = &call->obj;
+}
+
+/* The member's field declaration, and its type, or null if it isn't one. */
+static ast_expr_t *field_decl(ast_expr_t *member, type_t *type) {
+    *type = TYPE_UNKNOWN;
+    if (TYPEOF(member) == AST_TYPED) {
+        *type = member->typed_expr->type;
+        member = member->typed_expr->expr;
+    }
+    if (TYPEOF(member) != AST_IDENT || !(FLAGS(member) & F_ENV_DECLARATION)) return NULL;
+    return member;
+}
+
+/*
+ * A record type's fields are the val and var declarations in its block,
+ * in slot order. The type is bound to its name like a val.
+ */
+static void eval_typedef(ast_data_type_t *def, eval_result_t *result, interp_t *interp) {
+    uint32_t nfields = 0;
+    for (ast_expr_list_t *es = def->members; es != NULL; es = es->next) {
+        if (TYPEOF(es->root) != AST_EMPTY) nfields++;
+    }
+
+    obj_t *obj = record_type_obj(def->name, nfields);
+    if (TYPEOF(obj) == TYPE_NIL) {
+        result->err = ERR_OUT_OF_MEMORY;
+        goto error;
+    }
+
+    record_field_t *fields = obj->record_type->fields;
+    uint32_t i = 0;
+    for (ast_expr_list_t *es = def->members; es != NULL; es = es->next) {
+        if (TYPEOF(es->root) == AST_EMPTY) continue;
+
+        type_t type;
+        ast_expr_t *ident = field_decl(es->root, &type);
+        if (ident == NULL) {
+            printf("Fields are declared with val or var.\n");
+            result->err = ERR_SYNTAX_ERROR;
+            goto error;
+        }
+        for (uint32_t j = 0; j < i; j++) {
+            if (bytearray_eq(fields[j].name, ident->bytearray)) {
+                result->err = ERR_ENV_SYMBOL_REDEFINED;
+                goto error;
+            }
+        }
+
+        fields[i].name = ident->bytearray;
+        fields[i].type = type;
+        fields[i].flags = FLAGS(ident) & F_ENV_MUTABLE;
+        i++;
+    }
+
+    result->err = put_env_with_flags(interp, def->name, obj, F_ENV_ASSIGNABLE | F_ENV_DECLARATION);
+    if (result->err != ERR_NO_ERROR) goto error;
+    result->obj = obj;
+    return;
+
+    error:
+    result->obj = nil_obj();
+}
+
+/* What to keep in the field for obj, or null if the field doesn't take it. */
+static obj_t *field_value(record_field_t *field, obj_t *obj) {
+    if (field->type == TYPE_UNKNOWN) return obj;
+
+    obj_t *value = declared_value(field->type, obj);
+    if (value == NULL) {
+        printf("%s required, not %s.\n", type_names[field->type], type_names[TYPEOF(obj)]);
+    }
+    return value;
+}
+
+/* Calling a record type makes one, with the args for its fields in order. */
+static void eval_record_new(obj_t *type, ast_expr_list_t *args, eval_result_t *result, interp_t *interp) {
+    obj_record_type_t *layout = type->record_type;
+    obj_t *obj = record_obj(type);
+    if (TYPEOF(obj) == TYPE_NIL) {
+        result->err = ERR_OUT_OF_MEMORY;
+        goto error;
+    }
+
+    uint32_t i = 0;
+    for (; args != NULL; args = args->next) {
+        if (TYPEOF(args->root) == AST_EMPTY) continue;
+        if (i == layout->nfields) break;
+
+        eval_expr(args->root, interp, result);
+        if (result->err != ERR_NO_ERROR) goto error;
+
+        obj_t *value = field_value(&layout->fields[i], result->obj);
+        if (value == NULL) {
+            result->err = ERR_EVAL_TYPE_ERROR;
+            goto error;
+        }
+        obj->record->slots[i++] = value;
+    }
+
+    if (i != layout->nfields || args != NULL) {
+        result->err = ERR_WRONG_ARG_COUNT;
+        goto error;
+    }
+
+    result->obj = obj;
+    return;
+
+    error:
+    result->obj = nil_obj();
+}
+
+/*
+ * The slot of the field in the record obj, or -1 if it has none. Each
+ * field expr remembers the slot it found, and tries it first next time.
+ */
+static int field_slot(ast_field_t *field, obj_t *obj, eval_result_t *result) {
+    if (TYPEOF(obj) != TYPE_RECORD) {
+        printf("%s has no fields.\n", type_names[TYPEOF(obj)]);
+        result->err = ERR_NO_SUCH_FIELD;
+        result->obj = nil_obj();
+        return -1;
+    }
+
+    int slot = record_slot(obj->record->type, field->name, field->slot);
+    if (slot < 0) {
+        result->err = ERR_NO_SUCH_FIELD;
+        result->obj = nil_obj();
+        return -1;
+    }
+    field->slot = slot;
+    return slot;
+}
+
+static void eval_field(ast_field_t *field, eval_result_t *result, interp_t *interp) {
+    eval_expr(field->receiver, interp, result);
+    if (result->err != ERR_NO_ERROR) return;
+
+    obj_t *obj = result->obj;
+    int slot = field_slot(field, obj, result);
+    if (slot < 0) return;
+    result->obj = obj->record->slots[slot];
 }
 
 static void eval_func_call(ast_func_call_t *func_call, eval_result_t *result, interp_t *interp) {
@@ -242,55 +719,100 @@ static void eval_func_call(ast_func_call_t *func_call, eval_result_t *result, in
     }
     obj_t *obj = result->obj;
 
+    if (TYPEOF(obj) == TYPE_RECORD_TYPE) {
+        eval_record_new(obj, func_call->args, result, interp);
+        return;
+    }
+
     if (TYPEOF(obj) != TYPE_FUNCTION) {
         result->err = ERR_FUNCTION_UNDEFINED;
         result->obj = nil_obj();
         return;
     }
 
+    if (obj->func_def->memo != NULL) {
+        eval_memo_call(obj, func_call->args, result, interp);
+        return;
+    }
+
+    if (FLAGS(func_call) & F_TAIL_CALL) {
+        eval_tail_call(obj, func_call->args, result, interp);
+        return;
+    }
+
     ast_func_def_t *fn = (ast_func_def_t *) obj->func_def->code;
     ast_fn_arg_decl_t *argnames = fn->argnames;
     ast_expr_list_t *callargs = func_call->args;
     error_t err;
 
-    /* Push the scope the function was defined in. */
-    env_t *scope = (env_t *) obj->func_def->scope;
-
     /* Eval function args in parent scope, and create a new scope for the result. */
-    env_t *func_env = new_env();
-    func_env->parent = scope;
+    env_t *func_env = fn_env(obj);
 
     while (argnames != NULL) {
         if (callargs == NULL) {
             result->err = ERR_WRONG_ARG_COUNT;
-            goto error;
+            return;
         }
-        bytearray_t *name = argnames->name;
         eval_expr(callargs->root, interp, result);
-        err = dict_put((obj_t *) func_env->vars, string_obj(name), result->obj);
+        err = bind_arg(argnames, result->obj, func_env);
         if (err != ERR_NO_ERROR) {
             result->err = err;
-            goto error;
+            return;
         }
 
         argnames = argnames->next;
         callargs = callargs->next;
     }
 
-    err = push_scope(interp, scope);
+    run_fn(obj, func_env, result, interp);
+}
 
-    if ((result->err = err) != ERR_NO_ERROR) {
-        leave_scope(interp);
-        result->obj = nil_obj();
-        return;
+// The interpreter inside eval(), for native code that calls back into the language.
+static interp_t *running_interp = NULL;
+
+/* A copy on the heap of args, which may be on the caller's stack. */
+static obj_varargs_t *copy_args(obj_varargs_t *args) {
+    obj_varargs_t *copy = NULL;
+    obj_varargs_t **last = &copy;
+    for (; args != NULL; args = args->next) {
+        *last = (obj_varargs_t *) alloc_type(TYPE_VARIABLE_ARGS, F_NONE);
+        (*last)->arg = args->arg;
+        (*last)->next = NULL;
+        last = &(*last)->next;
     }
+    return copy;
+}
 
-    push_scope(interp, func_env);
-    eval_block_expr_in_scope(fn->block_exprs, result, interp);
-    leave_scope(interp);
+obj_t *call_fn_in_scope(obj_t *obj, obj_varargs_t *args, void **scope) {
+    if (running_interp == NULL || TYPEOF(obj) != TYPE_FUNCTION) return error_obj(ERR_FUNCTION_UNDEFINED);
 
-    error:
-    leave_scope(interp);
+    boolean memoized = obj->func_def->memo != NULL;
+    if (memoized) {
+        obj_t *val = memo_get(obj, args);
+        if (val != NULL) return val;
+    }
+
+    // Take the scope while the call runs, so a call from inside it makes its own.
+    env_t *func_env = (env_t *) *scope;
+    *scope = NULL;
+    if (func_env == NULL || !args_only_env(obj, func_env)) func_env = fn_env(obj);
+
+    eval_result_t result = {.hdr = {.type = EVAL_RESULT, .flags = F_NONE, .children = 1},
+                            .obj = NULL, .err = ERR_NO_ERROR};
+    result.err = bind_args(obj, args, func_env);
+    if (result.err == ERR_NO_ERROR) run_fn(obj, func_env, &result, running_interp);
+    *scope = func_env;
+    if (result.err != ERR_NO_ERROR) return error_obj(result.err);
+    if (TYPEOF(result.obj) == TYPE_ERROR) return result.obj;
+
+    // The memo keeps its key.
+    if (memoized) memo_put(obj, copy_args(args), result.obj);
+    return result.obj;
+}
+
+obj_t *call_fn(obj_t *obj, obj_varargs_t *args) {
+    void *scope = NULL;
+    return call_fn_in_scope(obj, args, &scope);
 }
 
 static void eval_string_expr(ast_expr_t *expr, eval_result_t *result) {
@@ -298,8 +820,13 @@ static void eval_string_expr(ast_expr_t *expr, eval_result_t *result) {
         result->err = ERR_EVAL_TYPE_ERROR;
         return;
     }
-    obj_t *obj = string_obj(expr->bytearray);
-    result->obj = obj;
+    // An interned literal outlives its code, and every string made from it
+    // shares it until one is written to. Interned bytes are the only ones
+    // in code marked copy-on-write. Any other literal goes with its code,
+    // so the string gets a copy.
+    bytearray_t *literal = expr->bytearray;
+    if (!(FLAGS(literal) & F_COPY_ON_WRITE)) literal = bytearray_clone(literal);
+    result->obj = string_obj(literal);
 }
 
 static void is_type(obj_t *obj, obj_t *type_obj, eval_result_t *result) {
@@ -323,7 +850,7 @@ static void cast(obj_t *obj, obj_t *type_obj, eval_result_t *result) {
         return;
     }
 
-    result->obj = m(obj, wrap_varargs(1, type_obj));
+    result->obj = m(obj, ONE_ARG(type_obj));
 }
 
 static void list_subscript_assign(obj_t *obj,
@@ -337,7 +864,7 @@ static void list_subscript_assign(obj_t *obj,
     eval_expr(rhs, interp, result);
     if (result->err != ERR_NO_ERROR) goto error;
     obj_t *val = result->obj;
-    result->obj = list_set(obj, wrap_varargs(2, offset, val));
+    result->obj = list_set(obj, TWO_ARGS(offset, val));
     return;
 
     error:
@@ -355,7 +882,25 @@ static void arr_subscript_assign(obj_t *obj,
     eval_expr(rhs, interp, result);
     if (result->err != ERR_NO_ERROR) goto error;
     obj_t *val = result->obj;
-    result->obj = arr_set(obj, wrap_varargs(2, offset, val));
+    result->obj = arr_set(obj, TWO_ARGS(offset, val));
+    return;
+
+    error:
+    result->obj = nil_obj();
+}
+
+static void vec_subscript_assign(obj_t *obj,
+                                 ast_expr_t *lhs,
+                                 ast_expr_t *rhs,
+                                 eval_result_t *result,
+                                 interp_t *interp) {
+    eval_expr(lhs->op_args->b, interp, result);
+    if (result->err != ERR_NO_ERROR) goto error;
+    obj_t *offset = result->obj;
+    eval_expr(rhs, interp, result);
+    if (result->err != ERR_NO_ERROR) goto error;
+    obj_t *val = result->obj;
+    result->obj = vec_set(obj, TWO_ARGS(offset, val));
     return;
 
     error:
@@ -373,12 +918,86 @@ static void dict_subscript_assign(obj_t *obj,
     eval_expr(rhs, interp, result);
     if (result->err != ERR_NO_ERROR) goto error;
     obj_t *v = result->obj;
-    result->obj = dict_obj_put(obj, wrap_varargs(2, k, v));
+    result->obj = dict_obj_put(obj, TWO_ARGS(k, v));
+    return;
+
+    error:
+    result->obj = nil_obj();
+
+}
+
+/*
+ * Declare a name with a type. The value is checked here, and after this
+ * the binding only takes that type. A var of Ints or Floats is unboxed.
+ */
+static void assign_typed(ast_typed_expr_t *typed,
+                         ast_expr_t *rhs,
+                         eval_result_t *result,
+                         interp_t *interp) {
+    ast_expr_t *ident = typed->expr;
+    if (TYPEOF(ident) != AST_IDENT || !(FLAGS(ident) & F_ENV_DECLARATION)) {
+        result->err = ERR_LHS_NOT_ASSIGNABLE;
+        goto error;
+    }
+
+    eval_expr(rhs, interp, result);
+    if (result->err != ERR_NO_ERROR) goto error;
+
+    obj_t *obj = declared_value(typed->type, result->obj);
+    if (obj == NULL) {
+        printf("%s required, not %s.\n", type_names[typed->type], type_names[TYPEOF(result->obj)]);
+        result->err = ERR_EVAL_TYPE_ERROR;
+        goto error;
+    }
+
+    flags_t flags = FLAGS(ident) | F_ENV_TYPED;
+    obj_t *bound = obj;
+    if ((flags & F_ENV_MUTABLE) && (typed->type == TYPE_INT || typed->type == TYPE_FLOAT)) {
+        flags |= F_ENV_UNBOXED;
+        bound = unboxed_value(obj);
+    }
+    result->err = put_env_with_flags(interp, ident->bytearray, bound, flags);
+    if (result->err != ERR_NO_ERROR) goto error;
+
+    result->obj = obj;
+    return;
+
+    error:
+    result->obj = nil_obj();
+}
+
+/* Only fields declared with var can be assigned, and only what they take. */
+static void assign_field(ast_field_t *field,
+                         ast_expr_t *rhs,
+                         eval_result_t *result,
+                         interp_t *interp) {
+    eval_expr(field->receiver, interp, result);
+    if (result->err != ERR_NO_ERROR) goto error;
+
+    obj_t *obj = result->obj;
+    int slot = field_slot(field, obj, result);
+    if (slot < 0) return;
+
+    record_field_t *decl = &obj->record->type->fields[slot];
+    if (!(decl->flags & F_ENV_MUTABLE)) {
+        result->err = ERR_LHS_NOT_ASSIGNABLE;
+        goto error;
+    }
+
+    eval_expr(rhs, interp, result);
+    if (result->err != ERR_NO_ERROR) goto error;
+
+    obj_t *value = field_value(decl, result->obj);
+    if (value == NULL) {
+        result->err = ERR_EVAL_TYPE_ERROR;
+        goto error;
+    }
+    obj->record->slots[slot] = value;
+    result->obj = value;
     return;
 
     error:
     result->obj = nil_obj();
-
 }
 
 static void assign(ast_expr_t *lhs,
@@ -400,6 +1019,10 @@ static void assign(ast_expr_t *lhs,
             case TYPE_BYTEARRAY:
                 arr_subscript_assign(obj, lhs, rhs, result, interp);
                 return;
+            case TYPE_INT_ARRAY:
+            case TYPE_FLOAT_ARRAY:
+                vec_subscript_assign(obj, lhs, rhs, result, interp);
+                return;
             case TYPE_DICT:
                 dict_subscript_assign(obj, lhs, rhs, result, interp);
                 return;
@@ -410,6 +1033,16 @@ static void assign(ast_expr_t *lhs,
         }
     }
 
+    if (TYPEOF(lhs) == AST_TYPED) {
+        assign_typed(lhs->typed_expr, rhs, result, interp);
+        return;
+    }
+
+    if (TYPEOF(lhs) == AST_FIELD) {
+        assign_field(lhs->field, rhs, result, interp);
+        return;
+    }
+
     if (!(FLAGS(lhs) & F_ENV_ASSIGNABLE)) {
         result->err = ERR_LHS_NOT_ASSIGNABLE;
         return;
@@ -421,8 +1054,7 @@ static void assign(ast_expr_t *lhs,
     if (TYPEOF(rhs) == AST_FUNCTION_DEF) {
         eval_func_def(rhs->func_def, result, interp);
         if (result->err != ERR_NO_ERROR) goto error;
-        ((gc_header_t *) result->obj)->flags = FLAGS(lhs);
-        error = put_env(interp, name, (gc_header_t*) result->obj);
+        error = put_env_with_flags(interp, name, result->obj, FLAGS(lhs));
         if (error != ERR_NO_ERROR) {
             result->err = error;
             goto error;
@@ -432,9 +1064,8 @@ static void assign(ast_expr_t *lhs,
 
     eval_expr(rhs, interp, result);
     if (result->err != ERR_NO_ERROR) goto error;
-    // Absorb lhs flags into the object we're saving.
-    ((gc_header_t *) result->obj)->flags = FLAGS(lhs);
-    result->err = put_env(interp, name, (gc_header_t*) result->obj);
+    // Bind with the lhs flags (val, var, etc.).
+    result->err = put_env_with_flags(interp, name, result->obj, FLAGS(lhs));
     if (result->err != ERR_NO_ERROR) goto error;
 
     return;
@@ -468,8 +1099,13 @@ static void cmp(type_t type, obj_t *a, obj_t *b, eval_result_t *result) {
             result->err = ERR_EVAL_TYPE_ERROR;
             return;
     }
+    if (m == NULL) {
+        printf("Can't compare %s.\n", type_names[TYPEOF(a)]);
+        result->err = ERR_NO_SUCH_METHOD;
+        return;
+    }
 
-    result->obj = m(a, wrap_varargs(1, b));
+    result->obj = m(a, ONE_ARG(b));
 }
 
 static void member_of(obj_t *a, obj_t *b, eval_result_t *result) {
@@ -479,7 +1115,7 @@ static void member_of(obj_t *a, obj_t *b, eval_result_t *result) {
         return;
     }
 
-    result->obj = m(b, wrap_varargs(1, a));
+    result->obj = m(b, ONE_ARG(a));
 }
 
 static void subscript_of(obj_t *a, obj_t *b, eval_result_t *result) {
@@ -489,7 +1125,7 @@ static void subscript_of(obj_t *a, obj_t *b, eval_result_t *result) {
         return;
     }
 
-    result->obj = m(a, wrap_varargs(1, b));
+    result->obj = m(a, ONE_ARG(b));
 }
 
 static boolean truthy(obj_t *obj) {
@@ -512,6 +1148,98 @@ static boolean truthy(obj_t *obj) {
     }
 }
 
+static int table_arm(match_table_t *table, int key) {
+    if (table->jump != NULL) {
+        int64_t i = (int64_t) key - table->min;
+        if (i < 0 || i >= table->span) return -1;
+        return table->jump[i];
+    }
+
+    uint32_t lo = 0;
+    uint32_t hi = table->n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (table->keys[mid].key == key) return table->keys[mid].arm;
+        if (table->keys[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+
+static int str_arm(ast_match_t *match, bytearray_t *s) {
+    if (match->nstrs == 0) return -1;
+
+    uint32_t hash = bytearray_hash(s);
+    uint32_t mask = match->nstrs - 1;
+    for (uint32_t i = hash & mask; match->strs[i].key != NULL; i = (i + 1) & mask) {
+        if (match->strs[i].hash == hash && bytearray_eq(match->strs[i].key, s)) return match->strs[i].arm;
+    }
+    return -1;
+}
+
+/* The literal arm for obj, or -1. A literal only matches its own type. */
+static int literal_arm(ast_match_t *match, obj_t *obj) {
+    switch (TYPEOF(obj)) {
+        case TYPE_INT:
+            return table_arm(&match->ints, obj->intval);
+        case TYPE_BYTE:
+            return table_arm(&match->bytes, obj->byteval);
+        case TYPE_BOOLEAN:
+            return obj->boolval ? match->on_true : match->on_false;
+        case TYPE_STRING:
+            return str_arm(match, obj->bytearray);
+        default:
+            return -1;
+    }
+}
+
+/* Like a literal, a value arm matches a value of its own type that's equal to it. */
+static boolean same_value(obj_t *a, obj_t *b) {
+    if (TYPEOF(a) != TYPEOF(b)) return False;
+
+    static_method eq = get_static_method(TYPEOF(a), METHOD_EQ);
+    if (eq == NULL) return a == b;
+    return truthy(eq(a, ONE_ARG(b)));
+}
+
+/*
+ * The tables give the first literal arm for the subject. Only the guard and
+ * value arms before that one are tried, in order, and only they can make
+ * the match cost more than a lookup. With no arm for it, the match is Nil.
+ */
+static void eval_match(ast_match_t *match, eval_result_t *result, interp_t *interp) {
+    eval_expr(match->subject, interp, result);
+    if (result->err != ERR_NO_ERROR) return;
+    obj_t *obj = result->obj;
+
+    int found = literal_arm(match, obj);
+    int before = found < 0 ? match->narms : found;
+    for (int i = match->first_guard; i < before; i++) {
+        ast_match_arm_t *arm = match->arms[i];
+        if (arm->kind == MATCH_LITERAL) continue;
+        if (arm->kind == MATCH_ELSE) {
+            found = i;
+            break;
+        }
+
+        eval_expr(arm->pattern, interp, result);
+        if (result->err != ERR_NO_ERROR) return;
+        if (arm->kind == MATCH_GUARD ? truthy(result->obj) : same_value(obj, result->obj)) {
+            found = i;
+            break;
+        }
+    }
+
+    if (found < 0) {
+        result->obj = nil_obj();
+        return;
+    }
+    eval_expr(match->arms[found]->expr, interp, result);
+}
+
 static void boolean_and(obj_t *a, obj_t *b, eval_result_t *result) {
     result->obj = boolean_obj(truthy(a) && truthy(b));
 }
@@ -539,7 +1267,326 @@ static void math(obj_t *a, obj_t *b,
         return;
     }
 
-    result->obj = m(a, wrap_varargs(1, b));
+    result->obj = m(a, ONE_ARG(b));
+}
+
+static boolean is_cmp(type_t op) {
+    switch (op) {
+        case AST_EQ:
+        case AST_NE:
+        case AST_LT:
+        case AST_GT:
+        case AST_LE:
+        case AST_GE:
+            return True;
+        default:
+            return False;
+    }
+}
+
+static boolean int_arith(type_t op, int a, int b, int *out) {
+    switch (op) {
+        case AST_ADD:
+            *out = a + b;
+            return True;
+        case AST_SUB:
+            *out = a - b;
+            return True;
+        case AST_MUL:
+            *out = a * b;
+            return True;
+        case AST_DIV:
+            if (b == 0) return False;
+            *out = a / b;
+            return True;
+        case AST_MOD:
+            if (b == 0) return False;
+            *out = a % b;
+            return True;
+        case AST_BITWISE_AND:
+            *out = a & b;
+            return True;
+        case AST_BITWISE_OR:
+            *out = a | b;
+            return True;
+        case AST_BITWISE_XOR:
+            *out = a ^ b;
+            return True;
+        case AST_BITWISE_SHL:
+            *out = a << (unsigned int) b;
+            return True;
+        case AST_BITWISE_SHR:
+            *out = a >> (unsigned int) b;
+            return True;
+        default:
+            return False;
+    }
+}
+
+static boolean int_cmp(type_t op, int a, int b) {
+    switch (op) {
+        case AST_EQ:
+            return a == b;
+        case AST_NE:
+            return a != b;
+        case AST_LT:
+            return a < b;
+        case AST_GT:
+            return a > b;
+        case AST_LE:
+            return a <= b;
+        default:
+            return a >= b;
+    }
+}
+
+static boolean float_arith(type_t op, float a, float b, float *out) {
+    switch (op) {
+        case AST_ADD:
+            *out = a + b;
+            return True;
+        case AST_SUB:
+            *out = a - b;
+            return True;
+        case AST_MUL:
+            *out = a * b;
+            return True;
+        case AST_DIV:
+            if (b == 0) return False;
+            *out = a / b;
+            return True;
+        default:
+            return False;
+    }
+}
+
+// Le and ge are not-gt and not-lt, as in float.c, which matters for NaN.
+static boolean float_cmp(type_t op, float a, float b) {
+    switch (op) {
+        case AST_EQ:
+            return a == b;
+        case AST_NE:
+            return !(a == b);
+        case AST_LT:
+            return a < b;
+        case AST_GT:
+            return a > b;
+        case AST_LE:
+            return !(a > b);
+        default:
+            return !(a < b);
+    }
+}
+
+static boolean int_op(type_t op, int a, int b, eval_result_t *result) {
+    if (is_cmp(op)) {
+        result->obj = boolean_obj(int_cmp(op, a, b));
+        return True;
+    }
+
+    int i;
+    if (!int_arith(op, a, b, &i)) return False;
+    result->obj = int_obj(i);
+    return True;
+}
+
+static boolean float_op(type_t op, float a, float b, eval_result_t *result) {
+    if (is_cmp(op)) {
+        result->obj = boolean_obj(float_cmp(op, a, b));
+        return True;
+    }
+
+    float f;
+    if (!float_arith(op, a, b, &f)) return False;
+    result->obj = float_obj(f);
+    return True;
+}
+
+static ast_seen_t operand_kind(obj_t *a, obj_t *b) {
+    if (TYPEOF(b) == TYPE_INT) {
+        if (TYPEOF(a) == TYPE_INT) return SEEN_INTS;
+        if (TYPEOF(a) == TYPE_BYTEARRAY) return SEEN_BYTEARRAY_INT;
+    } else if (TYPEOF(a) == TYPE_FLOAT && TYPEOF(b) == TYPE_FLOAT) {
+        return SEEN_FLOATS;
+    }
+    return SEEN_MIXED;
+}
+
+/*
+ * Work out the binop straight away if its operands are the kind it has had
+ * every time so far. It gets the answer the static methods would. Returns
+ * False to have eval take the long way, e.g. for new kinds of operands or
+ * division by zero.
+ */
+static boolean eval_seen(ast_expr_t *expr, obj_t *a, obj_t *b, eval_result_t *result) {
+    ast_op_args_t *args = expr->op_args;
+    if (args->seen == SEEN_MIXED) return False;
+
+    ast_seen_t kind = operand_kind(a, b);
+    if (args->seen == SEEN_NOTHING) {
+        args->seen = kind;
+    } else if (args->seen != kind) {
+        args->seen = SEEN_MIXED;
+        return False;
+    }
+
+    switch (kind) {
+        case SEEN_INTS:
+            return int_op(TYPEOF(expr), a->intval, b->intval, result);
+        case SEEN_FLOATS:
+            return float_op(TYPEOF(expr), a->floatval, b->floatval, result);
+        case SEEN_BYTEARRAY_INT:
+            if (TYPEOF(expr) != AST_SUBSCRIPT) return False;
+            result->obj = arr_get_at(a, b->intval);
+            return True;
+        default:
+            return False;
+    }
+}
+
+/*
+ * Work out an expr that specialize() found to be all Ints, without making
+ * an obj along the way. A name has to be bound to what it was declared as.
+ * False if it isn't, or the op can't be done, e.g. division by zero; then
+ * eval does it again the long way, to get the same answer or error it
+ * would have otherwise. There's nothing in the expr to do twice.
+ */
+static boolean eval_int(ast_expr_t *expr, interp_t *interp, int *out) {
+    switch (TYPEOF(expr)) {
+        case AST_INT:
+            *out = expr->intval;
+            return True;
+        case AST_IDENT: {
+            dict_kv_node_t *found = find_env_binding(interp, expr->bytearray);
+            if (found == NULL || TYPEOF(found->v) != TYPE_INT) return False;
+            *out = found->v->intval;
+            return True;
+        }
+        case AST_ADD:
+        case AST_SUB:
+        case AST_MUL:
+        case AST_DIV:
+        case AST_MOD:
+        case AST_BITWISE_SHL:
+        case AST_BITWISE_SHR:
+        case AST_BITWISE_AND:
+        case AST_BITWISE_OR:
+        case AST_BITWISE_XOR: {
+            int a, b;
+            if (expr->op_args->spec != TYPE_INT) return False;
+            if (!eval_int(expr->op_args->a, interp, &a)) return False;
+            if (!eval_int(expr->op_args->b, interp, &b)) return False;
+            return int_arith(TYPEOF(expr), a, b, out);
+        }
+        default:
+            return False;
+    }
+}
+
+/* Like eval_int(), for an expr of Floats, and Ints done as Floats. */
+static boolean eval_float(ast_expr_t *expr, interp_t *interp, float *out) {
+    switch (TYPEOF(expr)) {
+        case AST_FLOAT:
+            *out = expr->floatval;
+            return True;
+        case AST_INT:
+            *out = (float) expr->intval;
+            return True;
+        case AST_IDENT: {
+            dict_kv_node_t *found = find_env_binding(interp, expr->bytearray);
+            if (found == NULL) return False;
+            if (TYPEOF(found->v) == TYPE_FLOAT) {
+                *out = found->v->floatval;
+                return True;
+            }
+            if (TYPEOF(found->v) != TYPE_INT) return False;
+            *out = (float) found->v->intval;
+            return True;
+        }
+        case AST_ADD:
+        case AST_SUB:
+        case AST_MUL:
+        case AST_DIV:
+        case AST_MOD:
+        case AST_BITWISE_SHL:
+        case AST_BITWISE_SHR:
+        case AST_BITWISE_AND:
+        case AST_BITWISE_OR:
+        case AST_BITWISE_XOR: {
+            if (expr->op_args->spec == TYPE_INT) {
+                int i;
+                if (!eval_int(expr, interp, &i)) return False;
+                *out = (float) i;
+                return True;
+            }
+            float a, b;
+            if (expr->op_args->spec != TYPE_FLOAT) return False;
+            if (!eval_float(expr->op_args->a, interp, &a)) return False;
+            if (!eval_float(expr->op_args->b, interp, &b)) return False;
+            return float_arith(TYPEOF(expr), a, b, out);
+        }
+        default:
+            return False;
+    }
+}
+
+/* A binop specialize() marked, with one obj for the answer. */
+static boolean eval_spec(ast_expr_t *expr, interp_t *interp, eval_result_t *result) {
+    type_t op = TYPEOF(expr);
+    ast_op_args_t *args = expr->op_args;
+
+    if (args->spec == TYPE_INT) {
+        int a, b;
+        if (!is_cmp(op)) {
+            if (!eval_int(expr, interp, &a)) return False;
+            result->obj = int_obj(a);
+            return True;
+        }
+        if (!eval_int(args->a, interp, &a) || !eval_int(args->b, interp, &b)) return False;
+        result->obj = boolean_obj(int_cmp(op, a, b));
+        return True;
+    }
+
+    if (args->spec == TYPE_FLOAT) {
+        float a, b;
+        if (!is_cmp(op)) {
+            if (!eval_float(expr, interp, &a)) return False;
+            result->obj = float_obj(a);
+            return True;
+        }
+        if (!eval_float(args->a, interp, &a) || !eval_float(args->b, interp, &b)) return False;
+        result->obj = boolean_obj(float_cmp(op, a, b));
+        return True;
+    }
+
+    return False;
+}
+
+/*
+ * An assignment specialize() marked, to an unboxed binding, written
+ * straight into the binding's own obj. Its value is only made if it's
+ * wanted.
+ */
+static boolean eval_spec_assign(ast_expr_t *expr, interp_t *interp, eval_result_t *result) {
+    type_t spec = expr->op_args->spec;
+    if (spec == TYPE_UNKNOWN) return False;
+
+    dict_kv_node_t *found = find_env_binding(interp, expr->op_args->a->bytearray);
+    if (found == NULL || !(found->hdr.flags & F_ENV_UNBOXED) || TYPEOF(found->v) != spec) return False;
+
+    boolean unused = FLAGS(expr) & F_VALUE_UNUSED;
+    if (spec == TYPE_INT) {
+        int i;
+        if (!eval_int(expr->op_args->b, interp, &i)) return False;
+        found->v->intval = i;
+        result->obj = unused ? nil_obj() : int_obj(i);
+    } else {
+        float f;
+        if (!eval_float(expr->op_args->b, interp, &f)) return False;
+        found->v->floatval = f;
+        result->obj = unused ? nil_obj() : float_obj(f);
+    }
+    return True;
 }
 
 static void range(int from_inclusive, int to_inclusive, eval_result_t *result) {
@@ -598,6 +1645,7 @@ static void apply(ast_expr_t *expr, eval_result_t *result, interp_t *interp) {
 
         while (args != NULL) {
             eval_expr(args->root, interp, result);
+            if (result->err != ERR_NO_ERROR) return;
 
             method_args->arg = result->obj;
             method_args->next = NULL;
@@ -612,6 +1660,9 @@ static void apply(ast_expr_t *expr, eval_result_t *result, interp_t *interp) {
 
         result->obj = method(obj, method_args_root);
     }
+
+    // A method fails by returning an Error, e.g. when a function it called back failed.
+    if (TYPEOF(result->obj) == TYPE_ERROR) result->err = result->obj->errval;
 }
 
 static int print_args(ast_expr_list_t *args, eval_result_t *result, interp_t *interp) {
@@ -649,7 +1700,19 @@ static int print_args(ast_expr_list_t *args, eval_result_t *result, interp_t *in
                     printf("Nil ");
                     break;
                 case TYPE_BYTEARRAY:
-                    printf("%s", result->obj->bytearray->data);
+                    printf("%s ", bytearray_to_c_str(result->obj->bytearray));
+                    break;
+                case TYPE_STRING_BUILDER:
+                case TYPE_RECORD:
+                case TYPE_RECORD_TYPE: {
+                    static_method to_string = get_static_method(TYPEOF(result->obj), METHOD_TO_STRING);
+                    if (to_string == NULL) {
+                        printf("?? ");
+                        break;
+                    }
+                    printf("%s ", bytearray_to_c_str(to_string(result->obj, NULL)->bytearray));
+                    break;
+                }
                 default:
                     printf("?? ");
                     break;
@@ -774,6 +1837,36 @@ static void resolve_callable_expr(ast_expr_t *expr, interp_t *interp, eval_resul
         case AST_CALL_ABS:
             eval_abs(args->root, result, interp);
             break;
+        case AST_CALL_SQRT:
+            eval_math_fn(args->root, MATH_SQRT, result, interp);
+            break;
+        case AST_CALL_EXP:
+            eval_math_fn(args->root, MATH_EXP, result, interp);
+            break;
+        case AST_CALL_LN:
+            eval_math_fn(args->root, MATH_LN, result, interp);
+            break;
+        case AST_CALL_LOG:
+            eval_math_fn(args->root, MATH_LOG, result, interp);
+            break;
+        case AST_CALL_SIN:
+            eval_math_fn(args->root, MATH_SIN, result, interp);
+            break;
+        case AST_CALL_COS:
+            eval_math_fn(args->root, MATH_COS, result, interp);
+            break;
+        case AST_CALL_TAN:
+            eval_math_fn(args->root, MATH_TAN, result, interp);
+            break;
+        case AST_CALL_INTS:
+            eval_vec(args->root, TYPE_INT_ARRAY, result, interp);
+            break;
+        case AST_CALL_FLOATS:
+            eval_vec(args->root, TYPE_FLOAT_ARRAY, result, interp);
+            break;
+        case AST_CALL_MEMO:
+            eval_memo(args, result, interp);
+            break;
         case AST_CALL_GC:
             gc(interp);
             result->obj = nil_obj();
@@ -797,6 +1890,34 @@ static void resolve_callable_expr(ast_expr_t *expr, interp_t *interp, eval_resul
     result->obj = undef_obj();
 }
 
+/*
+ * Eval a loop's body. A block gets a fresh scope each time round, unless
+ * the one in *scope from last time is still empty and no function has
+ * hold of it. Once the heap has run out, the loop stops here.
+ */
+static void eval_loop_body(ast_expr_t *pred, env_t **scope, interp_t *interp, eval_result_t *result) {
+    if (heap_exhausted()) {
+        result->err = ERR_OUT_OF_MEMORY;
+        return;
+    }
+
+    if (TYPEOF(pred) != AST_BLOCK) {
+        eval_expr(pred, interp, result);
+        return;
+    }
+
+    env_t *env = *scope;
+    if (env == NULL || (FLAGS(env) & F_ENV_CAPTURED) || env->vars->dict->nelems > 0) {
+        env = new_env();
+        env->parent = interp->env;
+        *scope = env;
+    }
+    if ((result->err = push_scope(interp, env)) == ERR_NO_ERROR) {
+        eval_block_expr_in_scope(pred->block_exprs, result, interp);
+    }
+    leave_scope(interp);
+}
+
 static void eval_do_while_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *result) {
     eval_result_t *cond_r = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
 
@@ -806,8 +1927,9 @@ static void eval_do_while_loop(ast_expr_t *expr, interp_t *interp, eval_result_t
     result->obj = nil_obj();
     result->err = ERR_NO_ERROR;
 
+    env_t *body_env = NULL;
     for (;;) {
-        eval_expr(pred, interp, result);
+        eval_loop_body(pred, &body_env, interp, result);
         if (result->err != ERR_NO_ERROR) {
             result->obj = undef_obj();
             return;
@@ -842,6 +1964,7 @@ static void eval_while_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *r
 
     enter_scope(interp);
 
+    env_t *body_env = NULL;
     for (;;) {
         eval_expr(cond, interp, cond_r);
         if (cond_r->err != ERR_NO_ERROR) {
@@ -852,7 +1975,7 @@ static void eval_while_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *r
 
         if (!truthy(cond_r->obj)) goto done;
 
-        eval_expr(pred, interp, result);
+        eval_loop_body(pred, &body_env, interp, result);
         if (result->err != ERR_NO_ERROR) {
             result->obj = undef_obj();
             goto done;
@@ -870,6 +1993,78 @@ static void eval_while_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *r
     leave_scope(interp);
 }
 
+/*
+ * Count through a range in C, without a range obj or an iterator, giving
+ * the loop variable the same values the range's iterator would. The
+ * variable is unboxed: its binding is found once, and its obj written over
+ * each time round.
+ */
+static void eval_counted_for_loop(ast_expr_t *expr, int from, int to, int step,
+                                  interp_t *interp, eval_result_t *result) {
+    obj_t *result_obj = undef_obj();
+    ast_expr_t *pred = expr->for_loop->pred;
+    bytearray_t *elem_name = expr->for_loop->elem->bytearray;
+    int incr = from < to ? 1 : -1;
+    int len = (from < to ? to - from : from - to) + 1;
+
+    enter_scope(interp);
+    put_env_with_flags(interp, elem_name, unboxed_value(int_obj(from)),
+                       F_ENV_DECLARATION | F_ENV_OVERWRITE | F_ENV_UNBOXED);
+    dict_kv_node_t *elem = get_env_binding(interp, elem_name);
+    env_t *body_env = NULL;
+
+    for (int i = 0; i < len; i += step) {
+        int n = from + i * incr;
+        if (FLAGS(elem) & F_REMOVED) {
+            // The body deleted it; bind it anew.
+            put_env_with_flags(interp, elem_name, unboxed_value(int_obj(n)),
+                               F_ENV_DECLARATION | F_ENV_OVERWRITE | F_ENV_UNBOXED);
+            elem = get_env_binding(interp, elem_name);
+        } else if (FLAGS(elem) & F_ENV_UNBOXED) {
+            elem->v->intval = n;
+        } else {
+            // The body gave it something else, so it gave up its obj.
+            elem->v = unboxed_value(int_obj(n));
+            elem->hdr.flags |= F_ENV_UNBOXED;
+        }
+
+        eval_loop_body(pred, &body_env, interp, result);
+
+        if (result->err != ERR_NO_ERROR) {
+            printf("Leaving scope on error %d\n", result->err);
+            leave_scope(interp);
+            result->obj = undef_obj();
+            return;
+        }
+
+        if (TYPEOF(result->obj) == TYPE_BREAK) break;
+
+        if (TYPEOF(result->obj) != TYPE_CONTINUE) {
+            result_obj = result->obj;
+        }
+    }
+
+    leave_scope(interp);
+    result->obj = result_obj;
+}
+
+/* Evaluate a range's bounds, which must be Ints. */
+static boolean eval_range_bounds(ast_range_args_t *range, int bounds[3],
+                                 interp_t *interp, eval_result_t *result) {
+    ast_expr_t *exprs[3] = {range->from, range->to, range->step};
+    bounds[2] = 1;
+    for (int i = 0; i < 3 && exprs[i] != NULL; i++) {
+        eval_expr(exprs[i], interp, result);
+        if (result->err != ERR_NO_ERROR) return False;
+        if (TYPEOF(result->obj) != TYPE_INT) {
+            result->err = ERR_TYPE_INT_REQUIRED;
+            return False;
+        }
+        bounds[i] = result->obj->intval;
+    }
+    return True;
+}
+
 static void eval_for_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *result) {
     obj_t *result_obj = undef_obj();
     result->obj = result_obj;
@@ -883,15 +2078,32 @@ static void eval_for_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *res
     bytearray_t *elem_name = ((ast_expr_t *) expr->for_loop->elem)->bytearray;
 
     // The object whose elements we want to iterate over.
-    // Evaluate the iterable expression to get it.
-    eval_result_t *iter_r = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    obj_t *iter_obj;
+    if (TYPEOF(expr->for_loop->iterable) == AST_RANGE) {
+        // Don't make the range if we can just count.
+        int bounds[3];
+        if (!eval_range_bounds(expr->for_loop->iterable->range, bounds, interp, result)) {
+            result->obj = undef_obj();
+            return;
+        }
+        if (bounds[2] >= 1) {
+            eval_counted_for_loop(expr, bounds[0], bounds[1], bounds[2], interp, result);
+            return;
+        }
+        // Bad step. Let it fail the usual way.
+        iter_obj = range_step_obj(bounds[0], bounds[1], bounds[2]);
+    } else {
+        // Evaluate the iterable expression to get it.
+        eval_result_t *iter_r = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
 
-    eval_expr(expr->for_loop->iterable, interp, iter_r);
-    if ((result->err = iter_r->err) != ERR_NO_ERROR) {
-        printf("obj %llu err %d\n", ((gc_header_t *) iter_r->obj)->type, iter_r->err);
-        goto error;
+        eval_expr(expr->for_loop->iterable, interp, iter_r);
+        if ((result->err = iter_r->err) != ERR_NO_ERROR) {
+            printf("obj %llu err %d\n", ((gc_header_t *) iter_r->obj)->type, iter_r->err);
+            result->obj = undef_obj();
+            return;
+        }
+        iter_obj = iter_r->obj;
     }
-    obj_t *iter_obj = iter_r->obj;
 
     // An iterator object that points to said object and maintains
     // state as we iterate.
@@ -899,7 +2111,8 @@ static void eval_for_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *res
     if (get_iterator == NULL) {
         result->err = ERR_NO_SUCH_METHOD;
         printf("No iterator!\n");
-        goto error;
+        result->obj = undef_obj();
+        return;
     }
     obj_iter_t *iter = get_iterator(iter_obj, NULL)->iterator;
 
@@ -908,13 +2121,22 @@ static void eval_for_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *res
     enter_scope(interp);
     obj_t *next_elem = iter->next(iter);
 
+    // The special OVERWRITE flag lets the loop rebind a var the user can't.
+    // The flag lives on the binding, so elements (which may be shared,
+    // interned objects) are never modified.
+    flags_t elem_flags = F_ENV_DECLARATION | F_ENV_OVERWRITE;
+
     // The actual iteration. Done when we encounter Nil as a sentinel.
     while (TYPEOF(next_elem) != TYPE_NIL) {
         // Not mutable in user code.
         assert(orig_expr == (size_t) expr);
-        // The special OVERWRITE flags lets the loop mutate vars the user can't.
-        next_elem->hdr.flags |= F_ENV_OVERWRITE;
-        put_env(interp, elem_name, (gc_header_t*) next_elem);
+        put_env_with_flags(interp, elem_name, next_elem, elem_flags);
+        elem_flags = F_ENV_OVERWRITE;
+
+        if (heap_exhausted()) {
+            result->err = ERR_OUT_OF_MEMORY;
+            goto error;
+        }
 
         eval_expr(pred, interp, result);
 
@@ -922,13 +2144,19 @@ static void eval_for_loop(ast_expr_t *expr, interp_t *interp, eval_result_t *res
 
         if (TYPEOF(result->obj) == TYPE_BREAK) goto done;
 
-        if (TYPEOF(result->obj) == TYPE_CONTINUE) continue;
-
-        result_obj = result->obj;
+        if (TYPEOF(result->obj) != TYPE_CONTINUE) {
+            result_obj = result->obj;
+        }
 
         next_elem = iter->next(iter);
     }
 
+    // A pipeline stops early if its function fails.
+    if (iter->err != ERR_NO_ERROR) {
+        result->err = iter->err;
+        goto error;
+    }
+
     done:
     leave_scope(interp);
     result->obj = result_obj;
@@ -969,52 +2197,62 @@ static void eval_expr(ast_expr_t *expr, interp_t *interp, eval_result_t *result)
             break;
         }
         case AST_ADD: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_ADD);
             break;
         }
         case AST_SUB: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_SUB);
             break;
         }
         case AST_MUL: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_MUL);
             break;
         }
         case AST_DIV: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_DIV);
             break;
         }
         case AST_MOD: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_MOD);
             break;
         }
@@ -1057,52 +2295,62 @@ static void eval_expr(ast_expr_t *expr, interp_t *interp, eval_result_t *result)
             break;
         }
         case AST_BITWISE_SHL: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_BITWISE_SHL);
             break;
         }
         case AST_BITWISE_SHR: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_BITWISE_SHR);
             break;
         }
         case AST_BITWISE_OR: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_BITWISE_OR);
             break;
         }
         case AST_BITWISE_XOR: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_BITWISE_XOR);
             break;
         }
         case AST_BITWISE_AND: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             math(o1, o2, result, METHOD_BITWISE_AND);
             break;
         }
@@ -1112,16 +2360,19 @@ static void eval_expr(ast_expr_t *expr, interp_t *interp, eval_result_t *result)
         case AST_LE:
         case AST_NE:
         case AST_EQ: {
+            if (eval_spec(expr, interp, result)) break;
             eval_expr(expr->op_args->a, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o1 = result->obj;
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             cmp(TYPEOF(expr), o1, o2, result);
             break;
         }
         case AST_ASSIGN: {
+            if (eval_spec_assign(expr, interp, result)) break;
             assign(expr->op_args->a, expr->op_args->b, result, interp);
             break;
         }
@@ -1142,6 +2393,7 @@ static void eval_expr(ast_expr_t *expr, interp_t *interp, eval_result_t *result)
             eval_expr(expr->op_args->b, interp, result);
             if (result->err != ERR_NO_ERROR) return;
             obj_t *o2 = result->obj;
+            if (eval_seen(expr, o1, o2, result)) break;
             subscript_of(o1, o2, result);
             break;
         }
@@ -1217,6 +2469,10 @@ static void eval_expr(ast_expr_t *expr, interp_t *interp, eval_result_t *result)
             if (result->err != ERR_NO_ERROR) return;
             break;
         }
+        case AST_SET: {
+            eval_set_expr(expr->list, result, interp);
+            break;
+        }
         case AST_DICT: {
             eval_dict_expr(expr->dict, result, interp);
             if (result->err != ERR_NO_ERROR) return;
@@ -1247,6 +2503,21 @@ static void eval_expr(ast_expr_t *expr, interp_t *interp, eval_result_t *result)
             if (result->err != ERR_NO_ERROR) return;
             break;
         }
+        case AST_FIELD: {
+            eval_field(expr->field, result, interp);
+            if (result->err != ERR_NO_ERROR) return;
+            break;
+        }
+        case AST_TYPEDEF: {
+            eval_typedef(expr->data_type_def, result, interp);
+            if (result->err != ERR_NO_ERROR) return;
+            break;
+        }
+        case AST_MATCH: {
+            eval_match(expr->match, result, interp);
+            if (result->err != ERR_NO_ERROR) return;
+            break;
+        }
         case AST_DELETE: {
             error_t error = del_env(interp, expr->bytearray);
             if (error != ERR_NO_ERROR) {
@@ -1305,22 +2576,65 @@ static void eval_expr(ast_expr_t *expr, interp_t *interp, eval_result_t *result)
     }
 }
 
-void eval(interp_t *interp, const char *input, eval_result_t *result) {
-    ast_expr_t *ast = ast_empty();
-    parse_result_t *parse_result = mem_alloc(sizeof(parse_result_t));
-    parse_program(input, ast, parse_result);
+/* Make parsed code ready to run, at the interp's opt level. */
+static void ready_code(interp_t *interp, ast_expr_t *ast) {
+    if (interp->opt_level > 0) {
+        optimize(ast);
+        specialize(ast);
+    }
+
+#ifdef DEBUG
+    pretty_print(ast);
+#endif
+}
+
+void eval_code(interp_t *interp, ast_code_t *code, ast_expr_t *ast, eval_result_t *result) {
+    result->err = ERR_NO_ERROR;
+
+    char base;
+    if (running_interp == NULL) init_c_stack(&base);
+
+    interp_t *outer_interp = running_interp;
+    ast_code_t *outer_code = running_code;
+    running_interp = interp;
+    running_code = code;
+    eval_expr(ast, interp, result);
+    running_interp = outer_interp;
+    running_code = outer_code;
 
+    ast_code_release(code);
+}
+
+static void eval_parsed(interp_t *interp, ast_expr_t *ast, parse_result_t *parse_result, eval_result_t *result) {
     result->err = parse_result->err;
     result->depth = parse_result->depth;
 
     if (parse_result->err != ERR_NO_ERROR) {
+        ast_code_release(parse_result->code);
         result->obj = no_obj();
         return;
     }
 
-#ifdef DEBUG
-    pretty_print(ast);
-#endif
+    ready_code(interp, ast);
+    eval_code(interp, parse_result->code, ast, result);
+}
 
-    eval_expr(ast, interp, result);
+void eval(interp_t *interp, const char *input, eval_result_t *result) {
+    ast_expr_t ast;
+    parse_result_t parse_result;
+    parse_program(input, &ast, &parse_result);
+    eval_parsed(interp, &ast, &parse_result, result);
+}
+
+void compile_script(interp_t *interp, const char *input, uint32_t size,
+                    ast_expr_t *ast, parse_result_t *parse_result) {
+    parse_script(input, size, ast, parse_result);
+    if (parse_result->err == ERR_NO_ERROR) ready_code(interp, ast);
+}
+
+void eval_script(interp_t *interp, const char *input, uint32_t size, eval_result_t *result) {
+    ast_expr_t ast;
+    parse_result_t parse_result;
+    parse_script(input, size, &ast, &parse_result);
+    eval_parsed(interp, &ast, &parse_result, result);
 }
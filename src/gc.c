@@ -3,6 +3,7 @@
 #include "../inc/mem.h"
 #include "../inc/gc.h"
 #include "../inc/heap.h"
+#include "../inc/ast.h"
 
 /*
  * Baker's Mark and Sweep algorithm, as described in Aho et al., Compilers,
@@ -96,7 +97,8 @@ static int scan_non_dict_children(gc_header_t *data_ptr) {
         size_t offset = sizeof(gc_header_t) + (i * sizeof(void *));
         void **child = (void *) ((size_t) data_ptr + offset);
         // Pointers can be null. elem->next, etc.
-        if (*child != NULL) {
+        // Children off the heap are static and never collected.
+        if (*child != NULL && on_heap(*child)) {
             heap_node_t *child_heap_node = NODE_FOR_DATA(*child);
 
             // Move Unreached child to Unscanned.
@@ -129,6 +131,45 @@ static int scan_dict_children(gc_header_t *data_ptr) {
     return unscanned;
 }
 
+static int scan_record_children(gc_header_t *data_ptr) {
+    int unscanned = scan_non_dict_children(data_ptr);
+    obj_record_t *record = (obj_record_t *) data_ptr;
+    for (uint32_t i = 0; i < record->type->nfields; ++i) {
+        obj_t *child = record->slots[i];
+        // Interned objs are off the heap.
+        if (child != NULL && on_heap(child)) {
+            heap_node_t *child_heap_node = NODE_FOR_DATA(child);
+
+            // Move Unreached child to Unscanned.
+            if (child_heap_node->flags != F_GC_SCANNED) {
+                child_heap_node->flags &= ~F_GC_UNREACHED;
+                child_heap_node->flags |= F_GC_UNSCANNED;
+                unscanned++;
+            }
+        }
+    }
+    return unscanned;
+}
+
+static int scan_stack_children(gc_header_t *data_ptr) {
+    int unscanned = scan_non_dict_children(data_ptr);
+    env_segment_t *segment = (env_segment_t *) data_ptr;
+    for (int i = 0; i < ENV_SEGMENT_SIZE; ++i) {
+        env_t *child = segment->scopes[i];
+        if (child != NULL) {
+            heap_node_t *child_heap_node = NODE_FOR_DATA(child);
+
+            // Move Unreached child to Unscanned.
+            if (child_heap_node->flags != F_GC_SCANNED) {
+                child_heap_node->flags &= ~F_GC_UNREACHED;
+                child_heap_node->flags |= F_GC_UNSCANNED;
+                unscanned++;
+            }
+        }
+    }
+    return unscanned;
+}
+
 /*
  * While there are Unscanned nodes,
  *
@@ -154,7 +195,15 @@ static int scan_unscanned_objects() {
 
             if (data_ptr->type == TYPE_DICT_DATA) {
                 unscanned += scan_dict_children(data_ptr);
+            } else if (data_ptr->type == INTERP_STACK_DATA) {
+                unscanned += scan_stack_children(data_ptr);
+            } else if (data_ptr->type == TYPE_RECORD_DATA) {
+                unscanned += scan_record_children(data_ptr);
             } else {
+                // The code of a function is off the heap, but it has to stay.
+                if (data_ptr->type == TYPE_FUNCTION_PTR_DATA) {
+                    ast_code_reach(((obj_func_def_t *) data_ptr)->program);
+                }
                 unscanned += scan_non_dict_children(data_ptr);
             }
         }
@@ -169,22 +218,15 @@ static int scan_unscanned_objects() {
  * Mark nodes reached by the root set as Unscanned.
  */
 static void initialize_unscanned_roots(interp_t *interp) {
-    // Move objects referenced by the root set from Unreached to Unscanned.
-    for (int i = interp->top; i >= 0; --i) {
-        env_t *env = interp->ret_stack[i];
-        // TODO left off here
-        // TODO this can't really work
-        heap_node_t *heap_node = NODE_FOR_DATA(env);
-
-        // By definition allocated, so should already have been marked as Unreached.
-        assert(!(heap_node->flags & F_GC_FREE));
+    // Move the scope stack from Unreached to Unscanned. Its segments reach
+    // each other, and every scope on the stack.
+    heap_node_t *heap_node = NODE_FOR_DATA(interp->stack);
 
-        // I guess this assertion doesn't hold for shadowing vars?
-        // assert(heap_node->flags & F_GC_UNREACHED);
+    // By definition allocated, so should already have been marked as Unreached.
+    assert(!(heap_node->flags & F_GC_FREE));
 
-        heap_node->flags &= ~F_GC_UNREACHED;
-        heap_node->flags |= F_GC_UNSCANNED;
-    }
+    heap_node->flags &= ~F_GC_UNREACHED;
+    heap_node->flags |= F_GC_UNSCANNED;
 }
 
 /*
@@ -219,7 +261,9 @@ void gc(interp_t *interp) {
     while (scan_unscanned_objects());
     move_unreached_to_free();
     coalesce_free_nodes();
+    heap_rescan();
     conclude_gc();
+    ast_code_sweep();
 
     heap_info_t *after = get_heap_info();
     printf("GC freed %zu bytes. Bytes avail: %zu.\n", used_before - after->bytes_used, after->bytes_free);
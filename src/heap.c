@@ -10,6 +10,13 @@ static size_t heap[HEAP_BYTES] = {0};
 #define HEAP_DATA_BEGIN ((size_t) heap + sizeof(heap_node_t))
 #define HEAP_DATA_END ((size_t) heap + HEAP_BYTES)
 
+// No node before this one is free, so a search for space can start here.
+static heap_node_t *first_free = (heap_node_t *) heap;
+
+// Allocations stop short of this while the reserve is held back, so that a
+// program that runs out still has room to unwind and say so.
+static size_t heap_limit = HEAP_BYTES - HEAP_RESERVE_BYTES;
+
 // A global template we will use to construct new node data
 // before copying it to memory.
 heap_node_t node_template = {
@@ -108,6 +115,11 @@ static void coalesce_nodes(heap_node_t *left, heap_node_t *right) {
     assert_valid_heap_node(left);
 }
 
+/* True if bytes fit in node without going past the limit. */
+static boolean fits(heap_node_t *node, size_t bytes) {
+    return bytes <= node_size(node) && (size_t) node + sizeof(heap_node_t) + bytes <= (size_t) heap + heap_limit;
+}
+
 void *ealloc(size_t bytes) {
     if (bytes == 0) return NULL;
 
@@ -117,11 +129,21 @@ void *ealloc(size_t bytes) {
     }
 
     // Find the first free node of sufficient size.
-    heap_node_t *node = (heap_node_t *) heap;
+    heap_node_t *node = first_free;
+    boolean seen_free = False;
     while (node != NULL) {
-        if (bytes <= node_size(node) && (node->flags & F_GC_FREE)) break;
+        if (node->flags & F_GC_FREE) {
+            if (!seen_free) first_free = node;
+            seen_free = True;
+            if (fits(node, bytes)) break;
+        }
         node = node->next;
     }
+    if (node == NULL && heap_limit < HEAP_BYTES) {
+        // Give up the reserve. The program has to stop what it's doing.
+        heap_limit = HEAP_BYTES;
+        return ealloc(bytes);
+    }
     if (node == NULL) {
         printf("Out of heap space!\n");
         dump_heap();
@@ -138,6 +160,7 @@ void *ealloc(size_t bytes) {
     // Update header on this node. This is what we will return.
     fracture_node(node, bytes);
     node->flags &= ~F_GC_FREE;
+    if (node == first_free) first_free = node->next;
 
     assert_valid_heap_node(node);
 
@@ -163,15 +186,16 @@ void *erealloc(void *data_ptr, size_t size) {
     }
 
     // Try to allocate a bigger space for it. This may fail and return NULL.
-    heap_node_t *new_node = ealloc(size);
-    if (new_node == NULL) return NULL;
+    void *new_ptr = ealloc(size);
+    if (new_ptr == NULL) return NULL;
 
-    void *new_ptr = DATA_FOR_NODE(new_node);
-    mem_cp(data_ptr, new_ptr, node_size(node));
+    heap_node_t *new_node = NODE_FOR_DATA(new_ptr);
+    mem_cp(new_ptr, data_ptr, node_size(node));
 
     // Move the flags from src to dst.
     new_node->flags = node->flags;
     node->flags = F_GC_FREE;
+    if (first_free == NULL || node < first_free) first_free = node;
 
     assert((size_t) node >= (size_t) heap);
     if (node->next == NULL) {
@@ -197,8 +221,12 @@ void efree(void *data_ptr) {
     node->flags |= F_GC_FREE;
 
     // Merge adjacent free nodes. The order matters.
+    heap_node_t *prev = node->prev;
     coalesce_nodes(node, node->next);
-    coalesce_nodes(node->prev, node);
+    coalesce_nodes(prev, node);
+
+    heap_node_t *freed = (prev != NULL && (prev->flags & F_GC_FREE)) ? prev : node;
+    if (first_free == NULL || freed < first_free) first_free = freed;
 
     assert_valid_heap_node(node);
     if (node->prev != NULL) assert_valid_heap_node(node->prev);
@@ -211,19 +239,15 @@ void efree(void *data_ptr) {
  */
 void heap_init(unsigned char initval) {
     // Clear the heap
-    size_t *p = heap;
-    size_t size = HEAP_BYTES;
-    while (size > 0) {
-        *p = initval;
-        *p += 1;
-        size -= 1;
-    }
+    mem_set(heap, initval, HEAP_BYTES);
 
     // Create a node containing the entire heap.
     node_template.prev = NULL;
     node_template.next = NULL;
     node_template.flags = F_GC_FREE;
     mem_cp(heap, &node_template, sizeof(heap_node_t));
+    first_free = (heap_node_t *) heap;
+    heap_limit = HEAP_BYTES - HEAP_RESERVE_BYTES;
 
     printf("Initialized heap at %p, size %zu bytes\n", heap, HEAP_BYTES);
 }
@@ -275,6 +299,21 @@ heap_node_t *heap_head(void) {
     return (heap_node_t *) heap;
 }
 
+void heap_rescan(void) {
+    first_free = (heap_node_t *) heap;
+
+    // Hold the reserve back again, if nothing has been put in it.
+    heap_node_t *last = first_free;
+    while (last->next != NULL) last = last->next;
+    if ((last->flags & F_GC_FREE) && (size_t) last <= (size_t) heap + HEAP_BYTES - HEAP_RESERVE_BYTES) {
+        heap_limit = HEAP_BYTES - HEAP_RESERVE_BYTES;
+    }
+}
+
+boolean heap_exhausted(void) {
+    return heap_limit == HEAP_BYTES;
+}
+
 void assert_valid_heap_node(heap_node_t *node) {
     assert(node->magic == 0x4849);
     assert((size_t) node >= (size_t) heap);
@@ -293,6 +332,10 @@ void assert_valid_heap_node(heap_node_t *node) {
     }
 }
 
+boolean on_heap(void *data_ptr) {
+    return (size_t) data_ptr >= HEAP_DATA_BEGIN && (size_t) data_ptr <= HEAP_DATA_END;
+}
+
 void assert_valid_data_ptr(void *data_ptr) {
     assert((size_t) data_ptr >= HEAP_DATA_BEGIN);
     assert((size_t) data_ptr <= HEAP_DATA_END);
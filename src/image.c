@@ -0,0 +1,451 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../inc/ptr.h"
+#include "../inc/str.h"
+#include "../inc/image.h"
+
+#define IMAGE_MAGIC "ethelimg"
+#define IMAGE_VERSION 2
+// Made by the Makefile from the sources that lay out and rewrite code.
+#ifndef IMAGE_BUILD_ID
+#define IMAGE_BUILD_ID 0
+#endif
+
+#define IMAGE_WORD sizeof(void *)
+
+#define MARK_PTR 1  // The word points into the code.
+#define MARK_NAME 2  // The word names a name.
+#define MARK_NODE 4  // A node starts at the word, and has been walked.
+
+/*
+ * The file is the header, the code, the words in the code that point into
+ * it, the words in it that name names, and the names, each its size and
+ * its bytes.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t build;  // IMAGE_BUILD_ID of the build that wrote it.
+    uint32_t layout;  // See layout().
+    image_key_t key;
+    uint64_t code_size;
+    uint64_t root;  // Where the root is in the code.
+    uint64_t nptrs;
+    uint64_t nname_refs;
+    uint64_t nnames;
+    uint64_t names_size;
+} image_header_t;
+
+/*
+ * Images from a build whose nodes are laid out differently don't fit. The
+ * build id catches what sizes can't, e.g. renumbered tags or new rewrites.
+ */
+static uint32_t layout(void) {
+    return (uint32_t) (IMAGE_WORD << 24 | sizeof(ast_expr_t) << 16 | sizeof(gc_header_t) << 8 | TYPE_MAX);
+}
+
+image_key_t image_key(const char *source, uint32_t size, int opt_level) {
+    uint64_t hash = FNV64Basis;
+    for (uint32_t i = 0; i < size; i++) hash = FNV64Prime * (hash ^ (byte) source[i]);
+
+    image_key_t key = {.hash = hash, .size = size, .opt_level = (uint32_t) opt_level};
+    return key;
+}
+
+/* A run of the code's memory, and where it goes in the image. */
+typedef struct {
+    const unsigned char *start;
+    size_t size;
+    size_t offset;
+} region_t;
+
+typedef struct {
+    region_t *regions;  // By start.
+    int nregions;
+    unsigned char *code;  // The copy that's written out.
+    size_t code_size;
+    uint8_t *marks;  // For each word of code.
+    gc_header_t **todo;  // Nodes still to walk.
+    size_t ntodo;
+    size_t todo_capacity;
+    bytearray_t **names;  // In the order they're numbered.
+    uint32_t nnames;
+    uint32_t *name_slots;  // By address; a name's number + 1, or 0 if empty.
+    uint32_t name_capacity;
+    error_t err;
+} writer_t;
+
+static int compare_regions(const void *a, const void *b) {
+    const unsigned char *x = ((const region_t *) a)->start;
+    const unsigned char *y = ((const region_t *) b)->start;
+    return x < y ? -1 : x > y;
+}
+
+/* Copy the arena's chunks, and root, which the caller has, into one. */
+static error_t gather(writer_t *w, ast_code_t *code, ast_expr_t *root) {
+    int n = 1;
+    for (arena_chunk_t *chunk = code->arena.chunk; chunk != NULL; chunk = chunk->prev) n++;
+
+    w->regions = malloc((size_t) n * sizeof(region_t));
+    if (w->regions == NULL) return ERR_OUT_OF_MEMORY;
+
+    size_t offset = 0;
+    for (arena_chunk_t *chunk = code->arena.chunk; chunk != NULL; chunk = chunk->prev) {
+        region_t region = {.start = chunk->data, .size = chunk->used, .offset = offset};
+        w->regions[w->nregions++] = region;
+        offset += chunk->used;
+    }
+    region_t region = {.start = (unsigned char *) root, .size = sizeof(ast_expr_t), .offset = offset};
+    w->regions[w->nregions++] = region;
+    w->code_size = offset + sizeof(ast_expr_t);
+
+    w->code = malloc(w->code_size);
+    w->marks = calloc(w->code_size / IMAGE_WORD, 1);
+    if (w->code == NULL || w->marks == NULL) return ERR_OUT_OF_MEMORY;
+    for (int i = 0; i < w->nregions; i++) {
+        mem_cp(w->code + w->regions[i].offset, (void *) w->regions[i].start, w->regions[i].size);
+    }
+
+    qsort(w->regions, (size_t) n, sizeof(region_t), compare_regions);
+    return ERR_NO_ERROR;
+}
+
+/*
+ * Where p is in the image, or -1 if it's not in the code. Nodes start in
+ * a region; other pointers, like a bytearray's data, can be at its end.
+ */
+static int64_t image_offset(writer_t *w, const void *p, boolean node) {
+    const unsigned char *at = p;
+    int lo = 0;
+    int hi = w->nregions;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (w->regions[mid].start <= at) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return -1;
+
+    region_t *region = &w->regions[lo - 1];
+    size_t into = (size_t) (at - region->start);
+    if (into < region->size || (!node && into == region->size)) return (int64_t) (region->offset + into);
+    return -1;
+}
+
+static void push(writer_t *w, gc_header_t *node) {
+    if (w->ntodo == w->todo_capacity) {
+        size_t capacity = w->todo_capacity == 0 ? 256 : w->todo_capacity * 2;
+        gc_header_t **todo = realloc(w->todo, capacity * sizeof(gc_header_t *));
+        if (todo == NULL) {
+            w->err = ERR_OUT_OF_MEMORY;
+            return;
+        }
+        w->todo = todo;
+        w->todo_capacity = capacity;
+    }
+    w->todo[w->ntodo++] = node;
+}
+
+static uint32_t ptr_hash(const void *p) {
+    return (uint32_t) ((uintptr_t) p >> 3) * 2654435761u;
+}
+
+static boolean grow_names(writer_t *w) {
+    uint32_t capacity = w->name_capacity == 0 ? 64 : w->name_capacity * 2;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    bytearray_t **names = realloc(w->names, capacity / 2 * sizeof(bytearray_t *));
+    if (slots == NULL || names == NULL) {
+        free(slots);
+        if (names != NULL) w->names = names;
+        return False;
+    }
+
+    uint32_t mask = capacity - 1;
+    for (uint32_t n = 0; n < w->nnames; n++) {
+        uint32_t i = ptr_hash(names[n]) & mask;
+        while (slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = n + 1;
+    }
+    free(w->name_slots);
+    w->name_slots = slots;
+    w->names = names;
+    w->name_capacity = capacity;
+    return True;
+}
+
+/* The name's number in the image, the same each time it's asked for. */
+static uint32_t name_number(writer_t *w, bytearray_t *name) {
+    if (w->nnames * 2 >= w->name_capacity && !grow_names(w)) {
+        w->err = ERR_OUT_OF_MEMORY;
+        return 0;
+    }
+
+    uint32_t mask = w->name_capacity - 1;
+    uint32_t i = ptr_hash(name) & mask;
+    for (; w->name_slots[i] != 0; i = (i + 1) & mask) {
+        if (w->names[w->name_slots[i] - 1] == name) return w->name_slots[i] - 1;
+    }
+    w->names[w->nnames] = name;
+    w->name_slots[i] = ++w->nnames;
+    return w->nnames - 1;
+}
+
+/*
+ * Write the pointer in slot into the copy, as an offset or a name's number.
+ * If it's to a node, walk that next. Code can only point at itself and at
+ * names; anything else can't be written.
+ */
+static void put_ptr(writer_t *w, void *slot, boolean node) {
+    void *p = *(void **) slot;
+    if (p == NULL) return;
+
+    size_t at = (size_t) image_offset(w, slot, True);
+    int64_t to = image_offset(w, p, node);
+    if (to >= 0) {
+        *(uintptr_t *) (w->code + at) = (uintptr_t) to;
+        w->marks[at / IMAGE_WORD] |= MARK_PTR;
+        if (node && !(w->marks[to / IMAGE_WORD] & MARK_NODE)) {
+            w->marks[to / IMAGE_WORD] |= MARK_NODE;
+            push(w, p);
+        }
+        return;
+    }
+
+    if (node && ((gc_header_t *) p)->type == TYPE_BYTEARRAY_DATA && bytearray_is_interned(p)) {
+        *(uintptr_t *) (w->code + at) = name_number(w, p);
+        w->marks[at / IMAGE_WORD] |= MARK_NAME;
+        return;
+    }
+
+    w->err = ERR_TYPE_UNSUPPORTED;
+}
+
+static void put_table(writer_t *w, match_table_t *table) {
+    put_ptr(w, &table->keys, False);
+    put_ptr(w, &table->jump, False);
+}
+
+static void put_match(writer_t *w, ast_match_t *match) {
+    put_ptr(w, &match->subject, True);
+    put_ptr(w, &match->arm_list, True);
+    put_ptr(w, &match->arms, False);
+    for (int i = 0; i < match->narms; i++) put_ptr(w, &match->arms[i], True);
+    put_table(w, &match->ints);
+    put_table(w, &match->bytes);
+    put_ptr(w, &match->strs, False);
+    for (uint32_t i = 0; i < match->nstrs; i++) put_ptr(w, &match->strs[i].key, True);
+}
+
+/* A node's pointers are its children, but for the nodes that have others. */
+static void put_children(writer_t *w, gc_header_t *node) {
+    switch (node->type) {
+        case TYPE_BYTEARRAY_DATA:
+            put_ptr(w, &((bytearray_t *) node)->parent, True);
+            put_ptr(w, &((bytearray_t *) node)->data, False);
+            return;
+        case AST_BYTEARRAY_DECL_DATA:
+            put_ptr(w, &((ast_array_decl_t *) node)->size, True);
+            return;
+        case AST_FIELD_GET_DATA:
+            put_ptr(w, &((ast_field_t *) node)->receiver, True);
+            put_ptr(w, &((ast_field_t *) node)->name, True);
+            return;
+        case AST_MATCH_DATA:
+            put_match(w, (ast_match_t *) node);
+            return;
+        default:
+            for (int i = 0; i < node->children; i++) {
+                put_ptr(w, (unsigned char *) node + sizeof(gc_header_t) + i * sizeof(void *), True);
+            }
+            return;
+    }
+}
+
+static boolean put_words(FILE *f, writer_t *w, uint8_t mark) {
+    for (size_t i = 0; i < w->code_size / IMAGE_WORD; i++) {
+        if (!(w->marks[i] & mark)) continue;
+        uint32_t word = (uint32_t) i;
+        if (fwrite(&word, sizeof(word), 1, f) != 1) return False;
+    }
+    return True;
+}
+
+static uint64_t count_words(writer_t *w, uint8_t mark) {
+    uint64_t n = 0;
+    for (size_t i = 0; i < w->code_size / IMAGE_WORD; i++) {
+        if (w->marks[i] & mark) n++;
+    }
+    return n;
+}
+
+/* Write to a file of its own, then move that in, so a run never maps half an image. */
+static error_t save(writer_t *w, const char *fname, image_key_t *key, size_t root) {
+    image_header_t header = {
+            .magic = IMAGE_MAGIC,
+            .version = IMAGE_VERSION,
+            .build = IMAGE_BUILD_ID,
+            .layout = layout(),
+            .key = *key,
+            .code_size = w->code_size,
+            .root = root,
+            .nptrs = count_words(w, MARK_PTR),
+            .nname_refs = count_words(w, MARK_NAME),
+            .nnames = w->nnames,
+            .names_size = 0,
+    };
+    for (uint32_t i = 0; i < w->nnames; i++) header.names_size += sizeof(uint32_t) + w->names[i]->size;
+
+    size_t len = c_str_len(fname) + 5;
+    char *tmp = malloc(len);
+    if (tmp == NULL) return ERR_OUT_OF_MEMORY;
+    snprintf(tmp, len, "%s.tmp", fname);
+
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL) {
+        free(tmp);
+        return ERR_BAD_FILENAME;
+    }
+
+    boolean ok = fwrite(&header, sizeof(header), 1, f) == 1
+                 && fwrite(w->code, w->code_size, 1, f) == 1
+                 && put_words(f, w, MARK_PTR)
+                 && put_words(f, w, MARK_NAME);
+    for (uint32_t i = 0; ok && i < w->nnames; i++) {
+        uint32_t size = (uint32_t) w->names[i]->size;
+        ok = fwrite(&size, sizeof(size), 1, f) == 1
+             && (size == 0 || fwrite(w->names[i]->data, size, 1, f) == 1);
+    }
+
+    if (fclose(f) != 0) ok = False;
+    if (ok && rename(tmp, fname) != 0) ok = False;
+    if (!ok) remove(tmp);
+    free(tmp);
+    return ok ? ERR_NO_ERROR : ERR_WRITE_ERROR;
+}
+
+error_t image_write(const char *fname, image_key_t *key, ast_code_t *code, ast_expr_t *root) {
+    writer_t w;
+    mem_set(&w, 0, sizeof(writer_t));
+
+    w.err = gather(&w, code, root);
+    if (w.err == ERR_NO_ERROR) {
+        size_t at = (size_t) image_offset(&w, root, True);
+        w.marks[at / IMAGE_WORD] |= MARK_NODE;
+        put_children(&w, (gc_header_t *) root);
+        while (w.ntodo > 0 && w.err == ERR_NO_ERROR) put_children(&w, w.todo[--w.ntodo]);
+        if (w.err == ERR_NO_ERROR) w.err = save(&w, fname, key, at);
+    }
+
+    free(w.regions);
+    free(w.code);
+    free(w.marks);
+    free(w.todo);
+    free(w.names);
+    free(w.name_slots);
+    return w.err;
+}
+
+/* Whether the header is for key, and says what the rest of the size bytes are. */
+static boolean fits(image_header_t *header, image_key_t *key, size_t size) {
+    if (!mem_eq(header->magic, IMAGE_MAGIC, sizeof(header->magic))) return False;
+    if (header->version != IMAGE_VERSION || header->build != IMAGE_BUILD_ID) return False;
+    if (header->layout != layout()) return False;
+    if (header->key.hash != key->hash
+        || header->key.size != key->size
+        || header->key.opt_level != key->opt_level) {
+        return False;
+    }
+
+    size_t rest = size - sizeof(image_header_t);
+    if (header->code_size > rest || header->code_size % IMAGE_WORD != 0) return False;
+    if (header->code_size < sizeof(ast_expr_t)
+        || header->root > header->code_size - sizeof(ast_expr_t)
+        || header->root % IMAGE_WORD != 0) {
+        return False;
+    }
+    rest -= header->code_size;
+    if (header->nptrs > rest / sizeof(uint32_t)) return False;
+    rest -= header->nptrs * sizeof(uint32_t);
+    if (header->nname_refs > rest / sizeof(uint32_t)) return False;
+    rest -= header->nname_refs * sizeof(uint32_t);
+    return header->names_size == rest && header->nnames <= rest / sizeof(uint32_t);
+}
+
+/* Intern the names, and put them and the code's address into its words. */
+static boolean relocate(image_header_t *header, unsigned char *code) {
+    uint32_t *ptrs = (uint32_t *) (code + header->code_size);
+    uint32_t *name_refs = ptrs + header->nptrs;
+    unsigned char *names = (unsigned char *) (name_refs + header->nname_refs);
+    unsigned char *end = names + header->names_size;
+    uintptr_t *words = (uintptr_t *) code;
+    size_t nwords = header->code_size / IMAGE_WORD;
+
+    for (uint64_t i = 0; i < header->nptrs; i++) {
+        if (ptrs[i] >= nwords || words[ptrs[i]] > header->code_size) return False;
+        words[ptrs[i]] += (uintptr_t) code;
+    }
+
+    bytearray_t **interned = malloc((size_t) header->nnames * sizeof(bytearray_t *) + 1);
+    if (interned == NULL) return False;
+    for (uint64_t i = 0; i < header->nnames; i++) {
+        uint32_t size;
+        if ((size_t) (end - names) < sizeof(size)) goto fail;
+        mem_cp(&size, names, sizeof(size));
+        names += sizeof(size);
+        if ((size_t) (end - names) < size) goto fail;
+        interned[i] = bytearray_intern(names, size);
+        if (interned[i] == NULL) goto fail;
+        names += size;
+    }
+
+    for (uint64_t i = 0; i < header->nname_refs; i++) {
+        if (name_refs[i] >= nwords || words[name_refs[i]] >= header->nnames) goto fail;
+        words[name_refs[i]] = (uintptr_t) interned[words[name_refs[i]]];
+    }
+    free(interned);
+    return True;
+
+    fail:
+    free(interned);
+    return False;
+}
+
+ast_code_t *image_load(const char *fname, image_key_t *key, ast_expr_t *root) {
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(image_header_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    // Private, so the code can be written to as it runs, and relocated.
+    size_t size = (size_t) st.st_size;
+    unsigned char *image = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) return NULL;
+
+    image_header_t *header = (image_header_t *) image;
+    unsigned char *code = image + sizeof(image_header_t);
+    if (!fits(header, key, size) || !relocate(header, code)) {
+        munmap(image, size);
+        return NULL;
+    }
+
+    ast_code_t *loaded = ast_code_new();
+    if (loaded == NULL) {
+        munmap(image, size);
+        return NULL;
+    }
+    loaded->image = image;
+    loaded->image_size = size;
+    mem_cp(root, code + header->root, sizeof(ast_expr_t));
+    return loaded;
+}
@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include "../inc/type.h"
+#include "../inc/mem.h"
+#include "../inc/list.h"
+#include "../inc/eval.h"
+#include "../inc/iter.h"
+
+/*
+ * A pipeline stage keeps the iterator it pulls from in obj, and its function
+ * or second iterator in cursor, so the GC sees them both. Counting stages
+ * use index. A stage with a function keeps the scope of its calls in table,
+ * and each call reuses it, so running a chain allocates no more per elem
+ * than its functions do.
+ *
+ * If a stage's function fails, the stage stops with the error in err, and
+ * the stages after it stop with the same error. Whatever runs the chain
+ * returns it as an Error.
+ */
+
+obj_t *iter_of(obj_t *obj) {
+    if (TYPEOF(obj) == TYPE_ITERATOR) return obj;
+
+    static_method iterator = get_static_method(TYPEOF(obj), METHOD_ITERATOR);
+    if (iterator == NULL) {
+        printf("%s is not iterable.\n", type_names[TYPEOF(obj)]);
+        return NULL;
+    }
+    return iterator(obj, NULL);
+}
+
+/*
+ * Get the next elem from src for the stage. If src has run out, stop the
+ * stage as well and return NULL; Nil is a perfectly good elem.
+ */
+static obj_t *pull(obj_iter_t *stage, obj_t *src) {
+    obj_iter_t *iter = src->iterator;
+    obj_t *elem = iter->next(iter);
+    if (iter->state == ITER_STOPPED) {
+        stage->state = ITER_STOPPED;
+        stage->err = iter->err;
+        return NULL;
+    }
+    return elem;
+}
+
+static obj_t *fail(obj_iter_t *stage, obj_t *error) {
+    stage->state = ITER_STOPPED;
+    stage->err = error->errval;
+    return nil_obj();
+}
+
+/* The result of running a chain: value, or the Error if the chain failed. */
+static obj_t *finish(obj_iter_t *iter, obj_t *value) {
+    return iter->err != ERR_NO_ERROR ? error_obj(iter->err) : value;
+}
+
+/* Call the stage's function on elem. The args live on the stack; nothing keeps them. */
+static obj_t *call_on(obj_iter_t *stage, obj_t *elem) {
+    obj_varargs_t args = {.hdr = {.type = TYPE_VARIABLE_ARGS, .flags = F_NONE, .children = 2},
+                          .arg = elem, .next = NULL};
+    return call_fn_in_scope((obj_t *) stage->cursor, &args, &stage->table);
+}
+
+static obj_t *pair(obj_t *a, obj_t *b) {
+    obj_list_element_t *second = (obj_list_element_t *) alloc_type(TYPE_LIST_ELEM_DATA, F_NONE);
+    second->node = b;
+    second->next = NULL;
+    obj_list_element_t *first = (obj_list_element_t *) alloc_type(TYPE_LIST_ELEM_DATA, F_NONE);
+    first->node = a;
+    first->next = second;
+    return list_obj(first);
+}
+
+static obj_t *map_next(obj_iter_t *stage) {
+    if (stage->state == ITER_STOPPED) return nil_obj();
+
+    obj_t *elem = pull(stage, stage->obj);
+    if (elem == NULL) return nil_obj();
+    obj_t *mapped = call_on(stage, elem);
+    if (TYPEOF(mapped) == TYPE_ERROR) return fail(stage, mapped);
+    return mapped;
+}
+
+static obj_t *filter_next(obj_iter_t *stage) {
+    if (stage->state == ITER_STOPPED) return nil_obj();
+
+    for (;;) {
+        obj_t *elem = pull(stage, stage->obj);
+        if (elem == NULL) return nil_obj();
+
+        obj_t *keep = call_on(stage, elem);
+        if (TYPEOF(keep) == TYPE_ERROR) return fail(stage, keep);
+        if (TYPEOF(keep) == TYPE_BOOLEAN && keep->boolval) return elem;
+    }
+}
+
+static obj_t *take_next(obj_iter_t *stage) {
+    if (stage->state == ITER_STOPPED) return nil_obj();
+
+    // Don't pull anything once we have enough; the source may be expensive.
+    if (stage->index <= 0) {
+        stage->state = ITER_STOPPED;
+        return nil_obj();
+    }
+    stage->index--;
+
+    obj_t *elem = pull(stage, stage->obj);
+    return elem == NULL ? nil_obj() : elem;
+}
+
+static obj_t *zip_next(obj_iter_t *stage) {
+    if (stage->state == ITER_STOPPED) return nil_obj();
+
+    obj_t *a = pull(stage, stage->obj);
+    if (a == NULL) return nil_obj();
+    obj_t *b = pull(stage, (obj_t *) stage->cursor);
+    if (b == NULL) return nil_obj();
+    return pair(a, b);
+}
+
+static obj_t *enumerate_next(obj_iter_t *stage) {
+    if (stage->state == ITER_STOPPED) return nil_obj();
+
+    obj_t *elem = pull(stage, stage->obj);
+    if (elem == NULL) return nil_obj();
+    return pair(int_obj((int) stage->index++), elem);
+}
+
+static obj_t *stage_of(obj_t *obj, obj_t *(*next)(obj_iter_t *), void *cursor, int64_t index) {
+    obj_t *src = iter_of(obj);
+    if (src == NULL) return nil_obj();
+
+    obj_t *stage = iterator_obj(src, next);
+    stage->iterator->cursor = cursor;
+    stage->iterator->index = index;
+    return stage;
+}
+
+static obj_t *fn_arg(obj_varargs_t *args, const char *method) {
+    if (args == NULL || args->arg == NULL || TYPEOF(args->arg) != TYPE_FUNCTION) {
+        printf("Function required for %s().\n", method);
+        return NULL;
+    }
+    return args->arg;
+}
+
+obj_t *iter_map(obj_t *obj, obj_varargs_t *args) {
+    obj_t *fn = fn_arg(args, "map");
+    if (fn == NULL) return nil_obj();
+    return stage_of(obj, map_next, fn, 0);
+}
+
+obj_t *iter_filter(obj_t *obj, obj_varargs_t *args) {
+    obj_t *fn = fn_arg(args, "filter");
+    if (fn == NULL) return nil_obj();
+    return stage_of(obj, filter_next, fn, 0);
+}
+
+obj_t *iter_take(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL || TYPEOF(args->arg) != TYPE_INT) {
+        printf("Int required for take().\n");
+        return nil_obj();
+    }
+    return stage_of(obj, take_next, NULL, args->arg->intval);
+}
+
+obj_t *iter_zip(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Null arg to zip()\n");
+        return nil_obj();
+    }
+    obj_t *other = iter_of(args->arg);
+    if (other == NULL) return nil_obj();
+    return stage_of(obj, zip_next, other, 0);
+}
+
+obj_t *iter_enumerate(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return stage_of(obj, enumerate_next, NULL, 0);
+}
+
+obj_t *iter_reduce(obj_t *obj, obj_varargs_t *args) {
+    obj_t *fn = fn_arg(args, "reduce");
+    if (fn == NULL) return nil_obj();
+    obj_t *src = iter_of(obj);
+    if (src == NULL) return nil_obj();
+    obj_iter_t *iter = src->iterator;
+
+    obj_t *acc = args->next != NULL ? args->next->arg : iter->next(iter);
+    if (iter->state == ITER_STOPPED) return finish(iter, args->next != NULL ? acc : nil_obj());
+
+    void *scope = NULL;
+    obj_varargs_t second = {.hdr = {.type = TYPE_VARIABLE_ARGS, .flags = F_NONE, .children = 2}, .next = NULL};
+    obj_varargs_t first = {.hdr = {.type = TYPE_VARIABLE_ARGS, .flags = F_NONE, .children = 2}, .next = &second};
+    for (obj_t *elem = iter->next(iter); iter->state != ITER_STOPPED; elem = iter->next(iter)) {
+        first.arg = acc;
+        second.arg = elem;
+        acc = call_fn_in_scope(fn, &first, &scope);
+        if (TYPEOF(acc) == TYPE_ERROR) return acc;
+    }
+    return finish(iter, acc);
+}
+
+obj_t *iter_sum(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    obj_t *src = iter_of(obj);
+    if (src == NULL) return nil_obj();
+    obj_iter_t *iter = src->iterator;
+
+    // Add numbers unboxed until something else turns up, or the Ints
+    // would overflow; from there on, the elems' add methods take over.
+    int int_sum = 0;
+    float float_sum = 0;
+    boolean floats = False;
+    size_t seen = 0;
+    obj_t *elem = iter->next(iter);
+    for (; iter->state != ITER_STOPPED; elem = iter->next(iter)) {
+        if (TYPEOF(elem) == TYPE_INT) {
+            int next_sum;
+            if (__builtin_add_overflow(int_sum, elem->intval, &next_sum)) break;
+            int_sum = next_sum;
+        } else if (TYPEOF(elem) == TYPE_FLOAT) {
+            float_sum += elem->floatval;
+            floats = True;
+        } else {
+            break;
+        }
+        seen++;
+    }
+
+    obj_t *acc = floats ? float_obj(float_sum + (float) int_sum) : int_obj(int_sum);
+    if (iter->state == ITER_STOPPED) return finish(iter, acc);
+
+    // If there were no numbers before elem, start from elem.
+    if (seen == 0) {
+        acc = elem;
+        elem = iter->next(iter);
+    }
+    for (; iter->state != ITER_STOPPED; elem = iter->next(iter)) {
+        static_method add = get_static_method(TYPEOF(acc), METHOD_ADD);
+        if (add == NULL) {
+            printf("Can't add to %s.\n", type_names[TYPEOF(acc)]);
+            return nil_obj();
+        }
+        acc = add(acc, wrap_varargs(1, elem));
+    }
+    return finish(iter, acc);
+}
+
+obj_t *iter_count(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    obj_t *src = iter_of(obj);
+    if (src == NULL) return nil_obj();
+    obj_iter_t *iter = src->iterator;
+
+    int n = 0;
+    for (iter->next(iter); iter->state != ITER_STOPPED; iter->next(iter)) n++;
+    return finish(iter, int_obj(n));
+}
+
+obj_t *iter_to_list(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    obj_t *src = iter_of(obj);
+    if (src == NULL) return nil_obj();
+    obj_iter_t *iter = src->iterator;
+
+    obj_t *list = list_obj(NULL);
+    obj_list_element_t *last = NULL;
+    for (obj_t *elem = iter->next(iter); iter->state != ITER_STOPPED; elem = iter->next(iter)) {
+        obj_list_element_t *e = (obj_list_element_t *) alloc_type(TYPE_LIST_ELEM_DATA, F_NONE);
+        e->node = elem;
+        e->next = NULL;
+        if (last == NULL) {
+            list->list->elems = e;
+        } else {
+            last->next = e;
+        }
+        last = e;
+    }
+    return finish(iter, list);
+}
+
+static obj_t *iter_self(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return obj;
+}
+
+static_method get_iter_static_method(static_method_ident_t method_id) {
+    switch (method_id) {
+        case METHOD_ITERATOR:
+            return iter_self;
+        case METHOD_MAP:
+            return iter_map;
+        case METHOD_FILTER:
+            return iter_filter;
+        case METHOD_TAKE:
+            return iter_take;
+        case METHOD_ZIP:
+            return iter_zip;
+        case METHOD_ENUMERATE:
+            return iter_enumerate;
+        case METHOD_REDUCE:
+            return iter_reduce;
+        case METHOD_SUM:
+            return iter_sum;
+        case METHOD_COUNT:
+            return iter_count;
+        case METHOD_TO_LIST:
+            return iter_to_list;
+        default:
+            return NULL;
+    }
+}
@@ -1,42 +1,178 @@
-#include <ctype.h>
 #include "../inc/ptr.h"
 #include "../inc/str.h"
 #include "../inc/token.h"
 #include "../inc/lexer.h"
 
-#define MAX_WORD 256
-char word_buf[MAX_WORD];
-char next_word_buf[MAX_WORD];
+/*
+ * The lexer reads the caller's input in place. Past the end of it, every
+ * char is '\0', and pos keeps counting so that unreadch() still lines up.
+ * The text of a token is the slice of input at its offset and length.
+ */
+
+/*
+ * What each char can be part of. Anything outside ASCII is in no class, so
+ * outside strings and comments it's a lex error.
+ */
+#define CC_SPACE 1 // Between tokens, but EOL is a token itself.
+#define CC_DIGIT 2
+#define CC_ALPHA 4 // Letters and '_', which can start a word.
+#define CC_HEX 8
+#define CC_WORD (CC_ALPHA | CC_DIGIT)
+
+#define S CC_SPACE
+#define D (CC_DIGIT | CC_HEX)
+#define A CC_ALPHA
+#define H (CC_ALPHA | CC_HEX)
+static const uint8_t char_class[256] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, S, 0, 0, 0, S, 0, 0, // \t \r
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        S, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // ' '
+        D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0, // 0-9
+        0, H, H, H, H, H, H, A, A, A, A, A, A, A, A, A, // A-O
+        A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, A, // P-Z _
+        0, H, H, H, H, H, H, A, A, A, A, A, A, A, A, A, // a-o
+        A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0, // p-z
+};
+#undef S
+#undef D
+#undef A
+#undef H
+
+#define IS(c, class) (char_class[(unsigned char) (c)] & (class))
+
+/*
+ * Reserved words are found with one probe, nearly always, in a table built
+ * from reserved[] the first time it's needed. The hash happens to be
+ * perfect for the words there are now; a collision just costs a second
+ * probe.
+ */
+#define KEYWORD_SLOTS 256
+
+static struct {
+    uint8_t index; // One more than the index into reserved[]; 0 is empty.
+    uint8_t length;
+} keywords[KEYWORD_SLOTS];
+static boolean keywords_ready = False;
+
+static uint32_t keyword_hash(const char *word, uint32_t length) {
+    unsigned char first = (unsigned char) word[0];
+    unsigned char second = (unsigned char) word[length > 1 ? 1 : 0];
+    unsigned char last = (unsigned char) word[length - 1];
+    return (length + first + 10u * last + 17u * second) % KEYWORD_SLOTS;
+}
+
+static void init_keywords(void) {
+    if (keywords_ready) return;
+
+    for (uint32_t j = 0; j < sizeof(reserved) / sizeof(reserved[0]); j++) {
+        uint32_t length = (uint32_t) c_str_len(reserved[j].string);
+        uint32_t slot = keyword_hash(reserved[j].string, length);
+        while (keywords[slot].index != 0) slot = (slot + 1) % KEYWORD_SLOTS;
+        keywords[slot].index = (uint8_t) (j + 1);
+        keywords[slot].length = (uint8_t) length;
+    }
+    keywords_ready = True;
+}
+
+static tag_t keyword_tag(const char *word, uint32_t length) {
+    for (uint32_t slot = keyword_hash(word, length);
+         keywords[slot].index != 0;
+         slot = (slot + 1) % KEYWORD_SLOTS) {
+        const token_t *kw = &reserved[keywords[slot].index - 1];
+        if (keywords[slot].length == length && mem_eq(kw->string, word, length)) return kw->tag;
+    }
+    return TAG_IDENT;
+}
+
+/*
+ * Runs of blanks and word chars, and the insides of comments and strings,
+ * are skipped 16 chars at a time while there are that many left.
+ */
+#ifdef HAVE_SIMD
+#include <immintrin.h>
+
+static int space_mask(const char *p) {
+    __m128i x = _mm_loadu_si128((const __m128i *) p);
+    __m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+                             _mm_cmpeq_epi8(x, _mm_set1_epi8('\t')));
+    return _mm_movemask_epi8(_mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('\r'))));
+}
+
+// Bytes past ASCII are negative, so the signed compares leave them out.
+static __m128i in_range(__m128i x, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8((char) (lo - 1))),
+                         _mm_cmplt_epi8(x, _mm_set1_epi8((char) (hi + 1))));
+}
+
+static int word_mask(const char *p) {
+    __m128i x = _mm_loadu_si128((const __m128i *) p);
+    // Setting 0x20 folds upper case onto lower case.
+    __m128i m = in_range(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+    m = _mm_or_si128(m, in_range(x, '0', '9'));
+    return _mm_movemask_epi8(_mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('_'))));
+}
+#endif
+
+/* Return where the run of chars in class that starts at i ends. */
+static uint32_t span(lexer_t *lexer, uint32_t i, uint8_t class) {
+    const char *s = lexer->input;
+#ifdef HAVE_SIMD
+    while (i + 16 <= lexer->size) {
+        int mask = class == CC_SPACE ? space_mask(s + i) : word_mask(s + i);
+        if (mask != 0xffff) return i + (uint32_t) __builtin_ctz((unsigned int) ~mask);
+        i += 16;
+    }
+#endif
+    while (i < lexer->size && IS(s[i], class)) i++;
+    return i;
+}
+
+/* Return where the first c at or after i is, or the end of the input. */
+static uint32_t find(lexer_t *lexer, uint32_t i, char c) {
+    const char *s = lexer->input;
+#ifdef HAVE_SIMD
+    __m128i v = _mm_set1_epi8(c);
+    while (i + 16 <= lexer->size) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (s + i)), v));
+        if (mask != 0) return i + (uint32_t) __builtin_ctz((unsigned int) mask);
+        i += 16;
+    }
+#endif
+    while (i < lexer->size && s[i] != c) i++;
+    return i;
+}
+
+static char charat(lexer_t *lexer, uint32_t pos) {
+    return pos < lexer->size ? lexer->input[pos] : '\0';
+}
 
 static void unreadch(lexer_t *lexer) {
     lexer->pos--;
-    lexer->buf[lexer->pos] = lexer->nextch;
-    if (lexer->pos > 0) {
-        lexer->nextch = lexer->buf[lexer->pos - 1];
-    } else {
-        lexer->nextch = '\0';
-    }
+    lexer->nextch = lexer->pos > 0 ? charat(lexer, lexer->pos - 1) : '\0';
 }
 
 static void readch(lexer_t *lexer) {
-    lexer->nextch = lexer->buf[lexer->pos++];
+    lexer->nextch = charat(lexer, lexer->pos++);
 }
 
-static void consume_ws(lexer_t *lexer) {
-    for (;;) {
-        readch(lexer);
-        switch (lexer->nextch) {
-            case ' ':
-            case '\t':
-            case '\r':
-                // Do not eat EOL.
-                /* continue */
-                break;
+/* Make the char at i the next one, as if everything before it was read. */
+static void seek(lexer_t *lexer, uint32_t i) {
+    lexer->pos = i + 1;
+    lexer->nextch = charat(lexer, i);
+}
 
-            default:
-                return;
-        }
-    }
+/* The token's text starts at nextch, and ends before the char at pos. */
+static void start_text(lexer_t *lexer) {
+    lexer->next_token.offset = lexer->pos - 1;
+}
+
+static void end_text(lexer_t *lexer) {
+    lexer->next_token.length = lexer->pos - lexer->next_token.offset;
+}
+
+static void consume_ws(lexer_t *lexer) {
+    // Do not eat EOL.
+    seek(lexer, span(lexer, lexer->pos, CC_SPACE));
 }
 
 static token_t *lexer_error(lexer_t *lexer) {
@@ -61,46 +197,50 @@ static token_t *lex_eol(lexer_t *lexer) {
  * Consume all text up to the end of the line; return EOL.
  */
 static token_t *lex_comment(lexer_t *lexer) {
-    while (lexer->nextch != 0 && lexer->nextch != '\n') {
-        readch(lexer);
-    }
+    seek(lexer, find(lexer, lexer->pos, '\n'));
 
     return lex_eol(lexer);
 }
 
 static void lex_word_raw(lexer_t *lexer) {
-    mem_set(next_word_buf, 0, MAX_WORD);
-    int i = 0;
-    do {
-        next_word_buf[i++] = lexer->nextch;
-        readch(lexer);
-    } while (isalnum(lexer->nextch) || lexer->nextch == '_');
-    unreadch(lexer);
+    start_text(lexer);
+    seek(lexer, span(lexer, lexer->pos, CC_WORD) - 1);
+    end_text(lexer);
 }
 
+/*
+ * Lex the digits of a hex or binary number. Like hex_to_int() and
+ * bin_to_int(), only the least significant 32 bits are kept.
+ */
 static token_t *lex_base(lexer_t *lexer, tag_t which) {
-    mem_set(next_word_buf, 0, MAX_WORD);
-    int i = 0;
+    uint32_t val = 0;
+    start_text(lexer);
 
     if (which == TAG_HEX) {
-        do {
+        for (;;) {
             char c = lexer->nextch;
-            if (c >= 'A' && c <= 'F') c = ((char) (c - 'A' + 'a'));
-            next_word_buf[i++] = c;
+            if (c >= '0' && c <= '9') {
+                val = (val << 4) | (uint32_t) (c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                val = (val << 4) | (uint32_t) (c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                val = (val << 4) | (uint32_t) (c - 'A' + 10);
+            } else {
+                break;
+            }
             readch(lexer);
-        } while ((lexer->nextch >= '0' && lexer->nextch <= '9') ||
-                 (lexer->nextch >= 'a' && lexer->nextch <= 'f') ||
-                 (lexer->nextch >= 'A' && lexer->nextch <= 'F'));
+        }
     } else { // which == TAG_BIN
-        do {
-            next_word_buf[i++] = lexer->nextch;
+        while (lexer->nextch == '0' || lexer->nextch == '1') {
+            val = (val << 1) | (uint32_t) (lexer->nextch - '0');
             readch(lexer);
-        } while (lexer->nextch == '0' || lexer->nextch == '1');
+        }
     }
     unreadch(lexer);
+    end_text(lexer);
 
     lexer->next_token.tag = which;
-    lexer->next_token.string = next_word_buf;
+    lexer->next_token.intval = (int32_t) val;
 
     return &lexer->next_token;
 }
@@ -166,13 +306,11 @@ static token_t *lex_field_or_method(lexer_t *lexer) {
     if (lexer->nextch == '(') {
         unreadch(lexer);
         lexer->next_token.tag = TAG_METHOD_CALL;
-        lexer->next_token.string = next_word_buf;
         return &lexer->next_token;
     }
 
     unreadch(lexer);
     lexer->next_token.tag = TAG_FIELD_ACCESS;
-    lexer->next_token.string = next_word_buf;
     return &lexer->next_token;
 }
 
@@ -186,18 +324,11 @@ static token_t *lex_word(lexer_t *lexer) {
 
     // Get the word.
     lex_word_raw(lexer);
+    const char *word = lexer->input + lexer->next_token.offset;
+    uint32_t length = lexer->next_token.length;
 
-    // Is it a reserved word?
-    for (int j = 0; j < sizeof(reserved) / sizeof(reserved[0]); j++) {
-        if (c_str_eq(reserved[j].string, next_word_buf)) {
-            lexer->next_token = reserved[j];
-            return &lexer->next_token;
-        }
-    }
-
-    // It's a plain old identifier.
-    lexer->next_token.tag = TAG_IDENT;
-    lexer->next_token.string = next_word_buf;
+    // A reserved word, or a plain old identifier.
+    lexer->next_token.tag = keyword_tag(word, length);
     return &lexer->next_token;
 }
 
@@ -231,16 +362,13 @@ static token_t *lex_member_access(lexer_t *lexer) {
 static token_t *lex_string(lexer_t *lexer) {
     // Eat initial quote.
     readch(lexer);
-    mem_set(next_word_buf, 0, MAX_WORD);
-    int i = 0;
-    while (lexer->nextch != '"') {
-        next_word_buf[i++] = lexer->nextch;
-        readch(lexer);
-    }
+    start_text(lexer);
+    seek(lexer, find(lexer, lexer->pos - 1, '"'));
+    if (lexer->nextch != '"') return lexer_error(lexer);
     // Ate final quote.
+    lexer->next_token.length = lexer->pos - 1 - lexer->next_token.offset;
 
     lexer->next_token.tag = TAG_STRING;
-    // The string value is moved in the advance() function.
     return &lexer->next_token;
 }
 
@@ -267,12 +395,9 @@ static token_t *get_token(lexer_t *lexer) {
         }
     }
 
-    if (ch >= '0' && ch <= '9') return lex_num(lexer);
+    if (IS(ch, CC_DIGIT)) return lex_num(lexer);
 
-    if ((ch >= 'a' && ch <= 'z') ||
-        (ch >= 'A' && ch <= 'Z') ||
-        (ch == '_'))
-        return lex_word(lexer);
+    if (IS(ch, CC_ALPHA)) return lex_word(lexer);
 
     switch (ch) {
         case '{':
@@ -385,27 +510,23 @@ static token_t *get_token(lexer_t *lexer) {
 
 void advance(lexer_t *lexer) {
     lexer->token = lexer->next_token;
-    switch (lexer->token.tag) {
-        case TAG_INT:
-            lexer->token.intval = lexer->next_token.intval;
-            break;
-        case TAG_FLOAT:
-            lexer->token.floatval = lexer->next_token.floatval;
-            break;
-        case TAG_BYTE:
-            lexer->token.ch = lexer->next_token.ch;
-            break;
-        default:
-            for (int i = 0; i < MAX_WORD; i++) {
-                word_buf[i] = next_word_buf[i];
-            }
-            lexer->token.string = word_buf;
-            break;
-    }
 
-    if (lexer->token.tag != TAG_EOF) {
-        lexer->next_token = *get_token(lexer);
-    }
+    // get_token() fills in next_token itself.
+    if (lexer->token.tag != TAG_EOF) get_token(lexer);
+}
+
+bytearray_t *token_bytearray(lexer_t *lexer) {
+    bytearray_t *a = bytearray_alloc(lexer->token.length);
+    mem_cp(a->data, (void *) (lexer->input + lexer->token.offset), lexer->token.length);
+    return a;
+}
+
+bytearray_t *token_name(lexer_t *lexer) {
+    return bytearray_intern((const byte *) lexer->input + lexer->token.offset, lexer->token.length);
+}
+
+bytearray_t *token_literal(lexer_t *lexer) {
+    return bytearray_intern_literal((const byte *) lexer->input + lexer->token.offset, lexer->token.length);
 }
 
 boolean eat(lexer_t *lexer, tag_t t) {
@@ -420,25 +541,18 @@ boolean eat(lexer_t *lexer, tag_t t) {
 }
 
 void lexer_init(lexer_t *lexer, const char input[], const uint32_t input_size) {
+    lexer->input = input;
+    lexer->size = input_size;
     lexer->pos = 0;
     lexer->err_pos = 0;
     lexer->depth = 1;
     lexer->err = ERR_NO_ERROR;
-
-    if (input_size > LEXER_BUF_SIZE) {
-        lexer->err = ERR_INPUT_TOO_LONG;
-        return;
-    }
-
-    mem_set(next_word_buf, 0, MAX_WORD);
-    mem_set(word_buf, 0, MAX_WORD);
-
-    mem_set(lexer->buf, 0, LEXER_BUF_SIZE);
-    for (uint32_t i = 0; i < input_size; i++) {
-        lexer->buf[i] = input[i];
-    }
+    init_keywords();
 
     lexer->token.tag = TAG_EOF;
-    lexer->next_token = *get_token(lexer);
+    lexer->token.offset = 0;
+    lexer->token.length = 0;
+    lexer->next_token = lexer->token;
+    get_token(lexer);
     advance(lexer);
 }
@@ -4,6 +4,7 @@
 #include "../inc/mem.h"
 #include "../inc/list.h"
 #include "../inc/rand.h"
+#include "../inc/eval.h"
 
 static obj_t *new_empty_list() {
     obj_t *obj = (obj_t *) alloc_type(TYPE_LIST, F_ENV_ASSIGNABLE);
@@ -13,6 +14,38 @@ static obj_t *new_empty_list() {
     return obj;
 }
 
+/*
+ * tail() and suffix slices share their elements with the list they came
+ * from, so taking one is O(1) past finding the start. Both lists are marked
+ * F_COPY_ON_WRITE, and whichever one first writes into its elements takes
+ * its own copy of them. An iterator already walking the shared elements
+ * keeps walking those.
+ */
+static obj_t *list_view(obj_t *src, obj_list_element_t *elems) {
+    obj_t *view = new_empty_list();
+    if (elems == NULL) return view;
+
+    view->list->elems = elems;
+    FLAGS(view->list) |= F_COPY_ON_WRITE;
+    FLAGS(src->list) |= F_COPY_ON_WRITE;
+    return view;
+}
+
+/* Give the list its own elements, if it's sharing them, before a write. */
+static void own_elems(obj_t *obj) {
+    if (!(FLAGS(obj->list) & F_COPY_ON_WRITE)) return;
+    FLAGS(obj->list) &= ~F_COPY_ON_WRITE;
+
+    obj_list_element_t **link = &obj->list->elems;
+    for (obj_list_element_t *e = obj->list->elems; e != NULL; e = e->next) {
+        obj_list_element_t *copy = (obj_list_element_t *) alloc_type(TYPE_LIST_ELEM_DATA, F_NONE);
+        copy->node = e->node;
+        copy->next = NULL;
+        *link = copy;
+        link = &copy->next;
+    }
+}
+
 static obj_list_element_t *list_get_elem(obj_t *obj, int offset) {
     int i = 0;
     obj_list_element_t *root = obj->list->elems;
@@ -84,6 +117,9 @@ obj_t *list_slice_internal(obj_t *obj, int start, int end) {
         i++;
     }
 
+    if (end == -1) return list_view(obj, root);
+    if (root == NULL) return new_empty_list();
+
     // Allocate a new list to return.
     obj_t *slice = (obj_t *) alloc_type(TYPE_LIST, F_NONE);
     slice->list = (obj_list_t *) alloc_type(TYPE_LIST_DATA, F_NONE);
@@ -212,6 +248,7 @@ obj_t *list_set(obj_t *obj, obj_varargs_t *args) {
         return nil_obj();
     }
 
+    own_elems(obj);
     obj_list_element_t *elem = obj->list->elems;
     for (int i = 0; i < offset; i++) {
         elem = elem->next;
@@ -249,10 +286,9 @@ obj_t *list_head(obj_t *obj, obj_varargs_t *args) {
 obj_t *list_tail(obj_t *obj, obj_varargs_t *args) {
     (void) args;
 
-    if (list_len_internal(obj) == 1) {
-        return new_empty_list();
-    }
-    return list_slice_internal(obj, 1, -1);
+    obj_list_element_t *head = obj->list->elems;
+    if (head == NULL) return new_empty_list();
+    return list_view(obj, head->next);
 }
 
 obj_t *list_prepend(obj_t *obj, obj_varargs_t *args) {
@@ -276,6 +312,7 @@ obj_t *list_append(obj_t *obj, obj_varargs_t *args) {
         return nil_obj();
     }
 
+    own_elems(obj);
     int len = list_len_internal(obj);
     obj_list_element_t *last = list_get_elem(obj, len - 1);
     obj_list_element_t *new_elem = (obj_list_element_t *) alloc_type(TYPE_LIST_ELEM_DATA, F_NONE);
@@ -299,6 +336,9 @@ obj_t *list_remove_first(obj_t *obj, obj_varargs_t *args) {
     if (head != NULL) {
         obj_list_element_t *new_head = head->next;
         obj->list->elems = new_head;
+        // A shared head may still be in another list. Nothing can be
+        // iterating towards the head, so it's enough to unlink it.
+        if (!(FLAGS(obj->list) & F_COPY_ON_WRITE)) head->hdr.flags |= F_REMOVED;
         return head->node;
     }
     return nil_obj();
@@ -307,31 +347,26 @@ obj_t *list_remove_first(obj_t *obj, obj_varargs_t *args) {
 obj_t *list_remove_last(obj_t *obj, obj_varargs_t *args) {
     (void) args;
 
+    own_elems(obj);
     obj_list_element_t *first = list_get_elem(obj, 0);
     if (first == NULL) {
         return nil_obj();
     }
 
-    int len = list_len_internal(obj);
-    obj_list_element_t *last = list_get_elem(obj, len - 1);
-    if (first == last) {
-        obj_t *obj = first->node;
+    if (first->next == NULL) {
         obj->list->elems = NULL;
-        mem_free(last);
-        last = NULL;
-        first->node = NULL;
-        first->next = NULL;
-        return obj;
+        first->hdr.flags |= F_REMOVED;
+        return first->node;
     }
 
-    obj_list_element_t *new_last = list_get_elem(obj, len - 2);
+    obj_list_element_t *new_last = first;
+    while (new_last->next->next != NULL) {
+        new_last = new_last->next;
+    }
+    obj_list_element_t *last = new_last->next;
     new_last->next = NULL;
-    obj_t *result = last->node;
-    last->node = NULL;
-    last->next = NULL;
-    mem_free(last);
-    last = NULL;
-    return result;
+    last->hdr.flags |= F_REMOVED;
+    return last->node;
 }
 
 obj_t *list_remove_at(obj_t *obj, obj_varargs_t *args) {
@@ -359,18 +394,14 @@ obj_t *list_remove_at(obj_t *obj, obj_varargs_t *args) {
     if (offset == len - 1) return list_remove_last(obj, NULL);
 
     // If it's not one of those, we can get the previous element and stitch from there.
+    own_elems(obj);
+    // The removed element keeps its link, in case an iterator is sitting on it.
     obj_list_element_t *prev = list_get_elem(obj, offset - 1);
     obj_list_element_t *target = prev->next;
-    obj_list_element_t *subseq = target->next;
-    prev->next = subseq;
+    prev->next = target->next;
+    target->hdr.flags |= F_REMOVED;
 
-    obj_t *r = target->node;
-
-    target->node = NULL;
-    target->next = NULL;
-    mem_free(target);
-    target = NULL;
-    return r;
+    return target->node;
 }
 
 obj_t *list_random_choice(obj_t *obj, obj_varargs_t *args) {
@@ -383,25 +414,156 @@ obj_t *list_random_choice(obj_t *obj, obj_varargs_t *args) {
     return list_get_elem(obj, rand32() % len)->node;
 }
 
+/*
+ * The user's comparison for a sort, the scope its calls share, and the
+ * error if a call to it failed.
+ */
+typedef struct {
+    obj_t *fn;
+    void *scope;
+    error_t err;
+} sort_fn_t;
+
+typedef boolean (*less_than)(obj_t *a, obj_t *b, sort_fn_t *by);
+
+static boolean int_lt(obj_t *a, obj_t *b, sort_fn_t *by) {
+    return a->intval < b->intval;
+}
+
+static boolean float_lt(obj_t *a, obj_t *b, sort_fn_t *by) {
+    return a->floatval < b->floatval;
+}
+
+static boolean byte_lt(obj_t *a, obj_t *b, sort_fn_t *by) {
+    return a->byteval < b->byteval;
+}
+
+static boolean method_lt(obj_t *a, obj_t *b, sort_fn_t *by) {
+    static_method lt = get_static_method(TYPEOF(a), METHOD_LT);
+    if (lt == NULL) return False;
+    obj_t *r = lt(a, wrap_varargs(1, b));
+    return TYPEOF(r) == TYPE_BOOLEAN && r->boolval;
+}
+
+static boolean fn_lt(obj_t *a, obj_t *b, sort_fn_t *by) {
+    // After a failure, finish the passes without calling fn again.
+    if (by->err != ERR_NO_ERROR) return False;
+
+    obj_varargs_t second = {.hdr = {.type = TYPE_VARIABLE_ARGS, .flags = F_NONE, .children = 2},
+                            .arg = b, .next = NULL};
+    obj_varargs_t first = {.hdr = {.type = TYPE_VARIABLE_ARGS, .flags = F_NONE, .children = 2},
+                           .arg = a, .next = &second};
+    obj_t *r = call_fn_in_scope(by->fn, &first, &by->scope);
+    if (TYPEOF(r) == TYPE_ERROR) by->err = r->errval;
+    return TYPEOF(r) == TYPE_BOOLEAN && r->boolval;
+}
+
+/*
+ * Pick the cheapest comparison that works for every element. Lists of
+ * all Ints, all Floats or all Bytes compare their values directly.
+ */
+static less_than choose_lt(obj_list_element_t *elems) {
+    if (elems == NULL) return method_lt;
+
+    type_t type = TYPEOF(elems->node);
+    for (obj_list_element_t *e = elems->next; e != NULL; e = e->next) {
+        if (TYPEOF(e->node) != type) return method_lt;
+    }
+
+    switch (type) {
+        case TYPE_INT:
+            return int_lt;
+        case TYPE_FLOAT:
+            return float_lt;
+        case TYPE_BYTE:
+            return byte_lt;
+        default:
+            return method_lt;
+    }
+}
+
+/*
+ * Bottom-up merge sort of n objects, using tmp as scratch space. Each pass
+ * merges into the other array; returns whichever holds the sorted result.
+ * Stable: on ties, the element from the left run goes first.
+ */
+static obj_t **merge_sort(obj_t **a, obj_t **tmp, size_t n, less_than lt, sort_fn_t *by) {
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+
+            while (i < mid && j < hi) {
+                tmp[k++] = lt(a[j], a[i], by) ? a[j++] : a[i++];
+            }
+            while (i < mid) tmp[k++] = a[i++];
+            while (j < hi) tmp[k++] = a[j++];
+        }
+        obj_t **swap = a;
+        a = tmp;
+        tmp = swap;
+    }
+    return a;
+}
+
+obj_t *list_sort(obj_t *obj, obj_varargs_t *args) {
+    obj_t *fn = NULL;
+    if (args != NULL && args->arg != NULL) {
+        fn = args->arg;
+        if (TYPEOF(fn) != TYPE_FUNCTION) {
+            printf("sort() takes a function.\n");
+            return nil_obj();
+        }
+    }
+
+    size_t len = (size_t) list_len_internal(obj);
+    if (len < 2) return obj;
+
+    // Sort the values in an array, then write them back into the elements
+    // in order, so the list's structure doesn't change.
+    obj_t **vals = mem_alloc(2 * len * sizeof(obj_t *));
+    if (vals == NULL) {
+        printf("Out of memory to sort %zu elements.\n", len);
+        return nil_obj();
+    }
+    own_elems(obj);
+    size_t i = 0;
+    for (obj_list_element_t *e = obj->list->elems; e != NULL; e = e->next) {
+        vals[i++] = e->node;
+    }
+
+    less_than lt = fn != NULL ? fn_lt : choose_lt(obj->list->elems);
+    sort_fn_t by = {.fn = fn, .scope = NULL, .err = ERR_NO_ERROR};
+    obj_t **sorted = merge_sort(vals, vals + len, len, lt, &by);
+    if (by.err != ERR_NO_ERROR) {
+        // Leave the list as it was.
+        mem_free(vals);
+        return error_obj(by.err);
+    }
+
+    i = 0;
+    for (obj_list_element_t *e = obj->list->elems; e != NULL; e = e->next) {
+        e->node = sorted[i++];
+    }
+    mem_free(vals);
+
+    return obj;
+}
+
 static obj_t *iter_next(obj_iter_t *iterable) {
-    int current_index;
+    obj_list_element_t *elem;
 
     switch (iterable->state) {
         case ITER_NOT_STARTED:
             iterable->state = ITER_ITERATING;
-            current_index = 0;
-            iterable->state_obj->intval = current_index;
-            // Fall through to ITERATING.
+            elem = iterable->obj->list->elems;
+            break;
 
         case ITER_ITERATING:
-            current_index = iterable->state_obj->intval;
-            obj_t *next_val = list_get_at(iterable->obj, current_index);
-            if (TYPEOF(next_val) == TYPE_NIL) {
-                iterable->state = ITER_STOPPED;
-                return next_val;
-            }
-            iterable->state_obj->intval += 1;
-            return next_val;
+            // The cursor is the element we yielded last.
+            elem = ((obj_list_element_t *) iterable->cursor)->next;
+            break;
 
         case ITER_STOPPED:
             return nil_obj();
@@ -410,13 +572,25 @@ static obj_t *iter_next(obj_iter_t *iterable) {
             printf("Unexpected iteration state enum! %d\n", iterable->state);
             return nil_obj();
     }
+
+    while (elem != NULL && (elem->hdr.flags & F_REMOVED)) {
+        elem = elem->next;
+    }
+
+    if (elem == NULL) {
+        iterable->state = ITER_STOPPED;
+        iterable->cursor = NULL;
+        return nil_obj();
+    }
+
+    iterable->cursor = elem;
+    return elem->node;
 }
 
 obj_t *list_iterator(obj_t *obj, obj_varargs_t *args) {
     (void) args;
 
-    obj_t *start_state = int_obj(0);
-    return iterator_obj(obj, start_state, iter_next);
+    return iterator_obj(obj, iter_next);
 }
 
 static_method get_list_static_method(static_method_ident_t method_id) {
@@ -453,6 +627,8 @@ static_method get_list_static_method(static_method_ident_t method_id) {
             return list_random_choice;
         case METHOD_ITERATOR:
             return list_iterator;
+        case METHOD_SORT:
+            return list_sort;
         default:
             return NULL;
     }
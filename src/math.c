@@ -17,3 +17,28 @@ int abs(int n) {
 
     return n;
 }
+
+/*
+ * The system <math.h> is shadowed by ours, so use the compiler builtins.
+ * They compile to the libm calls.
+ */
+float math_apply(math_fn_t fn, float x) {
+    switch (fn) {
+        case MATH_SQRT:
+            return __builtin_sqrtf(x);
+        case MATH_EXP:
+            return __builtin_expf(x);
+        case MATH_LN:
+            return __builtin_logf(x);
+        case MATH_LOG:
+            return __builtin_log10f(x);
+        case MATH_SIN:
+            return __builtin_sinf(x);
+        case MATH_COS:
+            return __builtin_cosf(x);
+        case MATH_TAN:
+            return __builtin_tanf(x);
+        default:
+            return x;
+    }
+}
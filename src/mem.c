@@ -5,6 +5,7 @@
 #include "../inc/mem.h"
 #include "../inc/ptr.h"
 #include "../inc/heap.h"
+#include "../inc/arena.h"
 
 #define HDR_ALLOC(t, y, c) { \
   hdr = mem_alloc(sizeof(t)); \
@@ -12,7 +13,15 @@
   hdr->children = c; \
 }
 
+// While set, allocations come from here instead of the heap.
+static arena_t *arena = NULL;
+
+void mem_use_arena(arena_t *a) {
+    arena = a;
+}
+
 void *mem_alloc(size_t size) {
+    if (arena != NULL) return arena_alloc(arena, size);
     return ealloc(size);
 }
 
@@ -21,6 +30,8 @@ void *mem_realloc(void *b, size_t size) {
 }
 
 void mem_free(void *b) {
+    // Memory in an arena goes when the arena does.
+    if (!on_heap(b)) return;
     return efree(b);
 }
 
@@ -44,6 +55,41 @@ gc_header_t *alloc_dict(uint32_t buckets, flags_t flags) {
     return hdr;
 }
 
+gc_header_t *alloc_record_type(uint32_t nfields) {
+    gc_header_t *hdr;
+
+    hdr = mem_alloc(sizeof(obj_record_type_t) + nfields * sizeof(record_field_t));
+    if (hdr == NULL) return NULL;
+    hdr->type = TYPE_RECORD_TYPE_DATA;
+    hdr->flags = F_NONE;
+    // The names are interned.
+    hdr->children = 0;
+
+    ((obj_record_type_t *) hdr)->nfields = nfields;
+    mem_set(((obj_record_type_t *) hdr)->fields, 0, sizeof(record_field_t) * nfields);
+
+    return hdr;
+}
+
+/**
+ * Allocate a record, sizing the obj_record_t slots to the number of fields
+ * of its type. The GC scans the slots; see scan_record_children().
+ */
+gc_header_t *alloc_record(uint32_t nslots) {
+    gc_header_t *hdr;
+
+    hdr = mem_alloc(sizeof(obj_record_t) + nslots * sizeof(obj_t *));
+    if (hdr == NULL) return NULL;
+    hdr->type = TYPE_RECORD_DATA;
+    hdr->flags = F_NONE;
+    hdr->children = 1;
+
+    ((obj_record_t *) hdr)->type = NULL;
+    mem_set(((obj_record_t *) hdr)->slots, 0, sizeof(obj_t *) * nslots);
+
+    return hdr;
+}
+
 gc_header_t *alloc_type(type_t type, flags_t flags) {
     assert(type > TYPE_ERR_DO_NOT_USE && type < TYPE_MAX);
 
@@ -67,10 +113,16 @@ gc_header_t *alloc_type(type_t type, flags_t flags) {
             // Fancy types have one pointer to the child structure.
         case TYPE_LIST:
         case TYPE_DICT:
+        case TYPE_SET:
         case TYPE_BYTEARRAY:
+        case TYPE_INT_ARRAY:
+        case TYPE_FLOAT_ARRAY:
         case TYPE_STRING:
+        case TYPE_STRING_BUILDER:
         case TYPE_FUNCTION:
         case TYPE_RANGE:
+        case TYPE_RECORD_TYPE:
+        case TYPE_RECORD:
         case TYPE_ITERATOR: HDR_ALLOC(obj_t, type, 1)
             break;
 
@@ -84,15 +136,22 @@ gc_header_t *alloc_type(type_t type, flags_t flags) {
             break;
         case TYPE_LIST_ELEM_DATA: HDR_ALLOC(obj_list_element_t, type, 2)
             break;
-        case TYPE_DICT_DATA: assert("Use alloc_dict instead");
-            break;
+        case TYPE_DICT_DATA: assert(0 && "Use alloc_dict instead");
+            return NULL;
+        case TYPE_RECORD_TYPE_DATA:
+        case TYPE_RECORD_DATA: assert(0 && "Use alloc_record_type or alloc_record instead");
+            return NULL;
         case TYPE_DICT_KV_DATA: HDR_ALLOC(dict_kv_node_t, type, 3)
             break;
-        case TYPE_FUNCTION_PTR_DATA: HDR_ALLOC(obj_func_def_t, type, 2)
+        case TYPE_FUNCTION_PTR_DATA: HDR_ALLOC(obj_func_def_t, type, 3)
+            break;
+        case TYPE_MEMO_DATA: HDR_ALLOC(obj_memo_t, type, 3)
+            break;
+        case TYPE_MEMO_ENTRY_DATA: HDR_ALLOC(memo_entry_t, type, 4)
             break;
         case TYPE_RETURN_VAL: HDR_ALLOC(obj_t, type, 1)
             break;
-        case TYPE_ITERATOR_DATA: HDR_ALLOC(obj_iter_t, type, 2)
+        case TYPE_ITERATOR_DATA: HDR_ALLOC(obj_iter_t, type, 3)
             break;
 
             // Environment.
@@ -100,6 +159,8 @@ gc_header_t *alloc_type(type_t type, flags_t flags) {
             break;
         case INTERP_STATE: HDR_ALLOC(interp_t, type, 2)
             break;
+        case INTERP_STACK_DATA: HDR_ALLOC(env_segment_t, type, 2)
+            break;
 
             // Eval Result
         case EVAL_RESULT: HDR_ALLOC(eval_result_t, type, 1)
@@ -108,6 +169,7 @@ gc_header_t *alloc_type(type_t type, flags_t flags) {
             // AST.
             // Basic types and control words.
         case AST_EMPTY:
+        case AST_NIL:
         case AST_INT:
         case AST_FLOAT:
         case AST_BOOLEAN:
@@ -149,6 +211,7 @@ gc_header_t *alloc_type(type_t type, flags_t flags) {
         case AST_IN:
         case AST_SUBSCRIPT:
         case AST_MAPS_TO:
+        case AST_TYPEDEF:
         case AST_ASSIGN: HDR_ALLOC(ast_expr_t, type, 1)
             break;
 
@@ -177,11 +240,13 @@ gc_header_t *alloc_type(type_t type, flags_t flags) {
             break;
         case AST_DICT_KV: HDR_ALLOC(ast_expr_kv_list_t, type, 3)
             break;
+        case AST_SET: HDR_ALLOC(ast_expr_t, type, 1)
+            break;
         case AST_TYPED: HDR_ALLOC(ast_expr_t, type, 1)
             break;
         case AST_TYPED_DATA: HDR_ALLOC(ast_typed_expr_t, type, 2)
             break;
-        case AST_TYPEDEF: HDR_ALLOC(ast_data_type_t, type, 2)
+        case AST_TYPEDEF_DATA: HDR_ALLOC(ast_data_type_t, type, 2)
             break;
         case AST_BYTEARRAY_DECL: HDR_ALLOC(ast_expr_t, type, 1)
             break;
@@ -239,14 +304,24 @@ gc_header_t *alloc_type(type_t type, flags_t flags) {
             break;
         case AST_FOR_LOOP_DATA: HDR_ALLOC(ast_for_loop_t, type, 3)
             break;
+        case AST_MATCH: HDR_ALLOC(ast_expr_t, type, 1)
+            break;
+        case AST_MATCH_DATA: HDR_ALLOC(ast_match_t, type, 2)
+            break;
+        case AST_MATCH_ARM: HDR_ALLOC(ast_match_arm_t, type, 3)
+            break;
 
         default:
             printf("Unhandled GC type. Object will be untraceable: %s\n", type_names[type]);
             assert(0);
+            return NULL;
     }
 
     hdr->flags = flags;
 
+    // The GC may scan this node before the caller fills in every child.
+    mem_set((void *) hdr + sizeof(gc_header_t), 0, hdr->children * sizeof(void *));
+
     return hdr;
 }
 
@@ -258,6 +333,7 @@ void assert_valid_typed_node(gc_header_t *node) {
     for (int i = 0; i < node->children; ++i) {
         size_t offset = sizeof(gc_header_t) + (i * sizeof(void *));
         void **child = (void *) node + offset;
-        if (*child != NULL) assert_valid_data_ptr(*child);
+        // Interned objs, names and code live off the heap.
+        if (*child != NULL && on_heap(*child)) assert_valid_data_ptr(*child);
     }
 }
@@ -0,0 +1,131 @@
+#include "../inc/type.h"
+#include "../inc/mem.h"
+#include "../inc/ast.h"
+#include "../inc/dict.h"
+#include "../inc/memo.h"
+
+obj_t *memo_fn(obj_t *fn, int max_size) {
+    obj_memo_t *memo = (obj_memo_t *) alloc_type(TYPE_MEMO_DATA, F_NONE);
+    memo->table = dict_obj();
+    memo->newest = NULL;
+    memo->oldest = NULL;
+    memo->size = 0;
+    memo->max_size = max_size;
+
+    obj_t *obj = func_obj(fn->func_def->code, fn->func_def->scope);
+    obj->func_def->memo = memo;
+    obj->func_def->program = fn->func_def->program;
+    ast_code_add_fn(obj->func_def->program);
+    return obj;
+}
+
+/* Hash the args together, or return False if any of them can't be a key. */
+static boolean hash_args(obj_varargs_t *args, uint32_t *hash_val) {
+    uint32_t h = FNV32Basis;
+    for (; args != NULL; args = args->next) {
+        if (!dict_key_hashable(args->arg)) return False;
+        h = FNV32Prime * (h ^ dict_key_hash(args->arg));
+    }
+    *hash_val = h;
+    return True;
+}
+
+static boolean args_eq(obj_varargs_t *a, obj_varargs_t *b) {
+    while (a != NULL && b != NULL) {
+        if (!dict_keys_eq(a->arg, b->arg)) return False;
+        a = a->next;
+        b = b->next;
+    }
+    return a == b;
+}
+
+/*
+ * The table node for the hash. The table's keys are the hashes as Ints, so
+ * the key to look one up with can live on the stack.
+ */
+static dict_kv_node_t *table_node(obj_memo_t *memo, uint32_t hash_val) {
+    obj_t key = {.hdr = {.type = TYPE_INT, .flags = F_NONE, .children = 0}, .intval = (int) hash_val};
+    return dict_get_node_hashed(memo->table, &key, hash_val);
+}
+
+static void unlink_use(obj_memo_t *memo, memo_entry_t *entry) {
+    if (entry->newer != NULL) entry->newer->older = entry->older;
+    else memo->newest = entry->older;
+
+    if (entry->older != NULL) entry->older->newer = entry->newer;
+    else memo->oldest = entry->newer;
+}
+
+static void link_newest(obj_memo_t *memo, memo_entry_t *entry) {
+    entry->newer = NULL;
+    entry->older = memo->newest;
+    if (memo->newest != NULL) memo->newest->newer = entry;
+    else memo->oldest = entry;
+    memo->newest = entry;
+}
+
+static void evict_oldest(obj_memo_t *memo) {
+    memo_entry_t *entry = memo->oldest;
+    unlink_use(memo, entry);
+    memo->size--;
+
+    dict_kv_node_t *node = table_node(memo, entry->hash_val);
+    memo_entry_t *head = (memo_entry_t *) node->v;
+    if (head != entry) {
+        while (head->same_hash != entry) head = head->same_hash;
+        head->same_hash = entry->same_hash;
+    } else if (entry->same_hash != NULL) {
+        node->v = (obj_t *) entry->same_hash;
+    } else {
+        dict_remove(memo->table, node->k);
+    }
+}
+
+obj_t *memo_get(obj_t *fn, obj_varargs_t *args) {
+    obj_memo_t *memo = (obj_memo_t *) fn->func_def->memo;
+    uint32_t hash_val;
+    if (!hash_args(args, &hash_val)) return NULL;
+
+    dict_kv_node_t *node = table_node(memo, hash_val);
+    if (node == NULL) return NULL;
+
+    for (memo_entry_t *entry = (memo_entry_t *) node->v; entry != NULL; entry = entry->same_hash) {
+        if (!args_eq(entry->args, args)) continue;
+
+        if (memo->max_size > 0) {
+            unlink_use(memo, entry);
+            link_newest(memo, entry);
+        }
+        return entry->val;
+    }
+    return NULL;
+}
+
+void memo_put(obj_t *fn, obj_varargs_t *args, obj_t *val) {
+    obj_memo_t *memo = (obj_memo_t *) fn->func_def->memo;
+    uint32_t hash_val;
+    if (!hash_args(args, &hash_val)) return;
+
+    memo_entry_t *entry = (memo_entry_t *) alloc_type(TYPE_MEMO_ENTRY_DATA, F_NONE);
+    entry->args = args;
+    entry->val = val;
+    entry->hash_val = hash_val;
+    entry->newer = NULL;
+    entry->older = NULL;
+
+    dict_kv_node_t *node = table_node(memo, hash_val);
+    if (node != NULL) {
+        entry->same_hash = (memo_entry_t *) node->v;
+        node->v = (obj_t *) entry;
+    } else {
+        entry->same_hash = NULL;
+        dict_put_hashed(memo->table, int_obj((int) hash_val), (obj_t *) entry, hash_val);
+    }
+    memo->size++;
+
+    // Unbounded memos don't need to know the order of use.
+    if (memo->max_size == 0) return;
+
+    link_newest(memo, entry);
+    if (memo->size > memo->max_size) evict_oldest(memo);
+}
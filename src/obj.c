@@ -23,16 +23,75 @@ obj_t *obj_of(type_t type) {
     return (obj_t *) alloc_type(type, F_NONE);
 }
 
+/*
+ * Interned singletons.
+ *
+ * These live in static storage rather than on the heap, so the GC never marks
+ * or frees them, and heap_init() doesn't invalidate them. Every caller gets the
+ * same instance, so they can be compared by identity. They must never be
+ * mutated; see obj_unshared().
+ */
+enum interned_ident {
+    INTERNED_UNDEF,
+    INTERNED_NOTHING,
+    INTERNED_NIL,
+    INTERNED_FALSE,
+    INTERNED_TRUE,
+    INTERNED_BREAK,
+    INTERNED_CONTINUE,
+    INTERNED_MAX
+};
+
+static obj_t interned[INTERNED_MAX] = {
+        [INTERNED_UNDEF] = {.hdr = {.type = TYPE_UNDEF}},
+        [INTERNED_NOTHING] = {.hdr = {.type = TYPE_NOTHING}},
+        [INTERNED_NIL] = {.hdr = {.type = TYPE_NIL}},
+        [INTERNED_FALSE] = {.hdr = {.type = TYPE_BOOLEAN}, .boolval = False},
+        [INTERNED_TRUE] = {.hdr = {.type = TYPE_BOOLEAN}, .boolval = True},
+        [INTERNED_BREAK] = {.hdr = {.type = TYPE_BREAK}},
+        [INTERNED_CONTINUE] = {.hdr = {.type = TYPE_CONTINUE}},
+};
+
+/*
+ * Small ints are interned too. The table is filled on first use.
+ */
+static obj_t int_cache[INT_CACHE_MAX - INT_CACHE_MIN + 1];
+static boolean int_cache_ready = False;
+
+static void init_int_cache(void) {
+    for (int i = INT_CACHE_MIN; i <= INT_CACHE_MAX; ++i) {
+        obj_t *obj = &int_cache[i - INT_CACHE_MIN];
+        obj->hdr.type = TYPE_INT;
+        obj->hdr.flags = F_NONE;
+        obj->hdr.children = 0;
+        obj->intval = i;
+    }
+    int_cache_ready = True;
+}
+
+boolean obj_is_interned(obj_t *obj) {
+    return (obj >= interned && obj < interned + INTERNED_MAX) ||
+           (obj >= int_cache && obj < int_cache + (INT_CACHE_MAX - INT_CACHE_MIN + 1));
+}
+
+obj_t *obj_unshared(obj_t *obj) {
+    if (!obj_is_interned(obj)) return obj;
+
+    obj_t *copy = obj_of(TYPEOF(obj));
+    *copy = *obj;
+    return copy;
+}
+
 obj_t *undef_obj(void) {
-    return obj_of(TYPE_UNDEF);
+    return &interned[INTERNED_UNDEF];
 }
 
 obj_t *no_obj(void) {
-    return obj_of(TYPE_NOTHING);
+    return &interned[INTERNED_NOTHING];
 }
 
 obj_t *nil_obj(void) {
-    return obj_of(TYPE_NIL);
+    return &interned[INTERNED_NIL];
 }
 
 obj_t *error_obj(error_t errval) {
@@ -51,7 +110,23 @@ obj_t *bytearray_obj(size_t size, uint8_t *data) {
     return obj;
 }
 
+obj_t *vec_obj(type_t type, size_t n) {
+    obj_t *obj = obj_of(type);
+    // Int and Float elements are both four bytes.
+    obj->bytearray = bytearray_alloc(n * sizeof(int32_t));
+    if (obj->bytearray == NULL) {
+        printf("Out of memory for %s of %zu.\n", type_names[type], n);
+        return nil_obj();
+    }
+    return obj;
+}
+
 obj_t *int_obj(int i) {
+    if (i >= INT_CACHE_MIN && i <= INT_CACHE_MAX) {
+        if (!int_cache_ready) init_int_cache();
+        return &int_cache[i - INT_CACHE_MIN];
+    }
+
     obj_t *obj = obj_of(TYPE_INT);
     obj->intval = i;
     return obj;
@@ -65,7 +140,13 @@ obj_t *float_obj(float f) {
 
 obj_t *string_obj(bytearray_t *src) {
     obj_t *obj = obj_of(TYPE_STRING);
-    obj->bytearray = bytearray_clone(src);
+    obj->bytearray = bytearray_share(src);
+    return obj;
+}
+
+obj_t *string_builder_obj(bytearray_t *src) {
+    obj_t *obj = obj_of(TYPE_STRING_BUILDER);
+    obj->bytearray = bytearray_share(src);
     return obj;
 }
 
@@ -76,9 +157,7 @@ obj_t *byte_obj(byte b) {
 }
 
 obj_t *boolean_obj(boolean t) {
-    obj_t *obj = obj_of(TYPE_BOOLEAN);
-    obj->boolval = t ? True : False;
-    return obj;
+    return &interned[t ? INTERNED_TRUE : INTERNED_FALSE];
 }
 
 obj_t *range_obj(int from, int to) {
@@ -131,28 +210,65 @@ obj_t *dict_obj(void) {
     return dict_obj_of_size(DICT_INIT_BUCKETS);
 }
 
+obj_t *set_obj_of_size(size_t n) {
+    // Dicts double once they have more elems than buckets.
+    size_t buckets = DICT_INIT_BUCKETS;
+    while (buckets < n) buckets *= 2;
+
+    obj_t *obj = dict_obj_of_size(buckets);
+    if (TYPEOF(obj) == TYPE_DICT) obj->hdr.type = TYPE_SET;
+    return obj;
+}
+
+obj_t *set_obj(void) {
+    return set_obj_of_size(0);
+}
+
 obj_t *func_obj(void *code, void *scope) {
     obj_t *obj = obj_of(TYPE_FUNCTION);
     obj->func_def = (obj_func_def_t *) alloc_type(TYPE_FUNCTION_PTR_DATA, F_NONE);
     obj->func_def->code = code;
     obj->func_def->scope = scope;
+    obj->func_def->memo = NULL;
+    obj->func_def->program = NULL;
 
     return obj;
 }
 
-obj_t *iterator_obj(obj_t *obj, obj_t *state_obj, obj_t *(*next)(obj_iter_t *iterable)) {
+obj_t *iterator_obj(obj_t *obj, obj_t *(*next)(obj_iter_t *iterable)) {
     obj_t *iter = obj_of(TYPE_ITERATOR);
-    // Assume the caller has marked obj and state_obj as traceble.
+    // Assume the caller has marked obj as traceble.
     iter->iterator = (obj_iter_t *) alloc_type(TYPE_ITERATOR_DATA, F_NONE);
 
     iter->iterator->state = ITER_NOT_STARTED;
+    iter->iterator->err = ERR_NO_ERROR;
     iter->iterator->obj = obj;
-    iter->iterator->state_obj = state_obj;
+    iter->iterator->cursor = NULL;
+    iter->iterator->table = NULL;
     iter->iterator->next = next;
+    iter->iterator->index = 0;
 
     return iter;
 }
 
+obj_t *record_type_obj(bytearray_t *name, uint32_t nfields) {
+    obj_t *obj = obj_of(TYPE_RECORD_TYPE);
+    obj->record_type = (obj_record_type_t *) alloc_record_type(nfields);
+    if (obj->record_type == NULL) return nil_obj();
+    obj->record_type->name = name;
+    return obj;
+}
+
+obj_t *record_obj(obj_t *type) {
+    obj_t *obj = obj_of(TYPE_RECORD);
+    uint32_t nfields = type->record_type->nfields;
+    obj->record = (obj_record_t *) alloc_record(nfields);
+    if (obj->record == NULL) return nil_obj();
+    obj->record->type = type->record_type;
+    for (uint32_t i = 0; i < nfields; i++) obj->record->slots[i] = nil_obj();
+    return obj;
+}
+
 obj_t *return_val(obj_t *val) {
     obj_t *obj = obj_of(TYPE_RETURN_VAL);
     obj->return_val = val;
@@ -160,11 +276,11 @@ obj_t *return_val(obj_t *val) {
 }
 
 obj_t *break_obj(void) {
-    return obj_of(TYPE_BREAK);
+    return &interned[INTERNED_BREAK];
 }
 
 obj_t *continue_obj(void) {
-    return obj_of(TYPE_CONTINUE);
+    return &interned[INTERNED_CONTINUE];
 }
 
 obj_varargs_t *wrap_varargs(int n_args, ...) {
@@ -194,6 +310,9 @@ obj_varargs_t *wrap_varargs(int n_args, ...) {
 boolean obj_prim_eq(obj_t *a, obj_t *b) {
     if (TYPEOF(a) != TYPEOF(b)) return False;
 
+    // Interned values are equal only to themselves.
+    if (obj_is_interned(a) && obj_is_interned(b)) return a == b;
+
     switch (TYPEOF(a)) {
         case TYPE_BOOLEAN:
             return a->boolval == b->boolval;
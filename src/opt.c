@@ -0,0 +1,331 @@
+#include "../inc/type.h"
+#include "../inc/opt.h"
+
+/*
+ * Folding runs the same static methods eval would, on the literals' objs,
+ * so the answer is the same one. It only does it for the types the method
+ * takes without complaint. Ops that fail, like 1 / 0, give a TYPE_ERROR
+ * or Nil, which isn't a literal, and are left for eval to report.
+ */
+
+static void opt_list(ast_expr_list_t *es) {
+    for (; es != NULL; es = es->next) optimize(es->root);
+}
+
+static boolean is_literal(ast_expr_t *expr) {
+    switch (TYPEOF(expr)) {
+        case AST_NIL:
+        case AST_INT:
+        case AST_FLOAT:
+        case AST_BYTE:
+        case AST_BOOLEAN:
+            return True;
+        default:
+            return False;
+    }
+}
+
+static boolean is_number(ast_expr_t *expr) {
+    return TYPEOF(expr) == AST_INT || TYPEOF(expr) == AST_FLOAT;
+}
+
+static boolean both_ints(ast_expr_t *a, ast_expr_t *b) {
+    return TYPEOF(a) == AST_INT && TYPEOF(b) == AST_INT;
+}
+
+/* Same as truthy() in eval, for a literal. */
+static boolean literal_truthy(ast_expr_t *expr) {
+    switch (TYPEOF(expr)) {
+        case AST_INT:
+            return expr->intval != 0;
+        case AST_FLOAT:
+            return expr->floatval != 0;
+        case AST_BYTE:
+            return expr->byteval != 0x0;
+        case AST_BOOLEAN:
+            return expr->boolval;
+        default:
+            return False;
+    }
+}
+
+static obj_t *literal_obj(ast_expr_t *expr) {
+    switch (TYPEOF(expr)) {
+        case AST_INT:
+            return int_obj(expr->intval);
+        case AST_FLOAT:
+            return float_obj(expr->floatval);
+        case AST_BYTE:
+            return byte_obj(expr->byteval);
+        case AST_BOOLEAN:
+            return boolean_obj(expr->boolval);
+        default:
+            return nil_obj();
+    }
+}
+
+/*
+ * Make expr the literal for obj, if there is one. Literal nodes are the
+ * same size as any other expr, and have no children.
+ */
+static void become_literal(ast_expr_t *expr, obj_t *obj) {
+    type_t type;
+    switch (TYPEOF(obj)) {
+        case TYPE_INT:
+            type = AST_INT;
+            expr->intval = obj->intval;
+            break;
+        case TYPE_FLOAT:
+            type = AST_FLOAT;
+            expr->floatval = obj->floatval;
+            break;
+        case TYPE_BYTE:
+            type = AST_BYTE;
+            expr->byteval = obj->byteval;
+            break;
+        case TYPE_BOOLEAN:
+            type = AST_BOOLEAN;
+            expr->boolval = (int) obj->boolval;
+            break;
+        default:
+            return;
+    }
+
+    gc_header_t *hdr = (gc_header_t *) expr;
+    hdr->type = type;
+    hdr->flags = F_NONE;
+    hdr->children = 0;
+}
+
+static void become_nil(ast_expr_t *expr) {
+    gc_header_t *hdr = (gc_header_t *) expr;
+    hdr->type = AST_NIL;
+    hdr->flags = F_NONE;
+    hdr->children = 0;
+}
+
+/* Which method eval calls for the binop, given what the operands are. */
+static static_method_ident_t fold_method(type_t op, ast_expr_t *a, ast_expr_t *b) {
+    if (!is_number(a) || !is_number(b)) return METHOD_NONE;
+
+    switch (op) {
+        case AST_ADD:
+            return METHOD_ADD;
+        case AST_SUB:
+            return METHOD_SUB;
+        case AST_MUL:
+            return METHOD_MUL;
+        case AST_DIV:
+            return METHOD_DIV;
+        case AST_EQ:
+            return METHOD_EQ;
+        case AST_NE:
+            return METHOD_NE;
+        case AST_LT:
+            return METHOD_LT;
+        case AST_GT:
+            return METHOD_GT;
+        case AST_LE:
+            return METHOD_LE;
+        case AST_GE:
+            return METHOD_GE;
+        default:
+            break;
+    }
+
+    // Floats don't have these.
+    if (!both_ints(a, b)) return METHOD_NONE;
+
+    switch (op) {
+        case AST_MOD:
+            return METHOD_MOD;
+        case AST_BITWISE_AND:
+            return METHOD_BITWISE_AND;
+        case AST_BITWISE_OR:
+            return METHOD_BITWISE_OR;
+        case AST_BITWISE_XOR:
+            return METHOD_BITWISE_XOR;
+        case AST_BITWISE_SHL:
+            return METHOD_BITWISE_SHL;
+        case AST_BITWISE_SHR:
+            return METHOD_BITWISE_SHR;
+        default:
+            return METHOD_NONE;
+    }
+}
+
+static void fold_binop(ast_expr_t *expr) {
+    ast_expr_t *a = expr->op_args->a;
+    ast_expr_t *b = expr->op_args->b;
+    optimize(a);
+    optimize(b);
+
+    // Both sides are evaluated either way, so only literals can go.
+    if (TYPEOF(expr) == AST_AND || TYPEOF(expr) == AST_OR) {
+        if (!is_literal(a) || !is_literal(b)) return;
+        boolean value = TYPEOF(expr) == AST_AND
+                        ? literal_truthy(a) && literal_truthy(b)
+                        : literal_truthy(a) || literal_truthy(b);
+        become_literal(expr, boolean_obj(value));
+        return;
+    }
+
+    static_method_ident_t method_id = fold_method(TYPEOF(expr), a, b);
+    if (method_id == METHOD_NONE) return;
+    obj_t *o1 = literal_obj(a);
+    static_method m = get_static_method(TYPEOF(o1), method_id);
+    if (m == NULL) return;
+    become_literal(expr, m(o1, wrap_varargs(1, literal_obj(b))));
+}
+
+static void fold_unary(ast_expr_t *expr) {
+    ast_expr_t *a = expr->unary_arg->a;
+    optimize(a);
+
+    switch (TYPEOF(expr)) {
+        case AST_NOT:
+            if (is_literal(a)) become_literal(expr, boolean_obj(!literal_truthy(a)));
+            break;
+        case AST_NEGATE:
+            if (is_number(a)) {
+                obj_t *o = literal_obj(a);
+                become_literal(expr, get_static_method(TYPEOF(o), METHOD_NEG)(o, NULL));
+            }
+            break;
+        case AST_BITWISE_NOT:
+            if (TYPEOF(a) == AST_INT) become_literal(expr, int_obj(~a->intval));
+            break;
+        default:
+            break;
+    }
+}
+
+/* An if on a literal is just the branch it takes. */
+static void prune_if(ast_expr_t *expr) {
+    if (TYPEOF(expr) == AST_IF_THEN) {
+        ast_if_then_args_t *args = expr->if_then_args;
+        optimize(args->cond);
+        optimize(args->pred);
+        if (!is_literal(args->cond)) return;
+        if (literal_truthy(args->cond)) {
+            *expr = *args->pred;
+        } else {
+            become_nil(expr);
+        }
+        return;
+    }
+
+    ast_if_then_else_args_t *args = expr->if_then_else_args;
+    optimize(args->cond);
+    optimize(args->pred);
+    optimize(args->else_pred);
+    if (!is_literal(args->cond)) return;
+    *expr = literal_truthy(args->cond) ? *args->pred : *args->else_pred;
+}
+
+void optimize(ast_expr_t *expr) {
+    if (expr == NULL) return;
+
+    switch (TYPEOF(expr)) {
+        case AST_ADD:
+        case AST_SUB:
+        case AST_MUL:
+        case AST_DIV:
+        case AST_MOD:
+        case AST_AND:
+        case AST_OR:
+        case AST_BITWISE_SHL:
+        case AST_BITWISE_SHR:
+        case AST_BITWISE_AND:
+        case AST_BITWISE_OR:
+        case AST_BITWISE_XOR:
+        case AST_GT:
+        case AST_GE:
+        case AST_LT:
+        case AST_LE:
+        case AST_EQ:
+        case AST_NE:
+            fold_binop(expr);
+            break;
+        case AST_NOT:
+        case AST_NEGATE:
+        case AST_BITWISE_NOT:
+            fold_unary(expr);
+            break;
+        case AST_IS:
+        case AST_IN:
+        case AST_SUBSCRIPT:
+        case AST_ASSIGN:
+            optimize(expr->op_args->a);
+            optimize(expr->op_args->b);
+            break;
+        case AST_CAST:
+            optimize(expr->cast_args->a);
+            break;
+        case AST_RANGE:
+            optimize(expr->range->from);
+            optimize(expr->range->to);
+            optimize(expr->range->step);
+            break;
+        case AST_IF_THEN:
+        case AST_IF_THEN_ELSE:
+            prune_if(expr);
+            break;
+        case AST_LIST:
+        case AST_SET:
+            opt_list(expr->list->es);
+            break;
+        case AST_DICT:
+            for (ast_expr_kv_list_t *kv = expr->dict->kv; kv != NULL; kv = kv->next) {
+                optimize(kv->k);
+                optimize(kv->v);
+            }
+            break;
+        case AST_BLOCK:
+            opt_list(expr->block_exprs);
+            break;
+        case AST_FUNCTION_RETURN:
+            opt_list(expr->func_return_values);
+            break;
+        case AST_FUNCTION_DEF:
+            opt_list(expr->func_def->block_exprs);
+            break;
+        case AST_FUNCTION_CALL:
+            optimize(expr->func_call->expr);
+            opt_list(expr->func_call->args);
+            break;
+        case AST_RESERVED_CALLABLE:
+            opt_list(expr->reserved_callable->es);
+            break;
+        case AST_APPLY:
+            optimize(expr->application->receiver);
+            opt_list(expr->application->args);
+            break;
+        case AST_FIELD:
+            optimize(expr->field->receiver);
+            break;
+        case AST_DO_WHILE_LOOP:
+            optimize(expr->do_while_loop->pred);
+            optimize(expr->do_while_loop->cond);
+            break;
+        case AST_WHILE_LOOP:
+            optimize(expr->while_loop->cond);
+            optimize(expr->while_loop->pred);
+            break;
+        case AST_FOR_LOOP:
+            optimize(expr->for_loop->iterable);
+            optimize(expr->for_loop->pred);
+            break;
+        case AST_MATCH:
+            // The literal arms are already in the match's tables.
+            optimize(expr->match->subject);
+            for (ast_match_arm_t *arm = expr->match->arm_list; arm != NULL; arm = arm->next) {
+                if (arm->kind != MATCH_LITERAL) optimize(arm->pattern);
+                optimize(arm->expr);
+            }
+            break;
+        default:
+            // Literals, names, and what eval wants just as it was written.
+            break;
+    }
+}
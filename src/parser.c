@@ -164,6 +164,12 @@ static ast_reserved_callable_type_t ast_callable_type_for_tag(tag_t tag) {
             return AST_CALL_LN;
         case TAG_LOG:
             return AST_CALL_LOG;
+        case TAG_INTS:
+            return AST_CALL_INTS;
+        case TAG_FLOATS:
+            return AST_CALL_FLOATS;
+        case TAG_MEMO:
+            return AST_CALL_MEMO;
         default:
             return AST_CALL_UNDEFINED;
     }
@@ -185,6 +191,38 @@ static ast_expr_list_t *empty_expr_list(void) {
     return node;
 }
 
+/*
+ * Parse all the exprs up to EOF as the body of one block, as though they
+ * were wrapped in braces.
+ */
+static ast_expr_t *parse_start_block(lexer_t *lexer) {
+    ast_expr_list_t *root = empty_expr_list();
+    ast_expr_list_t *node = root;
+
+    while (lexer->token.tag != TAG_EOF && lexer->err == ERR_NO_ERROR) {
+        if (lexer->token.tag == TAG_EOL) {
+            advance(lexer);
+            continue;
+        }
+
+        ast_expr_t *e = parse_expr(lexer);
+        if (TYPEOF(node->root) == AST_EMPTY) {
+            node->root = e;
+        } else {
+            node->next = (ast_expr_list_t *) alloc_type(AST_EXPR_LIST, F_NONE);
+            node = node->next;
+            node->root = e;
+            node->next = NULL;
+        }
+
+        if (lexer->token.tag != TAG_EOL && lexer->token.tag != TAG_EOF && lexer->err == ERR_NO_ERROR) {
+            printf("Expected end of line; got %s at pos %d.\n", tag_names[lexer->token.tag], lexer->pos);
+            lexer->err = ERR_LEX_ERROR;
+        }
+    }
+    return ast_block(root);
+}
+
 static ast_expr_kv_list_t *empty_expr_kv_list(void) {
     ast_expr_kv_list_t *node = (ast_expr_kv_list_t *) alloc_type(AST_DICT_KV, F_NONE);
     node->k = ast_empty();
@@ -193,6 +231,38 @@ static ast_expr_kv_list_t *empty_expr_kv_list(void) {
     return node;
 }
 
+/* The type a type tag names, like int, or TYPE_UNKNOWN if it isn't one. */
+static type_t tag_type(tag_t tag) {
+    switch (tag) {
+        case TAG_TYPE_INT:
+            return TYPE_INT;
+        case TAG_TYPE_FLOAT:
+            return TYPE_FLOAT;
+        case TAG_TYPE_BYTE:
+            return TYPE_BYTE;
+        case TAG_TYPE_STRING:
+            return TYPE_STRING;
+        case TAG_TYPE_BOOLEAN:
+            return TYPE_BOOLEAN;
+        default:
+            return TYPE_UNKNOWN;
+    }
+}
+
+/* An arg's name, and its type if it's followed by one, as in a: int. */
+static boolean parse_fn_arg_name(lexer_t *lexer, ast_fn_arg_decl_t *node) {
+    node->name = token_name(lexer);
+    node->type = TYPE_UNKNOWN;
+    if (!eat(lexer, TAG_IDENT)) return False;
+    if (lexer->token.tag != TAG_COLON) return True;
+
+    advance(lexer);
+    node->type = tag_type(lexer->token.tag);
+    if (node->type == TYPE_UNKNOWN) return False;
+    advance(lexer);
+    return True;
+}
+
 static ast_fn_arg_decl_t *parse_fn_arg_decl(lexer_t *lexer) {
     ast_fn_arg_decl_t *node = (ast_fn_arg_decl_t *) alloc_type(
             AST_FUNCTION_DEF_ARGS, F_NONE);
@@ -202,17 +272,16 @@ static ast_fn_arg_decl_t *parse_fn_arg_decl(lexer_t *lexer) {
 
     if (lexer->token.tag != TAG_IDENT) return NULL;
 
-    node->name = bytearray_clone(c_str_to_bytearray(lexer->token.string));
-    advance(lexer);
+    if (!parse_fn_arg_name(lexer, node)) return NULL;
 
     while (lexer->token.tag == TAG_COMMA) {
         advance(lexer);
 
         node->next = (ast_fn_arg_decl_t *) alloc_type(AST_FUNCTION_DEF_ARGS, F_NONE);
         node = node->next;
+        node->next = NULL;
 
-        node->name = bytearray_clone(c_str_to_bytearray(lexer->token.string));
-        advance(lexer);
+        if (!parse_fn_arg_name(lexer, node)) return NULL;
     }
 
     node->next = NULL;
@@ -328,6 +397,36 @@ static ast_expr_list_t *parse_block(lexer_t *lexer) {
     return root;
 }
 
+/*
+ * Like parse_block(), for the fields of a record type. Each starts with val
+ * or var, so one can follow another on the same line.
+ */
+static ast_expr_list_t *parse_fields(lexer_t *lexer) {
+    ast_expr_list_t *node = empty_expr_list();
+    ast_expr_list_t *root = node;
+
+    ast_expr_t *e = parse_expr(lexer);
+    node->root = e;
+
+    for (;;) {
+        if (lexer->token.tag == TAG_EOL) {
+            advance(lexer);
+        } else if (lexer->token.tag != TAG_INVARIABLE && lexer->token.tag != TAG_VARIABLE) {
+            break;
+        }
+        ast_expr_list_t *next = (ast_expr_list_t *) alloc_type(AST_EXPR_LIST, F_NONE);
+        e = parse_expr(lexer);
+        next->root = e;
+
+        node->next = next;
+        node = next;
+        if (lexer->token.tag == TAG_END) break;
+    }
+
+    node->next = NULL;
+    return root;
+}
+
 ast_expr_t *parse_subscript_internal(lexer_t *lexer, int min_preced) {
     (void) min_preced;
 
@@ -470,10 +569,17 @@ static ast_expr_t *parse_expr_internal(lexer_t *lexer, int min_preced) {
             case TAG_MEMBER_ACCESS:
                 lhs = ast_access(lhs, parse_expr_internal(lexer, next_min_preced));
                 break;
-            case TAG_COLON:
+            case TAG_COLON: {
+                type_t type = tag_type(lexer->token.tag);
+                if (type == TYPE_UNKNOWN) {
+                    printf("Expected a type, not %s.\n", tag_names[lexer->token.tag]);
+                    lexer->err = ERR_SYNTAX_ERROR;
+                    return lhs;
+                }
+                lhs = ast_typed(lhs, token_name(lexer), type);
                 advance(lexer);
-                lhs = ast_typed(lhs, c_str_to_bytearray(lexer->token.string));
                 break;
+            }
             default:
                 printf("what? why this %s?\n", tag_names[tag]);
                 return lhs;
@@ -484,16 +590,65 @@ static ast_expr_t *parse_expr_internal(lexer_t *lexer, int min_preced) {
     return lhs;
 }
 
+/*
+ * The arms of a match, a line each: a pattern, or if and a cond, or else,
+ * then => and the arm's expr. Else has to be the last.
+ */
+static ast_match_arm_t *parse_match_arms(lexer_t *lexer) {
+    ast_match_arm_t *arms = NULL;
+    ast_match_arm_t *last = NULL;
+
+    while (1) {
+        while (lexer->token.tag == TAG_EOL) advance(lexer);
+        if (lexer->token.tag == TAG_END || lexer->token.tag == TAG_EOF) break;
+        if (last != NULL && last->kind == MATCH_ELSE) {
+            printf("Else has to be the last arm.\n");
+            lexer->err = ERR_SYNTAX_ERROR;
+            return NULL;
+        }
+
+        uint8_t kind = MATCH_VALUE;
+        ast_expr_t *pattern = NULL;
+        if (lexer->token.tag == TAG_ELSE) {
+            advance(lexer);
+            kind = MATCH_ELSE;
+        } else {
+            if (lexer->token.tag == TAG_IF) {
+                advance(lexer);
+                kind = MATCH_GUARD;
+            }
+            // Stop short of the =>.
+            pattern = parse_expr_internal(lexer, PRECED_MAPS_TO + 1);
+        }
+        if (!eat(lexer, TAG_MAPS_TO)) return NULL;
+
+        ast_match_arm_t *arm = ast_match_arm(kind, pattern, parse_expr(lexer));
+        if (lexer->err != ERR_NO_ERROR) return NULL;
+        if (last == NULL) {
+            arms = arm;
+        } else {
+            last->next = arm;
+        }
+        last = arm;
+    }
+
+    return arms;
+}
+
 static ast_expr_t *parse_expr(lexer_t *lexer) {
     switch (lexer->token.tag) {
         case TAG_TYPEDEF: {
             advance(lexer);
+            bytearray_t *name = token_name(lexer);
             if (!eat(lexer, TAG_IDENT)) goto error;
-            bytearray_t *name = c_str_to_bytearray(lexer->token.string);
             if (!eat(lexer, TAG_ASSIGN)) goto error;
             if (!eat(lexer, TAG_DATA)) goto error;
-            ast_expr_list_t *es = parse_block(lexer);
-            return ast_typedef(name, es);
+            if (!eat(lexer, TAG_BEGIN)) goto error;
+            lexer->depth++;
+            ast_expr_list_t *fields = empty_expr_list();
+            if (lexer->token.tag != TAG_END) fields = parse_fields(lexer);
+            if (!eat(lexer, TAG_END)) goto error;
+            return ast_typedef(name, fields);
         }
         case TAG_BEGIN: {
             lexer->depth++;
@@ -529,6 +684,26 @@ static ast_expr_t *parse_expr(lexer_t *lexer) {
             }
             return ast_if_then(if_clause, then_clause);
         }
+        case TAG_MATCH: {
+            // A blank line before it leaves incomplete input flagged, as for END.
+            lexer->err = ERR_NO_ERROR;
+            advance(lexer);
+            ast_expr_t *subject = parse_expr(lexer);
+            if (TYPEOF(subject) == AST_EMPTY) goto error;
+            if (lexer->token.tag != TAG_BEGIN) goto error;
+            lexer->depth++;
+            advance(lexer);
+            ast_match_arm_t *arms = parse_match_arms(lexer);
+            if (lexer->err != ERR_NO_ERROR) return ast_empty();
+            if (!eat(lexer, TAG_END)) goto error;
+            lexer->depth--;
+            ast_expr_t *match = ast_match(subject, arms);
+            if (match == NULL) {
+                lexer->err = ERR_OUT_OF_MEMORY;
+                return ast_empty();
+            }
+            return match;
+        }
         case TAG_DO: {
             advance(lexer);
             ast_expr_t *pred = parse_expr(lexer);
@@ -573,6 +748,21 @@ static ast_expr_t *parse_expr(lexer_t *lexer) {
             }
             return ast_list(NULL);
         }
+        case TAG_SET: {
+            advance(lexer);
+            if (lexer->token.tag == TAG_BEGIN) {
+                lexer->depth++;
+                eat(lexer, TAG_BEGIN);
+                ast_expr_list_t *es = parse_list_expr_list(lexer);
+                if (!eat(lexer, TAG_END)) {
+                    mem_free(es);
+                    es = NULL;
+                    goto error;
+                }
+                return ast_set(es);
+            }
+            return ast_set(NULL);
+        }
         case TAG_DICT: {
             advance(lexer);
             if (lexer->token.tag == TAG_BEGIN) {
@@ -649,12 +839,12 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
             return ast_boolean(False);
         }
         case TAG_HEX: {
-            ast_expr_t *e = ast_int(hex_to_int(lexer->token.string));
+            ast_expr_t *e = ast_int(lexer->token.intval);
             advance(lexer);
             return e;
         }
         case TAG_BIN: {
-            ast_expr_t *e = ast_int(bin_to_int(lexer->token.string));
+            ast_expr_t *e = ast_int(lexer->token.intval);
             advance(lexer);
             return e;
         }
@@ -674,7 +864,7 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
             return ast_byte(c);
         }
         case TAG_STRING: {
-            ast_expr_t *e = ast_string(c_str_to_bytearray(lexer->token.string));
+            ast_expr_t *e = ast_string(token_literal(lexer));
             advance(lexer);
             return e;
         }
@@ -698,16 +888,18 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
         }
         case TAG_INVARIABLE: {
             advance(lexer);
+            bytearray_t *name = token_name(lexer);
             if (!eat(lexer, TAG_IDENT)) goto error;
-            return ast_ident_decl(c_str_to_bytearray(lexer->token.string), F_NONE);
+            return ast_ident_decl(name, F_NONE);
         }
         case TAG_VARIABLE: {
             advance(lexer);
+            bytearray_t *name = token_name(lexer);
             if (!eat(lexer, TAG_IDENT)) goto error;
-            return ast_ident_decl(c_str_to_bytearray(lexer->token.string), F_ENV_MUTABLE);
+            return ast_ident_decl(name, F_ENV_MUTABLE);
         }
         case TAG_IDENT: {
-            ast_expr_t *id = ast_ident(c_str_to_bytearray(lexer->token.string));
+            ast_expr_t *id = ast_ident(token_name(lexer));
             if (!eat(lexer, TAG_IDENT)) goto error;
             return id;
         }
@@ -736,6 +928,8 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
                 goto error;
             }
             ast_expr_t *block = parse_expr(lexer);
+            // The body may be cut short, e.g. a line at a time in the repl.
+            if (TYPEOF(block) != AST_BLOCK) goto error;
             return ast_func_def(args, block->block_exprs);
         }
         case TAG_FUNC_RETURN: {
@@ -746,7 +940,7 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
             return ast_func_return(args);
         }
         case TAG_METHOD_CALL: {
-            bytearray_t *name = c_str_to_bytearray(lexer->token.string);
+            bytearray_t *name = token_name(lexer);
             advance(lexer);
             if (!eat(lexer, TAG_LPAREN)) {
                 mem_free(name);
@@ -773,14 +967,14 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
             return id;
         }
         case TAG_FIELD_ACCESS: {
-            bytearray_t *name = c_str_to_bytearray(lexer->token.string);
+            bytearray_t *name = token_name(lexer);
             advance(lexer);
             return ast_field(name);
         }
         case TAG_DEL: {
             advance(lexer);
             if (!eat(lexer, TAG_LPAREN)) goto error;
-            ast_expr_t *id = ast_ident(c_str_to_bytearray(lexer->token.string));
+            ast_expr_t *id = ast_ident(token_name(lexer));
             if (!eat(lexer, TAG_IDENT)) {
                 mem_free(id);
                 id = NULL;
@@ -807,6 +1001,9 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
         case TAG_EXP:
         case TAG_LN:
         case TAG_LOG:
+        case TAG_INTS:
+        case TAG_FLOATS:
+        case TAG_MEMO:
         case TAG_TO_HEX:
         case TAG_TO_BIN:
         case TAG_DUMP:
@@ -826,7 +1023,7 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
                 if (!eat(lexer, TAG_RPAREN)) goto error;
                 return ast_reserved_callable(callable_type, empty_expr_list());
             }
-            return ast_ident(c_str_to_bytearray(lexer->token.string));
+            return ast_ident(token_name(lexer));
         }
         default:
             goto error;
@@ -847,10 +1044,12 @@ static ast_expr_t *parse_atom(lexer_t *lexer) {
     return ast_empty();
 }
 
-void parse_program(const char *input, ast_expr_t *ast, parse_result_t *parse_result) {
+static void parse(const char *input, uint32_t size, boolean script,
+                  ast_expr_t *ast, parse_result_t *parse_result) {
     lexer_t lexer;
 
-    lexer_init(&lexer, input, c_str_len(input));
+    lexer_init(&lexer, input, size);
+    parse_result->code = NULL;
 
     // Lexer error. Don't parse.
     if (lexer.err != ERR_NO_ERROR) {
@@ -859,20 +1058,35 @@ void parse_program(const char *input, ast_expr_t *ast, parse_result_t *parse_res
         return;
     }
 
-    ast_expr_t *p = parse_start(&lexer);
+    ast_code_t *code = ast_code_new();
+    if (code == NULL) {
+        parse_result->err = ERR_OUT_OF_MEMORY;
+        parse_result->pos = lexer.pos;
+        return;
+    }
+
+    mem_use_arena(&code->arena);
+    ast_expr_t *p = script ? parse_start_block(&lexer) : parse_start(&lexer);
+    mem_use_arena(NULL);
 
     parse_result->err = lexer.err;
     parse_result->pos = lexer.pos;
     parse_result->depth = lexer.depth;
     if (lexer.err == ERR_LEX_INCOMPLETE_INPUT) {
-        mem_free(p);
-        p = NULL;
+        ast_code_release(code);
         return;
     }
 
     mem_cp(ast, p, sizeof(ast_expr_t));
-    mem_free(p);
-    p = NULL;
+    parse_result->code = code;
 }
 
 #pragma clang diagnostic pop
+
+void parse_program(const char *input, ast_expr_t *ast, parse_result_t *parse_result) {
+    parse(input, (uint32_t) c_str_len(input), False, ast, parse_result);
+}
+
+void parse_script(const char *input, uint32_t size, ast_expr_t *ast, parse_result_t *parse_result) {
+    parse(input, size, True, ast, parse_result);
+}
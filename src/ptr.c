@@ -1,14 +1,181 @@
 #include "../inc/ptr.h"
 
+/*
+ * Vector versions of the primitives. SSE2 is always there on x86-64;
+ * AVX2 is picked at run time if the CPU has it. Short buffers don't pay
+ * for the setup, so they take the plain byte loops.
+ */
+#ifdef HAVE_SIMD
+#include <immintrin.h>
+
+#define SIMD_MIN 32
+
+static enum { SIMD_UNKNOWN, SIMD_SSE2, SIMD_AVX2 } simd_level = SIMD_UNKNOWN;
+
+boolean have_avx2(void) {
+    if (simd_level == SIMD_UNKNOWN) {
+        __builtin_cpu_init();
+        simd_level = __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+    }
+    return simd_level == SIMD_AVX2;
+}
+
+static size_t set_sse2(unsigned char *p, int val, size_t len) {
+    __m128i v = _mm_set1_epi8((char) val);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) _mm_storeu_si128((__m128i *) (p + i), v);
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t set_avx2(unsigned char *p, int val, size_t len) {
+    __m256i v = _mm256_set1_epi8((char) val);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) _mm256_storeu_si256((__m256i *) (p + i), v);
+    return i;
+}
+
+static size_t cp_sse2(unsigned char *dst, const unsigned char *src, size_t size) {
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i b = _mm_loadu_si128((const __m128i *) (src + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *) (src + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *) (src + i + 48));
+        _mm_storeu_si128((__m128i *) (dst + i), a);
+        _mm_storeu_si128((__m128i *) (dst + i + 16), b);
+        _mm_storeu_si128((__m128i *) (dst + i + 32), c);
+        _mm_storeu_si128((__m128i *) (dst + i + 48), d);
+    }
+    for (; i + 16 <= size; i += 16) {
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_loadu_si128((const __m128i *) (src + i)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t cp_avx2(unsigned char *dst, const unsigned char *src, size_t size) {
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) (src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *) (src + i + 32));
+        _mm256_storeu_si256((__m256i *) (dst + i), a);
+        _mm256_storeu_si256((__m256i *) (dst + i + 32), b);
+    }
+    for (; i + 32 <= size; i += 32) {
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_loadu_si256((const __m256i *) (src + i)));
+    }
+    return i;
+}
+
+// Return the offset of the first 16-byte block that differs, or the number
+// of bytes compared if they were all the same.
+static size_t eq_sse2(const unsigned char *a, const unsigned char *b, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff) return i;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t eq_avx2(const unsigned char *a, const unsigned char *b, size_t size) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        if ((unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xffffffffu) return i;
+    }
+    return i;
+}
+
+// Return the offset of the 16-byte block holding the first match, or the
+// number of bytes searched if there was none.
+static size_t chr_sse2(const unsigned char *p, int val, size_t size) {
+    __m128i v = _mm_set1_epi8((char) val);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (p + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, v))) return i;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t chr_avx2(const unsigned char *p, int val, size_t size) {
+    __m256i v = _mm256_set1_epi8((char) val);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (p + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v))) return i;
+    }
+    return i;
+}
+#endif
+
 void mem_set(void *b, int val, size_t len) {
     unsigned char *p = b;
+#ifdef HAVE_SIMD
+    if (len >= SIMD_MIN) {
+        size_t done = have_avx2() ? set_avx2(p, val, len) : set_sse2(p, val, len);
+        p += done;
+        len -= done;
+    }
+#endif
     while (len-- > 0) *p++ = val;
 }
 
 void *mem_cp(void *dst, void *src, size_t size) {
     unsigned char *p1 = (unsigned char *) dst;
     const unsigned char *p2 = (const unsigned char *) src;
+#ifdef HAVE_SIMD
+    if (size >= SIMD_MIN) {
+        size_t done = have_avx2() ? cp_avx2(p1, p2, size) : cp_sse2(p1, p2, size);
+        p1 += done;
+        p2 += done;
+        size -= done;
+    }
+#endif
 
     while (size-- > 0) *p1++ = *p2++;
     return dst;
 }
+
+boolean mem_eq(const void *a, const void *b, size_t size) {
+    const unsigned char *p1 = (const unsigned char *) a;
+    const unsigned char *p2 = (const unsigned char *) b;
+#ifdef HAVE_SIMD
+    if (size >= SIMD_MIN) {
+        size_t same = have_avx2() ? eq_avx2(p1, p2, size) : eq_sse2(p1, p2, size);
+        // Stopped early, so some byte in the next block differs.
+        if (size - same >= SIMD_MIN) return False;
+        p1 += same;
+        p2 += same;
+        size -= same;
+    }
+#endif
+
+    while (size-- > 0) {
+        if (*p1++ != *p2++) return False;
+    }
+    return True;
+}
+
+void *mem_chr(const void *b, int val, size_t size) {
+    const unsigned char *p = (const unsigned char *) b;
+#ifdef HAVE_SIMD
+    if (size >= SIMD_MIN) {
+        size_t skip = have_avx2() ? chr_avx2(p, val, size) : chr_sse2(p, val, size);
+        p += skip;
+        size -= skip;
+    }
+#endif
+
+    while (size-- > 0) {
+        if (*p == (unsigned char) val) return (void *) p;
+        p++;
+    }
+    return NULL;
+}
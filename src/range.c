@@ -102,25 +102,24 @@ static obj_t *iter_next(obj_iter_t *iterable) {
     error_t error = ERR_NO_ERROR;
 
     switch (iterable->state) {
-        // The state object stores our offset from the start of the range.
+        // The index stores our offset from the start of the range.
         // So on initialization, set that to 0.
         // Then fall through to the Iterating state.
         case ITER_NOT_STARTED:
             iterable->state = ITER_ITERATING;
-            current_val = 0;
-            iterable->state_obj->intval = current_val;
+            iterable->index = 0;
             // Fall through to ITERATING.
 
-            // While iterating, get the range element at the state value's offset.
+            // While iterating, get the range element at the index.
             // Update the offset for the next iteration and return the value.
         case ITER_ITERATING:
-            current_val = iterable->state_obj->intval;
+            current_val = (int) iterable->index;
             int next_val = range_get_internal(iterable->obj, current_val, &error);
             if (error != ERR_NO_ERROR) {
                 iterable->state = ITER_STOPPED;
                 return nil_obj();
             }
-            iterable->state_obj->intval += iterable->obj->range->step;
+            iterable->index += iterable->obj->range->step;
             return int_obj(next_val);
 
             // Having iterated over all the elements, return Nil as a sentinel.
@@ -135,8 +134,7 @@ static obj_t *iter_next(obj_iter_t *iterable) {
 obj_t *range_iterator(obj_t *obj, obj_varargs_t *args) {
     (void) args;
 
-    obj_t *start_state = int_obj(0);
-    return iterator_obj(obj, start_state, iter_next);
+    return iterator_obj(obj, iter_next);
 }
 
 static_method get_range_static_method(static_method_ident_t method_id) {
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include "../inc/type.h"
+#include "../inc/mem.h"
+#include "../inc/str.h"
+#include "../inc/arr.h"
+#include "../inc/dict.h"
+#include "../inc/record.h"
+
+int record_slot(obj_record_type_t *type, bytearray_t *name, int hint) {
+    int n = (int) type->nfields;
+    if (hint >= 0 && hint < n && type->fields[hint].name == name) return hint;
+
+    for (int i = 0; i < n; i++) {
+        if (type->fields[i].name == name || bytearray_eq(type->fields[i].name, name)) return i;
+    }
+    return -1;
+}
+
+static void append(obj_t *s, obj_t *value) {
+    if (TYPEOF(value) != TYPE_STRING &&
+        get_static_method(TYPEOF(value), METHOD_TO_STRING) == NULL) {
+        builder_append(s, wrap_varargs(1, string_obj(c_str_to_bytearray("<"))));
+        builder_append(s, wrap_varargs(1, string_obj(c_str_to_bytearray(type_names[TYPEOF(value)]))));
+        builder_append(s, wrap_varargs(1, string_obj(c_str_to_bytearray(">"))));
+        return;
+    }
+    builder_append(s, wrap_varargs(1, value));
+}
+
+obj_t *record_to_string(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    obj_record_type_t *type = obj->record->type;
+    obj_t *s = string_builder_obj(type->name);
+    append(s, string_obj(c_str_to_bytearray("(")));
+    for (uint32_t i = 0; i < type->nfields; i++) {
+        if (i > 0) append(s, string_obj(c_str_to_bytearray(", ")));
+        append(s, string_obj(bytearray_clone(type->fields[i].name)));
+        append(s, string_obj(c_str_to_bytearray(": ")));
+        append(s, obj->record->slots[i]);
+    }
+    append(s, string_obj(c_str_to_bytearray(")")));
+    return builder_to_string(s, NULL);
+}
+
+obj_t *record_type_to_string(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    obj_t *s = string_builder_obj(c_str_to_bytearray("<Type "));
+    append(s, string_obj(obj->record_type->name));
+    append(s, string_obj(c_str_to_bytearray(">")));
+    return builder_to_string(s, NULL);
+}
+
+obj_t *record_copy(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    uint32_t nfields = obj->record->type->nfields;
+    obj_t *copy = obj_of(TYPE_RECORD);
+    copy->record = (obj_record_t *) alloc_record(nfields);
+    if (copy->record == NULL) return nil_obj();
+    copy->record->type = obj->record->type;
+    for (uint32_t i = 0; i < nfields; i++) {
+        obj_t *value = obj->record->slots[i];
+        static_method copy_value = get_static_method(TYPEOF(value), METHOD_COPY);
+        copy->record->slots[i] = copy_value != NULL ? copy_value(value, NULL) : value;
+    }
+    return copy;
+}
+
+static boolean slot_eq(obj_t *a, obj_t *b) {
+    static_method eq = get_static_method(TYPEOF(a), METHOD_EQ);
+    if (eq == NULL) return a == b;
+    obj_t *r = eq(a, wrap_varargs(1, b));
+    return TYPEOF(r) == TYPE_BOOLEAN && r->boolval;
+}
+
+obj_t *record_eq(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) return boolean_obj(False);
+    obj_t *arg = args->arg;
+    if (TYPEOF(arg) != TYPE_RECORD || arg->record->type != obj->record->type) return boolean_obj(False);
+
+    for (uint32_t i = 0; i < obj->record->type->nfields; i++) {
+        if (!slot_eq(obj->record->slots[i], arg->record->slots[i])) return boolean_obj(False);
+    }
+    return boolean_obj(True);
+}
+
+obj_t *record_ne(obj_t *obj, obj_varargs_t *args) {
+    return boolean_obj(record_eq(obj, args)->boolval ? False : True);
+}
+
+boolean record_hashable(obj_t *obj) {
+    for (uint32_t i = 0; i < obj->record->type->nfields; i++) {
+        if (!dict_key_hashable(obj->record->slots[i])) return False;
+    }
+    return True;
+}
+
+uint32_t record_key_hash(obj_t *obj) {
+    uint32_t h = FNV32Prime * (FNV32Basis ^ bytearray_hash(obj->record->type->name));
+    for (uint32_t i = 0; i < obj->record->type->nfields; i++) {
+        h = FNV32Prime * (h ^ dict_key_hash(obj->record->slots[i]));
+    }
+    return h;
+}
+
+boolean record_keys_eq(obj_t *a, obj_t *b) {
+    if (a->record->type != b->record->type) return False;
+
+    for (uint32_t i = 0; i < a->record->type->nfields; i++) {
+        if (!dict_keys_eq(a->record->slots[i], b->record->slots[i])) return False;
+    }
+    return True;
+}
+
+obj_t *record_hash(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    if (!record_hashable(obj)) {
+        printf("Can't hash %s; not every field is hashable.\n",
+               bytearray_to_c_str(obj->record->type->name));
+        return nil_obj();
+    }
+    return int_obj((int) record_key_hash(obj));
+}
+
+static_method get_record_static_method(static_method_ident_t method_id) {
+    switch (method_id) {
+        case METHOD_TO_STRING:
+            return record_to_string;
+        case METHOD_EQ:
+            return record_eq;
+        case METHOD_NE:
+            return record_ne;
+        case METHOD_HASH:
+            return record_hash;
+        case METHOD_COPY:
+            return record_copy;
+        default:
+            return NULL;
+    }
+}
+
+static_method get_record_type_static_method(static_method_ident_t method_id) {
+    if (method_id == METHOD_TO_STRING) {
+        return record_type_to_string;
+    }
+
+    return NULL;
+}
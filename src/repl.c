@@ -43,6 +43,23 @@ static void print_list(obj_t *list_obj) {
     printf(" }");
 }
 
+static void print_set(obj_t *set_obj) {
+    printf("{ ");
+
+    obj_t *iter = dict_obj_iterator(set_obj, NULL);
+    obj_t *elem = iter->iterator->next(iter->iterator);
+    while (iter->iterator->state != ITER_STOPPED) {
+        print_value(elem);
+        elem = iter->iterator->next(iter->iterator);
+
+        if (iter->iterator->state != ITER_STOPPED) {
+            printf(", ");
+        }
+    }
+
+    printf(" }");
+}
+
 static void print_dict(obj_t *dict_obj) {
     if (dict_obj->dict->nelems < 1) {
         printf("{}");
@@ -66,13 +83,20 @@ static void print_result(obj_t *obj) {
         print_list(obj);
     } else if (TYPEOF(obj) == TYPE_DICT) {
         print_dict(obj);
+    } else if (TYPEOF(obj) == TYPE_SET) {
+        print_set(obj);
     } else {
         print_value(obj);
     }
     printf("\n");
 }
 
-int main() {
+int main(int argc, char **argv) {
+    if (argc > 2 || (argc == 2 && !c_str_eq(argv[1], "-O0") && !c_str_eq(argv[1], "-O1"))) {
+        fputs("Usage: repl [-O0|-O1]\n", stderr);
+        return -1;
+    }
+
     // Init ethel memory management.
     mem_init('x');
 
@@ -84,9 +108,10 @@ int main() {
 
     interp_t interp;
     interp_init(&interp);
+    if (argc == 2) interp.opt_level = argv[1][2] - '0';
 
     eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
-    put_env(&interp, c_str_to_bytearray("__eval_result"), (gc_header_t *) result);
+    put_env_with_flags(&interp, c_str_to_bytearray("__eval_result"), (obj_t *) result, F_ENV_DECLARATION);
 
     while (1) {
         if (indent) {
@@ -1,28 +1,62 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "../inc/type.h"
 #include "../inc/mem.h"
 #include "../inc/env.h"
 #include "../inc/str.h"
 #include "../inc/eval.h"
+#include "../inc/opt.h"
+#include "../inc/image.h"
 #include "../inc/run.h"
 
-static int _eval(char *program) {
+static int report(eval_result_t *result) {
+    printf("Error: %s\n", err_names[result->err]);
+    fputs("Execution error\n", stderr);
+    return result->err;
+}
+
+/*
+ * Run the program from its image, if there's one for it. If not, parse it,
+ * and write the image for next time. Failing to write one is no reason not
+ * to run the program, unless all that was asked for was the image.
+ */
+static int _eval(const char *program, uint32_t size, const char *image_name,
+                 int max_depth, int opt_level, boolean compile_only) {
     interp_t interp;
     interp_init(&interp);
+    if (max_depth > 0) interp.max_depth = max_depth;
+    interp.opt_level = opt_level;
 
     eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
-    put_env(&interp, c_str_to_bytearray("__eval_result"), (gc_header_t *) result);
+    put_env_with_flags(&interp, c_str_to_bytearray("__eval_result"), (obj_t *) result, F_ENV_DECLARATION);
     enter_scope(&interp);
 
-    eval(&interp, program, result);
+    image_key_t key = image_key(program, size, opt_level);
+    ast_expr_t ast;
+    parse_result_t parse_result = {.err = ERR_NO_ERROR, .code = NULL};
+    if (!compile_only) parse_result.code = image_load(image_name, &key, &ast);
+    if (parse_result.code == NULL) {
+        compile_script(&interp, program, size, &ast, &parse_result);
+        if (parse_result.err == ERR_NO_ERROR) {
+            error_t err = image_write(image_name, &key, parse_result.code, &ast);
+            if (compile_only) parse_result.err = err;
+        }
+    }
 
-    if (result->err != ERR_NO_ERROR) {
-        printf("Error: %s\n", err_names[result->err]);
-        fputs("Execution error\n", stderr);
-        return result->err;
+    if (parse_result.err != ERR_NO_ERROR || compile_only) {
+        ast_code_release(parse_result.code);
+        result->err = parse_result.err;
+        return result->err == ERR_NO_ERROR ? ERR_NO_ERROR : report(result);
     }
 
+    eval_code(&interp, parse_result.code, &ast, result);
+    if (result->err != ERR_NO_ERROR) return report(result);
+
     obj_t *obj = (obj_t *) result->obj;
     static_method to_string = get_static_method(TYPEOF(obj), METHOD_TO_STRING);
     if (to_string != NULL) {
@@ -34,53 +68,55 @@ static int _eval(char *program) {
     return ERR_NO_ERROR;
 }
 
-int run(char *fname) {
-    FILE *fp = fopen(fname, "r");
-    char *program = NULL;
-
-    if (fp == NULL) {
+/*
+ * Map the file and run it where it lies. The lexer doesn't copy its input,
+ * so the source is never copied at all. The image for file.e is file.ec.
+ */
+int run(char *fname, int max_depth, int opt_level, boolean compile_only) {
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
         fputs("Read error\n", stderr);
         return errno;
     }
 
-    if (fseek(fp, 0L, SEEK_END) != 0) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
         fputs("Error determining file length\n", stderr);
+        close(fd);
         return errno;
     }
 
-    // We're going to secretly wrap the entire program between curly braces,
-    // so add another two bytes to the size.
-    size_t bufsize = ftell(fp) + 2;
-    if (bufsize == -1) {
-        fputs("File error", stderr);
-        return errno;
-    }
-
-    // One for the null, two for the enclosing braces.
-    program = mem_alloc(bufsize + 3);
-    program[0] = '{';
-    program[bufsize - 1] = '}';
-    program[bufsize] = '\0';
-
-
-    if (fseek(fp, 0L, SEEK_SET) != 0) {
-        fputs("Error rewinding file\n", stderr);
-        return errno;
-    }
-
-    // Start writing the source right after the first brace.
-    size_t f_len = fread(program + 1, sizeof(char), bufsize, fp);
-    if (f_len == 0) {
+    if (st.st_size == 0) {
         fputs("Zero bytes read\n", stderr);
+        close(fd);
         return 0;
     }
-    if (ferror(fp) != 0) {
+    if (st.st_size > UINT32_MAX) {
+        fputs("File too long\n", stderr);
+        close(fd);
+        return ERR_INPUT_TOO_LONG;
+    }
+
+    size_t size = (size_t) st.st_size;
+    char *program = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (program == MAP_FAILED) {
         fputs("Read error\n", stderr);
         return errno;
     }
-    fclose(fp);
 
-    return _eval(program);
+    size_t len = c_str_len(fname) + 2;
+    char *image_name = malloc(len);
+    if (image_name == NULL) {
+        munmap(program, size);
+        return ERR_OUT_OF_MEMORY;
+    }
+    snprintf(image_name, len, "%sc", fname);
+
+    int err = _eval(program, (uint32_t) size, image_name, max_depth, opt_level, compile_only);
+    free(image_name);
+    munmap(program, size);
+    return err;
 }
 
 int main(int argc, char **argv) {
@@ -90,11 +126,34 @@ int main(int argc, char **argv) {
      */
     mem_init('x');
 
-    if (argc != 2) {
-        fputs("Usage: run <file.e>\n", stderr);
+    // Scopes can nest this deep; each call takes two.
+    int max_depth = 0;
+    int opt_level = OPT_DEFAULT_LEVEL;
+    boolean compile_only = False;
+    while (argc > 2) {
+        if (argc > 3 && c_str_eq(argv[1], "--max-depth")) {
+            max_depth = atoi(argv[2]);
+            argc--;
+            argv++;
+        } else if (c_str_eq(argv[1], "-O0")) {
+            opt_level = 0;
+        } else if (c_str_eq(argv[1], "-O1")) {
+            opt_level = 1;
+        } else if (c_str_eq(argv[1], "--compile")) {
+            // Write file.ec, and don't run it.
+            compile_only = True;
+        } else {
+            break;
+        }
+        argc--;
+        argv++;
+    }
+
+    if (argc != 2 || max_depth < 0) {
+        fputs("Usage: run [-O0|-O1] [--max-depth n] [--compile] <file.e>\n", stderr);
         return -1;
     }
 
     char *fname = argv[1];
-    return run(fname);
+    return run(fname, max_depth, opt_level, compile_only);
 }
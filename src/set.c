@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include "../inc/type.h"
+#include "../inc/dict.h"
+#include "../inc/set.h"
+
+/*
+ * Put each elem of src in dst. With a filter, only put the elems that are
+ * also in the filter, or, if keep is False, the ones that aren't.
+ *
+ * The elems already belong to a set, so their hashes and copies are reused.
+ */
+static error_t put_from(obj_t *dst, obj_t *src, obj_t *filter, boolean keep) {
+    obj_dict_t *dict = src->dict;
+    for (size_t i = 0; i < dict->buckets; i++) {
+        for (dict_kv_node_t *kv = dict->nodes[i]; kv != NULL; kv = kv->next) {
+            if (filter != NULL &&
+                (dict_get_node_hashed(filter, kv->k, kv->hash_val) != NULL) != keep) {
+                continue;
+            }
+            error_t err = dict_put_hashed(dst, kv->k, boolean_obj(True), kv->hash_val);
+            if (err != ERR_NO_ERROR) return err;
+        }
+    }
+    return ERR_NO_ERROR;
+}
+
+/*
+ * Return the set operand of a binary set method, converting a list into a
+ * set. Return NULL if there's no such operand.
+ */
+static obj_t *set_arg(obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Argument missing\n");
+        return NULL;
+    }
+
+    obj_t *arg = args->arg;
+    if (TYPEOF(arg) == TYPE_SET) return arg;
+
+    if (TYPEOF(arg) != TYPE_LIST) {
+        printf("Set or list required, not %s.\n", type_names[TYPEOF(arg)]);
+        return NULL;
+    }
+
+    size_t n = 0;
+    for (obj_list_element_t *elem = arg->list->elems; elem != NULL; elem = elem->next) n++;
+
+    obj_t *set = set_obj_of_size(n);
+    for (obj_list_element_t *elem = arg->list->elems; elem != NULL; elem = elem->next) {
+        if (set_add(set, elem->node) != ERR_NO_ERROR) {
+            printf("Can't put %s in a set.\n", type_names[TYPEOF(elem->node)]);
+            return NULL;
+        }
+    }
+    return set;
+}
+
+error_t set_add(obj_t *obj, obj_t *elem) {
+    return dict_put(obj, elem, boolean_obj(True));
+}
+
+boolean set_contains(obj_t *obj, obj_t *elem) {
+    return dict_contains(obj, elem);
+}
+
+obj_t *set_union(obj_t *obj, obj_varargs_t *args) {
+    obj_t *other = set_arg(args);
+    if (other == NULL) return nil_obj();
+
+    // Start from the larger set; the smaller one can add at most its size.
+    obj_t *big = obj->dict->nelems >= other->dict->nelems ? obj : other;
+    obj_t *small = big == obj ? other : obj;
+
+    obj_t *result = set_obj_of_size(big->dict->nelems + small->dict->nelems);
+    if (put_from(result, big, NULL, True) != ERR_NO_ERROR ||
+        put_from(result, small, NULL, True) != ERR_NO_ERROR) {
+        return nil_obj();
+    }
+    return result;
+}
+
+obj_t *set_intersection(obj_t *obj, obj_varargs_t *args) {
+    obj_t *other = set_arg(args);
+    if (other == NULL) return nil_obj();
+
+    // Walk the smaller set and probe the larger one.
+    obj_t *big = obj->dict->nelems >= other->dict->nelems ? obj : other;
+    obj_t *small = big == obj ? other : obj;
+
+    obj_t *result = set_obj_of_size(small->dict->nelems);
+    if (put_from(result, small, big, True) != ERR_NO_ERROR) return nil_obj();
+    return result;
+}
+
+obj_t *set_difference(obj_t *obj, obj_varargs_t *args) {
+    obj_t *other = set_arg(args);
+    if (other == NULL) return nil_obj();
+
+    obj_t *result = set_obj_of_size(obj->dict->nelems);
+    if (put_from(result, obj, other, False) != ERR_NO_ERROR) return nil_obj();
+    return result;
+}
+
+obj_t *set_obj_add(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Null arg to add()\n");
+        return nil_obj();
+    }
+    if (set_add(obj, args->arg) != ERR_NO_ERROR) {
+        printf("Can't put %s in a set.\n", type_names[TYPEOF(args->arg)]);
+        return nil_obj();
+    }
+    return obj;
+}
+
+obj_t *set_obj_contains(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Null arg to contains()\n");
+        return nil_obj();
+    }
+    return boolean_obj(set_contains(obj, args->arg));
+}
+
+obj_t *set_obj_remove(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Null arg to remove()\n");
+        return nil_obj();
+    }
+    // The values are all True, so anything else means it wasn't there.
+    return boolean_obj(TYPEOF(dict_remove(obj, args->arg)) == TYPE_BOOLEAN);
+}
+
+obj_t *set_obj_copy(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    obj_t *result = set_obj_of_size(obj->dict->nelems);
+    if (put_from(result, obj, NULL, True) != ERR_NO_ERROR) return nil_obj();
+    return result;
+}
+
+obj_t *set_obj_eq(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Null arg to eq()\n");
+        return nil_obj();
+    }
+    obj_t *other = args->arg;
+    if (TYPEOF(other) != TYPE_SET) return boolean_obj(False);
+    if (obj->dict->nelems != other->dict->nelems) return boolean_obj(False);
+
+    obj_dict_t *dict = obj->dict;
+    for (size_t i = 0; i < dict->buckets; i++) {
+        for (dict_kv_node_t *kv = dict->nodes[i]; kv != NULL; kv = kv->next) {
+            if (dict_get_node_hashed(other, kv->k, kv->hash_val) == NULL) {
+                return boolean_obj(False);
+            }
+        }
+    }
+    return boolean_obj(True);
+}
+
+obj_t *set_obj_ne(obj_t *obj, obj_varargs_t *args) {
+    obj_t *eq = set_obj_eq(obj, args);
+    if (TYPEOF(eq) != TYPE_BOOLEAN) return eq;
+    return boolean_obj(!eq->boolval);
+}
+
+static_method get_set_static_method(static_method_ident_t method_id) {
+    switch (method_id) {
+        case METHOD_CONTAINS:
+            return set_obj_contains;
+        case METHOD_INSERT:
+            return set_obj_add;
+        case METHOD_REMOVE_ELEM:
+            return set_obj_remove;
+        case METHOD_LENGTH:
+            return dict_obj_len;
+        case METHOD_ITERATOR:
+            return dict_obj_iterator;
+        case METHOD_COPY:
+            return set_obj_copy;
+        case METHOD_EQ:
+            return set_obj_eq;
+        case METHOD_NE:
+            return set_obj_ne;
+        case METHOD_UNION:
+        case METHOD_BITWISE_OR:
+            return set_union;
+        case METHOD_INTERSECTION:
+        case METHOD_BITWISE_AND:
+            return set_intersection;
+        case METHOD_DIFFERENCE:
+        case METHOD_SUB:
+            return set_difference;
+        default:
+            return NULL;
+    }
+}
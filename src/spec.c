@@ -0,0 +1,308 @@
+#include "../inc/type.h"
+#include "../inc/spec.h"
+
+#define SPEC_SCOPE_NAMES 32
+
+/*
+ * The names a scope has declared so far, and what as. A name declared
+ * without a type is TYPE_UNKNOWN, so that it hides one further out. Names
+ * past the first SPEC_SCOPE_NAMES aren't kept, which is safe, since eval
+ * checks what it finds anyway.
+ */
+typedef struct SpecScope {
+    struct SpecScope *parent;
+    int n;
+    bytearray_t *names[SPEC_SCOPE_NAMES];
+    type_t types[SPEC_SCOPE_NAMES];
+} spec_scope_t;
+
+static type_t spec(ast_expr_t *expr, spec_scope_t *scope);
+
+static void spec_stmt(ast_expr_t *expr, spec_scope_t *scope, boolean wanted);
+
+static void declare(spec_scope_t *scope, bytearray_t *name, type_t type) {
+    if (scope->n == SPEC_SCOPE_NAMES) return;
+    scope->names[scope->n] = name;
+    scope->types[scope->n] = type;
+    scope->n++;
+}
+
+/* Names are interned, so the same name is the same bytearray. */
+static type_t declared(spec_scope_t *scope, bytearray_t *name) {
+    for (; scope != NULL; scope = scope->parent) {
+        for (int i = scope->n - 1; i >= 0; i--) {
+            if (scope->names[i] == name) return scope->types[i];
+        }
+    }
+    return TYPE_UNKNOWN;
+}
+
+static boolean is_number(type_t type) {
+    return type == TYPE_INT || type == TYPE_FLOAT;
+}
+
+static void spec_list(ast_expr_list_t *es, spec_scope_t *scope) {
+    for (; es != NULL; es = es->next) spec(es->root, scope);
+}
+
+/* Whether a block's value can still come from before expr. */
+static boolean passes_value(ast_expr_t *expr) {
+    switch (TYPEOF(expr)) {
+        case AST_EMPTY:
+            return True;
+        case AST_RESERVED_CALLABLE:
+            // Printing gives nothing, so the block's value is what came before.
+            return expr->reserved_callable->type == AST_CALL_PRINT;
+        case AST_ASSIGN:
+        case AST_IDENT:
+        case AST_INT:
+        case AST_FLOAT:
+        case AST_STRING:
+        case AST_FUNCTION_CALL:
+        case AST_FUNCTION_RETURN:
+        case AST_WHILE_LOOP:
+        case AST_DO_WHILE_LOOP:
+        case AST_FOR_LOOP:
+            return False;
+        default:
+            // It might continue the loop it's in, which leaves the block
+            // with the value before.
+            return True;
+    }
+}
+
+/*
+ * The exprs of a block, declaring into scope. Only the last one that gives
+ * the block its value is wanted, and only if the block's is.
+ */
+static void spec_block(ast_expr_list_t *es, spec_scope_t *scope, boolean wanted) {
+    for (; es != NULL; es = es->next) {
+        ast_expr_list_t *next = es->next;
+        while (next != NULL && passes_value(next->root)) next = next->next;
+        spec_stmt(es->root, scope, next == NULL && wanted);
+    }
+}
+
+/* Ints make Ints. An Int with a Float is done in floats, by the ops floats have. */
+static type_t spec_arith(ast_expr_t *expr, spec_scope_t *scope) {
+    type_t a = spec(expr->op_args->a, scope);
+    type_t b = spec(expr->op_args->b, scope);
+
+    if (a == TYPE_INT && b == TYPE_INT) {
+        expr->op_args->spec = TYPE_INT;
+    } else if (is_number(a) && is_number(b)) {
+        switch (TYPEOF(expr)) {
+            case AST_ADD:
+            case AST_SUB:
+            case AST_MUL:
+            case AST_DIV:
+                expr->op_args->spec = TYPE_FLOAT;
+                break;
+            default:
+                break;
+        }
+    }
+    return expr->op_args->spec;
+}
+
+/* Only like with like. Mixed ones are left to the static methods. */
+static type_t spec_cmp(ast_expr_t *expr, spec_scope_t *scope) {
+    type_t a = spec(expr->op_args->a, scope);
+    type_t b = spec(expr->op_args->b, scope);
+
+    if (a == b && is_number(a)) expr->op_args->spec = a;
+    return TYPE_BOOLEAN;
+}
+
+static type_t spec_assign(ast_expr_t *expr, spec_scope_t *scope) {
+    ast_expr_t *lhs = expr->op_args->a;
+    type_t rhs = spec(expr->op_args->b, scope);
+
+    if (TYPEOF(lhs) == AST_TYPED) {
+        ast_typed_expr_t *typed = lhs->typed_expr;
+        if (TYPEOF(typed->expr) == AST_IDENT) declare(scope, typed->expr->bytearray, typed->type);
+        return TYPE_UNKNOWN;
+    }
+
+    if (TYPEOF(lhs) != AST_IDENT) {
+        spec(lhs, scope);
+        return TYPE_UNKNOWN;
+    }
+
+    if (FLAGS(lhs) & F_ENV_DECLARATION) {
+        declare(scope, lhs->bytearray, TYPE_UNKNOWN);
+        return TYPE_UNKNOWN;
+    }
+
+    type_t type = declared(scope, lhs->bytearray);
+    if ((type == TYPE_INT && rhs == TYPE_INT) || (type == TYPE_FLOAT && is_number(rhs))) {
+        expr->op_args->spec = type;
+    }
+    return TYPE_UNKNOWN;
+}
+
+static void spec_fn(ast_func_def_t *fn, spec_scope_t *scope) {
+    spec_scope_t inner = {.parent = scope, .n = 0};
+    for (ast_fn_arg_decl_t *arg = fn->argnames; arg != NULL; arg = arg->next) {
+        declare(&inner, arg->name, arg->type);
+    }
+    spec_block(fn->block_exprs, &inner, True);
+}
+
+/* A loop's value is its body's last, so the body is wanted if the loop is. */
+static void spec_for_loop(ast_for_loop_t *loop, spec_scope_t *scope, boolean wanted) {
+    spec(loop->iterable, scope);
+
+    // Ranges count in Ints.
+    spec_scope_t inner = {.parent = scope, .n = 0};
+    declare(&inner, loop->elem->bytearray,
+            TYPEOF(loop->iterable) == AST_RANGE ? TYPE_INT : TYPE_UNKNOWN);
+    spec_stmt(loop->pred, &inner, wanted);
+}
+
+/* Like spec(), for an expr whose value may not be wanted. */
+static void spec_stmt(ast_expr_t *expr, spec_scope_t *scope, boolean wanted) {
+    switch (TYPEOF(expr)) {
+        case AST_ASSIGN:
+            if (!wanted) ((gc_header_t *) expr)->flags |= F_VALUE_UNUSED;
+            spec_assign(expr, scope);
+            break;
+        case AST_BLOCK: {
+            spec_scope_t inner = {.parent = scope, .n = 0};
+            spec_block(expr->block_exprs, &inner, wanted);
+            break;
+        }
+        case AST_DO_WHILE_LOOP:
+            spec_stmt(expr->do_while_loop->pred, scope, wanted);
+            spec(expr->do_while_loop->cond, scope);
+            break;
+        case AST_WHILE_LOOP:
+            spec(expr->while_loop->cond, scope);
+            spec_stmt(expr->while_loop->pred, scope, wanted);
+            break;
+        case AST_FOR_LOOP:
+            spec_for_loop(expr->for_loop, scope, wanted);
+            break;
+        case AST_MATCH:
+            // The match's value is its arm's.
+            spec(expr->match->subject, scope);
+            for (ast_match_arm_t *arm = expr->match->arm_list; arm != NULL; arm = arm->next) {
+                spec(arm->pattern, scope);
+                spec_stmt(arm->expr, scope, wanted);
+            }
+            break;
+        default:
+            spec(expr, scope);
+            break;
+    }
+}
+
+/* Mark what can be marked in expr, and say what it's known to be. */
+static type_t spec(ast_expr_t *expr, spec_scope_t *scope) {
+    if (expr == NULL) return TYPE_UNKNOWN;
+
+    switch (TYPEOF(expr)) {
+        case AST_INT:
+            return TYPE_INT;
+        case AST_FLOAT:
+            return TYPE_FLOAT;
+        case AST_IDENT:
+            return declared(scope, expr->bytearray);
+        case AST_ADD:
+        case AST_SUB:
+        case AST_MUL:
+        case AST_DIV:
+        case AST_MOD:
+        case AST_BITWISE_SHL:
+        case AST_BITWISE_SHR:
+        case AST_BITWISE_AND:
+        case AST_BITWISE_OR:
+        case AST_BITWISE_XOR:
+            return spec_arith(expr, scope);
+        case AST_GT:
+        case AST_GE:
+        case AST_LT:
+        case AST_LE:
+        case AST_EQ:
+        case AST_NE:
+            return spec_cmp(expr, scope);
+        case AST_ASSIGN:
+            return spec_assign(expr, scope);
+        case AST_AND:
+        case AST_OR:
+        case AST_IS:
+        case AST_IN:
+        case AST_SUBSCRIPT:
+        case AST_MAPS_TO:
+            spec(expr->op_args->a, scope);
+            spec(expr->op_args->b, scope);
+            break;
+        case AST_NOT:
+        case AST_NEGATE:
+        case AST_BITWISE_NOT:
+            spec(expr->unary_arg->a, scope);
+            break;
+        case AST_CAST:
+            spec(expr->cast_args->a, scope);
+            break;
+        case AST_RANGE:
+            spec(expr->range->from, scope);
+            spec(expr->range->to, scope);
+            spec(expr->range->step, scope);
+            break;
+        case AST_IF_THEN:
+            spec(expr->if_then_args->cond, scope);
+            spec(expr->if_then_args->pred, scope);
+            break;
+        case AST_IF_THEN_ELSE:
+            spec(expr->if_then_else_args->cond, scope);
+            spec(expr->if_then_else_args->pred, scope);
+            spec(expr->if_then_else_args->else_pred, scope);
+            break;
+        case AST_LIST:
+        case AST_SET:
+            spec_list(expr->list->es, scope);
+            break;
+        case AST_DICT:
+            for (ast_expr_kv_list_t *kv = expr->dict->kv; kv != NULL; kv = kv->next) {
+                spec(kv->k, scope);
+                spec(kv->v, scope);
+            }
+            break;
+        case AST_BLOCK:
+        case AST_DO_WHILE_LOOP:
+        case AST_WHILE_LOOP:
+        case AST_FOR_LOOP:
+        case AST_MATCH:
+            spec_stmt(expr, scope, True);
+            break;
+        case AST_FUNCTION_RETURN:
+            spec_list(expr->func_return_values, scope);
+            break;
+        case AST_FUNCTION_DEF:
+            spec_fn(expr->func_def, scope);
+            break;
+        case AST_FUNCTION_CALL:
+            spec(expr->func_call->expr, scope);
+            spec_list(expr->func_call->args, scope);
+            break;
+        case AST_RESERVED_CALLABLE:
+            spec_list(expr->reserved_callable->es, scope);
+            break;
+        case AST_APPLY:
+            spec(expr->application->receiver, scope);
+            spec_list(expr->application->args, scope);
+            break;
+        case AST_FIELD:
+            spec(expr->field->receiver, scope);
+            break;
+        default:
+            break;
+    }
+    return TYPE_UNKNOWN;
+}
+
+void specialize(ast_expr_t *expr) {
+    spec_scope_t top = {.parent = NULL, .n = 0};
+    spec_stmt(expr, &top, True);
+}
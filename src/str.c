@@ -4,6 +4,7 @@
 #include "../inc/type.h"
 #include "../inc/ptr.h"
 #include "../inc/mem.h"
+#include "../inc/arena.h"
 #include "../inc/arr.h"
 #include "../inc/math.h"
 #include "../inc/str.h"
@@ -25,8 +26,8 @@ static void strip_trailing_ws(char *s) {
     }
 }
 
-static obj_t *str_slice_internal(obj_t *obj, size_t start, size_t end) {
-    if (end > obj->bytearray->size) end = obj->bytearray->size;
+static obj_t *str_slice_internal(obj_t *obj, int start, int end) {
+    if (end > obj->bytearray->size) end = (int) obj->bytearray->size;
 
     if (end < 0 ||
         start < 0 ||
@@ -35,13 +36,7 @@ static obj_t *str_slice_internal(obj_t *obj, size_t start, size_t end) {
         return string_obj(bytearray_alloc(0));
     }
 
-    size_t len = end - start;
-    bytearray_t *ba = bytearray_alloc(len);
-    for (int i = 0; i < end; i++) {
-        ba->data[i] = obj->bytearray->data[start + i];
-    }
-
-    return string_obj(ba);
+    return string_obj(bytearray_slice(obj->bytearray, (size_t) start, (size_t) end));
 }
 
 obj_t *str_hash(obj_t *obj, obj_varargs_t /* Ignored */ *args) {
@@ -51,7 +46,7 @@ obj_t *str_hash(obj_t *obj, obj_varargs_t /* Ignored */ *args) {
 obj_t *str_copy(obj_t *obj, obj_varargs_t /* Ignored */ *args) {
     (void) args;
 
-    // string_obj copies the contents of the source.
+    // string_obj shares the contents of the source, copy-on-write.
     return string_obj(obj->bytearray);
 }
 
@@ -329,14 +324,65 @@ bytearray_t *int_to_hex(unsigned int n) {
 }
 
 static bytearray_t *bytearray_alloc_internal(size_t size) {
-    bytearray_t *a = mem_alloc(size + sizeof(size_t) + sizeof(gc_header_t));
+    bytearray_t *a = mem_alloc(sizeof(bytearray_t) + size);
+    if (a == NULL) return NULL;
     ((gc_header_t *) a)->type = TYPE_BYTEARRAY_DATA;
     ((gc_header_t *) a)->flags = F_NONE;
-    ((gc_header_t *) a)->children = 0;
+    ((gc_header_t *) a)->children = 1;
+    a->parent = NULL;
     a->size = size;
+    a->capacity = size;
+    a->data = a->bytes;
     return a;
 }
 
+static bytearray_t *bytearray_view(bytearray_t *owner, byte *data, size_t size) {
+    bytearray_t *a = mem_alloc(sizeof(bytearray_t));
+    ((gc_header_t *) a)->type = TYPE_BYTEARRAY_DATA;
+    // The bytes belong to the owner, so writes must go to a copy.
+    ((gc_header_t *) a)->flags = F_COPY_ON_WRITE;
+    ((gc_header_t *) a)->children = 1;
+    a->parent = bytearray_share(owner);
+    a->size = size;
+    a->capacity = 0;
+    a->data = data;
+    return a;
+}
+
+/*
+ * Return the bytes of a followed by the bytes of b.
+ *
+ * Long results go in an owner with room to spare, and the result views it.
+ * When a is such a view and ends where its owner's bytes end, b is written
+ * into the spare room, so a chain of appends copies each byte about once.
+ * Nobody else can see past the end of a, so a stays as it was.
+ */
+static bytearray_t *bytearray_concat(bytearray_t *a, bytearray_t *b) {
+    size_t size = a->size + b->size;
+    bytearray_t *owner = a->parent;
+
+    if (owner != NULL &&
+        a->data + a->size == owner->data + owner->size &&
+        owner->size + b->size <= owner->capacity) {
+        mem_cp(owner->data + owner->size, b->data, b->size);
+        owner->size += b->size;
+        return bytearray_view(owner, a->data, size);
+    }
+
+    if (size <= SLICE_COPY_MAX) {
+        bytearray_t *new = bytearray_alloc_internal(size);
+        mem_cp(new->data, a->data, a->size);
+        mem_cp(new->data + a->size, b->data, b->size);
+        return new;
+    }
+
+    owner = bytearray_alloc_internal(size * 2);
+    mem_cp(owner->data, a->data, a->size);
+    mem_cp(owner->data + a->size, b->data, b->size);
+    owner->size = size;
+    return bytearray_view(owner, owner->data, size);
+}
+
 bytearray_t *bytearray_alloc_with_data(size_t size, uint8_t *data) {
     bytearray_t *a = bytearray_alloc_internal(size);
     mem_cp(a->data, data, size);
@@ -345,39 +391,132 @@ bytearray_t *bytearray_alloc_with_data(size_t size, uint8_t *data) {
 
 bytearray_t *bytearray_alloc(size_t size) {
     bytearray_t *a = bytearray_alloc_internal(size);
+    if (a == NULL) return NULL;
     mem_set(a->data, '\0', size);
     return a;
 }
 
+bytearray_t *bytearray_slice(bytearray_t *src, size_t start, size_t end) {
+    size_t len = end - start;
+    bytearray_t *owner = src->parent ? src->parent : src;
+
+    if (len <= SLICE_COPY_MAX || len < owner->size / SLICE_COMPACT_RATIO) {
+        return bytearray_alloc_with_data(len, src->data + start);
+    }
+
+    return bytearray_view(owner, src->data + start, len);
+}
+
+/*
+ * Interned names, and string literals up to a bound, stay for as long as
+ * the program runs, in an arena of their own, so that the code naming them
+ * can come and go. The table is open addressed, and doubles when it's half
+ * full.
+ */
+static arena_t names;
+static bytearray_t **name_slots = NULL;
+static uint32_t name_capacity = 0;
+static uint32_t name_count = 0;
+
+static boolean grow_names(void) {
+    uint32_t capacity = name_capacity == 0 ? 256 : name_capacity * 2;
+    bytearray_t **slots = calloc(capacity, sizeof(bytearray_t *));
+    if (slots == NULL) return False;
+
+    for (uint32_t i = 0; i < name_capacity; i++) {
+        if (name_slots[i] == NULL) continue;
+        uint32_t j = bytearray_hash(name_slots[i]) & (capacity - 1);
+        while (slots[j] != NULL) j = (j + 1) & (capacity - 1);
+        slots[j] = name_slots[i];
+    }
+    free(name_slots);
+    name_slots = slots;
+    name_capacity = capacity;
+    return True;
+}
+
+/* The slot for these bytes, holding them if they're interned, or null if out of memory. */
+static bytearray_t **name_slot(const byte *data, size_t size) {
+    if (name_count * 2 >= name_capacity && !grow_names()) return NULL;
+
+    bytearray_t key = {.size = size, .data = (byte *) data};
+    uint32_t mask = name_capacity - 1;
+    uint32_t i = bytearray_hash(&key) & mask;
+    for (; name_slots[i] != NULL; i = (i + 1) & mask) {
+        if (bytearray_eq(name_slots[i], &key)) break;
+    }
+    return name_slots + i;
+}
+
+static bytearray_t *intern_in(bytearray_t **slot, const byte *data, size_t size) {
+    bytearray_t *a = arena_alloc(&names, sizeof(bytearray_t) + size);
+    if (a == NULL) return NULL;
+    ((gc_header_t *) a)->type = TYPE_BYTEARRAY_DATA;
+    // Shared by everyone who names it, so never written.
+    ((gc_header_t *) a)->flags = F_COPY_ON_WRITE;
+    ((gc_header_t *) a)->children = 1;
+    a->parent = NULL;
+    a->size = size;
+    a->capacity = size;
+    a->data = a->bytes;
+    mem_cp(a->data, (void *) data, size);
+
+    *slot = a;
+    name_count++;
+    return a;
+}
+
+bytearray_t *bytearray_intern(const byte *data, size_t size) {
+    bytearray_t **slot = name_slot(data, size);
+    if (slot == NULL) return NULL;
+    if (*slot != NULL) return *slot;
+    return intern_in(slot, data, size);
+}
+
+// Bytes of string literals interned so far. See bytearray_intern_literal().
+static size_t literal_bytes = 0;
+
+bytearray_t *bytearray_intern_literal(const byte *data, size_t size) {
+    bytearray_t **slot = name_slot(data, size);
+    if (slot == NULL) return NULL;
+    if (*slot != NULL) return *slot;
+    if (literal_bytes + size > LITERAL_INTERN_MAX) return bytearray_alloc_with_data(size, (uint8_t *) data);
+
+    literal_bytes += size;
+    return intern_in(slot, data, size);
+}
+
+boolean bytearray_is_interned(bytearray_t *a) {
+    if (name_capacity == 0) return False;
+
+    uint32_t mask = name_capacity - 1;
+    for (uint32_t i = bytearray_hash(a) & mask; name_slots[i] != NULL; i = (i + 1) & mask) {
+        if (name_slots[i] == a) return True;
+    }
+    return False;
+}
+
+bytearray_t *bytearray_share(bytearray_t *src) {
+    if (src == NULL) return NULL;
+    ((gc_header_t *) src)->flags |= F_COPY_ON_WRITE;
+    return src;
+}
+
 bytearray_t *bytearray_clone(bytearray_t *src) {
     if (src == NULL) return NULL;
-    bytearray_t *dst = bytearray_alloc(src->size);
-    size_t i = 0;
-    while (i < src->size) {
-        dst->data[i] = src->data[i];
-        i++;
-    }
-    return dst;
+    return bytearray_alloc_with_data(src->size, src->data);
 }
 
 boolean bytearray_eq(bytearray_t *a, bytearray_t *b) {
     if (a->size != b->size) return False;
 
-    for (int i = 0; i < a->size; i++) {
-        if (a->data[i] != b->data[i]) return False;
-    }
-
-    return True;
+    return mem_eq(a->data, b->data, a->size);
 }
 
 boolean c_str_eq_bytearray(const char *s, bytearray_t *a) {
     if (c_str_len(s) != a->size) return False;
 
-    for (int i = 0; i < a->size; i++) {
-        if (s[i] != a->data[i]) return False;
-    }
-
-    return True;
+    return mem_eq(s, a->data, a->size);
 }
 
 char *bytearray_to_c_str(bytearray_t *a) {
@@ -454,27 +593,50 @@ obj_t *str_add(obj_t *obj, obj_varargs_t *args) {
         return obj;
     }
 
-    bytearray_t *new = bytearray_alloc(obj->bytearray->size + arg->bytearray->size);
-    if (new == NULL) {
-        printf("Couldn't allocate new string!\n");
+    // The operands' bytearrays may be shared, so leave them alone.
+    return string_obj(bytearray_concat(obj->bytearray, arg->bytearray));
+}
+
+obj_t *str_builder(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return string_builder_obj(obj->bytearray);
+}
+
+obj_t *builder_append(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Null arg to append()\n");
         return obj;
     }
-    for (size_t i = 0; i < obj->bytearray->size; i++) {
-        new->data[i] = obj->bytearray->data[i];
-    }
-    size_t offset = obj->bytearray->size;
-    for (size_t i = 0; i < arg->bytearray->size; i++) {
-        new->data[offset + i] = arg->bytearray->data[i];
-    }
 
-    bytearray_t *old = obj->bytearray;
-    obj->bytearray = new;
-    mem_free(old);
-    old = NULL;
+    obj_t *arg = args->arg;
+    if (TYPEOF(arg) != TYPE_STRING) {
+        static_method to_string = get_static_method(TYPEOF(arg), METHOD_TO_STRING);
+        if (to_string == NULL) {
+            printf("Cannot append %s to %s.\n",
+                   type_names[TYPEOF(arg)], type_names[TYPEOF(obj)]);
+            return obj;
+        }
+        arg = to_string(arg, NULL);
+    }
 
+    // The old bytes may be shared by a snapshot, and concat leaves them be.
+    obj->bytearray = bytearray_concat(obj->bytearray, arg->bytearray);
     return obj;
 }
 
+obj_t *builder_to_string(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return string_obj(obj->bytearray);
+}
+
+obj_t *builder_len(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return int_obj(obj->bytearray->size);
+}
+
 obj_t *str_random_choice(obj_t *obj, obj_varargs_t *args) {
     return arr_random_choice(obj, args);
 }
@@ -666,6 +828,8 @@ static_method get_str_static_method(static_method_ident_t method_id) {
             return str_contains;
         case METHOD_ADD:
             return str_add;
+        case METHOD_BUILDER:
+            return str_builder;
         case METHOD_GET:
             return str_get;
         case METHOD_EQ:
@@ -680,6 +844,21 @@ static_method get_str_static_method(static_method_ident_t method_id) {
             return str_random_choice;
         case METHOD_ITERATOR:
             return arr_iterator;
+        case METHOD_SORT:
+            return arr_sort;
+        default:
+            return NULL;
+    }
+}
+
+static_method get_builder_static_method(static_method_ident_t method_id) {
+    switch (method_id) {
+        case METHOD_APPEND:
+            return builder_append;
+        case METHOD_TO_STRING:
+            return builder_to_string;
+        case METHOD_LENGTH:
+            return builder_len;
         default:
             return NULL;
     }
@@ -9,11 +9,15 @@
 #include "../inc/str.h"
 #include "../inc/list.h"
 #include "../inc/dict.h"
+#include "../inc/set.h"
+#include "../inc/vec.h"
 #include "../inc/range.h"
 #include "../inc/fn.h"
+#include "../inc/iter.h"
+#include "../inc/record.h"
 
-static_method get_static_method(type_t obj_type,
-                                static_method_ident_t method_id) {
+static static_method get_type_static_method(type_t obj_type,
+                                            static_method_ident_t method_id) {
     switch (obj_type) {
         case TYPE_BYTE:
             return get_byte_static_method(method_id);
@@ -29,13 +33,36 @@ static_method get_static_method(type_t obj_type,
             return get_list_static_method(method_id);
         case TYPE_DICT:
             return get_dict_static_method(method_id);
+        case TYPE_SET:
+            return get_set_static_method(method_id);
         case TYPE_STRING:
             return get_str_static_method(method_id);
+        case TYPE_STRING_BUILDER:
+            return get_builder_static_method(method_id);
+        case TYPE_INT_ARRAY:
+        case TYPE_FLOAT_ARRAY:
+            return get_vec_static_method(method_id);
         case TYPE_RANGE:
             return get_range_static_method(method_id);
         case TYPE_FUNCTION:
             return get_fn_static_method(method_id);
+        case TYPE_ITERATOR:
+            return get_iter_static_method(method_id);
+        case TYPE_RECORD:
+            return get_record_static_method(method_id);
+        case TYPE_RECORD_TYPE:
+            return get_record_type_static_method(method_id);
         default:
             return NULL;
     }
 }
+
+static_method get_static_method(type_t obj_type,
+                                static_method_ident_t method_id) {
+    static_method m = get_type_static_method(obj_type, method_id);
+    if (m != NULL || method_id == METHOD_ITERATOR) return m;
+
+    // Anything iterable gets the pipeline methods it doesn't define itself.
+    if (get_type_static_method(obj_type, METHOD_ITERATOR) == NULL) return NULL;
+    return get_iter_static_method(method_id);
+}
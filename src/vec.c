@@ -0,0 +1,733 @@
+#include <stdio.h>
+#include "../inc/type.h"
+#include "../inc/ptr.h"
+#include "../inc/vec.h"
+
+#define INTS(obj) ((int32_t *) (obj)->bytearray->data)
+#define FLOATS(obj) ((float *) (obj)->bytearray->data)
+
+// Arrays shorter than this aren't worth the vector setup.
+#define VEC_SIMD_MIN 16
+
+// Elements vec_of() makes room for before it knows how many there are.
+#define VEC_OF_MIN_ROOM 16
+
+#ifdef HAVE_SIMD
+#include <immintrin.h>
+
+/*
+ * Elementwise kernels. Each does as many whole vectors as fit and returns
+ * the number of elements done; the caller finishes the tail. If b is NULL,
+ * the scalar s is used for every element of b.
+ */
+static size_t float_op_sse2(float *dst, const float *a, const float *b, float s,
+                            size_t n, static_method_ident_t op) {
+    __m128 vs = _mm_set1_ps(s);
+    size_t i = 0;
+    switch (op) {
+        case METHOD_ADD:
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(a + i), b ? _mm_loadu_ps(b + i) : vs));
+            }
+            break;
+        case METHOD_SUB:
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(dst + i, _mm_sub_ps(_mm_loadu_ps(a + i), b ? _mm_loadu_ps(b + i) : vs));
+            }
+            break;
+        case METHOD_MUL:
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(a + i), b ? _mm_loadu_ps(b + i) : vs));
+            }
+            break;
+        case METHOD_DIV:
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(dst + i, _mm_div_ps(_mm_loadu_ps(a + i), b ? _mm_loadu_ps(b + i) : vs));
+            }
+            break;
+        default:
+            break;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t float_op_avx2(float *dst, const float *a, const float *b, float s,
+                            size_t n, static_method_ident_t op) {
+    __m256 vs = _mm256_set1_ps(s);
+    size_t i = 0;
+    switch (op) {
+        case METHOD_ADD:
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(a + i), b ? _mm256_loadu_ps(b + i) : vs));
+            }
+            break;
+        case METHOD_SUB:
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(dst + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), b ? _mm256_loadu_ps(b + i) : vs));
+            }
+            break;
+        case METHOD_MUL:
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), b ? _mm256_loadu_ps(b + i) : vs));
+            }
+            break;
+        case METHOD_DIV:
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(dst + i, _mm256_div_ps(_mm256_loadu_ps(a + i), b ? _mm256_loadu_ps(b + i) : vs));
+            }
+            break;
+        default:
+            break;
+    }
+    return i;
+}
+
+// SSE2 has no 32-bit multiply, so only add and subtract are done here.
+static size_t int_op_sse2(int32_t *dst, const int32_t *a, const int32_t *b, int32_t s,
+                          size_t n, static_method_ident_t op) {
+    __m128i vs = _mm_set1_epi32(s);
+    size_t i = 0;
+    switch (op) {
+        case METHOD_ADD:
+            for (; i + 4 <= n; i += 4) {
+                __m128i y = b ? _mm_loadu_si128((const __m128i *) (b + i)) : vs;
+                _mm_storeu_si128((__m128i *) (dst + i), _mm_add_epi32(_mm_loadu_si128((const __m128i *) (a + i)), y));
+            }
+            break;
+        case METHOD_SUB:
+            for (; i + 4 <= n; i += 4) {
+                __m128i y = b ? _mm_loadu_si128((const __m128i *) (b + i)) : vs;
+                _mm_storeu_si128((__m128i *) (dst + i), _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (a + i)), y));
+            }
+            break;
+        default:
+            break;
+    }
+    return i;
+}
+
+// There's no vector integer division at all.
+__attribute__((target("avx2")))
+static size_t int_op_avx2(int32_t *dst, const int32_t *a, const int32_t *b, int32_t s,
+                          size_t n, static_method_ident_t op) {
+    __m256i vs = _mm256_set1_epi32(s);
+    size_t i = 0;
+    switch (op) {
+        case METHOD_ADD:
+            for (; i + 8 <= n; i += 8) {
+                __m256i y = b ? _mm256_loadu_si256((const __m256i *) (b + i)) : vs;
+                _mm256_storeu_si256((__m256i *) (dst + i), _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (a + i)), y));
+            }
+            break;
+        case METHOD_SUB:
+            for (; i + 8 <= n; i += 8) {
+                __m256i y = b ? _mm256_loadu_si256((const __m256i *) (b + i)) : vs;
+                _mm256_storeu_si256((__m256i *) (dst + i), _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (a + i)), y));
+            }
+            break;
+        case METHOD_MUL:
+            for (; i + 8 <= n; i += 8) {
+                __m256i y = b ? _mm256_loadu_si256((const __m256i *) (b + i)) : vs;
+                _mm256_storeu_si256((__m256i *) (dst + i), _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *) (a + i)), y));
+            }
+            break;
+        default:
+            break;
+    }
+    return i;
+}
+
+static size_t sqrt_sse2(float *dst, const float *a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(dst + i, _mm_sqrt_ps(_mm_loadu_ps(a + i)));
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t sqrt_avx2(float *dst, const float *a, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_sqrt_ps(_mm256_loadu_ps(a + i)));
+    return i;
+}
+
+/*
+ * Reduction kernels. Each keeps one accumulator per lane and stores them in
+ * lanes for the caller to fold, along with the tail. A dot product leaves
+ * partial sums in the lanes. They need at least one whole vector.
+ */
+static size_t float_reduce_sse2(const float *a, const float *b, size_t n,
+                                static_method_ident_t op, float *lanes) {
+    __m128 acc = _mm_loadu_ps(a);
+    size_t i = 4;
+    switch (op) {
+        case METHOD_SUM:
+            for (; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_loadu_ps(a + i));
+            break;
+        case METHOD_MIN:
+            for (; i + 4 <= n; i += 4) acc = _mm_min_ps(acc, _mm_loadu_ps(a + i));
+            break;
+        case METHOD_MAX:
+            for (; i + 4 <= n; i += 4) acc = _mm_max_ps(acc, _mm_loadu_ps(a + i));
+            break;
+        case METHOD_DOT:
+            acc = _mm_mul_ps(acc, _mm_loadu_ps(b));
+            for (; i + 4 <= n; i += 4) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            }
+            break;
+        default:
+            return 0;
+    }
+    _mm_storeu_ps(lanes, acc);
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t float_reduce_avx2(const float *a, const float *b, size_t n,
+                                static_method_ident_t op, float *lanes) {
+    __m256 acc = _mm256_loadu_ps(a);
+    size_t i = 8;
+    switch (op) {
+        case METHOD_SUM:
+            for (; i + 8 <= n; i += 8) acc = _mm256_add_ps(acc, _mm256_loadu_ps(a + i));
+            break;
+        case METHOD_MIN:
+            for (; i + 8 <= n; i += 8) acc = _mm256_min_ps(acc, _mm256_loadu_ps(a + i));
+            break;
+        case METHOD_MAX:
+            for (; i + 8 <= n; i += 8) acc = _mm256_max_ps(acc, _mm256_loadu_ps(a + i));
+            break;
+        case METHOD_DOT:
+            acc = _mm256_mul_ps(acc, _mm256_loadu_ps(b));
+            for (; i + 8 <= n; i += 8) {
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            }
+            break;
+        default:
+            return 0;
+    }
+    _mm256_storeu_ps(lanes, acc);
+    return i;
+}
+
+// SSE2 has no 32-bit min, max or multiply, so min and max are built from
+// compares, and dot products are left to the caller.
+static size_t int_reduce_sse2(const int32_t *a, size_t n,
+                              static_method_ident_t op, int32_t *lanes) {
+    __m128i acc = _mm_loadu_si128((const __m128i *) a);
+    size_t i = 4;
+    switch (op) {
+        case METHOD_SUM:
+            for (; i + 4 <= n; i += 4) acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i *) (a + i)));
+            break;
+        case METHOD_MIN:
+            for (; i + 4 <= n; i += 4) {
+                __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+                __m128i lt = _mm_cmplt_epi32(x, acc);
+                acc = _mm_or_si128(_mm_and_si128(lt, x), _mm_andnot_si128(lt, acc));
+            }
+            break;
+        case METHOD_MAX:
+            for (; i + 4 <= n; i += 4) {
+                __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+                __m128i gt = _mm_cmpgt_epi32(x, acc);
+                acc = _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, acc));
+            }
+            break;
+        default:
+            return 0;
+    }
+    _mm_storeu_si128((__m128i *) lanes, acc);
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t int_reduce_avx2(const int32_t *a, const int32_t *b, size_t n,
+                              static_method_ident_t op, int32_t *lanes) {
+    __m256i acc = _mm256_loadu_si256((const __m256i *) a);
+    size_t i = 8;
+    switch (op) {
+        case METHOD_SUM:
+            for (; i + 8 <= n; i += 8) acc = _mm256_add_epi32(acc, _mm256_loadu_si256((const __m256i *) (a + i)));
+            break;
+        case METHOD_MIN:
+            for (; i + 8 <= n; i += 8) acc = _mm256_min_epi32(acc, _mm256_loadu_si256((const __m256i *) (a + i)));
+            break;
+        case METHOD_MAX:
+            for (; i + 8 <= n; i += 8) acc = _mm256_max_epi32(acc, _mm256_loadu_si256((const __m256i *) (a + i)));
+            break;
+        case METHOD_DOT:
+            acc = _mm256_mullo_epi32(acc, _mm256_loadu_si256((const __m256i *) b));
+            for (; i + 8 <= n; i += 8) {
+                __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+                __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+                acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(x, y));
+            }
+            break;
+        default:
+            return 0;
+    }
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    return i;
+}
+#endif
+
+static float float_fold(float acc, float x, static_method_ident_t op) {
+    switch (op) {
+        case METHOD_MIN:
+            return x < acc ? x : acc;
+        case METHOD_MAX:
+            return x > acc ? x : acc;
+        default:
+            return acc + x;
+    }
+}
+
+// Ints wrap around on overflow, in the vector lanes and here alike.
+static int32_t int_fold(int32_t acc, int32_t x, static_method_ident_t op) {
+    switch (op) {
+        case METHOD_MIN:
+            return x < acc ? x : acc;
+        case METHOD_MAX:
+            return x > acc ? x : acc;
+        default:
+            return (int32_t) ((uint32_t) acc + (uint32_t) x);
+    }
+}
+
+size_t vec_len(obj_t *obj) {
+    // Both element types are four bytes.
+    return obj->bytearray->size / sizeof(int32_t);
+}
+
+static boolean to_int32(obj_t *obj, int32_t *out) {
+    switch (TYPEOF(obj)) {
+        case TYPE_INT:
+            *out = obj->intval;
+            return True;
+        case TYPE_BYTE:
+            *out = obj->byteval;
+            return True;
+        default:
+            return False;
+    }
+}
+
+static boolean to_float32(obj_t *obj, float *out) {
+    switch (TYPEOF(obj)) {
+        case TYPE_FLOAT:
+            *out = obj->floatval;
+            return True;
+        case TYPE_INT:
+            *out = (float) obj->intval;
+            return True;
+        case TYPE_BYTE:
+            *out = (float) obj->byteval;
+            return True;
+        default:
+            return False;
+    }
+}
+
+// Store obj as the i'th element of the array, if it's the right kind of number.
+static boolean vec_put(obj_t *vec, size_t i, obj_t *obj) {
+    if (TYPEOF(vec) == TYPE_FLOAT_ARRAY) return to_float32(obj, FLOATS(vec) + i);
+    return to_int32(obj, INTS(vec) + i);
+}
+
+obj_t *vec_of(type_t type, obj_t *src) {
+    if (TYPEOF(src) == TYPE_INT) {
+        if (src->intval < 0) {
+            printf("Array size can't be negative.\n");
+            return nil_obj();
+        }
+        return vec_obj(type, (size_t) src->intval);
+    }
+
+    static_method iterator = get_static_method(TYPEOF(src), METHOD_ITERATOR);
+    if (iterator == NULL) {
+        printf("Size or sequence required, not %s.\n", type_names[TYPEOF(src)]);
+        return nil_obj();
+    }
+
+    // Collect in one pass, into room that doubles when it fills.
+    size_t n = 0;
+    size_t room = VEC_OF_MIN_ROOM;
+    obj_t *vec = vec_obj(type, room);
+    if (TYPEOF(vec) == TYPE_NIL) return vec;
+    obj_iter_t *iter = iterator(src, NULL)->iterator;
+    for (obj_t *elem = iter->next(iter); iter->state != ITER_STOPPED; elem = iter->next(iter)) {
+        if (n == room) {
+            obj_t *bigger = vec_obj(type, room * 2);
+            if (TYPEOF(bigger) == TYPE_NIL) return bigger;
+            mem_cp(bigger->bytearray->data, vec->bytearray->data, vec->bytearray->size);
+            vec = bigger;
+            room *= 2;
+        }
+        if (!vec_put(vec, n, elem)) {
+            printf("Can't put %s in %s.\n", type_names[TYPEOF(elem)], type_names[type]);
+            return nil_obj();
+        }
+        n++;
+    }
+    if (iter->err != ERR_NO_ERROR) return error_obj(iter->err);
+
+    // What's left of the room stays with the bytes, past their size.
+    vec->bytearray->size = n * sizeof(int32_t);
+    return vec;
+}
+
+obj_t *vec_map(obj_t *obj, math_fn_t fn) {
+    size_t n = vec_len(obj);
+    obj_t *result = vec_obj(TYPE_FLOAT_ARRAY, n);
+    if (TYPEOF(result) == TYPE_NIL) return result;
+    float *dst = FLOATS(result);
+
+    const float *src = FLOATS(obj);
+    if (TYPEOF(obj) == TYPE_INT_ARRAY) {
+        // Convert into the result, then work on that in place.
+        int32_t *ints = INTS(obj);
+        for (size_t i = 0; i < n; i++) dst[i] = (float) ints[i];
+        src = dst;
+    }
+
+    size_t i = 0;
+#ifdef HAVE_SIMD
+    if (fn == MATH_SQRT && n >= VEC_SIMD_MIN) {
+        i = have_avx2() ? sqrt_avx2(dst, src, n) : sqrt_sse2(dst, src, n);
+    }
+#endif
+    for (; i < n; i++) dst[i] = math_apply(fn, src[i]);
+
+    return result;
+}
+
+obj_t *vec_size(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return int_obj((int) vec_len(obj));
+}
+
+obj_t *vec_copy(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    obj_t *copy = vec_obj(TYPEOF(obj), vec_len(obj));
+    if (TYPEOF(copy) == TYPE_NIL) return copy;
+    mem_cp(copy->bytearray->data, obj->bytearray->data, obj->bytearray->size);
+    return copy;
+}
+
+static obj_t *vec_get_at(obj_t *obj, size_t i) {
+    if (TYPEOF(obj) == TYPE_FLOAT_ARRAY) return float_obj(FLOATS(obj)[i]);
+    return int_obj(INTS(obj)[i]);
+}
+
+obj_t *vec_get(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Null arg to get()\n");
+        return nil_obj();
+    }
+    obj_t *arg = args->arg;
+    if (TYPEOF(arg) != TYPE_INT || arg->intval < 0 || (size_t) arg->intval >= vec_len(obj)) {
+        return nil_obj();
+    }
+    return vec_get_at(obj, (size_t) arg->intval);
+}
+
+obj_t *vec_set(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL || args->next == NULL) {
+        printf("Null arg to set()\n");
+        return nil_obj();
+    }
+    obj_t *a = args->arg;
+    if (TYPEOF(a) != TYPE_INT) {
+        printf("Int offset required.\n");
+        return nil_obj();
+    }
+    if (a->intval < 0 || (size_t) a->intval >= vec_len(obj)) {
+        printf("Out of bounds\n");
+        return nil_obj();
+    }
+
+    obj_t *val = args->next->arg;
+    if (!vec_put(obj, (size_t) a->intval, val)) {
+        printf("Can't put %s in %s.\n", type_names[TYPEOF(val)], type_names[TYPEOF(obj)]);
+        return nil_obj();
+    }
+    return vec_get_at(obj, (size_t) a->intval);
+}
+
+static void float_op(float *dst, const float *a, const float *b, float s,
+                     size_t n, static_method_ident_t op) {
+    size_t i = 0;
+#ifdef HAVE_SIMD
+    if (n >= VEC_SIMD_MIN) {
+        i = have_avx2() ? float_op_avx2(dst, a, b, s, n, op) : float_op_sse2(dst, a, b, s, n, op);
+    }
+#endif
+    for (; i < n; i++) {
+        float y = b ? b[i] : s;
+        switch (op) {
+            case METHOD_ADD:
+                dst[i] = a[i] + y;
+                break;
+            case METHOD_SUB:
+                dst[i] = a[i] - y;
+                break;
+            case METHOD_MUL:
+                dst[i] = a[i] * y;
+                break;
+            default:
+                dst[i] = a[i] / y;
+                break;
+        }
+    }
+}
+
+// Return False on division by zero.
+static boolean int_op(int32_t *dst, const int32_t *a, const int32_t *b, int32_t s,
+                      size_t n, static_method_ident_t op) {
+    size_t i = 0;
+#ifdef HAVE_SIMD
+    if (n >= VEC_SIMD_MIN) {
+        i = have_avx2() ? int_op_avx2(dst, a, b, s, n, op) : int_op_sse2(dst, a, b, s, n, op);
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t x = (uint32_t) a[i];
+        int32_t y = b ? b[i] : s;
+        switch (op) {
+            case METHOD_ADD:
+                dst[i] = (int32_t) (x + (uint32_t) y);
+                break;
+            case METHOD_SUB:
+                dst[i] = (int32_t) (x - (uint32_t) y);
+                break;
+            case METHOD_MUL:
+                dst[i] = (int32_t) (x * (uint32_t) y);
+                break;
+            default:
+                if (y == 0) return False;
+                // INT32_MIN / -1 overflows; wrap it like everything else.
+                dst[i] = y == -1 ? (int32_t) (0u - x) : a[i] / y;
+                break;
+        }
+    }
+    return True;
+}
+
+static obj_t *vec_math(obj_t *obj, obj_varargs_t *args, static_method_ident_t op) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Argument missing\n");
+        return nil_obj();
+    }
+    obj_t *arg = args->arg;
+    size_t n = vec_len(obj);
+
+    obj_t *other = NULL;
+    int32_t int_s = 0;
+    float float_s = 0;
+    if (TYPEOF(arg) == TYPEOF(obj)) {
+        if (vec_len(arg) != n) {
+            printf("Arrays differ in length.\n");
+            return nil_obj();
+        }
+        other = arg;
+    } else if (!(TYPEOF(obj) == TYPE_FLOAT_ARRAY ? to_float32(arg, &float_s) : to_int32(arg, &int_s))) {
+        printf("Can't combine %s with %s.\n", type_names[TYPEOF(obj)], type_names[TYPEOF(arg)]);
+        return nil_obj();
+    }
+
+    // Dividing by a zero scalar is an error, as it is for plain numbers.
+    if (op == METHOD_DIV && other == NULL && int_s == 0 && float_s == 0) {
+        return error_obj(ERR_DIVISION_BY_ZERO);
+    }
+
+    obj_t *result = vec_obj(TYPEOF(obj), n);
+    if (TYPEOF(result) == TYPE_NIL) return result;
+    if (TYPEOF(obj) == TYPE_FLOAT_ARRAY) {
+        float_op(FLOATS(result), FLOATS(obj), other ? FLOATS(other) : NULL, float_s, n, op);
+    } else if (!int_op(INTS(result), INTS(obj), other ? INTS(other) : NULL, int_s, n, op)) {
+        return error_obj(ERR_DIVISION_BY_ZERO);
+    }
+    return result;
+}
+
+obj_t *vec_add(obj_t *obj, obj_varargs_t *args) {
+    return vec_math(obj, args, METHOD_ADD);
+}
+
+obj_t *vec_sub(obj_t *obj, obj_varargs_t *args) {
+    return vec_math(obj, args, METHOD_SUB);
+}
+
+obj_t *vec_mul(obj_t *obj, obj_varargs_t *args) {
+    return vec_math(obj, args, METHOD_MUL);
+}
+
+obj_t *vec_div(obj_t *obj, obj_varargs_t *args) {
+    return vec_math(obj, args, METHOD_DIV);
+}
+
+static obj_t *float_reduce(obj_t *obj, obj_t *other, static_method_ident_t op) {
+    size_t n = vec_len(obj);
+    const float *a = FLOATS(obj);
+    const float *b = other ? FLOATS(other) : NULL;
+
+    float acc = op == METHOD_MIN || op == METHOD_MAX ? a[0] : 0;
+    size_t i = 0;
+#ifdef HAVE_SIMD
+    if (n >= VEC_SIMD_MIN) {
+        float lanes[8];
+        size_t nlanes = have_avx2() ? 8 : 4;
+        i = nlanes == 8 ? float_reduce_avx2(a, b, n, op, lanes) : float_reduce_sse2(a, b, n, op, lanes);
+        for (size_t l = 0; l < nlanes; l++) acc = float_fold(acc, lanes[l], op);
+    }
+#endif
+    for (; i < n; i++) acc = float_fold(acc, b ? a[i] * b[i] : a[i], op);
+
+    return float_obj(acc);
+}
+
+static obj_t *int_reduce(obj_t *obj, obj_t *other, static_method_ident_t op) {
+    size_t n = vec_len(obj);
+    const int32_t *a = INTS(obj);
+    const int32_t *b = other ? INTS(other) : NULL;
+
+    int32_t acc = op == METHOD_MIN || op == METHOD_MAX ? a[0] : 0;
+    size_t i = 0;
+#ifdef HAVE_SIMD
+    if (n >= VEC_SIMD_MIN) {
+        int32_t lanes[8];
+        size_t nlanes = have_avx2() ? 8 : 4;
+        i = nlanes == 8 ? int_reduce_avx2(a, b, n, op, lanes) : int_reduce_sse2(a, n, op, lanes);
+        // Nothing was done if this CPU has no kernel for the op.
+        if (i == 0) nlanes = 0;
+        for (size_t l = 0; l < nlanes; l++) acc = int_fold(acc, lanes[l], op);
+    }
+#endif
+    for (; i < n; i++) {
+        acc = int_fold(acc, b ? (int32_t) ((uint32_t) a[i] * (uint32_t) b[i]) : a[i], op);
+    }
+
+    return int_obj(acc);
+}
+
+static obj_t *vec_reduce(obj_t *obj, obj_t *other, static_method_ident_t op) {
+    if (vec_len(obj) == 0) {
+        if (op == METHOD_MIN || op == METHOD_MAX) return nil_obj();
+        return TYPEOF(obj) == TYPE_FLOAT_ARRAY ? float_obj(0) : int_obj(0);
+    }
+    if (TYPEOF(obj) == TYPE_FLOAT_ARRAY) return float_reduce(obj, other, op);
+    return int_reduce(obj, other, op);
+}
+
+obj_t *vec_sum(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return vec_reduce(obj, NULL, METHOD_SUM);
+}
+
+obj_t *vec_min(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return vec_reduce(obj, NULL, METHOD_MIN);
+}
+
+obj_t *vec_max(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return vec_reduce(obj, NULL, METHOD_MAX);
+}
+
+obj_t *vec_dot(obj_t *obj, obj_varargs_t *args) {
+    if (args == NULL || args->arg == NULL) {
+        printf("Null arg to dot()\n");
+        return nil_obj();
+    }
+    obj_t *other = args->arg;
+    if (TYPEOF(other) != TYPEOF(obj) || vec_len(other) != vec_len(obj)) {
+        printf("%s of the same length required.\n", type_names[TYPEOF(obj)]);
+        return nil_obj();
+    }
+    return vec_reduce(obj, other, METHOD_DOT);
+}
+
+obj_t *vec_abs(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    size_t n = vec_len(obj);
+    obj_t *result = vec_obj(TYPEOF(obj), n);
+    if (TYPEOF(result) == TYPE_NIL) return result;
+    if (TYPEOF(obj) == TYPE_FLOAT_ARRAY) {
+        float *src = FLOATS(obj), *dst = FLOATS(result);
+        for (size_t i = 0; i < n; i++) dst[i] = src[i] < 0 ? -src[i] : src[i];
+    } else {
+        int32_t *src = INTS(obj), *dst = INTS(result);
+        for (size_t i = 0; i < n; i++) dst[i] = src[i] < 0 ? (int32_t) (0u - (uint32_t) src[i]) : src[i];
+    }
+    return result;
+}
+
+static obj_t *iter_next(obj_iter_t *iterable) {
+    switch (iterable->state) {
+        case ITER_NOT_STARTED:
+            iterable->index = 0;
+            iterable->state = ITER_ITERATING;
+            // Fall through to ITERATING.
+
+        case ITER_ITERATING:
+            if ((size_t) iterable->index >= vec_len(iterable->obj)) {
+                iterable->state = ITER_STOPPED;
+                return nil_obj();
+            }
+            return vec_get_at(iterable->obj, (size_t) iterable->index++);
+
+        case ITER_STOPPED:
+            return nil_obj();
+
+        default:
+            printf("Unexpected iteration state enum! %d\n", iterable->state);
+            return nil_obj();
+    }
+}
+
+obj_t *vec_iterator(obj_t *obj, obj_varargs_t *args) {
+    (void) args;
+
+    return iterator_obj(obj, iter_next);
+}
+
+static_method get_vec_static_method(static_method_ident_t method_id) {
+    switch (method_id) {
+        case METHOD_COPY:
+            return vec_copy;
+        case METHOD_LENGTH:
+            return vec_size;
+        case METHOD_GET:
+            return vec_get;
+        case METHOD_ADD:
+            return vec_add;
+        case METHOD_SUB:
+            return vec_sub;
+        case METHOD_MUL:
+            return vec_mul;
+        case METHOD_DIV:
+            return vec_div;
+        case METHOD_SUM:
+            return vec_sum;
+        case METHOD_MIN:
+            return vec_min;
+        case METHOD_MAX:
+            return vec_max;
+        case METHOD_DOT:
+            return vec_dot;
+        case METHOD_ABS:
+            return vec_abs;
+        case METHOD_ITERATOR:
+            return vec_iterator;
+        default:
+            return NULL;
+    }
+}
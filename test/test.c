@@ -9,6 +9,9 @@
 #include "test_list.h"
 #include "test_bytearray.h"
 #include "test_dict.h"
+#include "test_set.h"
+#include "test_vec.h"
+#include "test_iter.h"
 #include "test_lexer.h"
 #include "test_parser.h"
 #include "test_eval.h"
@@ -17,6 +20,9 @@
 #include "test_rand.h"
 #include "test_closure.h"
 #include "test_examples.h"
+#include "test_image.h"
+#include "util.h"
+#include "../inc/opt.h"
 
 void setUp(void) {
     mem_init('x');
@@ -38,13 +44,21 @@ int main(int argc, char **argv) {
     test_range();
     test_list();
     test_dict();
+    test_set();
+    test_vec();
+    test_iter();
     test_bytearray();
     test_hash();
     test_env();
     test_eval();
+    // Again, with the code run just as it was parsed.
+    eval_opt_level(0);
+    test_eval();
+    eval_opt_level(OPT_DEFAULT_LEVEL);
     test_rand();
     test_closure();
     test_examples();
+    test_image();
 
     UNITY_END();
 }
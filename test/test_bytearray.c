@@ -66,10 +66,19 @@ void test_barr_slice(void) {
     TEST_ASSERT_EQUAL('i', slice->bytearray->data[1]);
 }
 
+void test_barr_sort(void) {
+    obj_t *a = bytearray_obj(6, (uint8_t *) "\xff\x02zebra");
+    TEST_ASSERT_EQUAL_PTR(a, arr_sort(a, NULL));
+
+    uint8_t expected[6] = {0x02, 'b', 'e', 'r', 'z', 0xff};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, a->bytearray->data, 6);
+}
+
 void test_bytearray(void) {
     RUN_TEST(test_barr_new);
     RUN_TEST(test_barr_contains);
     RUN_TEST(test_barr_eq);
     RUN_TEST(test_barr_ne);
     RUN_TEST(test_barr_slice);
+    RUN_TEST(test_barr_sort);
 }
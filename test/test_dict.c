@@ -3,6 +3,8 @@
 #include "../inc/type.h"
 #include "../inc/dict.h"
 #include "../inc/str.h"
+#include "../inc/arr.h"
+#include "../inc/heap.h"
 
 void test_dict_init(void) {
     obj_t *d = dict_obj();
@@ -101,7 +103,8 @@ void test_dict_keys_are_copied_on_put(void) {
     obj_t *v = int_obj(42);
     dict_put(d, k, v);
 
-    k->bytearray->data[2] = 'p';
+    // Writes go through arr_set, which won't touch the shared copy in the dict.
+    arr_set(k, wrap_varargs(2, int_obj(2), byte_obj('p')));
 
     TEST_ASSERT_EQUAL_STRING("mop", bytearray_to_c_str(k->bytearray));
     TEST_ASSERT_EQUAL(42, dict_get(d, string_obj(c_str_to_bytearray("moo")))->intval);
@@ -213,6 +216,78 @@ void test_dict_resize(void) {
     TEST_ASSERT_NOT_EQUAL(DICT_INIT_BUCKETS, d->dict->buckets);
 }
 
+void test_dict_iterator(void) {
+    obj_t *d = dict_obj();
+    for (int i = 0; i < 1000; i++) {
+        dict_put(d, int_obj(i), int_obj(i * 2));
+    }
+    obj_iter_t *iter = dict_obj_iterator(d, NULL)->iterator;
+
+    // Stepping through the keys allocates nothing.
+    size_t free_before = get_heap_info()->bytes_free;
+    int seen[1000] = {0};
+    int count = 0;
+    for (obj_t *k = iter->next(iter); TYPEOF(k) != TYPE_NIL; k = iter->next(iter)) {
+        seen[k->intval]++;
+        count++;
+    }
+    TEST_ASSERT_EQUAL(free_before, get_heap_info()->bytes_free);
+
+    TEST_ASSERT_EQUAL(1000, count);
+    for (int i = 0; i < 1000; i++) TEST_ASSERT_EQUAL(1, seen[i]);
+}
+
+void test_dict_iterator_remove_current(void) {
+    obj_t *d = dict_obj();
+    for (int i = 0; i < 100; i++) {
+        dict_put(d, int_obj(i), int_obj(i));
+    }
+    obj_iter_t *iter = dict_obj_iterator(d, NULL)->iterator;
+
+    int count = 0;
+    for (obj_t *k = iter->next(iter); TYPEOF(k) != TYPE_NIL; k = iter->next(iter)) {
+        dict_remove(d, k);
+        count++;
+    }
+    TEST_ASSERT_EQUAL(100, count);
+    TEST_ASSERT_EQUAL(0, d->dict->nelems);
+}
+
+void test_dict_iterator_resumes_after_resize(void) {
+    obj_t *d = dict_obj();
+    for (int i = 0; i < DICT_INIT_BUCKETS; i++) {
+        dict_put(d, int_obj(i), int_obj(i));
+    }
+    obj_iter_t *iter = dict_obj_iterator(d, NULL)->iterator;
+
+    // Each key there from the start is seen once, however many resizes
+    // happen on the way, and whichever of the new ones are seen are seen once.
+    int seen[1000] = {0};
+    int next = DICT_INIT_BUCKETS;
+    for (obj_t *k = iter->next(iter); TYPEOF(k) != TYPE_NIL; k = iter->next(iter)) {
+        seen[k->intval]++;
+        for (int i = 0; i < 50 && next < 1000; i++, next++) {
+            dict_put(d, int_obj(next), int_obj(next));
+        }
+    }
+    TEST_ASSERT_NOT_EQUAL(DICT_INIT_BUCKETS, d->dict->buckets);
+    for (int i = 0; i < DICT_INIT_BUCKETS; i++) TEST_ASSERT_EQUAL(1, seen[i]);
+    for (int i = DICT_INIT_BUCKETS; i < 1000; i++) TEST_ASSERT_LESS_OR_EQUAL(1, seen[i]);
+
+    // Nor does removing the key it's on first.
+    int seen_again[3000] = {0};
+    iter = dict_obj_iterator(d, NULL)->iterator;
+    for (obj_t *k = iter->next(iter); TYPEOF(k) != TYPE_NIL; k = iter->next(iter)) {
+        seen_again[k->intval]++;
+        dict_remove(d, k);
+        for (int i = 0; i < 2 && next < 3000; i++, next++) {
+            dict_put(d, int_obj(next), int_obj(next));
+        }
+    }
+    for (int i = 0; i < 1000; i++) TEST_ASSERT_EQUAL(1, seen_again[i]);
+    for (int i = 1000; i < 3000; i++) TEST_ASSERT_LESS_OR_EQUAL(1, seen_again[i]);
+}
+
 void test_dict(void) {
     RUN_TEST(test_dict_init);
     RUN_TEST(test_dict_put);
@@ -223,4 +298,7 @@ void test_dict(void) {
     RUN_TEST(test_dict_remove);
     RUN_TEST(test_dict_contains);
     RUN_TEST(test_dict_resize);
+    RUN_TEST(test_dict_iterator);
+    RUN_TEST(test_dict_iterator_remove_current);
+    RUN_TEST(test_dict_iterator_resumes_after_resize);
 }
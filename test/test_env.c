@@ -4,6 +4,7 @@
 #include "../inc/mem.h"
 #include "../inc/str.h"
 #include "../inc/env.h"
+#include "../inc/heap.h"
 
 #define NAME(x) (c_str_to_bytearray(x))
 
@@ -13,6 +14,7 @@ typedef struct {
 } fake_ast_block_t;
 
 static gc_header_t *decl(obj_t *obj) {
+    obj = obj_unshared(obj);
     obj->hdr.flags |= F_ENV_DECLARATION;
     return (gc_header_t *) obj;
 }
@@ -41,6 +43,21 @@ void test_env_put_get() {
     TEST_ASSERT_EQUAL(42, found->intval);
 }
 
+void test_env_lookup_does_not_allocate() {
+    interp_t interp;
+    interp_init(&interp);
+
+    bytearray_t *name = NAME("ethel");
+    put_env(&interp, name, decl(int_obj(100000)));
+    enter_scope(&interp);
+
+    size_t free_before = get_heap_info()->bytes_free;
+    for (int i = 0; i < 100; ++i) {
+        TEST_ASSERT_EQUAL(100000, get_env(&interp, name)->intval);
+    }
+    TEST_ASSERT_EQUAL(free_before, get_heap_info()->bytes_free);
+}
+
 void test_env_put_del_get() {
     interp_t interp;
     interp_init(&interp);
@@ -168,11 +185,42 @@ void test_env_redefinition_error(void) {
     TEST_ASSERT_EQUAL(ERR_ENV_SYMBOL_REDEFINED, put_env(&interp, NAME("thing"), (gc_header_t *) float_obj(1.2)));
 }
 
+void test_env_deep_scopes(void) {
+    interp_t interp;
+    interp_init(&interp);
+
+    // Across several segments and back.
+    for (int i = 1; i <= 3 * ENV_SEGMENT_SIZE; ++i) {
+        TEST_ASSERT_EQUAL(ERR_NO_ERROR, enter_scope(&interp));
+        if (i == ENV_SEGMENT_SIZE) put_env(&interp, NAME("edge"), decl(int_obj(i)));
+    }
+    TEST_ASSERT_EQUAL(3 * ENV_SEGMENT_SIZE, interp.top);
+    TEST_ASSERT_EQUAL(ENV_SEGMENT_SIZE, get_env(&interp, NAME("edge"))->intval);
+
+    for (int i = 3 * ENV_SEGMENT_SIZE; i >= ENV_SEGMENT_SIZE; --i) {
+        TEST_ASSERT_EQUAL(ERR_NO_ERROR, leave_scope(&interp));
+    }
+    TEST_ASSERT_EQUAL(TYPE_UNDEF, TYPEOF(get_env(&interp, NAME("edge"))));
+    TEST_ASSERT_EQUAL(scope_at(&interp, interp.top), interp.env);
+
+    // The limit is set at run time.
+    interp.max_depth = ENV_SEGMENT_SIZE + 2;
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, enter_scope(&interp));
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, enter_scope(&interp));
+    TEST_ASSERT_EQUAL(ERR_ENV_MAX_DEPTH_EXCEEDED, enter_scope(&interp));
+
+    // A failed push is undone like any other.
+    env_t *env = scope_at(&interp, interp.top - 1);
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, leave_scope(&interp));
+    TEST_ASSERT_EQUAL(env, interp.env);
+}
 
 void test_env(void) {
     RUN_TEST(test_env_init);
     RUN_TEST(test_env_put_get);
+    RUN_TEST(test_env_lookup_does_not_allocate);
     RUN_TEST(test_env_put_del_get);
     RUN_TEST(test_env_scopes);
     RUN_TEST(test_env_redefinition_error);
+    RUN_TEST(test_env_deep_scopes);
 }
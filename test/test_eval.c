@@ -1,10 +1,14 @@
+#include <stdlib.h>
 #include "util.h"
 #include "unity/unity.h"
 #include "test_eval.h"
 #include "../inc/type.h"
 #include "../inc/mem.h"
+#include "../inc/heap.h"
 #include "../inc/str.h"
+#include "../inc/list.h"
 #include "../inc/rand.h"
+#include "../inc/ptr.h"
 
 obj_t *evaluate(const char *program) {
     eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
@@ -195,6 +199,35 @@ void test_eval_for_loop_range_step(void) {
     TEST_ASSERT_EQUAL(15, obj->intval);
 }
 
+void test_eval_for_loop_range_counted(void) {
+    // Counting down, skipping and stopping, with a fresh binding each time.
+    char *program = "{ var n = 0                          \n"
+                    "  val fs = list { }                  \n"
+                    "  for i in 10..1 step 2 {            \n"
+                    "    // 10, 8, 6, 4                   \n"
+                    "    if i == 2 then break             \n"
+                    "    val j = i                        \n"
+                    "    fs.append(fn() { j })            \n"
+                    "    if i == 8 then continue          \n"
+                    "    n = n + i                        \n"
+                    "  }                                  \n"
+                    "  n * 100 + fs[0]() + fs[1]()        \n"
+                    "}";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL(TYPE_INT, TYPEOF(obj));
+    TEST_ASSERT_EQUAL(2018, obj->intval);
+
+    // The loop's value is its body's last.
+    obj = evaluate("for i in 5..-5 step 5 { i * 2 }");
+    TEST_ASSERT_EQUAL(TYPE_INT, TYPEOF(obj));
+    TEST_ASSERT_EQUAL(-10, obj->intval);
+
+    // Bounds must be Ints.
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    eval_program("for i in 1..2.5 { i }", result);
+    TEST_ASSERT_EQUAL(ERR_TYPE_INT_REQUIRED, result->err);
+}
+
 void test_eval_for_loop_list(void) {
     char *program = "{ val l = list { 1, 3, 5 }   \n"
                     "  var n = 0                  \n"
@@ -493,6 +526,387 @@ void test_eval_truthiness(void) {
     TEST_ASSERT_EQUAL(1, obj->intval);
 }
 
+void test_eval_interned_bindings(void) {
+    // val and var bindings of the same singleton must not share flags.
+    char *program = "{ val a = true   \n"
+                    "  var b = true   \n"
+                    "  b = false      \n"
+                    "  var c = false  \n"
+                    "  c = 1          \n"
+                    "  a and not b and c == 1 }";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL(TYPE_BOOLEAN, TYPEOF(obj));
+    TEST_ASSERT_EQUAL(True, obj->boolval);
+
+    TEST_ASSERT_EQUAL(ERR_ENV_SYMBOL_REDEFINED, check_error("{ var a = true \n val b = true \n b = false }"));
+
+    // Nil can be bound like anything else.
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(evaluate("{ val a = nil \n a }")));
+}
+
+void test_eval_for_loop_shadows(void) {
+    char *program = "{ var i = 100                 \n"
+                    "  for i in 1..3 { i }           \n"
+                    "  i                             \n"
+                    "}";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL(TYPE_INT, TYPEOF(obj));
+    TEST_ASSERT_EQUAL(100, obj->intval);
+}
+
+void test_eval_string_literal_copy_on_write(void) {
+    // Each evaluation of the literal sees the original text.
+    char *program = "{ var r = \"\"                  \n"
+                    "  for i in 1..3 {                 \n"
+                    "    val s = \"abc\"             \n"
+                    "    r = r + s                     \n"
+                    "    s[0] = 'x'                    \n"
+                    "  }                               \n"
+                    "  r                               \n"
+                    "}";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL(TYPE_STRING, TYPEOF(obj));
+    TEST_ASSERT_EQUAL_STRING("abcabcabc", bytearray_to_c_str(obj->bytearray));
+
+    obj = evaluate("{ val a = \"x\" \n val b = a + \"y\" \n a }");
+    TEST_ASSERT_EQUAL_STRING("x", bytearray_to_c_str(obj->bytearray));
+
+    // Until then, every evaluation shares the literal's bytes.
+    obj = evaluate("{ val f = fn() { \"abc\" } \n list { f(), f() } }");
+    obj_list_element_t *elem = obj->list->elems;
+    TEST_ASSERT_EQUAL_PTR(elem->node->bytearray, elem->next->node->bytearray);
+}
+
+void test_eval_string_literals_bounded(void) {
+    // Too long to intern, so it goes with its code, and each string is a copy.
+    const char *head = "{ val f = fn() { \"";
+    const char *tail = "\" } \n list { f(), f() } }";
+    size_t len = LITERAL_INTERN_MAX + 1;
+    char *program = malloc(c_str_len(head) + len + c_str_len(tail) + 1);
+    TEST_ASSERT_NOT_NULL(program);
+    c_str_cp(program, head);
+    mem_set(program + c_str_len(head), 'a', len);
+    c_str_cp(program + c_str_len(head) + len, tail);
+
+    obj_t *obj = evaluate(program);
+    free(program);
+    obj_list_element_t *elem = obj->list->elems;
+    TEST_ASSERT_EQUAL(len, elem->node->bytearray->size);
+    TEST_ASSERT_EQUAL('a', elem->next->node->bytearray->data[len - 1]);
+    TEST_ASSERT_FALSE(bytearray_is_interned(elem->node->bytearray));
+    TEST_ASSERT_NOT_EQUAL(elem->node->bytearray, elem->next->node->bytearray);
+}
+
+void test_eval_string_building(void) {
+    // Quadratic copying would need far more than the whole heap.
+    char *program = "{ val line = \"0123456789012345678901234567890123456789\" \n"
+                    "  var s = \"\"                                             \n"
+                    "  val b = \"\".builder()                                   \n"
+                    "  for i in 1..1000 {                                         \n"
+                    "    s = s + line + line                                      \n"
+                    "    b.append(line).append(line)                              \n"
+                    "  }                                                          \n"
+                    "  s.length() + b.toString().length()                         \n"
+                    "}";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL(TYPE_INT, TYPEOF(obj));
+    TEST_ASSERT_EQUAL(160000, obj->intval);
+}
+
+void test_eval_string_builder(void) {
+    obj_t *obj = evaluate("{ val b = \"n=\".builder() \n b.append(4).append(2) \n b.toString() }");
+    TEST_ASSERT_EQUAL(TYPE_STRING, TYPEOF(obj));
+    TEST_ASSERT_EQUAL_STRING("n=42", bytearray_to_c_str(obj->bytearray));
+
+    // A snapshot keeps its contents, and so does the string the builder started from.
+    obj = evaluate("{ val s = \"a\" \n val b = s.builder() \n b.append(\"b\") \n"
+                   "  val t = b.toString() \n b.append(\"c\") \n s + t + b.toString() }");
+    TEST_ASSERT_EQUAL_STRING("aababc", bytearray_to_c_str(obj->bytearray));
+
+    // Strings themselves have no append().
+    TEST_ASSERT_EQUAL(ERR_NO_SUCH_METHOD, check_error("{ val s = \"a\" \n s.append(\"b\") }"));
+}
+
+void test_eval_sort(void) {
+    obj_t *obj = evaluate("{ val l = list { 3, 1, 2 } \n l.sort() \n l[0] * 100 + l[1] * 10 + l[2] }");
+    TEST_ASSERT_EQUAL(123, obj->intval);
+
+    obj = evaluate("{ val l = list { 3, 1, 2 } \n l.sort(fn(a, b) { a > b }) \n l[0] }");
+    TEST_ASSERT_EQUAL(3, obj->intval);
+
+    // Stable, with a comparator that only looks at part of each element.
+    char *program = "{ val l = list { list { 1, \"b\" }, list { 0, \"x\" }, list { 1, \"a\" } } \n"
+                    "  l.sort(fn(p, q) { p[0] < q[0] })              \n"
+                    "  l[1][1] + l[2][1]                             \n"
+                    "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL_STRING("ba", bytearray_to_c_str(obj->bytearray));
+
+    // Sorting a literal's string doesn't change the literal.
+    program = "{ var r = \"\"                 \n"
+              "  for i in 1..2 {                \n"
+              "    val s = \"cab\"            \n"
+              "    r = r + s.sort()             \n"
+              "  }                              \n"
+              "  r                              \n"
+              "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL_STRING("abcabc", bytearray_to_c_str(obj->bytearray));
+}
+
+void test_eval_set(void) {
+    obj_t *obj = evaluate("{ val s = set { 1, 2, 2, 3 } \n s.length() }");
+    TEST_ASSERT_EQUAL(3, obj->intval);
+
+    obj = evaluate("{ val s = set { \"a\", \"b\" } \n s.add(\"c\") \n \"c\" in s and not (\"d\" in s) }");
+    TEST_ASSERT_TRUE(obj->boolval);
+
+    char *program = "{ val a = set { 1, 2, 3, 4 }                   \n"
+                    "  val b = set { 3, 4, 5 }                      \n"
+                    "  val c = a.difference(list { 1, 1, 5 })      \n"
+                    "  (a | b).length() * 100 + (a & b).length() * 10 + c.length() \n"
+                    "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL(523, obj->intval);
+
+    program = "{ var sum = 0                   \n"
+              "  for x in set { 10, 20, 10 } { \n"
+              "    sum = sum + x               \n"
+              "  }                             \n"
+              "  sum                           \n"
+              "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL(30, obj->intval);
+
+    obj = evaluate("set { 1, 2 } == set { 2, 1 }");
+    TEST_ASSERT_TRUE(obj->boolval);
+}
+
+void test_eval_typed_arrays(void) {
+    char *program = "{ val a = floats(1..100)            \n"
+                    "  val b = a * 2.0 + a                \n"
+                    "  b[0] = 0.5                         \n"
+                    "  b.sum()                            \n"
+                    "}";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL_FLOAT(15147.5f, obj->floatval);
+
+    obj = evaluate("{ val a = ints(list { 3, 4 }) \n a.dot(a) }");
+    TEST_ASSERT_EQUAL(25, obj->intval);
+
+    obj = evaluate("{ var n = 0 \n for x in ints(5) { n = n + 1 } \n n }");
+    TEST_ASSERT_EQUAL(5, obj->intval);
+
+    obj = evaluate("sqrt(floats(list { 4, 9 })).max()");
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, obj->floatval);
+}
+
+void test_eval_math_builtins(void) {
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, evaluate("sqrt(9)")->floatval);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, evaluate("exp(0.0)")->floatval);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, evaluate("ln(1)")->floatval);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, evaluate("log(100)")->floatval);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, evaluate("sin(0)")->floatval);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, evaluate("cos(0)")->floatval);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, evaluate("tan(0)")->floatval);
+}
+
+void test_eval_pipelines(void) {
+    obj_t *obj = evaluate("(1..100).filter(fn(x) { x % 2 == 0 }).map(fn(x) { x * x }).take(3).toList()");
+    TEST_ASSERT_EQUAL(TYPE_LIST, TYPEOF(obj));
+    TEST_ASSERT_EQUAL(3, list_len(obj, NULL)->intval);
+    TEST_ASSERT_EQUAL(36, list_get(obj, wrap_varargs(1, int_obj(2)))->intval);
+
+    obj = evaluate("(1..10).reduce(fn(acc, x) { acc * x }, 1)");
+    TEST_ASSERT_EQUAL(3628800, obj->intval);
+
+    obj = evaluate("{ val l = list { 1.5, 2.5, 3 } \n l.map(fn(x) { x * 2 }).sum() }");
+    TEST_ASSERT_EQUAL_FLOAT(14.0f, obj->floatval);
+
+    obj = evaluate("\"hello\".filter(fn(c) { c == 'l' }).count()");
+    TEST_ASSERT_EQUAL(2, obj->intval);
+
+    char *program = "{ var total = 0                                     \n"
+                    "  for p in (10..20).zip(list { 1, 2, 3 }).enumerate() { \n"
+                    "    total = total + p[0] + p[1][0] * p[1][1]          \n"
+                    "  }                                                   \n"
+                    "  total                                               \n"
+                    "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL(3 + 10 + 22 + 36, obj->intval);
+}
+
+void test_eval_callback_errors(void) {
+    // A function that fails fails the method that called it.
+    TEST_ASSERT_EQUAL(ERR_ENV_SYMBOL_UNDEFINED,
+                      check_error("{ val l = list { 1, 2 } \n l.map(fn(x) { x + undefined_name }).toList() }"));
+    TEST_ASSERT_EQUAL(ERR_DIVISION_BY_ZERO, check_error("(1..5).filter(fn(x) { x / 0 }).count()"));
+    TEST_ASSERT_EQUAL(ERR_DIVISION_BY_ZERO, check_error("(1..5).map(fn(x) { x / 0 }).sum()"));
+    TEST_ASSERT_EQUAL(ERR_DIVISION_BY_ZERO, check_error("(1..5).reduce(fn(a, x) { a / 0 })"));
+    TEST_ASSERT_EQUAL(ERR_DIVISION_BY_ZERO, check_error("ints((1..5).map(fn(x) { x / 0 }))"));
+    TEST_ASSERT_EQUAL(ERR_DIVISION_BY_ZERO, check_error("for x in (1..5).map(fn(x) { x / 0 }) { x }"));
+    TEST_ASSERT_EQUAL(ERR_ENV_SYMBOL_UNDEFINED,
+                      check_error("{ val l = list { 3, 1, 2 } \n l.sort(fn(a, b) { a < undefined_name }) }"));
+}
+
+void test_eval_pipelines_in_place(void) {
+    // Each stage's calls share one scope, so a long chain takes no more heap than a short one.
+    size_t used_before = get_heap_info()->bytes_used;
+    obj_t *obj = evaluate("(1..10).filter(fn(x) { x % 2 == 0 }).map(fn(x) { x * 2 }).count()");
+    TEST_ASSERT_EQUAL(5, obj->intval);
+    size_t used_short = get_heap_info()->bytes_used - used_before;
+
+    used_before = get_heap_info()->bytes_used;
+    obj = evaluate("(1..30000).filter(fn(x) { x % 2 == 0 }).map(fn(x) { x * 2 }).count()");
+    TEST_ASSERT_EQUAL(15000, obj->intval);
+    TEST_ASSERT_EQUAL(used_short, get_heap_info()->bytes_used - used_before);
+
+    used_before = get_heap_info()->bytes_used;
+    obj = evaluate("(1..10).reduce(fn(a, x) { x })");
+    TEST_ASSERT_EQUAL(10, obj->intval);
+    used_short = get_heap_info()->bytes_used - used_before;
+
+    used_before = get_heap_info()->bytes_used;
+    obj = evaluate("(1..30000).reduce(fn(a, x) { x })");
+    TEST_ASSERT_EQUAL(30000, obj->intval);
+    TEST_ASSERT_EQUAL(used_short, get_heap_info()->bytes_used - used_before);
+
+    // A closure that keeps the scope gets a new one next time.
+    obj = evaluate("{ val fs = (1..3).map(fn(x) { fn() { x } }).toList() \n fs[0]() + fs[2]() }");
+    TEST_ASSERT_EQUAL(4, obj->intval);
+}
+
+void test_eval_memo(void) {
+    // Far too slow without the memo.
+    char *program = "{ val fib = memo(fn(x) {        \n"
+                    "    if x <= 1 then return x     \n"
+                    "    fib(x - 1) + fib(x - 2)     \n"
+                    "  })                            \n"
+                    "  fib(22)                       \n"
+                    "}";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL(17711, obj->intval);
+
+    // Keeps the two most recently used results.
+    program = "{ var calls = 0                                         \n"
+              "  val sq = memo(fn(x) { calls = calls + 1 \n x * x }, 2) \n"
+              "  sq(1) \n sq(2) \n sq(1) \n sq(3) \n sq(2) \n sq(1)           \n"
+              "  calls                                                 \n"
+              "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL(5, obj->intval);
+
+    // Keyed on all the args. Args that can't be keys aren't remembered.
+    program = "{ var calls = 0                                             \n"
+              "  val f = memo(fn(a, b) { calls = calls + 1 \n a.length() + b }) \n"
+              "  f(\"ab\", 1) + f(\"ab\", 1) + f(\"ab\", 2)                      \n"
+              "  f(list { 1 }, 1) + f(list { 1 }, 1)                         \n"
+              "  calls                                                     \n"
+              "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL(4, obj->intval);
+}
+
+void test_eval_tail_calls(void) {
+    // Much deeper than the scope stack, which holds about 25 calls.
+    char *program = "{ val sum = fn(n, acc) {                   \n"
+                    "    if n == 0 then return acc              \n"
+                    "    sum(n - 1, acc + n)                    \n"
+                    "  }                                        \n"
+                    "  sum(5000, 0)                             \n"
+                    "}";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL(12502500, obj->intval);
+
+    program = "{ var is_even = nil                                         \n"
+              "  val is_odd = fn(n) { if n == 0 then false else is_even(n - 1) } \n"
+              "  is_even = fn(n) { if n == 0 then true else is_odd(n - 1) }      \n"
+              "  is_even(1001)                                             \n"
+              "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL(TYPE_BOOLEAN, TYPEOF(obj));
+    TEST_ASSERT_FALSE(obj->boolval);
+
+    // A closure keeps the scope of the call that made it.
+    program = "{ val loop = fn(n, f) {                                      \n"
+              "    if n == 0 then return f()                                \n"
+              "    loop(n - 1, if n == 3 then fn() { n } else f)            \n"
+              "  }                                                          \n"
+              "  loop(5, fn() { -1 })                                       \n"
+              "}";
+    obj = evaluate(program);
+    TEST_ASSERT_EQUAL(3, obj->intval);
+}
+
+void test_eval_tail_calls_in_place(void) {
+    // Each call rebinds its args where the one it replaces had them, so
+    // however deep the loop goes, it takes no more heap than a short one.
+    size_t used_before = get_heap_info()->bytes_used;
+    obj_t *obj = evaluate("{ val count = fn(n, k) { if n == 0 then return k \n count(n - 1, k) } \n count(10, 7) }");
+    TEST_ASSERT_EQUAL(7, obj->intval);
+    size_t used_short = get_heap_info()->bytes_used - used_before;
+
+    used_before = get_heap_info()->bytes_used;
+    obj = evaluate("{ val count = fn(n, k) { if n == 0 then return k \n count(n - 1, k) } \n count(60000, 7) }");
+    TEST_ASSERT_EQUAL(7, obj->intval);
+    TEST_ASSERT_EQUAL(used_short, get_heap_info()->bytes_used - used_before);
+
+    // Past the int cache, only the ints themselves are new.
+    obj = evaluate("{ val sum = fn(n, acc) {                  \n"
+                   "    if n == 0 then return acc             \n"
+                   "    sum(n - 1, acc + 1)                   \n"
+                   "  }                                       \n"
+                   "  sum(100000, 0)                          \n"
+                   "}");
+    TEST_ASSERT_EQUAL(100000, obj->intval);
+}
+
+void test_eval_block_scopes_reused(void) {
+    // A block that declares nothing leaves its scope for the next one.
+    size_t used_before = get_heap_info()->bytes_used;
+    obj_t *obj = evaluate("{ val count = fn(n, k) { if n == 0 then return k \n { k } \n count(n - 1, k) } \n count(10000, 7) }");
+    TEST_ASSERT_EQUAL(7, obj->intval);
+    size_t used_short = get_heap_info()->bytes_used - used_before;
+
+    used_before = get_heap_info()->bytes_used;
+    obj = evaluate("{ val count = fn(n, k) { if n == 0 then return k \n { k } \n count(n - 1, k) } \n count(60000, 7) }");
+    TEST_ASSERT_EQUAL(7, obj->intval);
+    TEST_ASSERT_EQUAL(used_short, get_heap_info()->bytes_used - used_before);
+}
+
+void test_eval_out_of_memory(void) {
+    // Every int past the cache is new, so these run the heap out.
+    TEST_ASSERT_EQUAL(ERR_OUT_OF_MEMORY, check_error("{ val loop = fn(n, acc) {        \n"
+                                                     "    if n == 0 then return acc      \n"
+                                                     "    loop(n - 1, acc + 1)           \n"
+                                                     "  }                                \n"
+                                                     "  loop(300000, 0)                  \n"
+                                                     "}"));
+    TEST_ASSERT_TRUE(heap_exhausted());
+
+    mem_init('x');
+    TEST_ASSERT_FALSE(heap_exhausted());
+    TEST_ASSERT_EQUAL(ERR_OUT_OF_MEMORY, check_error("{ var x = 100000 \n while true { x = x + 1 } }"));
+}
+
+void test_eval_deep_recursion(void) {
+    // Not a tail call, so each call keeps its scopes.
+    char *program = "{ val depth = fn(n) {                      \n"
+                    "    if n == 0 then return 0                \n"
+                    "    1 + depth(n - 1)                       \n"
+                    "  }                                        \n"
+                    "  depth(1000)                              \n"
+                    "}";
+    obj_t *obj = evaluate(program);
+    TEST_ASSERT_EQUAL(1000, obj->intval);
+
+    // Past the limit is an error, not a crash.
+    program = "{ val forever = fn(n) { 1 + forever(n) } \n forever(0) }";
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    eval_program(program, result);
+    TEST_ASSERT_EQUAL(ERR_ENV_MAX_DEPTH_EXCEEDED, result->err);
+}
+
 void test_eval_numeric_comparison(void) {
     char *program = "if 5 < 3.1 then val x = 2 else val x = if 5>= 3 then 42 else -1";
 
@@ -1448,8 +1862,266 @@ void test_eval_iterable_random_choice() {
     TEST_ASSERT_EQUAL(4, result->obj->intval);
 }
 
+void test_eval_binop_operand_kinds(void) {
+    // One + sees Ints, then Floats, then Strings, then Ints again.
+    obj_t *obj = evaluate("{ val add = fn(a, b) { a + b }\n"
+                          "  list { add(1, 2), add(1.5, 2.5), add(\"a\", \"b\"), add(3, 4) } }");
+    obj_list_element_t *elem = obj->list->elems;
+    TEST_ASSERT_EQUAL(3, elem->node->intval);
+    elem = elem->next;
+    TEST_ASSERT_EQUAL_FLOAT(4.0, elem->node->floatval);
+    elem = elem->next;
+    TEST_ASSERT_EQUAL_STRING("ab", bytearray_to_c_str(elem->node->bytearray));
+    elem = elem->next;
+    TEST_ASSERT_EQUAL(7, elem->node->intval);
+
+    // Division by zero still fails after the Ints before it.
+    obj = evaluate("{ val div = fn(a, b) { a / b }\n"
+                   "  div(6, 3)\n"
+                   "  div(1, 0) }");
+    TEST_ASSERT_EQUAL(TYPE_ERROR, TYPEOF(obj));
+
+    obj = evaluate("{ val a = arr(4)\n"
+                   "  a[1] = 7\n"
+                   "  val get = fn(i) { a[i] }\n"
+                   "  list { get(1), get(9), get(0) } }");
+    elem = obj->list->elems;
+    TEST_ASSERT_EQUAL(7, elem->node->byteval);
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(elem->next->node));
+    TEST_ASSERT_EQUAL(0, elem->next->next->node->byteval);
+
+    // Comparisons keep NaN's answers.
+    TEST_ASSERT_EQUAL(True, evaluate("{ val le = fn(a, b) { a <= b }\n"
+                                     "  le(1.5, 2.5)\n"
+                                     "  le(sqrt(-1.5), 2.5) }")->boolval);
+}
+
+void test_eval_typed_decl(void) {
+    obj_t *obj = evaluate("{ val a: int = 3 \n var b: float = a \n b = b + 1 \n b }");
+    TEST_ASSERT_EQUAL(TYPE_FLOAT, TYPEOF(obj));
+    TEST_ASSERT_EQUAL_FLOAT(4.0, obj->floatval);
+
+    // What's read from a var isn't changed by writing to it after.
+    obj = evaluate("{ var n: int = 70000        \n"
+                   "  val l = list { n }        \n"
+                   "  n = n + 1                 \n"
+                   "  l.append(n)               \n"
+                   "  for i in 70000..70001 {   \n"
+                   "    l.append(i)             \n"
+                   "    n = n * 2               \n"
+                   "  }                         \n"
+                   "  val f = fn() { n }        \n"
+                   "  n = 5                     \n"
+                   "  l.append(f())             \n"
+                   "  l }");
+    int want[] = {70000, 70001, 70000, 70001, 5};
+    obj_list_element_t *elem = obj->list->elems;
+    for (int i = 0; i < 5; i++, elem = elem->next) {
+        TEST_ASSERT_EQUAL(want[i], elem->node->intval);
+    }
+
+    TEST_ASSERT_EQUAL(ERR_EVAL_TYPE_ERROR, check_error("val a: int = 1.5"));
+    TEST_ASSERT_EQUAL(ERR_EVAL_TYPE_ERROR, check_error("{ var s: string = \"a\" \n s = 1 }"));
+    TEST_ASSERT_EQUAL(ERR_EVAL_TYPE_ERROR, check_error("{ var n: int = 1 \n n = n + 0.5 }"));
+    TEST_ASSERT_EQUAL(ERR_ENV_SYMBOL_REDEFINED, check_error("{ val n: int = 1 \n n = 2 }"));
+    TEST_ASSERT_NOT_EQUAL(ERR_NO_ERROR, check_error("val a: nope = 1"));
+}
+
+void test_eval_typed_fn_args(void) {
+    obj_t *obj = evaluate("{ val f = fn(a: int, b: float, c) { a * b } \n f(3, 2, nil) }");
+    TEST_ASSERT_EQUAL(TYPE_FLOAT, TYPEOF(obj));
+    TEST_ASSERT_EQUAL_FLOAT(6.0, obj->floatval);
+
+    TEST_ASSERT_EQUAL(ERR_EVAL_TYPE_ERROR, check_error("{ val f = fn(a: int) { a } \n f(\"a\") }"));
+
+    // Checked for each call in a loop of tail calls, too.
+    TEST_ASSERT_EQUAL(ERR_EVAL_TYPE_ERROR,
+                      check_error("{ val f = fn(n: int) { if n > 0 then return f(n - 1) else return f(1.5) } \n f(3) }"));
+}
+
+void test_eval_typed_kernel(void) {
+    // The same answers, and errors, as without the types.
+    char *program = "{ val k = fn(n: int) {                \n"
+                    "    var s: int = 0                     \n"
+                    "    var x: float = 1.5                 \n"
+                    "    var i: int = 0                     \n"
+                    "    while i < n {                      \n"
+                    "      s = s + (i * 7 % 5) - (i >> 1)   \n"
+                    "      x = x * 0.5 + i / 2              \n"
+                    "      i = i + 1                        \n"
+                    "    }                                  \n"
+                    "    if x > 10.5 then s else -s         \n"
+                    "  }                                    \n"
+                    "  k(100) }";
+    TEST_ASSERT_EQUAL(-2250, evaluate(program)->intval);
+    TEST_ASSERT_EQUAL(-2, evaluate("{ val k = fn(n: int) { var s: int = 2 \n s = s - n \n s } \n k(4) }")->intval);
+    TEST_ASSERT_EQUAL(TYPE_ERROR, TYPEOF(evaluate("{ var a: int = 1 \n var b: int = 0 \n a / b }")));
+    // A Float var can't take the Error.
+    TEST_ASSERT_EQUAL(ERR_EVAL_TYPE_ERROR, check_error("{ var a: float = 1 \n a = a / 0 }"));
+}
+
+void test_eval_record(void) {
+    char *decl = "type point = data { \n"
+                 "  val x: int        \n"
+                 "  var y: float      \n"
+                 "  var tag           \n"
+                 "}                   \n";
+    char program[512];
+
+    snprintf(program, sizeof(program), "{ %s val p = point(1, 2, \"a\") \n p.x + p.y }", decl);
+    TEST_ASSERT_EQUAL_FLOAT(3.0, evaluate(program)->floatval);
+
+    snprintf(program, sizeof(program), "{ %s val p = point(1, 2, 3) \n p.tag = \"b\" \n p.y = p.x + 4 \n p.y }", decl);
+    TEST_ASSERT_EQUAL_FLOAT(5.0, evaluate(program)->floatval);
+
+    snprintf(program, sizeof(program), "{ %s typeof(point(1, 2, 3)) }", decl);
+    TEST_ASSERT_EQUAL_STRING("point", bytearray_to_c_str(evaluate(program)->bytearray));
+
+    // The same field at different slots, from the same code.
+    char *two = "{ type a = data { \n val x \n val y \n } \n"
+                "  type b = data { \n val y \n } \n"
+                "  val f = fn(r) { r.y } \n"
+                "  var s = 0 \n"
+                "  for i in 1..3 { s = s + f(a(0, i)) * 10 + f(b(i)) } \n"
+                "  s }";
+    TEST_ASSERT_EQUAL(66, evaluate(two)->intval);
+
+    // Fields can share a line.
+    obj_t *obj = evaluate("{ type point = data { val x: int  var y } \n val p = point(1, 2) \n p.y = 5 \n p.x + p.y }");
+    TEST_ASSERT_EQUAL(6, obj->intval);
+}
+
+void test_eval_record_equality(void) {
+    char *decl = "type point = data { val x \n val y } \n"
+                 "type pair = data { val x \n val y } \n";
+    char program[512];
+
+    snprintf(program, sizeof(program), "{ %s point(1, 2) == point(1, 2) }", decl);
+    TEST_ASSERT_TRUE(evaluate(program)->boolval);
+    snprintf(program, sizeof(program), "{ %s point(1, 2) != point(1, 3) }", decl);
+    TEST_ASSERT_TRUE(evaluate(program)->boolval);
+    snprintf(program, sizeof(program), "{ %s point(1, \"a\") == point(1, \"a\") }", decl);
+    TEST_ASSERT_TRUE(evaluate(program)->boolval);
+
+    // Same fields, different types.
+    snprintf(program, sizeof(program), "{ %s point(1, 2) == pair(1, 2) }", decl);
+    TEST_ASSERT_FALSE(evaluate(program)->boolval);
+
+    // Records make dict keys and set elements, by value.
+    snprintf(program, sizeof(program),
+             "{ %s val d = dict { point(1, 2) => \"a\", pair(1, 2) => \"b\" } \n d[point(1, 2)] + d[pair(1, 2)] }",
+             decl);
+    TEST_ASSERT_EQUAL_STRING("ab", bytearray_to_c_str(evaluate(program)->bytearray));
+    snprintf(program, sizeof(program), "{ %s val s = set { point(1, 2), point(1, 2), point(2, 1) } \n s.length() }", decl);
+    TEST_ASSERT_EQUAL(2, evaluate(program)->intval);
+    snprintf(program, sizeof(program), "{ %s point(1, 2).hash() == point(1, 2).hash() }", decl);
+    TEST_ASSERT_TRUE(evaluate(program)->boolval);
+
+    // Not if a field can't be a key.
+    snprintf(program, sizeof(program), "{ %s dict { point(1, list { 2 }) => 1 } }", decl);
+    TEST_ASSERT_NOT_EQUAL(ERR_NO_ERROR, check_error(program));
+}
+
+void test_eval_record_errors(void) {
+    char *decl = "type point = data { \n"
+                 "  val x: int        \n"
+                 "  var y: float      \n"
+                 "}                   \n";
+    char program[512];
+
+    snprintf(program, sizeof(program), "{ %s point(1) }", decl);
+    TEST_ASSERT_EQUAL(ERR_WRONG_ARG_COUNT, check_error(program));
+    snprintf(program, sizeof(program), "{ %s point(1, 2, 3) }", decl);
+    TEST_ASSERT_EQUAL(ERR_WRONG_ARG_COUNT, check_error(program));
+    snprintf(program, sizeof(program), "{ %s point(1.5, 2) }", decl);
+    TEST_ASSERT_EQUAL(ERR_EVAL_TYPE_ERROR, check_error(program));
+    snprintf(program, sizeof(program), "{ %s val p = point(1, 2) \n p.x = 3 }", decl);
+    TEST_ASSERT_EQUAL(ERR_LHS_NOT_ASSIGNABLE, check_error(program));
+    snprintf(program, sizeof(program), "{ %s val p = point(1, 2) \n p.y = \"s\" }", decl);
+    TEST_ASSERT_EQUAL(ERR_EVAL_TYPE_ERROR, check_error(program));
+    snprintf(program, sizeof(program), "{ %s val p = point(1, 2) \n p.z }", decl);
+    TEST_ASSERT_EQUAL(ERR_NO_SUCH_FIELD, check_error(program));
+    TEST_ASSERT_EQUAL(ERR_NO_SUCH_FIELD, check_error("{ val d = dict { \"x\" => 1 } \n d.x }"));
+    TEST_ASSERT_EQUAL(ERR_ENV_SYMBOL_REDEFINED, check_error("type t = data { \n val x \n var x \n }"));
+}
+
+void test_eval_print(void) {
+    char *decl = "type point = data { \n val x \n } \n";
+    char program[256];
+
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, check_error("{ val b = arr(3) \n print(b) }"));
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, check_error("print(1, 2.5, 'x', \"s\", true, nil)"));
+    snprintf(program, sizeof(program), "{ %s print(point, point(1)) }", decl);
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, check_error(program));
+}
+
+void test_eval_match(void) {
+    char *name = "{ val name = fn(op) { \n"
+                 "    match op { \n"
+                 "      0 => \"nop\" \n"
+                 "      1 => \"push\" \n"
+                 "      2 => \"pop\" \n"
+                 "      -1 => \"halt\" \n"
+                 "      1000 => \"far\" \n"
+                 "      'x' => \"byte\" \n"
+                 "      \"add\" => \"str\" \n"
+                 "      true => \"yes\" \n"
+                 "      if op == 7 => \"seven\" \n"
+                 "      else => \"other\" \n"
+                 "    } \n"
+                 "  } \n"
+                 "  var s = \"\" \n"
+                 "  for op in list { 0, 1, 2, -1, 1000, 'x', \"add\", true, 7, 8, 1.5 } { s = s + name(op) + \" \" } \n"
+                 "  s }";
+    TEST_ASSERT_EQUAL_STRING("nop push pop halt far byte str yes seven other other ",
+                             bytearray_to_c_str(evaluate(name)->bytearray));
+
+    // Literals only match their own type, so 1 isn't true, and 'a' isn't 97.
+    TEST_ASSERT_EQUAL(2, evaluate("match 1 { true => 1 \n 1 => 2 }")->intval);
+    TEST_ASSERT_EQUAL(2, evaluate("match 'a' { 97 => 1 \n 'a' => 2 }")->intval);
+
+    // The first arm that matches wins, guards and values included.
+    TEST_ASSERT_EQUAL(1, evaluate("{ val k = 3 \n match 3 { k => 1 \n 3 => 2 } }")->intval);
+    TEST_ASSERT_EQUAL(1, evaluate("match 3 { if true => 1 \n 3 => 2 }")->intval);
+    TEST_ASSERT_EQUAL(1, evaluate("match 3 { 3 => 1 \n 3 => 2 }")->intval);
+    TEST_ASSERT_EQUAL(2, evaluate("match 3 { 3 => 2 \n if true => 1 }")->intval);
+
+    // No arm, no value.
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(evaluate("match 5 { 1 => 1 }")));
+
+    char *loop = "{ var s = 0 \n"
+                 "  var v = 0 \n"
+                 "  for i in 1..200 { \n"
+                 "    v = match i % 8 { \n"
+                 "      0 => 1 \n 1 => 2 \n 2 => 3 \n 3 => 4 \n"
+                 "      4 => 5 \n 5 => 6 \n 6 => 7 \n else => 8 \n"
+                 "    } \n"
+                 "    s = s + v \n"
+                 "  } \n"
+                 "  s }";
+    TEST_ASSERT_EQUAL(900, evaluate(loop)->intval);
+
+    char *ret = "{ val f = fn(n) { \n match n { 1 => return \"one\" \n else => \"more\" } \n \"after\" } \n f(1) + f(2) }";
+    TEST_ASSERT_EQUAL_STRING("oneafter", bytearray_to_c_str(evaluate(ret)->bytearray));
+}
+
+void test_eval_match_errors(void) {
+    TEST_ASSERT_NOT_EQUAL(ERR_NO_ERROR, check_error("match 1 { else => 1 \n 1 => 2 }"));
+    TEST_ASSERT_EQUAL(ERR_ENV_SYMBOL_UNDEFINED, check_error("match 1 { nope => 1 }"));
+}
+
 void test_eval(void) {
     RUN_TEST(test_eval_calculator);
+    RUN_TEST(test_eval_binop_operand_kinds);
+    RUN_TEST(test_eval_typed_decl);
+    RUN_TEST(test_eval_typed_fn_args);
+    RUN_TEST(test_eval_typed_kernel);
+    RUN_TEST(test_eval_record);
+    RUN_TEST(test_eval_record_equality);
+    RUN_TEST(test_eval_record_errors);
+    RUN_TEST(test_eval_print);
+    RUN_TEST(test_eval_match);
+    RUN_TEST(test_eval_match_errors);
     RUN_TEST(test_eval_preced_not_astonishing);
     RUN_TEST(test_eval_preced_cast);
     RUN_TEST(test_eval_add);
@@ -1464,6 +2136,7 @@ void test_eval(void) {
     RUN_TEST(test_eval_del);
     RUN_TEST(test_eval_for_loop_range);
     RUN_TEST(test_eval_for_loop_range_step);
+    RUN_TEST(test_eval_for_loop_range_counted);
     RUN_TEST(test_eval_for_loop_list);
     RUN_TEST(test_eval_for_loop_dict);
     RUN_TEST(test_eval_for_loop_arr);
@@ -1474,6 +2147,7 @@ void test_eval(void) {
     RUN_TEST(test_eval_while_loop_break);
     RUN_TEST(test_eval_do_while_loop_break);
     RUN_TEST(test_eval_for_loop_continue);
+    RUN_TEST(test_eval_for_loop_shadows);
     RUN_TEST(test_eval_while_loop_continue);
     RUN_TEST(test_eval_do_while_loop_continue);
     RUN_TEST(test_eval_if_else);
@@ -1484,6 +2158,24 @@ void test_eval(void) {
     RUN_TEST(test_eval_boolean_false);
     RUN_TEST(test_eval_logical_not);
     RUN_TEST(test_eval_truthiness);
+    RUN_TEST(test_eval_interned_bindings);
+    RUN_TEST(test_eval_string_literal_copy_on_write);
+    RUN_TEST(test_eval_string_literals_bounded);
+    RUN_TEST(test_eval_string_building);
+    RUN_TEST(test_eval_string_builder);
+    RUN_TEST(test_eval_sort);
+    RUN_TEST(test_eval_set);
+    RUN_TEST(test_eval_typed_arrays);
+    RUN_TEST(test_eval_math_builtins);
+    RUN_TEST(test_eval_pipelines);
+    RUN_TEST(test_eval_callback_errors);
+    RUN_TEST(test_eval_pipelines_in_place);
+    RUN_TEST(test_eval_memo);
+    RUN_TEST(test_eval_tail_calls);
+    RUN_TEST(test_eval_tail_calls_in_place);
+    RUN_TEST(test_eval_block_scopes_reused);
+    RUN_TEST(test_eval_out_of_memory);
+    RUN_TEST(test_eval_deep_recursion);
     RUN_TEST(test_eval_numeric_comparison);
     RUN_TEST(test_eval_char_comparison);
     RUN_TEST(test_eval_cast_int);
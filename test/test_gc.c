@@ -7,10 +7,12 @@
 #include "../inc/dict.h"
 #include "../inc/heap.h"
 #include "../inc/gc.h"
+#include "../inc/ast.h"
 
 #define NAME(s) (c_str_to_bytearray(s))
 
 static gc_header_t *decl(obj_t *obj) {
+    obj = obj_unshared(obj);
     obj->hdr.flags |= F_ENV_DECLARATION;
     return (gc_header_t *) obj;
 }
@@ -172,11 +174,224 @@ void gc_scope(void) {
     TEST_ASSERT_EQUAL(ERR_NO_ERROR, result->err);
 }
 
+void gc_deep_scopes(void) {
+    interp_t interp;
+    interp_init(&interp);
+
+    // Bindings in scopes in later segments of the stack survive.
+    for (int i = 0; i < 2 * ENV_SEGMENT_SIZE; ++i) {
+        enter_scope(&interp);
+    }
+    put_env(&interp, NAME("deep"), decl(float_obj(4.2)));
+    enter_scope(&interp);
+    put_env(&interp, NAME("cull"), decl(float_obj(1.3)));
+    leave_scope(&interp);
+
+    int mid_free = get_heap_info()->bytes_free;
+    gc(&interp);
+
+    TEST_ASSERT_TRUE(get_heap_info()->bytes_free > mid_free);
+    TEST_ASSERT_EQUAL(TYPE_FLOAT, TYPEOF(get_env(&interp, NAME("deep"))));
+    TEST_ASSERT_EQUAL(4.2, get_env(&interp, NAME("deep"))->floatval);
+}
+
+void gc_string_slice(void) {
+    interp_t interp;
+    interp_init(&interp);
+    gc(&interp);
+    int init_free = get_heap_info()->bytes_free;
+
+    // Only the slice is reachable, but it keeps its parent alive.
+    enter_scope(&interp);
+    obj_t *parent = string_obj(bytearray_alloc(1000));
+    parent->bytearray->data[500] = 'x';
+    obj_t *slice = obj_of(TYPE_STRING);
+    slice->bytearray = bytearray_slice(parent->bytearray, 500, 1000);
+    put_env(&interp, NAME("slice"), decl(slice));
+    gc(&interp);
+    int mid_free = get_heap_info()->bytes_free;
+    TEST_ASSERT_EQUAL('x', get_env(&interp, NAME("slice"))->bytearray->data[0]);
+    TEST_ASSERT_GREATER_THAN(1000, init_free - mid_free);
+
+    leave_scope(&interp);
+    gc(&interp);
+    TEST_ASSERT_EQUAL(init_free, get_heap_info()->bytes_free);
+}
+
+void gc_interned(void) {
+    interp_t interp;
+    interp_init(&interp);
+
+    obj_t *t = boolean_obj(True);
+    TEST_ASSERT_EQUAL_PTR(t, boolean_obj(True));
+    TEST_ASSERT_EQUAL_PTR(nil_obj(), nil_obj());
+    TEST_ASSERT_NOT_EQUAL(boolean_obj(True), boolean_obj(False));
+    TEST_ASSERT_EQUAL_PTR(int_obj(INT_CACHE_MIN), int_obj(INT_CACHE_MIN));
+    TEST_ASSERT_EQUAL_PTR(int_obj(INT_CACHE_MAX), int_obj(INT_CACHE_MAX));
+    TEST_ASSERT_NOT_EQUAL(int_obj(INT_CACHE_MAX + 1), int_obj(INT_CACHE_MAX + 1));
+
+    // decl() flags a copy of an interned object, so the original stays unflagged.
+    put_env(&interp, NAME("t"), decl(t));
+    TEST_ASSERT_NOT_EQUAL(t, get_env(&interp, NAME("t")));
+    TEST_ASSERT_EQUAL(F_NONE, FLAGS(t));
+
+    // Unrooted singletons survive collection and allocate nothing.
+    gc(&interp);
+    int init_free = get_heap_info()->bytes_free;
+    for (int i = 0; i < 10; ++i) {
+        nil_obj();
+        no_obj();
+        boolean_obj(i & 1);
+        break_obj();
+        int_obj(i * 1000);
+    }
+    TEST_ASSERT_EQUAL(init_free, get_heap_info()->bytes_free);
+    TEST_ASSERT_EQUAL(TYPE_BOOLEAN, TYPEOF(t));
+    TEST_ASSERT_EQUAL(True, t->boolval);
+}
+
+static int bytes_used_by(interp_t *interp, const char *program, eval_result_t *result) {
+    gc(interp);
+    int before = get_heap_info()->bytes_free;
+    eval(interp, program, result);
+    int used = before - get_heap_info()->bytes_free;
+    gc(interp);
+    return used;
+}
+
+void gc_small_int_loop(void) {
+    interp_t interp;
+    interp_init(&interp);
+
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    put_env(&interp, NAME("result"), decl((obj_t *) result));
+    enter_scope(&interp);
+
+    // Same loop, but only the second one needs fresh Int objects.
+    int small = bytes_used_by(&interp, "{ var n = 0 \n for i in 1..200 { n = i + 1 } \n n }", result);
+    TEST_ASSERT_EQUAL(201, result->obj->intval);
+    int large = bytes_used_by(&interp, "{ var n = 0 \n for i in 100001..100200 { n = i + 1 } \n n }", result);
+    TEST_ASSERT_EQUAL(100201, result->obj->intval);
+
+    // Two Ints per iteration: the loop counter and the sum.
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * 200 * (int) sizeof(obj_t), large - small);
+}
+
+void gc_unboxed_loop(void) {
+    interp_t interp;
+    interp_init(&interp);
+
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    put_env(&interp, NAME("result"), decl((obj_t *) result));
+    enter_scope(&interp);
+
+    char *program = "{ var n: int = 100000    \n"
+                    "  var x: float = 0        \n"
+                    "  for i in 1..%d {        \n"
+                    "    n = n + i * 3         \n"
+                    "    x = x * 0.5 + n       \n"
+                    "  }                       \n"
+                    "  n }";
+    char few_program[256];
+    char many_program[256];
+    snprintf(few_program, sizeof(few_program), program, 10);
+    snprintf(many_program, sizeof(many_program), program, 1000);
+
+    // Once to intern the names.
+    bytes_used_by(&interp, few_program, result);
+
+    // Declared as numbers, the loop makes no objs however often it goes round.
+    int few = bytes_used_by(&interp, few_program, result);
+    TEST_ASSERT_EQUAL(100165, result->obj->intval);
+    int many = bytes_used_by(&interp, many_program, result);
+    TEST_ASSERT_EQUAL(1601500, result->obj->intval);
+
+    TEST_ASSERT_EQUAL(few, many);
+}
+
+/* What's still used once the program is done and the garbage is gone. */
+static int bytes_kept_by(interp_t *interp, const char *program, eval_result_t *result) {
+    result->obj = nil_obj();
+    gc(interp);
+    int before = get_heap_info()->bytes_free;
+    eval(interp, program, result);
+    gc(interp);
+    return before - get_heap_info()->bytes_free;
+}
+
+void gc_record(void) {
+    interp_t interp;
+    interp_init(&interp);
+
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    put_env(&interp, NAME("result"), decl((obj_t *) result));
+    enter_scope(&interp);
+
+    char *records = "{ type point = data { \n val x \n val y \n } \n"
+                    "  val ps = list {} \n"
+                    "  for i in 1..100 { ps.append(point(i, -i)) } \n"
+                    "  ps }";
+    char *dicts = "{ val ps = list {} \n"
+                  "  for i in 1..100 { ps.append(dict { \"x\" => i, \"y\" => -i }) } \n"
+                  "  ps }";
+
+    // Once each to intern the names.
+    bytes_kept_by(&interp, records, result);
+    bytes_kept_by(&interp, dicts, result);
+
+    int as_records = bytes_kept_by(&interp, records, result);
+    TEST_ASSERT_EQUAL(TYPE_LIST, TYPEOF(result->obj));
+    int as_dicts = bytes_kept_by(&interp, dicts, result);
+    TEST_ASSERT_EQUAL(TYPE_LIST, TYPEOF(result->obj));
+
+    // A slot per field, against a table of buckets and a node per key.
+    TEST_ASSERT_LESS_THAN(as_dicts / 2, as_records);
+}
+
+void gc_code(void) {
+    interp_t interp;
+    interp_init(&interp);
+
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    put_env(&interp, NAME("result"), decl((obj_t *) result));
+    enter_scope(&interp);
+    gc(&interp);
+    size_t init_code = ast_code_bytes();
+
+    // Code with no functions in it goes as soon as it has run.
+    eval(&interp, "val s = \"hello\"", result);
+    TEST_ASSERT_EQUAL(init_code, ast_code_bytes());
+
+    // But string literals were copied out of it.
+    gc(&interp);
+    eval(&interp, "s + \" world\"", result);
+    TEST_ASSERT_EQUAL_STRING("hello world", bytearray_to_c_str(result->obj->bytearray));
+
+    // A function keeps the code it came from for as long as it's around.
+    eval(&interp, "val f = fn(a) { a * 2 }", result);
+    TEST_ASSERT_GREATER_THAN(init_code, ast_code_bytes());
+    gc(&interp);
+    TEST_ASSERT_GREATER_THAN(init_code, ast_code_bytes());
+    eval(&interp, "f(21)", result);
+    TEST_ASSERT_EQUAL(42, result->obj->intval);
+
+    eval(&interp, "del(f)", result);
+    gc(&interp);
+    TEST_ASSERT_EQUAL(init_code, ast_code_bytes());
+}
+
 void test_gc(void) {
     RUN_TEST(gc_primitives);
+    RUN_TEST(gc_interned);
+    RUN_TEST(gc_small_int_loop);
+    RUN_TEST(gc_unboxed_loop);
+    RUN_TEST(gc_record);
     RUN_TEST(gc_bytearray);
     RUN_TEST(gc_string);
+    RUN_TEST(gc_string_slice);
     RUN_TEST(gc_list);
     RUN_TEST(gc_dict);
     RUN_TEST(gc_scope);
+    RUN_TEST(gc_deep_scopes);
+    RUN_TEST(gc_code);
 }
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "util.h"
+#include "unity/unity.h"
+#include "test_image.h"
+#include "../inc/mem.h"
+#include "../inc/type.h"
+#include "../inc/str.h"
+#include "../inc/opt.h"
+#include "../inc/image.h"
+
+#define IMAGE_FILE "/tmp/ethel_test_image.ec"
+
+static void init(interp_t *interp, eval_result_t *result) {
+    interp_init(interp);
+    put_env(interp, c_str_to_bytearray("__prog_result"), (gc_header_t *) result);
+    enter_scope(interp);
+}
+
+/* Compile the script to an image, and drop the parsed code. */
+static void write_image(interp_t *interp, const char *script, image_key_t *key) {
+    uint32_t size = (uint32_t) c_str_len(script);
+    ast_expr_t ast;
+    parse_result_t parse_result;
+    compile_script(interp, script, size, &ast, &parse_result);
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, parse_result.err);
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, image_write(IMAGE_FILE, key, parse_result.code, &ast));
+    ast_code_release(parse_result.code);
+}
+
+static obj_t *eval_image(const char *script) {
+    interp_t interp;
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    init(&interp, result);
+
+    image_key_t key = image_key(script, (uint32_t) c_str_len(script), OPT_DEFAULT_LEVEL);
+    write_image(&interp, script, &key);
+
+    ast_expr_t ast;
+    ast_code_t *code = image_load(IMAGE_FILE, &key, &ast);
+    TEST_ASSERT_NOT_NULL(code);
+    eval_code(&interp, code, &ast, result);
+    remove(IMAGE_FILE);
+
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, result->err);
+    return result->obj;
+}
+
+void test_image_round_trip(void) {
+    char *fib = "val fib = fn(n: int) { \n"
+                "  if n < 2 then return n \n"
+                "  fib(n - 1) + fib(n - 2) \n"
+                "} \n"
+                "fib(15)";
+    TEST_ASSERT_EQUAL(610, eval_image(fib)->intval);
+
+    char *closure = "val adder = fn(x) { fn(y) { x + y } } \n"
+                    "val add5 = adder(5) \n"
+                    "add5(10) + adder(1)(2)";
+    TEST_ASSERT_EQUAL(18, eval_image(closure)->intval);
+
+    char *collections = "val d = dict { \"a\" => 1, \"b\" => 2 } \n"
+                        "val l = list { 1, 2, 3 } \n"
+                        "var s = \"x\" \n"
+                        "for e in l { s = s + \"y\" } \n"
+                        "s.length() + d[\"b\"] + (1..10).reduce(fn(a, b) { a + b }, 0)";
+    TEST_ASSERT_EQUAL(61, eval_image(collections)->intval);
+
+    char *record = "type point = data { \n"
+                   "  val x: int \n"
+                   "  var y: float \n"
+                   "} \n"
+                   "val p = point(1, 2) \n"
+                   "p.y = p.y + p.x \n"
+                   "p.y";
+    TEST_ASSERT_EQUAL_FLOAT(3.0, eval_image(record)->floatval);
+
+    char *match = "val name = fn(op) { \n"
+                  "  match op { \n"
+                  "    0 => \"nop\" \n"
+                  "    1 => \"push\" \n"
+                  "    -7 => \"far\" \n"
+                  "    'x' => \"byte\" \n"
+                  "    \"add\" => \"str\" \n"
+                  "    if op == 2 => \"two\" \n"
+                  "    else => \"other\" \n"
+                  "  } \n"
+                  "} \n"
+                  "name(0) + name(1) + name(-7) + name('x') + name(\"add\") + name(2) + name(3)";
+    TEST_ASSERT_EQUAL_STRING("noppushfarbytestrtwoother", bytearray_to_c_str(eval_image(match)->bytearray));
+}
+
+void test_image_names_interned(void) {
+    interp_t interp;
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    init(&interp, result);
+
+    char *script = "val some_name = 42 \n some_name";
+    image_key_t key = image_key(script, (uint32_t) c_str_len(script), OPT_DEFAULT_LEVEL);
+    write_image(&interp, script, &key);
+
+    ast_expr_t ast;
+    ast_code_t *code = image_load(IMAGE_FILE, &key, &ast);
+    remove(IMAGE_FILE);
+    TEST_ASSERT_NOT_NULL(code);
+
+    // The script's last expr is the name, which is the one there is.
+    TEST_ASSERT_EQUAL(AST_BLOCK, TYPEOF(&ast));
+    ast_expr_list_t *es = ast.block_exprs;
+    while (es->next != NULL) es = es->next;
+    TEST_ASSERT_EQUAL(AST_IDENT, TYPEOF(es->root));
+    TEST_ASSERT_EQUAL_PTR(bytearray_intern((const byte *) "some_name", 9), es->root->bytearray);
+
+    eval_code(&interp, code, &ast, result);
+    TEST_ASSERT_EQUAL(42, result->obj->intval);
+}
+
+void test_image_only_for_its_key(void) {
+    interp_t interp;
+    eval_result_t *result = (eval_result_t *) alloc_type(EVAL_RESULT, F_NONE);
+    init(&interp, result);
+
+    char *script = "1 + 2";
+    uint32_t size = (uint32_t) c_str_len(script);
+    image_key_t key = image_key(script, size, OPT_DEFAULT_LEVEL);
+    ast_expr_t ast;
+
+    remove(IMAGE_FILE);
+    TEST_ASSERT_NULL(image_load(IMAGE_FILE, &key, &ast));
+
+    write_image(&interp, script, &key);
+
+    image_key_t edited = image_key("1 + 3", size, OPT_DEFAULT_LEVEL);
+    TEST_ASSERT_NULL(image_load(IMAGE_FILE, &edited, &ast));
+    image_key_t unoptimized = image_key(script, size, 0);
+    TEST_ASSERT_NULL(image_load(IMAGE_FILE, &unoptimized, &ast));
+
+    // Nor is one from another build. Its id follows the magic and version.
+    uint32_t build;
+    FILE *f = fopen(IMAGE_FILE, "r+b");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(0, fseek(f, 12, SEEK_SET));
+    TEST_ASSERT_EQUAL(1, fread(&build, sizeof(build), 1, f));
+    build += 1;
+    TEST_ASSERT_EQUAL(0, fseek(f, 12, SEEK_SET));
+    TEST_ASSERT_EQUAL(1, fwrite(&build, sizeof(build), 1, f));
+    fclose(f);
+    TEST_ASSERT_NULL(image_load(IMAGE_FILE, &key, &ast));
+    write_image(&interp, script, &key);
+
+    // Nor is half an image any good.
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, stat(IMAGE_FILE, &st));
+    TEST_ASSERT_EQUAL(0, truncate(IMAGE_FILE, st.st_size / 2));
+    TEST_ASSERT_NULL(image_load(IMAGE_FILE, &key, &ast));
+    remove(IMAGE_FILE);
+}
+
+void test_image(void) {
+    RUN_TEST(test_image_round_trip);
+    RUN_TEST(test_image_names_interned);
+    RUN_TEST(test_image_only_for_its_key);
+}
@@ -0,0 +1,6 @@
+#ifndef __TEST_IMAGE_H
+#define __TEST_IMAGE_H
+
+void test_image(void);
+
+#endif
@@ -0,0 +1,83 @@
+#include "unity/unity.h"
+#include "test_iter.h"
+#include "../inc/type.h"
+#include "../inc/iter.h"
+#include "../inc/str.h"
+#include "../inc/list.h"
+#include "../inc/heap.h"
+
+void test_iter_of(void) {
+    obj_t *r = range_obj(1, 3);
+    obj_t *it = iter_of(r);
+    TEST_ASSERT_EQUAL(TYPE_ITERATOR, TYPEOF(it));
+    TEST_ASSERT_EQUAL(it, iter_of(it));
+
+    TEST_ASSERT_NULL(iter_of(int_obj(1)));
+}
+
+void test_iter_take(void) {
+    obj_t *it = iter_take(range_obj(1, 100), wrap_varargs(1, int_obj(3)));
+    obj_t *l = iter_to_list(it, NULL);
+    TEST_ASSERT_EQUAL(3, list_len(l, NULL)->intval);
+    TEST_ASSERT_EQUAL(1, list_head(l, NULL)->intval);
+
+    // Taking more than there is just stops early.
+    it = iter_take(range_obj(1, 2), wrap_varargs(1, int_obj(5)));
+    TEST_ASSERT_EQUAL(2, iter_count(it, NULL)->intval);
+}
+
+void test_iter_enumerate(void) {
+    obj_t *s = string_obj(c_str_to_bytearray("abc"));
+    obj_t *l = iter_to_list(iter_enumerate(s, NULL), NULL);
+    TEST_ASSERT_EQUAL(3, list_len(l, NULL)->intval);
+
+    obj_t *last = list_get(l, wrap_varargs(1, int_obj(2)));
+    TEST_ASSERT_EQUAL(2, list_head(last, NULL)->intval);
+}
+
+void test_iter_zip(void) {
+    obj_t *it = iter_zip(range_obj(1, 10), wrap_varargs(1, range_obj(1, 4)));
+    TEST_ASSERT_EQUAL(4, iter_count(it, NULL)->intval);
+}
+
+void test_iter_sum(void) {
+    TEST_ASSERT_EQUAL(5050, iter_sum(range_obj(1, 100), NULL)->intval);
+    TEST_ASSERT_EQUAL(0, iter_sum(list_obj(NULL), NULL)->intval);
+
+    // Numbers that add up to 0 are still numbers seen; the strings are added to them.
+    obj_t *l = list_obj(NULL);
+    list_append(l, wrap_varargs(1, int_obj(1)));
+    list_append(l, wrap_varargs(1, int_obj(-1)));
+    list_append(l, wrap_varargs(1, string_obj(c_str_to_bytearray("x"))));
+    list_append(l, wrap_varargs(1, string_obj(c_str_to_bytearray("y"))));
+    TEST_ASSERT_EQUAL(TYPE_INT, TYPEOF(iter_sum(l, NULL)));
+
+    // Once the unboxed sum would overflow, Int's add takes over.
+    l = list_obj(NULL);
+    list_append(l, wrap_varargs(1, int_obj(INT32_MAX)));
+    list_append(l, wrap_varargs(1, int_obj(1)));
+    list_append(l, wrap_varargs(1, int_obj(-1)));
+    obj_t *sum = iter_sum(l, NULL);
+    TEST_ASSERT_EQUAL(TYPE_INT, TYPEOF(sum));
+    TEST_ASSERT_EQUAL(INT32_MAX, sum->intval);
+}
+
+void test_iter_no_intermediate_alloc(void) {
+    // Ints in this range are interned, so pulling them through a chain of
+    // stages should cost nothing once the stages exist.
+    obj_t *it = iter_take(range_obj(1, 1000), wrap_varargs(1, int_obj(500)));
+    it = iter_take(it, wrap_varargs(1, int_obj(400)));
+
+    size_t before = get_heap_info()->bytes_free;
+    TEST_ASSERT_EQUAL(400, iter_count(it, NULL)->intval);
+    TEST_ASSERT_EQUAL(before, get_heap_info()->bytes_free);
+}
+
+void test_iter(void) {
+    RUN_TEST(test_iter_of);
+    RUN_TEST(test_iter_take);
+    RUN_TEST(test_iter_enumerate);
+    RUN_TEST(test_iter_zip);
+    RUN_TEST(test_iter_sum);
+    RUN_TEST(test_iter_no_intermediate_alloc);
+}
@@ -0,0 +1,6 @@
+#ifndef __TEST_ITER_H
+#define __TEST_ITER_H
+
+void test_iter(void);
+
+#endif
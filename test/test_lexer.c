@@ -1,5 +1,7 @@
 #include "unity/unity.h"
 #include "test_lexer.h"
+#include "../inc/mem.h"
+#include "../inc/ptr.h"
 #include "../inc/str.h"
 #include "../inc/lexer.h"
 
@@ -37,7 +39,7 @@ void test_lex_word(void) {
         if (lexer.token.tag == TAG_INT) {
             TEST_ASSERT_EQUAL(expected[i].intval, lexer.token.intval);
         } else if (lexer.token.tag != TAG_RANGE) {
-            TEST_ASSERT(c_str_eq(expected[i].string, lexer.token.string));
+            TEST_ASSERT(c_str_eq_bytearray(expected[i].string, token_bytearray(&lexer)));
         }
         advance(&lexer);
     }
@@ -50,7 +52,8 @@ void test_lex_hex(void) {
 
     TEST_ASSERT_EQUAL(ERR_NO_ERROR, lexer.err);
     TEST_ASSERT_EQUAL(TAG_HEX, lexer.token.tag);
-    TEST_ASSERT_EQUAL_STRING("cafe42", lexer.token.string);
+    TEST_ASSERT_EQUAL(0xcafe42, lexer.token.intval);
+    TEST_ASSERT(c_str_eq_bytearray("CafE42", token_bytearray(&lexer)));
 }
 
 void test_lex_bin(void) {
@@ -60,7 +63,8 @@ void test_lex_bin(void) {
 
     TEST_ASSERT_EQUAL(ERR_NO_ERROR, lexer.err);
     TEST_ASSERT_EQUAL(TAG_BIN, lexer.token.tag);
-    TEST_ASSERT_EQUAL_STRING("1101101", lexer.token.string);
+    TEST_ASSERT_EQUAL(0x6d, lexer.token.intval);
+    TEST_ASSERT(c_str_eq_bytearray("1101101", token_bytearray(&lexer)));
 }
 
 void test_lex_int(void) {
@@ -110,7 +114,7 @@ void test_lex_string(void) {
 
     TEST_ASSERT_EQUAL(ERR_NO_ERROR, lexer.err);
     TEST_ASSERT_EQUAL(TAG_STRING, lexer.token.tag);
-    TEST_ASSERT_EQUAL_STRING("i like pie", lexer.token.string);
+    TEST_ASSERT(c_str_eq_bytearray("i like pie", token_bytearray(&lexer)));
 }
 
 void test_lex_true(void) {
@@ -455,7 +459,7 @@ void test_lex_field_assign(void) {
         TEST_ASSERT_EQUAL(expected[i], lexer.token.tag);
 
         if (lexer.token.tag == TAG_FIELD_ACCESS) {
-            TEST_ASSERT_EQUAL_STRING("t", lexer.token.string);
+            TEST_ASSERT(c_str_eq_bytearray("t", token_bytearray(&lexer)));
         }
 
         advance(&lexer);
@@ -476,7 +480,7 @@ void test_lex_field_access(void) {
         TEST_ASSERT_EQUAL(expected[i], lexer.token.tag);
 
         if (lexer.token.tag == TAG_FIELD_ACCESS) {
-            TEST_ASSERT_EQUAL_STRING("x", lexer.token.string);
+            TEST_ASSERT(c_str_eq_bytearray("x", token_bytearray(&lexer)));
         }
 
         advance(&lexer);
@@ -496,7 +500,7 @@ void test_lex_method_access(void) {
         TEST_ASSERT_EQUAL(expected[i], lexer.token.tag);
 
         if (lexer.token.tag == TAG_METHOD_CALL) {
-            TEST_ASSERT_EQUAL_STRING("insert", lexer.token.string);
+            TEST_ASSERT(c_str_eq_bytearray("insert", token_bytearray(&lexer)));
         }
         advance(&lexer);
     }
@@ -650,6 +654,94 @@ void test_lex_all_tokens(void) {
     }
 }
 
+void test_lex_sized_input(void) {
+    // Only the given bytes are lexed; the input needn't end in a null.
+    char *expr = "abc def";
+    lexer_t lexer;
+    lexer_init(&lexer, expr, 3);
+
+    TEST_ASSERT_EQUAL(TAG_IDENT, lexer.token.tag);
+    TEST_ASSERT(c_str_eq_bytearray("abc", token_bytearray(&lexer)));
+    advance(&lexer);
+    TEST_ASSERT_EQUAL(TAG_EOF, lexer.token.tag);
+}
+
+void test_lex_long_input(void) {
+    // Well past the 64000 bytes the lexer used to be limited to.
+    const char *line = "total = total + 42 // more\n";
+    size_t line_len = c_str_len(line);
+    int lines = 10000;
+    char *expr = mem_alloc(line_len * (size_t) lines + 4);
+    for (int i = 0; i < lines; i++) mem_cp(expr + line_len * (size_t) i, (void *) line, line_len);
+    mem_cp(expr + line_len * (size_t) lines, "end", 4);
+
+    lexer_t lexer;
+    lexer_init(&lexer, expr, (uint32_t) c_str_len(expr));
+
+    int idents = 0;
+    while (lexer.token.tag != TAG_EOF) {
+        if (lexer.token.tag == TAG_IDENT) idents++;
+        if (lexer.token.tag == TAG_IDENT && idents == 2 * lines + 1) {
+            TEST_ASSERT(c_str_eq_bytearray("end", token_bytearray(&lexer)));
+        }
+        advance(&lexer);
+    }
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, lexer.err);
+    TEST_ASSERT_EQUAL(2 * lines + 1, idents);
+    mem_free(expr);
+}
+
+void test_lex_reserved_words(void) {
+    // Every reserved word is found, and words that are nearly one aren't.
+    lexer_t lexer;
+    char word[16];
+    for (int i = 0; i < sizeof(reserved) / sizeof(reserved[0]); i++) {
+        const char *text = reserved[i].string;
+        uint32_t len = (uint32_t) c_str_len(text);
+        lexer_init(&lexer, text, len);
+        TEST_ASSERT_EQUAL(reserved[i].tag, lexer.token.tag);
+
+        mem_cp(word, (void *) text, len);
+        word[len] = '_';
+        lexer_init(&lexer, word, len + 1);
+        TEST_ASSERT_EQUAL(TAG_IDENT, lexer.token.tag);
+        word[0] = (char) (word[0] - 'a' + 'A');
+        lexer_init(&lexer, word, len);
+        TEST_ASSERT_EQUAL(TAG_IDENT, lexer.token.tag);
+    }
+}
+
+void test_lex_long_runs(void) {
+    // Runs longer than the 16 chars that are skipped at a time.
+    char *expr = "    \t   \t     a_very_long_identifier_0123456789 \"a string that goes on\""
+                 "  // and a comment that goes on and on\n  end";
+    lexer_t lexer;
+    lexer_init(&lexer, expr, c_str_len(expr));
+
+    TEST_ASSERT_EQUAL(TAG_IDENT, lexer.token.tag);
+    TEST_ASSERT(c_str_eq_bytearray("a_very_long_identifier_0123456789", token_bytearray(&lexer)));
+    advance(&lexer);
+    TEST_ASSERT_EQUAL(TAG_STRING, lexer.token.tag);
+    TEST_ASSERT(c_str_eq_bytearray("a string that goes on", token_bytearray(&lexer)));
+    advance(&lexer);
+    TEST_ASSERT_EQUAL(TAG_EOL, lexer.token.tag);
+    advance(&lexer);
+    TEST_ASSERT_EQUAL(TAG_IDENT, lexer.token.tag);
+    TEST_ASSERT(c_str_eq_bytearray("end", token_bytearray(&lexer)));
+    advance(&lexer);
+    TEST_ASSERT_EQUAL(TAG_EOF, lexer.token.tag);
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, lexer.err);
+}
+
+void test_lex_unterminated_string(void) {
+    char *expr = "print(\"this string never ends and is longer than sixteen chars";
+    lexer_t lexer;
+    lexer_init(&lexer, expr, c_str_len(expr));
+
+    while (lexer.token.tag != TAG_EOF) advance(&lexer);
+    TEST_ASSERT_EQUAL(ERR_LEX_UNEXPECTED_TOKEN, lexer.err);
+}
+
 void test_lexer(void) {
     RUN_TEST(test_lex_error);
     RUN_TEST(test_lex_word);
@@ -689,4 +781,9 @@ void test_lexer(void) {
     RUN_TEST(test_lex_function_call);
     RUN_TEST(test_lex_function_with_return);
     RUN_TEST(test_lex_all_tokens);
+    RUN_TEST(test_lex_sized_input);
+    RUN_TEST(test_lex_long_input);
+    RUN_TEST(test_lex_reserved_words);
+    RUN_TEST(test_lex_long_runs);
+    RUN_TEST(test_lex_unterminated_string);
 }
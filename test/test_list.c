@@ -61,6 +61,28 @@ void test_list_tail(void) {
     TEST_ASSERT_EQUAL(2, list_len(slice, NULL)->intval);
 }
 
+void test_list_tail_shares(void) {
+    obj_t *list = make_list(3, 1, 2, 3);
+    obj_t *tail = list_tail(list, NULL);
+    TEST_ASSERT_EQUAL_PTR(list->list->elems->next, tail->list->elems);
+
+    obj_t *suffix = list_slice(list, n_args(2, 1, -1));
+    TEST_ASSERT_EQUAL_PTR(tail->list->elems, suffix->list->elems);
+
+    // Writes to either side copy first, and don't show through.
+    list_set(tail, n_args(2, 0, 20));
+    TEST_ASSERT_EQUAL(2, list_get(list, n_args(1, 1))->intval);
+    TEST_ASSERT_EQUAL(20, list_get(tail, n_args(1, 0))->intval);
+
+    list_append(list, n_args(1, 4));
+    TEST_ASSERT_EQUAL(2, list_len(suffix, NULL)->intval);
+    TEST_ASSERT_EQUAL(4, list_len(list, NULL)->intval);
+
+    list_remove_first(suffix, NULL);
+    TEST_ASSERT_EQUAL(2, list_get(list, n_args(1, 1))->intval);
+    TEST_ASSERT_EQUAL(1, list_len(suffix, NULL)->intval);
+}
+
 void test_list_prepend(void) {
     obj_t *list = make_list(0);
     list_prepend(list, n_args(1, 42));
@@ -101,6 +123,10 @@ void test_list_remove_last(void) {
     TEST_ASSERT_EQUAL(3, list_len(list, NULL)->intval);
     TEST_ASSERT_EQUAL(3, list_remove_last(list, NULL)->intval);
     TEST_ASSERT_EQUAL(2, list_len(list, NULL)->intval);
+
+    list = make_list(1, 1);
+    TEST_ASSERT_EQUAL(1, list_remove_last(list, NULL)->intval);
+    TEST_ASSERT_EQUAL(0, list_len(list, NULL)->intval);
 }
 
 void test_list_remove_at(void) {
@@ -132,6 +158,49 @@ void test_list_remove_at(void) {
     TEST_ASSERT_EQUAL(2, list_len(list, NULL)->intval);
 }
 
+void test_list_iterator_mutation(void) {
+    obj_t *list = make_list(4, 1, 2, 3, 4);
+    obj_iter_t *iter = list_iterator(list, NULL)->iterator;
+
+    // Removing the element just yielded is fine.
+    TEST_ASSERT_EQUAL(1, iter->next(iter)->intval);
+    list_remove_first(list, NULL);
+    TEST_ASSERT_EQUAL(2, iter->next(iter)->intval);
+    list_remove_at(list, n_args(1, 0));
+
+    // Removed elements ahead of the cursor are skipped; appended ones are seen.
+    list_remove_at(list, n_args(1, 0));
+    list_append(list, n_args(1, 5));
+    TEST_ASSERT_EQUAL(4, iter->next(iter)->intval);
+    TEST_ASSERT_EQUAL(5, iter->next(iter)->intval);
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(iter->next(iter)));
+}
+
+void test_list_sort(void) {
+    obj_t *list = make_list(7, 5, -1, 3, 3, 0, 9, -20);
+    TEST_ASSERT_EQUAL_PTR(list, list_sort(list, NULL));
+
+    int expected[] = {-20, -1, 0, 3, 3, 5, 9};
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_EQUAL(expected[i], list_get(list, n_args(1, i))->intval);
+    }
+
+    list = make_list(0);
+    TEST_ASSERT_EQUAL(0, list_len(list_sort(list, NULL), NULL)->intval);
+}
+
+void test_list_sort_mixed(void) {
+    // Not all one type, so this goes through the lt methods.
+    obj_t *list = make_list(3, 3, 1, 2);
+    list_prepend(list, wrap_varargs(1, float_obj(2.5f)));
+    list_sort(list, NULL);
+
+    TEST_ASSERT_EQUAL(1, list_get(list, n_args(1, 0))->intval);
+    TEST_ASSERT_EQUAL(2, list_get(list, n_args(1, 1))->intval);
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, list_get(list, n_args(1, 2))->floatval);
+    TEST_ASSERT_EQUAL(3, list_get(list, n_args(1, 3))->intval);
+}
+
 void test_list(void) {
     RUN_TEST(test_list_len);
     RUN_TEST(test_list_get);
@@ -139,9 +208,13 @@ void test_list(void) {
     RUN_TEST(test_list_contains);
     RUN_TEST(test_list_head);
     RUN_TEST(test_list_tail);
+    RUN_TEST(test_list_tail_shares);
     RUN_TEST(test_list_prepend);
     RUN_TEST(test_list_append);
     RUN_TEST(test_list_remove_first);
     RUN_TEST(test_list_remove_last);
     RUN_TEST(test_list_remove_at);
+    RUN_TEST(test_list_iterator_mutation);
+    RUN_TEST(test_list_sort);
+    RUN_TEST(test_list_sort_mixed);
 }
@@ -4,6 +4,7 @@
 #include "../inc/mem.h"
 #include "../inc/str.h"
 #include "../inc/parser.h"
+#include "../inc/opt.h"
 
 void test_parse_empty(void) {
     char *program = "  ";
@@ -382,6 +383,68 @@ void test_parse_typedef(void) {
     TEST_ASSERT_EQUAL(AST_TYPEDEF, TYPEOF(ast));
 }
 
+void test_parse_typed_decl(void) {
+    char *program = "var x: int = 3";
+    ast_expr_t *ast = mem_alloc(sizeof(ast_expr_t));
+    parse_result_t *parse_result = mem_alloc(sizeof(parse_result_t));
+    parse_program(program, ast, parse_result);
+
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, parse_result->err);
+    TEST_ASSERT_EQUAL(AST_ASSIGN, TYPEOF(ast));
+    TEST_ASSERT_EQUAL(AST_TYPED, TYPEOF(ast->op_args->a));
+    TEST_ASSERT_EQUAL(TYPE_INT, ast->op_args->a->typed_expr->type);
+    TEST_ASSERT_EQUAL(AST_INT, TYPEOF(ast->op_args->b));
+}
+
+static ast_expr_t *parse_optimized(const char *program) {
+    ast_expr_t *ast = mem_alloc(sizeof(ast_expr_t));
+    parse_result_t *parse_result = mem_alloc(sizeof(parse_result_t));
+    parse_program(program, ast, parse_result);
+    TEST_ASSERT_EQUAL(ERR_NO_ERROR, parse_result->err);
+    optimize(ast);
+    return ast;
+}
+
+void test_optimize_fold(void) {
+    ast_expr_t *ast = parse_optimized("1 << 4 + 2");
+    TEST_ASSERT_EQUAL(AST_INT, TYPEOF(ast));
+    TEST_ASSERT_EQUAL(18, ast->intval);
+
+    ast = parse_optimized("-(2 * 3.5) / 7");
+    TEST_ASSERT_EQUAL(AST_FLOAT, TYPEOF(ast));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0, ast->floatval);
+
+    ast = parse_optimized("not (3 > 2 and 1 < 1.5)");
+    TEST_ASSERT_EQUAL(AST_BOOLEAN, TYPEOF(ast));
+    TEST_ASSERT_EQUAL(False, ast->boolval);
+
+    // Folds inside what it can't fold.
+    ast = parse_optimized("x + 2 * 3");
+    TEST_ASSERT_EQUAL(AST_ADD, TYPEOF(ast));
+    TEST_ASSERT_EQUAL(AST_IDENT, TYPEOF(ast->op_args->a));
+    TEST_ASSERT_EQUAL(AST_INT, TYPEOF(ast->op_args->b));
+    TEST_ASSERT_EQUAL(6, ast->op_args->b->intval);
+}
+
+void test_optimize_prune_if(void) {
+    ast_expr_t *ast = parse_optimized("if 1 > 2 then 3 else { x }");
+    TEST_ASSERT_EQUAL(AST_BLOCK, TYPEOF(ast));
+
+    ast = parse_optimized("if 1 > 2 then 3");
+    TEST_ASSERT_EQUAL(AST_NIL, TYPEOF(ast));
+
+    ast = parse_optimized("if x then 3 else 4");
+    TEST_ASSERT_EQUAL(AST_IF_THEN_ELSE, TYPEOF(ast));
+}
+
+void test_optimize_leaves_errors(void) {
+    // These fail when run, and still have to.
+    TEST_ASSERT_EQUAL(AST_DIV, TYPEOF(parse_optimized("1 / 0")));
+    TEST_ASSERT_EQUAL(AST_MOD, TYPEOF(parse_optimized("1.5 % 1")));
+    TEST_ASSERT_EQUAL(AST_BITWISE_SHL, TYPEOF(parse_optimized("1.5 << 2")));
+    TEST_ASSERT_EQUAL(AST_ADD, TYPEOF(parse_optimized("1 + \"a\"")));
+}
+
 void test_parser(void) {
     RUN_TEST(test_parse_empty);
     RUN_TEST(test_parse_add);
@@ -411,4 +474,8 @@ void test_parser(void) {
     RUN_TEST(test_parse_member_field_get);
     RUN_TEST(test_parse_member_field_set);
     RUN_TEST(test_parse_typedef);
+    RUN_TEST(test_parse_typed_decl);
+    RUN_TEST(test_optimize_fold);
+    RUN_TEST(test_optimize_prune_if);
+    RUN_TEST(test_optimize_leaves_errors);
 }
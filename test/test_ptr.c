@@ -16,6 +16,63 @@ void test_mem_set(void) {
     TEST_ASSERT_EQUAL(5, c_str_len(s));
 }
 
+void test_mem_set_long(void) {
+    // Odd lengths and offsets exercise both the vector and byte loops.
+    unsigned char *s = mem_alloc(300);
+    mem_set(s, 0, 300);
+    mem_set(s + 3, 'x', 257);
+
+    TEST_ASSERT_EQUAL(0, s[2]);
+    for (int i = 3; i < 260; i++) TEST_ASSERT_EQUAL('x', s[i]);
+    TEST_ASSERT_EQUAL(0, s[260]);
+}
+
+void test_mem_cp(void) {
+    unsigned char *src = mem_alloc(300);
+    unsigned char *dst = mem_alloc(300);
+    for (int i = 0; i < 300; i++) src[i] = (unsigned char) i;
+    mem_set(dst, 0, 300);
+
+    mem_cp(dst + 1, src + 5, 250);
+    TEST_ASSERT_EQUAL(0, dst[0]);
+    for (int i = 0; i < 250; i++) TEST_ASSERT_EQUAL((unsigned char) (i + 5), dst[i + 1]);
+    TEST_ASSERT_EQUAL(0, dst[251]);
+}
+
+void test_mem_eq(void) {
+    unsigned char *a = mem_alloc(300);
+    unsigned char *b = mem_alloc(300);
+    mem_set(a, 'a', 300);
+    mem_set(b, 'a', 300);
+    TEST_ASSERT_TRUE(mem_eq(a, b, 300));
+    TEST_ASSERT_TRUE(mem_eq(a, b, 0));
+
+    // A difference in every possible position of a long buffer.
+    for (int i = 0; i < 300; i++) {
+        b[i] = 'b';
+        TEST_ASSERT_FALSE(mem_eq(a, b, 300));
+        TEST_ASSERT_TRUE(mem_eq(a, b, (size_t) i));
+        b[i] = 'a';
+    }
+}
+
+void test_mem_chr(void) {
+    unsigned char *s = mem_alloc(300);
+    mem_set(s, 0, 300);
+    TEST_ASSERT_NULL(mem_chr(s, 'x', 300));
+
+    for (int i = 0; i < 300; i++) {
+        s[i] = 'x';
+        TEST_ASSERT_EQUAL_PTR(s + i, mem_chr(s, 'x', 300));
+        TEST_ASSERT_NULL(mem_chr(s, 'x', (size_t) i));
+        s[i] = 0;
+    }
+}
+
 void test_ptr(void) {
     RUN_TEST(test_mem_set);
+    RUN_TEST(test_mem_set_long);
+    RUN_TEST(test_mem_cp);
+    RUN_TEST(test_mem_eq);
+    RUN_TEST(test_mem_chr);
 }
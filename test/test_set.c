@@ -0,0 +1,118 @@
+#include "unity/unity.h"
+#include "test_set.h"
+#include "../inc/type.h"
+#include "../inc/set.h"
+#include "../inc/str.h"
+#include "../inc/list.h"
+#include "../inc/heap.h"
+
+static obj_t *set_of_ints(int from, int to) {
+    obj_t *s = set_obj();
+    for (int i = from; i <= to; i++) {
+        set_add(s, int_obj(i));
+    }
+    return s;
+}
+
+void test_set_init(void) {
+    obj_t *s = set_obj();
+    TEST_ASSERT_EQUAL(TYPE_SET, TYPEOF(s));
+    TEST_ASSERT_EQUAL(0, s->dict->nelems);
+
+    // Sized so that n elems fit without resizing.
+    s = set_obj_of_size(100);
+    TEST_ASSERT_EQUAL(128, s->dict->buckets);
+}
+
+void test_set_add(void) {
+    obj_t *s = set_obj();
+    set_add(s, int_obj(1));
+    set_add(s, int_obj(1));
+    set_add(s, string_obj(c_str_to_bytearray("one")));
+    set_add(s, string_obj(c_str_to_bytearray("one")));
+    TEST_ASSERT_EQUAL(2, s->dict->nelems);
+
+    TEST_ASSERT_TRUE(set_contains(s, int_obj(1)));
+    TEST_ASSERT_TRUE(set_contains(s, string_obj(c_str_to_bytearray("one"))));
+    TEST_ASSERT_FALSE(set_contains(s, byte_obj(1)));
+
+    TEST_ASSERT_EQUAL(ERR_TYPE_UNUSABLE_AS_KEY, set_add(s, set_obj()));
+}
+
+void test_set_remove(void) {
+    obj_t *s = set_of_ints(1, 3);
+    TEST_ASSERT_TRUE(set_obj_remove(s, wrap_varargs(1, int_obj(2)))->boolval);
+    TEST_ASSERT_FALSE(set_obj_remove(s, wrap_varargs(1, int_obj(2)))->boolval);
+    TEST_ASSERT_EQUAL(2, s->dict->nelems);
+    TEST_ASSERT_FALSE(set_contains(s, int_obj(2)));
+}
+
+void test_set_union(void) {
+    obj_t *a = set_of_ints(1, 100);
+    obj_t *b = set_of_ints(51, 150);
+    obj_t *u = set_union(a, wrap_varargs(1, b));
+    TEST_ASSERT_EQUAL(150, u->dict->nelems);
+    TEST_ASSERT_TRUE(set_contains(u, int_obj(1)));
+    TEST_ASSERT_TRUE(set_contains(u, int_obj(150)));
+
+    // Neither operand changes.
+    TEST_ASSERT_EQUAL(100, a->dict->nelems);
+    TEST_ASSERT_EQUAL(100, b->dict->nelems);
+}
+
+void test_set_intersection(void) {
+    obj_t *a = set_of_ints(1, 1000);
+    obj_t *b = set_of_ints(991, 1010);
+    obj_t *i = set_intersection(a, wrap_varargs(1, b));
+    TEST_ASSERT_EQUAL(10, i->dict->nelems);
+    TEST_ASSERT_TRUE(set_contains(i, int_obj(991)));
+    TEST_ASSERT_FALSE(set_contains(i, int_obj(1001)));
+
+    // Sized from the smaller operand, whichever side it's on.
+    TEST_ASSERT_EQUAL(32, i->dict->buckets);
+    i = set_intersection(b, wrap_varargs(1, a));
+    TEST_ASSERT_EQUAL(10, i->dict->nelems);
+    TEST_ASSERT_EQUAL(32, i->dict->buckets);
+}
+
+void test_set_difference(void) {
+    obj_t *a = set_of_ints(1, 10);
+    obj_t *b = set_of_ints(6, 20);
+    obj_t *d = set_difference(a, wrap_varargs(1, b));
+    TEST_ASSERT_EQUAL(5, d->dict->nelems);
+    TEST_ASSERT_TRUE(set_contains(d, int_obj(5)));
+    TEST_ASSERT_FALSE(set_contains(d, int_obj(6)));
+}
+
+void test_set_list_operand(void) {
+    obj_t *l = list_obj(NULL);
+    list_append(l, wrap_varargs(1, int_obj(3)));
+    list_append(l, wrap_varargs(1, int_obj(3)));
+    list_append(l, wrap_varargs(1, int_obj(4)));
+
+    obj_t *u = set_union(set_obj(), wrap_varargs(1, l));
+    TEST_ASSERT_EQUAL(2, u->dict->nelems);
+
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(set_union(u, wrap_varargs(1, int_obj(3)))));
+}
+
+void test_set_eq(void) {
+    obj_t *a = set_of_ints(1, 50);
+    obj_t *b = set_of_ints(1, 50);
+    TEST_ASSERT_TRUE(set_obj_eq(a, wrap_varargs(1, b))->boolval);
+
+    set_add(b, int_obj(51));
+    TEST_ASSERT_FALSE(set_obj_eq(a, wrap_varargs(1, b))->boolval);
+    TEST_ASSERT_TRUE(set_obj_eq(a, wrap_varargs(1, set_obj_copy(a, NULL)))->boolval);
+}
+
+void test_set(void) {
+    RUN_TEST(test_set_init);
+    RUN_TEST(test_set_add);
+    RUN_TEST(test_set_remove);
+    RUN_TEST(test_set_union);
+    RUN_TEST(test_set_intersection);
+    RUN_TEST(test_set_difference);
+    RUN_TEST(test_set_list_operand);
+    RUN_TEST(test_set_eq);
+}
@@ -0,0 +1,6 @@
+#ifndef __TEST_SET_H
+#define __TEST_SET_H
+
+void test_set(void);
+
+#endif
@@ -2,6 +2,8 @@
 #include "test_str.h"
 #include "../inc/mem.h"
 #include "../inc/str.h"
+#include "../inc/arr.h"
+#include "../inc/type.h"
 
 void test_c_str_len(void) {
   TEST_ASSERT_EQUAL(0, c_str_len(""));
@@ -159,6 +161,99 @@ void test_str_substr(void) {
   TEST_ASSERT_EQUAL_STRING("ai", bytearray_to_c_str(slice->bytearray));
 }
 
+void test_str_substr_shares_parent(void) {
+  bytearray_t *text = bytearray_alloc(100);
+  for (int i = 0; i < 100; i++) text->data[i] = (byte) ('a' + i % 26);
+  obj_t *a = string_obj(text);
+
+  // Long substrings view the parent's bytes.
+  obj_t *tail = str_substring(a, wrap_varargs(2, int_obj(1), int_obj(100)));
+  TEST_ASSERT_EQUAL(99, tail->bytearray->size);
+  TEST_ASSERT_EQUAL_PTR(text, tail->bytearray->parent);
+  TEST_ASSERT_EQUAL_PTR(text->data + 1, tail->bytearray->data);
+
+  // A slice of a slice still points at the owner.
+  obj_t *tail2 = str_substring(tail, wrap_varargs(2, int_obj(1), int_obj(99)));
+  TEST_ASSERT_EQUAL_PTR(text, tail2->bytearray->parent);
+  TEST_ASSERT_EQUAL('c', tail2->bytearray->data[0]);
+
+  // Short ones are copied.
+  obj_t *word = str_substring(tail, wrap_varargs(2, int_obj(0), int_obj(3)));
+  TEST_ASSERT_NULL(word->bytearray->parent);
+  TEST_ASSERT_EQUAL_STRING("bcd", bytearray_to_c_str(word->bytearray));
+
+  // Writes to either side don't show through.
+  arr_set(tail, wrap_varargs(2, int_obj(0), byte_obj('X')));
+  TEST_ASSERT_EQUAL('b', text->data[1]);
+  arr_set(a, wrap_varargs(2, int_obj(2), byte_obj('Y')));
+  TEST_ASSERT_EQUAL('c', tail2->bytearray->data[0]);
+}
+
+void test_str_copy_on_write(void) {
+  obj_t *a = string_obj(c_str_to_bytearray("moo"));
+  obj_t *b = str_copy(a, NULL);
+  TEST_ASSERT_EQUAL_PTR(a->bytearray, b->bytearray);
+
+  arr_set(b, wrap_varargs(2, int_obj(2), byte_obj('p')));
+  TEST_ASSERT_NOT_EQUAL(a->bytearray, b->bytearray);
+  TEST_ASSERT_EQUAL_STRING("moo", bytearray_to_c_str(a->bytearray));
+  TEST_ASSERT_EQUAL_STRING("mop", bytearray_to_c_str(b->bytearray));
+
+  // b owns its copy now, so further writes happen in place.
+  bytearray_t *owned = b->bytearray;
+  arr_set(b, wrap_varargs(2, int_obj(0), byte_obj('b')));
+  TEST_ASSERT_EQUAL_PTR(owned, b->bytearray);
+  TEST_ASSERT_EQUAL_STRING("bop", bytearray_to_c_str(b->bytearray));
+}
+
+void test_str_add_extends_in_place(void) {
+  obj_t *a = string_obj(c_str_to_bytearray("The quick brown fox jumps over "));
+  obj_t *b = string_obj(c_str_to_bytearray("the lazy dog"));
+  obj_t *c = str_add(a, wrap_varargs(1, b));
+  bytearray_t *owner = c->bytearray->parent;
+  TEST_ASSERT_NOT_NULL(owner);
+
+  // c ends at the end of its owner, so d just writes past it.
+  obj_t *d = str_add(c, wrap_varargs(1, b));
+  TEST_ASSERT_EQUAL_PTR(owner, d->bytearray->parent);
+  TEST_ASSERT_EQUAL_PTR(c->bytearray->data, d->bytearray->data);
+  TEST_ASSERT_EQUAL(43, c->bytearray->size);
+  TEST_ASSERT_EQUAL(55, d->bytearray->size);
+
+  // c no longer ends there, so this one copies.
+  obj_t *e = str_add(c, wrap_varargs(1, a));
+  TEST_ASSERT_NOT_EQUAL(owner, e->bytearray->parent);
+  TEST_ASSERT_EQUAL_STRING("The quick brown fox jumps over the lazy dog",
+                           bytearray_to_c_str(c->bytearray));
+  TEST_ASSERT_EQUAL_STRING("The quick brown fox jumps over the lazy dogthe lazy dog",
+                           bytearray_to_c_str(d->bytearray));
+  TEST_ASSERT_EQUAL_STRING("The quick brown fox jumps over the lazy dogThe quick brown fox jumps over ",
+                           bytearray_to_c_str(e->bytearray));
+}
+
+void test_str_builder(void) {
+  obj_t *s = string_obj(c_str_to_bytearray("n="));
+  obj_t *b = str_builder(s, NULL);
+  builder_append(b, wrap_varargs(1, int_obj(42)));
+  obj_t *snapshot = builder_to_string(b, NULL);
+  builder_append(b, wrap_varargs(1, string_obj(c_str_to_bytearray("!"))));
+
+  TEST_ASSERT_EQUAL(TYPE_STRING_BUILDER, TYPEOF(b));
+  TEST_ASSERT_EQUAL_STRING("n=", bytearray_to_c_str(s->bytearray));
+  TEST_ASSERT_EQUAL_STRING("n=42!", bytearray_to_c_str(b->bytearray));
+  TEST_ASSERT_EQUAL_STRING("n=42", bytearray_to_c_str(snapshot->bytearray));
+  TEST_ASSERT_EQUAL(5, builder_len(b, NULL)->intval);
+}
+
+void test_str_add_leaves_operands(void) {
+  obj_t *a = string_obj(c_str_to_bytearray("foo"));
+  obj_t *b = string_obj(c_str_to_bytearray("bar"));
+  obj_t *c = str_add(a, wrap_varargs(1, b));
+  TEST_ASSERT_EQUAL_STRING("foobar", bytearray_to_c_str(c->bytearray));
+  TEST_ASSERT_EQUAL_STRING("foo", bytearray_to_c_str(a->bytearray));
+  TEST_ASSERT_EQUAL_STRING("bar", bytearray_to_c_str(b->bytearray));
+}
+
 void test_str(void) {
   RUN_TEST(test_c_str_len);
   RUN_TEST(test_c_str_eq);
@@ -176,4 +271,9 @@ void test_str(void) {
   RUN_TEST(test_str_eq);
   RUN_TEST(test_str_ne);
   RUN_TEST(test_str_substr);
+  RUN_TEST(test_str_substr_shares_parent);
+  RUN_TEST(test_str_copy_on_write);
+  RUN_TEST(test_str_add_leaves_operands);
+  RUN_TEST(test_str_add_extends_in_place);
+  RUN_TEST(test_str_builder);
 }
@@ -0,0 +1,122 @@
+#include "unity/unity.h"
+#include "test_vec.h"
+#include "../inc/type.h"
+#include "../inc/vec.h"
+
+// Long enough for the vector kernels, with a tail left over.
+#define N 37
+
+static obj_t *int_range(int n) {
+    return vec_of(TYPE_INT_ARRAY, range_obj(1, n));
+}
+
+static obj_t *float_range(int n) {
+    return vec_of(TYPE_FLOAT_ARRAY, range_obj(1, n));
+}
+
+void test_vec_of(void) {
+    obj_t *v = vec_obj(TYPE_INT_ARRAY, 3);
+    TEST_ASSERT_EQUAL(3, vec_len(v));
+    TEST_ASSERT_EQUAL(0, vec_get(v, wrap_varargs(1, int_obj(2)))->intval);
+
+    v = float_range(N);
+    TEST_ASSERT_EQUAL(TYPE_FLOAT_ARRAY, TYPEOF(v));
+    TEST_ASSERT_EQUAL(N, vec_len(v));
+    TEST_ASSERT_EQUAL_FLOAT(37.0f, vec_get(v, wrap_varargs(1, int_obj(36)))->floatval);
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(vec_get(v, wrap_varargs(1, int_obj(N)))));
+
+    // Made in one pass, so the elements got moved as the room grew.
+    v = int_range(N);
+    TEST_ASSERT_EQUAL(N, vec_len(v));
+    for (int i = 0; i < N; i++) TEST_ASSERT_EQUAL(i + 1, vec_get(v, wrap_varargs(1, int_obj(i)))->intval);
+
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(vec_of(TYPE_INT_ARRAY, int_obj(-1))));
+}
+
+void test_vec_set(void) {
+    obj_t *v = vec_obj(TYPE_INT_ARRAY, 2);
+    TEST_ASSERT_EQUAL(7, vec_set(v, wrap_varargs(2, int_obj(1), int_obj(7)))->intval);
+    TEST_ASSERT_EQUAL(7, vec_get(v, wrap_varargs(1, int_obj(1)))->intval);
+
+    // An Int Array doesn't silently truncate Floats.
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(vec_set(v, wrap_varargs(2, int_obj(0), float_obj(1.5f)))));
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(vec_set(v, wrap_varargs(2, int_obj(2), int_obj(1)))));
+}
+
+void test_vec_elementwise(void) {
+    obj_t *a = int_range(N);
+    obj_t *b = int_range(N);
+    obj_t *ops[] = {vec_add(a, wrap_varargs(1, b)),
+                    vec_sub(a, wrap_varargs(1, int_obj(1))),
+                    vec_mul(a, wrap_varargs(1, b)),
+                    vec_div(a, wrap_varargs(1, int_obj(2)))};
+    for (int i = 0; i < N; i++) {
+        obj_varargs_t *at = wrap_varargs(1, int_obj(i));
+        TEST_ASSERT_EQUAL(2 * (i + 1), vec_get(ops[0], at)->intval);
+        TEST_ASSERT_EQUAL(i, vec_get(ops[1], at)->intval);
+        TEST_ASSERT_EQUAL((i + 1) * (i + 1), vec_get(ops[2], at)->intval);
+        TEST_ASSERT_EQUAL((i + 1) / 2, vec_get(ops[3], at)->intval);
+    }
+
+    obj_t *f = float_range(N);
+    obj_t *g = vec_div(f, wrap_varargs(1, int_obj(4)));
+    obj_t *h = vec_sub(f, wrap_varargs(1, g));
+    for (int i = 0; i < N; i++) {
+        obj_varargs_t *at = wrap_varargs(1, int_obj(i));
+        TEST_ASSERT_EQUAL_FLOAT((float) (i + 1) * 0.75f, vec_get(h, at)->floatval);
+    }
+}
+
+void test_vec_elementwise_errors(void) {
+    obj_t *a = int_range(N);
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(vec_add(a, wrap_varargs(1, int_range(N - 1)))));
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(vec_add(a, wrap_varargs(1, float_range(N)))));
+    TEST_ASSERT_EQUAL(TYPE_ERROR, TYPEOF(vec_div(a, wrap_varargs(1, int_obj(0)))));
+    TEST_ASSERT_EQUAL(TYPE_ERROR, TYPEOF(vec_div(a, wrap_varargs(1, vec_obj(TYPE_INT_ARRAY, N)))));
+}
+
+void test_vec_reduce(void) {
+    obj_t *a = int_range(N);
+    TEST_ASSERT_EQUAL(N * (N + 1) / 2, vec_sum(a, NULL)->intval);
+    TEST_ASSERT_EQUAL(1, vec_min(a, NULL)->intval);
+    TEST_ASSERT_EQUAL(N, vec_max(a, NULL)->intval);
+    TEST_ASSERT_EQUAL(N * (N + 1) * (2 * N + 1) / 6, vec_dot(a, wrap_varargs(1, a))->intval);
+
+    // Extremes in the tail and in the middle of a vector.
+    obj_t *b = vec_sub(a, wrap_varargs(1, int_obj(20)));
+    vec_set(b, wrap_varargs(2, int_obj(N - 1), int_obj(-100)));
+    vec_set(b, wrap_varargs(2, int_obj(5), int_obj(100)));
+    TEST_ASSERT_EQUAL(-100, vec_min(b, NULL)->intval);
+    TEST_ASSERT_EQUAL(100, vec_max(b, NULL)->intval);
+
+    obj_t *f = float_range(N);
+    TEST_ASSERT_EQUAL_FLOAT((float) (N * (N + 1) / 2), vec_sum(f, NULL)->floatval);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, vec_min(f, NULL)->floatval);
+    TEST_ASSERT_EQUAL_FLOAT((float) N, vec_max(f, NULL)->floatval);
+    TEST_ASSERT_EQUAL_FLOAT((float) (N * (N + 1) * (2 * N + 1) / 6), vec_dot(f, wrap_varargs(1, f))->floatval);
+
+    obj_t *empty = vec_obj(TYPE_FLOAT_ARRAY, 0);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, vec_sum(empty, NULL)->floatval);
+    TEST_ASSERT_EQUAL(TYPE_NIL, TYPEOF(vec_min(empty, NULL)));
+}
+
+void test_vec_map(void) {
+    obj_t *a = vec_mul(int_range(N), wrap_varargs(1, int_range(N)));
+    obj_t *r = vec_map(a, MATH_SQRT);
+    TEST_ASSERT_EQUAL(TYPE_FLOAT_ARRAY, TYPEOF(r));
+    for (int i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_FLOAT((float) (i + 1), vec_get(r, wrap_varargs(1, int_obj(i)))->floatval);
+    }
+
+    r = vec_map(vec_obj(TYPE_FLOAT_ARRAY, N), MATH_EXP);
+    TEST_ASSERT_EQUAL_FLOAT(N, vec_sum(r, NULL)->floatval);
+}
+
+void test_vec(void) {
+    RUN_TEST(test_vec_of);
+    RUN_TEST(test_vec_set);
+    RUN_TEST(test_vec_elementwise);
+    RUN_TEST(test_vec_elementwise_errors);
+    RUN_TEST(test_vec_reduce);
+    RUN_TEST(test_vec_map);
+}
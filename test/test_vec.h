@@ -0,0 +1,6 @@
+#ifndef __TEST_VEC_H
+#define __TEST_VEC_H
+
+void test_vec(void);
+
+#endif
@@ -4,6 +4,9 @@
 #include "../inc/ptr.h"
 #include "../inc/str.h"
 #include "../inc/mem.h"
+#include "../inc/opt.h"
+
+static int opt_level = OPT_DEFAULT_LEVEL;
 
 obj_varargs_t *n_args(int n, ...) {
     va_list vargs;
@@ -60,9 +63,14 @@ obj_t *make_list(int n_elems, ...) {
     return list_obj(root_elem);
 }
 
+void eval_opt_level(int level) {
+    opt_level = level;
+}
+
 void eval_program(const char *program, eval_result_t *result) {
     interp_t interp;
     interp_init(&interp);
+    interp.opt_level = opt_level;
 
     // Move input to ethel's memory.
     size_t len = c_str_len(program) + 1;
@@ -8,6 +8,9 @@ obj_varargs_t *n_args(int n, ...);
 
 obj_t *make_list(int n_elems, ...);
 
+/* Run eval_program() at this optimization level from now on. */
+void eval_opt_level(int level);
+
 void eval_program(const char *program, eval_result_t *result);
 
 #endif